@@ -0,0 +1,73 @@
+/*
+ * Heap allocations per request against a loopback server, with and
+ * without a per-exchange arena. Only the threads of the client side are
+ * counted: the caller and the thread running the client's io_service.
+ * Expect about 11 per request without the arena and 8 with it.
+ * Usage: arena_bench [requests] [arena size]
+ */
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <boost/asio/io_service.hpp>
+#include <network/http/client.hpp>
+#include "loopback_server.hpp"
+#include "counting_allocator.hpp"
+
+namespace {
+    using network::bench::allocations;
+    using network::bench::counting_scope;
+
+    void run(std::size_t arena_size, std::size_t requests) {
+        using namespace network::http;
+
+        network::bench::loopback_server server(256);
+        boost::asio::io_service io_service;
+        std::unique_ptr<boost::asio::io_service::work> work(new boost::asio::io_service::work(io_service));
+        std::thread io_thread([&io_service] () {
+                counting_scope scope;
+                io_service.run();
+            });
+
+        {
+            client c(client_options()
+                .io_service(io_service)
+                .exchange_arena_size(arena_size));
+            network::uri url(server.url());
+
+            /* warm up the connection pool and asio's handler caches */
+            c.get(request(url)).get();
+
+            counting_scope scope;
+            std::uint64_t before = allocations();
+            auto start = std::chrono::steady_clock::now();
+            for (std::size_t i = 0; i < requests; ++i) {
+                auto r = c.get(request(url)).get();
+                if (r.body().size() != 256) {
+                    std::cerr << "unexpected body size " << r.body().size() << std::endl;
+                    std::exit(1);
+                }
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::uint64_t count = allocations() - before;
+
+            std::cout << (arena_size ? "arena     " : "heap      ")
+                      << static_cast<double>(count) / requests << " allocations/request, "
+                      << requests / elapsed.count() << " req/s" << std::endl;
+        }
+
+        work.reset();
+        io_thread.join();
+    }
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::size_t requests = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    std::size_t arena_size = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 8192;
+
+    network::bench::measuring() = true;
+    run(0, requests);
+    run(arena_size, requests);
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+/*
+ * Requests/sec against a loopback server with `window` requests kept
+ * outstanding, waited for on std::futures in order, and completed into
+ * callbacks given to async_get(), which start the next request.
+ * Usage: async_bench [requests] [window]
+ */
+#include <iostream>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <cstdlib>
+#include <network/http/client.hpp>
+#include "loopback_server.hpp"
+
+namespace {
+    using namespace network::http;
+
+    double run_futures(std::size_t requests, std::size_t window) {
+        network::bench::loopback_server server;
+        client c(client_options().max_connections_per_host(window));
+        network::uri url(server.url());
+
+        auto start = std::chrono::steady_clock::now();
+        std::deque<std::future<response> > inflight;
+        for (std::size_t sent = 0; sent < requests || !inflight.empty(); ) {
+            while (sent < requests && inflight.size() < window) {
+                inflight.push_back(c.get(request(url)));
+                ++sent;
+            }
+            inflight.front().get();
+            inflight.pop_front();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << "futures   " << requests / elapsed.count() << " req/s" << std::endl;
+        return requests / elapsed.count();
+    }
+
+    struct callback_run {
+        callback_run(client &c, const network::uri &url, std::size_t requests) :
+            c(c), url(url), to_send(requests), to_complete(requests) { }
+
+        void send() {
+            if (to_send.fetch_sub(1) <= 0) {
+                return;
+            }
+            c.async_get(request(url), [this] (std::exception_ptr, response) {
+                    send();
+                    if (--to_complete == 0) {
+                        done.set_value();
+                    }
+                });
+        }
+
+        client &c;
+        network::uri url;
+        std::atomic<std::ptrdiff_t> to_send;
+        std::atomic<std::size_t> to_complete;
+        std::promise<void> done;
+    };
+
+    double run_callbacks(std::size_t requests, std::size_t window) {
+        network::bench::loopback_server server;
+        client c(client_options().max_connections_per_host(window));
+        callback_run r(c, network::uri(server.url()), requests);
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < window; ++i) {
+            r.send();
+        }
+        r.done.get_future().wait();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << "callbacks " << requests / elapsed.count() << " req/s" << std::endl;
+        return requests / elapsed.count();
+    }
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::size_t requests = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    std::size_t window = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 8;
+
+    double futures = run_futures(requests, window);
+    double callbacks = run_callbacks(requests, window);
+    std::cout << "speedup   " << callbacks / futures << "x" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * Requests/sec for a GET of a 16KB body without a response cache, answered
+ * from the cache while fresh (max-age=3600), and revalidated on every
+ * request (no-cache, answered 304 Not Modified), with the requests the
+ * server answered, the bytes it sent per request and the connections it
+ * accepted.
+ * Usage: cache_bench [requests]
+ */
+#include <iostream>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <network/http/client.hpp>
+#include "loopback_server.hpp"
+
+namespace {
+    using namespace network::http;
+
+    void run(const char *label, const char *cache_control, bool cached, std::size_t requests) {
+        network::bench::loopback_server server(16 * 1024);
+        server.cache_control(cache_control);
+        auto cache = std::make_shared<client_message::response_cache>();
+        client_options options;
+        if (cached) {
+            options.response_cache(cache);
+        }
+        client c(options);
+        network::uri url(server.url());
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < requests; ++i) {
+            auto r = c.get(request(url)).get();
+            if (r.status() != status::ok || r.body().size() != 16 * 1024) {
+                std::cerr << label << ": unexpected response " << static_cast<int>(r.status()) << std::endl;
+                std::exit(1);
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        auto stats = cache->statistics();
+        std::cout << label << requests / elapsed.count() << " req/s, "
+                  << static_cast<double>(server.requests()) / requests << " server requests/request, "
+                  << server.bytes_sent() / requests << " bytes/request, "
+                  << stats.hits << " hits, " << stats.revalidated << " revalidated, " << server.accepted() << " connections" << std::endl;
+    }
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::size_t requests = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+
+    run("no cache    ", "max-age=3600", false, requests);
+    run("fresh       ", "max-age=3600", true, requests);
+    run("revalidated ", "no-cache", true, requests);
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+#ifndef NETWORK_BENCH_COUNTING_ALLOCATOR_HPP
+#define NETWORK_BENCH_COUNTING_ALLOCATOR_HPP
+
+/*
+ * Replaces the global operator new and delete, every form but the aligned
+ * ones, with malloc and free, counting the allocations made by threads
+ * that opted in while measuring is set. Include it in the one file of a
+ * benchmark that defines main.
+ */
+#include <new>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+
+namespace network {
+    namespace bench {
+        inline std::atomic<std::uint64_t> &allocations() {
+            static std::atomic<std::uint64_t> count(0);
+            return count;
+        }
+
+        inline std::atomic<bool> &measuring() {
+            static std::atomic<bool> on(false);
+            return on;
+        }
+
+        /* whether this thread's allocations are counted */
+        inline bool &counted() {
+            static thread_local bool on = false;
+            return on;
+        }
+
+        /* counts the allocations of the thread it lives on */
+        struct counting_scope {
+            counting_scope() { counted() = true; }
+            ~counting_scope() { counted() = false; }
+        };
+
+        namespace detail {
+            /*
+             * Out of line so that GCC does not inline free() into code
+             * that got its pointer from operator new and warn
+             * (-Wmismatched-new-delete).
+             */
+            __attribute__((noinline)) inline void *counted_malloc(std::size_t size) noexcept {
+                if (counted() && measuring().load(std::memory_order_relaxed)) {
+                    allocations().fetch_add(1, std::memory_order_relaxed);
+                }
+                return std::malloc(size ? size : 1);
+            }
+
+            __attribute__((noinline)) inline void counted_free(void *p) noexcept {
+                std::free(p);
+            }
+
+            inline void *counted_new(std::size_t size) {
+                if (void *p = counted_malloc(size)) {
+                    return p;
+                }
+                throw std::bad_alloc();
+            }
+        } // namespace detail
+    } // namespace bench
+} // namespace network
+
+void *operator new(std::size_t size) {
+    return network::bench::detail::counted_new(size);
+}
+
+void *operator new[](std::size_t size) {
+    return network::bench::detail::counted_new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    return network::bench::detail::counted_malloc(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return network::bench::detail::counted_malloc(size);
+}
+
+void operator delete(void *p) noexcept {
+    network::bench::detail::counted_free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    network::bench::detail::counted_free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    network::bench::detail::counted_free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+    network::bench::detail::counted_free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+    network::bench::detail::counted_free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+    network::bench::detail::counted_free(p);
+}
+
+#endif // NETWORK_BENCH_COUNTING_ALLOCATOR_HPP
@@ -0,0 +1,93 @@
+/*
+ * Bytes on the wire, requests/sec and process CPU time per request for a
+ * compressible JSON body fetched as sent, gzip-encoded and br-encoded,
+ * decoded by the client as it arrives. Build with NETLIBX_ENABLE_ZLIB and
+ * NETLIBX_ENABLE_BROTLI, linking zlib and brotli's encoder and decoder.
+ * Usage: decompress_bench [requests] [body_size]
+ */
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ctime>
+#include <cstdlib>
+#include <zlib.h>
+#include <brotli/encode.h>
+#include <network/http/client.hpp>
+#include "loopback_server.hpp"
+
+namespace {
+    using namespace network::http;
+
+    std::string json_body(std::size_t size) {
+        std::string body = "[";
+        for (std::size_t i = 0; body.size() < size; ++i) {
+            body += (i ? "," : "") + std::string("{\"id\":") + std::to_string(i) +
+                ",\"name\":\"item " + std::to_string(i % 97) +
+                "\",\"tags\":[\"alpha\",\"beta\"],\"price\":" + std::to_string(i % 1000) + ".99}";
+        }
+        return body + "]";
+    }
+
+    std::string gzip(const std::string &in) {
+        z_stream s{};
+        deflateInit2(&s, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+        std::string out(deflateBound(&s, in.size()), '\0');
+        s.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in.data()));
+        s.avail_in = static_cast<uInt>(in.size());
+        s.next_out = reinterpret_cast<Bytef *>(&out[0]);
+        s.avail_out = static_cast<uInt>(out.size());
+        deflate(&s, Z_FINISH);
+        out.resize(s.total_out);
+        deflateEnd(&s);
+        return out;
+    }
+
+    std::string brotli(const std::string &in) {
+        std::size_t size = BrotliEncoderMaxCompressedSize(in.size());
+        std::string out(size, '\0');
+        BrotliEncoderCompress(BROTLI_DEFAULT_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT,
+            in.size(), reinterpret_cast<const std::uint8_t *>(in.data()),
+            &size, reinterpret_cast<std::uint8_t *>(&out[0]));
+        out.resize(size);
+        return out;
+    }
+
+    void run(const char *label, const std::string &body, const std::string &encoding,
+        const std::string &encoded, std::size_t requests) {
+        network::bench::loopback_server server;
+        server.body(body);
+        if (!encoding.empty()) {
+            server.encoded_body(encoding, encoded);
+        }
+        client c(client_options().decompress(!encoding.empty()));
+        network::uri url(server.url());
+
+        std::clock_t cpu = std::clock();
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < requests; ++i) {
+            if (c.get(request(url)).get().body().size() != body.size()) {
+                std::cerr << label << ": body not decoded" << std::endl;
+                std::exit(1);
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        double cpu_us = 1e6 * (std::clock() - cpu) / CLOCKS_PER_SEC / requests;
+
+        std::cout << label << server.bytes_sent() / requests << " bytes/response, "
+                  << requests / elapsed.count() << " req/s, "
+                  << cpu_us << " us CPU/request" << std::endl;
+    }
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::size_t requests = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+    std::size_t body_size = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 256 * 1024;
+
+    std::string body = json_body(body_size);
+    run("identity ", body, "", "", requests);
+    run("gzip     ", body, "gzip", gzip(body), requests);
+    run("br       ", body, "br", brotli(body), requests);
+
+    return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * header_map against the vector<pair<string, string> > + boost::iequals
+ * scan it replaced: filling a typical response's headers, then the
+ * lookups the client does per response. Usage: header_map_bench [iterations]
+ */
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <boost/algorithm/string/predicate.hpp>
+#include <network/http/header_map.hpp>
+
+namespace {
+    const std::pair<const char *, const char *> fields[] = {
+        { "Date", "Mon, 12 Oct 2026 10:00:00 GMT" },
+        { "Server", "nginx/1.25.3" },
+        { "Content-Type", "text/html; charset=utf-8" },
+        { "Cache-Control", "private, max-age=0, must-revalidate" },
+        { "ETag", "\"5f8d0d55-1a2b3c\"" },
+        { "Last-Modified", "Sun, 11 Oct 2026 09:00:00 GMT" },
+        { "Vary", "Accept-Encoding, Cookie" },
+        { "Set-Cookie", "session=0123456789abcdef0123456789abcdef; Path=/; HttpOnly" },
+        { "Set-Cookie", "tracking=fedcba9876543210; Path=/; Max-Age=31536000" },
+        { "X-Request-Id", "7b0c6f0e-6a3c-4c1b-9a55-3f1c2d4e5f60" },
+        { "Connection", "keep-alive" },
+        { "Content-Length", "512" },
+    };
+
+    const char *lookups[] = {
+        "content-length", "Transfer-Encoding", "Connection", "Content-Encoding",
+        "Location", "ETag", "x-request-id", "X-Missing",
+    };
+
+    typedef std::vector<std::pair<std::string, std::string> > vector_headers;
+
+    std::size_t vector_round() {
+        vector_headers headers;
+        for (const auto &f : fields) {
+            headers.push_back(std::make_pair(std::string(f.first), std::string(f.second)));
+        }
+        std::size_t found = 0;
+        for (const char *name : lookups) {
+            for (auto hdr : headers) {
+                if (boost::iequals(hdr.first, name)) {
+                    found += hdr.second.size();
+                    break;
+                }
+            }
+        }
+        return found;
+    }
+
+    std::size_t map_round() {
+        network::http::header_map headers;
+        for (const auto &f : fields) {
+            headers.append(f.first, f.second);
+        }
+        std::size_t found = 0;
+        for (const char *name : lookups) {
+            if (auto value = headers.find(name)) {
+                found += value->size();
+            }
+        }
+        return found;
+    }
+
+    template <class Round>
+        void run(const char *label, Round round, std::size_t iterations) {
+            std::size_t sink = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (std::size_t i = 0; i < iterations; ++i) {
+                sink += round();
+            }
+            std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << label << elapsed.count() / iterations << " ns/response (" << sink / iterations << ")" << std::endl;
+        }
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 500000;
+
+    run("vector      ", vector_round, iterations);
+    run("header_map  ", map_round, iterations);
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+/*
+ * Cost of recording request phases: requests/sec with record_latency off
+ * and on, over one keep-alive connection and over 64 concurrent requests
+ * on 4 threads, best of 5 runs each, then the percentiles recorded and the
+ * size of the Prometheus text for them. Last, what the client does per
+ * request to record, alone: the host lookup, a clock read and a sample for
+ * each phase of a request on a kept-alive connection.
+ * Usage: latency_bench [requests]
+ */
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <future>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <network/http/client.hpp>
+#include "loopback_server.hpp"
+
+namespace {
+    using namespace network::http;
+    using client_message::latency_phase;
+
+    double run(network::bench::loopback_server &server, bool record, std::size_t threads,
+        std::size_t concurrency, std::size_t requests, client_message::latency_snapshot *snapshot) {
+        /* enough idle connections kept for every request in flight */
+        client c(client_options().record_latency(record).io_threads(threads)
+            .max_connections_per_host(concurrency).max_idle_connections_per_host(concurrency));
+        network::uri url(server.url());
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::future<response> > in_flight;
+        for (std::size_t i = 0; i < requests; ++i) {
+            in_flight.push_back(c.get(request(url)));
+            if (in_flight.size() == concurrency) {
+                for (auto &f : in_flight) {
+                    f.get();
+                }
+                in_flight.clear();
+            }
+        }
+        for (auto &f : in_flight) {
+            f.get();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        if (snapshot) {
+            *snapshot = c.latency();
+        }
+        return requests / elapsed.count();
+    }
+
+    void compare(const char *label, std::size_t threads, std::size_t concurrency, std::size_t requests) {
+        network::bench::loopback_server server(64, threads);
+        double off = 0, on = 0;
+        client_message::latency_snapshot snapshot;
+        for (int i = 0; i < 5; ++i) {
+            off = std::max(off, run(server, false, threads, concurrency, requests, nullptr));
+            on = std::max(on, run(server, true, threads, concurrency, requests, &snapshot));
+        }
+
+        std::cout << label << std::fixed << std::setprecision(0) << off << " req/s off, " << on << " req/s on, "
+                  << std::setprecision(2) << (off - on) / off * 100 << "% overhead" << std::endl;
+        for (std::size_t i = 0; i < client_message::latency_phase_count; ++i) {
+            const auto &d = snapshot.overall[i];
+            if (d.count == 0) {
+                continue;
+            }
+            std::cout << "    " << std::left << std::setw(14) << client_message::latency_phase_name(static_cast<latency_phase>(i))
+                      << std::right << std::setw(8) << d.count << " samples, p50 " << std::setw(6) << d.percentile(50)
+                      << " us, p99 " << std::setw(6) << d.percentile(99) << " us, max " << std::setw(6) << d.max << " us"
+                      << std::endl;
+        }
+        std::cout << "    prometheus text: " << client_message::prometheus_text(snapshot).size() << " bytes" << std::endl;
+    }
+
+    void recording_alone(std::size_t requests) {
+        client_message::latency_recorder recorder;
+        const latency_phase phases[] = { latency_phase::pool_wait, latency_phase::request_write,
+            latency_phase::first_byte, latency_phase::body, latency_phase::total };
+        std::string host("127.0.0.1");
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < requests; ++i) {
+            auto h = recorder.host(host, 80);
+            auto mark = std::chrono::steady_clock::now();
+            for (auto phase : phases) {
+                auto now = std::chrono::steady_clock::now();
+                h->record(phase, now - mark);
+                mark = now;
+            }
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "recording alone    " << std::setprecision(0) << elapsed.count() / requests
+                  << " ns/request" << std::endl;
+    }
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::size_t requests = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+
+    compare("sequential         ", 1, 1, requests);
+    compare("64 on 4 threads    ", 4, 64, requests * 4);
+    recording_alone(requests * 50);
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * The client under load against a loopback server: small and large
+ * bodies, keep-alive and a new connection per request, http and, built
+ * with NETLIBX_ENABLE_HTTPS, https, at 1, 16 and 64 requests in flight.
+ * For each, requests/sec, throughput, latency percentiles and errors from
+ * a load_generator run, and the heap allocations per request made by the
+ * client's side: the caller and the thread running the client's
+ * io_service, through operator new, so not OpenSSL's own. Each run
+ * follows a warm-up of a fifth of its length. Only runs whose name
+ * contains `filter` are done, e.g. "https keep-alive".
+ * Usage: load_bench [seconds per run] [filter]
+ */
+#include <chrono>
+#include <string>
+#include <thread>
+#include <memory>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <boost/asio/io_service.hpp>
+#include <network/http/client.hpp>
+#include "loopback_server.hpp"
+#include "load_generator.hpp"
+#include "counting_allocator.hpp"
+
+namespace {
+    using namespace network::http;
+
+    using network::bench::allocations;
+    using network::bench::measuring;
+    using network::bench::counting_scope;
+
+    struct scenario {
+        bool https;
+        bool keep_alive;
+        std::size_t body_size;
+        std::size_t concurrency;
+    };
+
+    std::string name_of(const scenario &s) {
+        return std::string(s.https ? "https " : "http  ") + (s.keep_alive ? "keep-alive " : "close      ") +
+            (s.body_size >= 1024 ? std::to_string(s.body_size / 1024) + "KiB" : std::to_string(s.body_size) + "B") +
+            " c" + std::to_string(s.concurrency);
+    }
+
+    std::unique_ptr<network::bench::loopback_server> server_for(const scenario &s) {
+#if defined(NETLIBX_ENABLE_HTTPS)
+        if (s.https) {
+            return std::unique_ptr<network::bench::loopback_server>(
+                new network::bench::loopback_server(network::bench::self_signed_context(), s.body_size));
+        }
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+        return std::unique_ptr<network::bench::loopback_server>(new network::bench::loopback_server(s.body_size));
+    }
+
+    void run(const scenario &s, std::chrono::milliseconds duration) {
+        auto server = server_for(s);
+        boost::asio::io_service io_service;
+        std::unique_ptr<boost::asio::io_service::work> work(new boost::asio::io_service::work(io_service));
+        std::thread io_thread([&io_service] () {
+                counting_scope scope;
+                io_service.run();
+            });
+
+        network::bench::load_result result;
+        std::uint64_t count = 0;
+        {
+            client_options options;
+            options.io_service(io_service).keep_alive(s.keep_alive)
+                .max_connections_per_host(s.concurrency).max_idle_connections_per_host(s.concurrency);
+#if defined(NETLIBX_ENABLE_HTTPS)
+            /* the server's certificate is self-signed */
+            options.tls_context(std::make_shared<client_connection::tls_context>(
+                    std::vector<std::string>(), std::vector<std::string>(), false));
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+            client c(options);
+            network::bench::load_generator generator(c, network::uri(server->url()), s.concurrency);
+
+            generator.run(duration / 5);
+            counting_scope scope;
+            std::uint64_t before = allocations();
+            measuring() = true;
+            result = generator.run(duration);
+            measuring() = false;
+            count = allocations() - before;
+        }
+
+        work.reset();
+        io_thread.join();
+
+        const auto &latency = result.latency;
+        std::cout << std::left << std::setw(28) << name_of(s) << std::right << std::fixed
+                  << std::setprecision(0) << std::setw(9) << result.requests_per_second()
+                  << std::setprecision(1) << std::setw(9) << result.megabytes_per_second()
+                  << std::setw(8) << latency.percentile(50) << std::setw(8) << latency.percentile(90)
+                  << std::setw(8) << latency.percentile(99) << std::setw(8) << latency.percentile(99.9)
+                  << std::setw(9) << latency.max
+                  << std::setprecision(1) << std::setw(10)
+                  << (result.requests ? static_cast<double>(count) / result.requests : 0.0)
+                  << std::setw(8) << result.errors << std::endl;
+    }
+} // namespace
+
+int main(int argc, char *argv[]) {
+    double seconds = argc > 1 ? std::strtod(argv[1], nullptr) : 1.0;
+    std::string filter = argc > 2 ? argv[2] : "";
+    std::chrono::milliseconds duration(static_cast<long>(seconds * 1000));
+
+    std::cout << std::left << std::setw(28) << "run" << std::right << std::setw(9) << "req/s" << std::setw(9) << "MiB/s"
+              << std::setw(8) << "p50 us" << std::setw(8) << "p90" << std::setw(8) << "p99" << std::setw(8) << "p99.9"
+              << std::setw(9) << "max" << std::setw(10) << "allocs/rq" << std::setw(8) << "errors" << std::endl;
+
+#if defined(NETLIBX_ENABLE_HTTPS)
+    const bool schemes[] = { false, true };
+#else
+    const bool schemes[] = { false };
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+    for (bool https : schemes) {
+        for (bool keep_alive : { true, false }) {
+            for (std::size_t body_size : { std::size_t(64), std::size_t(64 * 1024) }) {
+                for (std::size_t concurrency : { 1, 16, 64 }) {
+                    scenario s = { https, keep_alive, body_size, concurrency };
+                    if (name_of(s).find(filter) != std::string::npos) {
+                        run(s, duration);
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
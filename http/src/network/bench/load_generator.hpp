@@ -0,0 +1,120 @@
+#ifndef NETWORK_BENCH_LOAD_GENERATOR_HPP
+#define NETWORK_BENCH_LOAD_GENERATOR_HPP
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <exception>
+#include <condition_variable>
+#include <network/http/client.hpp>
+
+namespace network {
+    namespace bench {
+        /* what a load_generator run did, latencies in microseconds */
+        struct load_result {
+            load_result() : requests(0), errors(0), bytes(0), seconds(0) { }
+
+            double requests_per_second() const {
+                return seconds > 0 ? requests / seconds : 0.0;
+            }
+
+            double megabytes_per_second() const {
+                return seconds > 0 ? bytes / seconds / (1024 * 1024) : 0.0;
+            }
+
+            std::uint64_t requests;
+            std::uint64_t errors;
+            std::uint64_t bytes;
+            double seconds;
+            http::client_message::latency_distribution latency;
+        };
+
+        /*
+         * class load_generator
+         *
+         * Load in the manner of wrk: `concurrency` requests are kept in
+         * flight on a client, each started again from the callback of the
+         * one before it, until `duration` has passed. A request answered
+         * with anything but 200 or failing counts as an error. Latencies
+         * are those seen by the caller, from async_get() to its callback,
+         * in a latency_histogram.
+         */
+        class load_generator {
+            load_generator(const load_generator &) = delete;
+            load_generator &operator = (const load_generator &) = delete;
+
+        public:
+            load_generator(http::client &client, network::uri url, std::size_t concurrency) :
+                _client(client),
+                _url(std::move(url)),
+                _concurrency(concurrency ? concurrency : 1) { }
+
+            load_result run(std::chrono::steady_clock::duration duration) {
+                run_state state;
+                state.deadline = std::chrono::steady_clock::now() + duration;
+                state.running = _concurrency;
+
+                auto start = std::chrono::steady_clock::now();
+                for (std::size_t i = 0; i < _concurrency; ++i) {
+                    send(state);
+                }
+                {
+                    std::unique_lock<std::mutex> lock(state.mutex);
+                    state.done.wait(lock, [&state] () { return state.running == 0; });
+                }
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+                load_result result;
+                result.requests = state.requests;
+                result.errors = state.errors;
+                result.bytes = state.bytes;
+                result.seconds = elapsed.count();
+                state.latency.add_to(result.latency);
+                return result;
+            }
+
+        private:
+            struct run_state {
+                std::chrono::steady_clock::time_point deadline;
+                std::atomic<std::uint64_t> requests{0};
+                std::atomic<std::uint64_t> errors{0};
+                std::atomic<std::uint64_t> bytes{0};
+                http::client_message::latency_histogram latency;
+                std::mutex mutex;
+                std::condition_variable done;
+                std::size_t running;
+            };
+
+            void send(run_state &state) {
+                auto sent = std::chrono::steady_clock::now();
+                if (sent >= state.deadline) {
+                    std::lock_guard<std::mutex> lock(state.mutex);
+                    if (--state.running == 0) {
+                        state.done.notify_one();
+                    }
+                    return;
+                }
+                _client.async_get(http::request(_url), [this, &state, sent] (std::exception_ptr error, http::response r) {
+                        state.latency.record(std::chrono::steady_clock::now() - sent);
+                        ++state.requests;
+                        if (error || r.status() != http::status::ok) {
+                            ++state.errors;
+                        } else {
+                            state.bytes += r.body().size();
+                        }
+                        send(state);
+                    });
+            }
+
+            http::client &_client;
+            network::uri _url;
+            std::size_t _concurrency;
+        };
+    } // namespace bench
+} // namespace network
+
+#endif // NETWORK_BENCH_LOAD_GENERATOR_HPP
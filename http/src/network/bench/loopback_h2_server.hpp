@@ -0,0 +1,732 @@
+#ifndef NETWORK_BENCH_LOOPBACK_H2_SERVER_HPP
+#define NETWORK_BENCH_LOOPBACK_H2_SERVER_HPP
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <boost/asio.hpp>
+#if defined(NETLIBX_ENABLE_HTTPS)
+#include <boost/asio/ssl.hpp>
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+#include <network/http/http2/frame.hpp>
+#include <network/http/http2/hpack.hpp>
+
+namespace network {
+    namespace bench {
+        /*
+         * class loopback_h2_server
+         *
+         * HTTP/2 server on 127.0.0.1 for the benchmarks and tests: h2c with
+         * prior knowledge, or h2 over TLS when ALPN offers it. A request is
+         * handed to the handler once its stream is half closed, on the
+         * server's one thread; by default it is answered with 200 and a
+         * fixed body. Handlers answer through the connection, which can
+         * also send what a test needs the server to get wrong or refuse:
+         * RST_STREAM, GOAWAY, new SETTINGS or raw bytes. Response bodies are
+         * sent within the client's flow control windows, request bodies are
+         * granted their window back as they arrive.
+         */
+        class loopback_h2_server {
+            loopback_h2_server(const loopback_h2_server &) = delete;
+            loopback_h2_server &operator = (const loopback_h2_server &) = delete;
+
+        public:
+            typedef std::vector<std::pair<std::string, std::string> > fields;
+            typedef std::vector<std::pair<http::http2::setting, std::uint32_t> > settings_list;
+
+            struct stream_request {
+                std::uint32_t id;
+                fields headers;
+                std::string body;
+
+                /* the value of the first field called name, "" without one */
+                std::string header(const std::string &name) const {
+                    for (const auto &f : headers) {
+                        if (f.first == name) {
+                            return f.second;
+                        }
+                    }
+                    return std::string();
+                }
+            };
+
+            struct statistics {
+                std::uint64_t connections;
+                std::uint64_t requests;
+                /* most streams open at once on one connection */
+                std::size_t max_open_streams;
+                std::uint64_t stream_window_updates;
+                std::uint64_t connection_window_updates;
+                /* DATA payload bytes */
+                std::uint64_t data_sent;
+                std::uint64_t data_received;
+                /* RST_STREAM received: stream and error code */
+                std::vector<std::pair<std::uint32_t, std::uint32_t> > resets;
+                /* error codes of the GOAWAY frames received */
+                std::vector<std::uint32_t> goaways;
+                /* the client's last SETTINGS_INITIAL_WINDOW_SIZE */
+                std::uint32_t client_initial_window;
+            };
+
+            class connection;
+            typedef std::function<void (connection &, const stream_request &)> request_handler;
+
+            explicit loopback_h2_server(std::size_t body_size = 64) :
+                _acceptor(_io_service, boost::asio::ip::tcp::endpoint(
+                        boost::asio::ip::address_v4::loopback(), 0)),
+                _body(body_size, 'x'),
+                _statistics() {
+                start();
+            }
+
+#if defined(NETLIBX_ENABLE_HTTPS)
+            /* selects "h2" with ALPN when the client offers it, and answers nothing else */
+            loopback_h2_server(std::shared_ptr<boost::asio::ssl::context> context, std::size_t body_size = 64) :
+                _acceptor(_io_service, boost::asio::ip::tcp::endpoint(
+                        boost::asio::ip::address_v4::loopback(), 0)),
+                _tls(std::move(context)),
+                _body(body_size, 'x'),
+                _statistics() {
+                SSL_CTX_set_alpn_select_cb(_tls->native_handle(), &loopback_h2_server::select_h2, nullptr);
+                start();
+            }
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+
+            ~loopback_h2_server() {
+                _io_service.stop();
+                _thread.join();
+            }
+
+            std::uint16_t port() const {
+                return _acceptor.local_endpoint().port();
+            }
+
+            std::string url(const std::string &path = "/") const {
+                return std::string(tls() ? "https" : "http") + "://127.0.0.1:" + std::to_string(port()) + path;
+            }
+
+            /* set before the first request */
+            void handler(request_handler handler) {
+                _handler = std::move(handler);
+            }
+
+            void body(std::string body) {
+                _body = std::move(body);
+            }
+
+            /* sent in the server's first SETTINGS frame, set before the first connection */
+            void settings(settings_list settings) {
+                _settings = std::move(settings);
+            }
+
+            /* runs f on the server's thread */
+            void post(std::function<void ()> f) {
+                _io_service.post(std::move(f));
+            }
+
+            struct statistics statistics() const {
+                std::lock_guard<std::mutex> lock(_mutex);
+                return _statistics;
+            }
+
+            bool tls() const {
+#if defined(NETLIBX_ENABLE_HTTPS)
+                return _tls != nullptr;
+#else
+                return false;
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+            }
+
+            /*
+             * class connection
+             *
+             * One client connection; its functions are called on the
+             * server's thread, from a handler or something posted.
+             */
+            class connection : public std::enable_shared_from_this<connection> {
+                connection(const connection &) = delete;
+                connection &operator = (const connection &) = delete;
+
+            public:
+                connection(boost::asio::io_service &io_service, loopback_h2_server &server, std::uint64_t index) :
+                    _socket(io_service),
+                    _server(server),
+                    _index(index),
+                    _preface(false),
+                    _closed(false),
+                    _writing(false),
+                    _send_window(http::http2::default_window_size),
+                    _peer_initial_window(http::http2::default_window_size),
+                    _peer_max_frame_size(http::http2::default_max_frame_size),
+                    _block_stream(0),
+                    _block_end_stream(false),
+                    _open(0) { }
+
+                /* 1 for the server's first connection, 2 for the next... */
+                std::uint64_t index() const {
+                    return _index;
+                }
+
+                /* streams whose request arrived and whose response is not complete */
+                std::size_t open_streams() const {
+                    return _open;
+                }
+
+                /* HEADERS, then the body if any and trailers if any; Content-Length without trailers */
+                void respond(std::uint32_t id, int status, const std::string &body,
+                    fields headers = fields(), const fields &trailers = fields()) {
+                    headers.insert(headers.begin(), std::make_pair(std::string(":status"), std::to_string(status)));
+                    if (trailers.empty()) {
+                        headers.emplace_back("content-length", std::to_string(body.size()));
+                    }
+                    bool end = body.empty() && trailers.empty();
+                    send_headers(id, headers, end);
+                    if (!body.empty()) {
+                        send_data(id, body, trailers.empty());
+                    }
+                    if (!trailers.empty()) {
+                        send_trailers(id, trailers);
+                    }
+                }
+
+                /* HEADERS and, past the client's frame size, CONTINUATION frames */
+                void send_headers(std::uint32_t id, const fields &headers, bool end_stream) {
+                    std::string block;
+                    _encoder.begin(block);
+                    for (const auto &f : headers) {
+                        _encoder.encode(block, f.first, f.second);
+                    }
+                    std::size_t offset = 0;
+                    auto type = http::http2::frame_type::headers;
+                    std::uint8_t flags = end_stream ? http::http2::frame_flags::end_stream : 0;
+                    do {
+                        std::size_t length = std::min<std::size_t>(block.size() - offset, _peer_max_frame_size);
+                        bool last = offset + length == block.size();
+                        http::http2::append_frame_header(_out, static_cast<std::uint32_t>(length), type,
+                            flags | (last ? http::http2::frame_flags::end_headers : 0), id);
+                        _out.append(block, offset, length);
+                        offset += length;
+                        type = http::http2::frame_type::continuation;
+                        flags = 0;
+                    } while (offset != block.size());
+                    if (end_stream) {
+                        finished(id);
+                    }
+                    flush();
+                }
+
+                /* queued until the flow control windows let it out */
+                void send_data(std::uint32_t id, const std::string &data, bool end_stream) {
+                    auto it = _streams.find(id);
+                    if (it == _streams.end()) {
+                        return;
+                    }
+                    it->second.pending.append(data);
+                    it->second.end = end_stream;
+                    send_pending();
+                    flush();
+                }
+
+                /* sent after the data queued so far, ending the stream */
+                void send_trailers(std::uint32_t id, const fields &trailers) {
+                    auto it = _streams.find(id);
+                    if (it == _streams.end()) {
+                        return;
+                    }
+                    it->second.trailers = trailers;
+                    it->second.has_trailers = true;
+                    send_pending();
+                    flush();
+                }
+
+                void reset(std::uint32_t id, http::http2::error_code code) {
+                    http::http2::append_frame_header(_out, 4, http::http2::frame_type::rst_stream, 0, id);
+                    http::http2::append_uint32(_out, static_cast<std::uint32_t>(code));
+                    finished(id);
+                    flush();
+                }
+
+                void goaway(std::uint32_t last_stream_id, http::http2::error_code code) {
+                    http::http2::append_frame_header(_out, 8, http::http2::frame_type::goaway, 0, 0);
+                    http::http2::append_uint32(_out, last_stream_id);
+                    http::http2::append_uint32(_out, static_cast<std::uint32_t>(code));
+                    flush();
+                }
+
+                void settings(const settings_list &settings) {
+                    http::http2::append_frame_header(_out, static_cast<std::uint32_t>(6 * settings.size()),
+                        http::http2::frame_type::settings, 0, 0);
+                    for (const auto &s : settings) {
+                        _out.push_back(static_cast<char>(static_cast<std::uint16_t>(s.first) >> 8));
+                        _out.push_back(static_cast<char>(s.first));
+                        http::http2::append_uint32(_out, s.second);
+                    }
+                    flush();
+                }
+
+                /* gives the client more window to send in, stream 0 for the connection */
+                void window_update(std::uint32_t id, std::uint32_t increment) {
+                    http::http2::append_frame_header(_out, 4, http::http2::frame_type::window_update, 0, id);
+                    http::http2::append_uint32(_out, increment);
+                    flush();
+                }
+
+                /* bytes as they are, e.g. hand-made frames */
+                void raw(const std::string &bytes) {
+                    _out.append(bytes);
+                    flush();
+                }
+
+                void close() {
+                    _closed = true;
+                    boost::system::error_code ignored;
+                    _socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+                    _socket.close(ignored);
+                }
+
+            private:
+                friend class loopback_h2_server;
+
+                struct stream {
+                    stream() : sent(0), end(false), has_trailers(false), window(0) { }
+
+                    stream_request request;
+                    std::string pending;
+                    std::size_t sent;
+                    bool end;
+                    fields trailers;
+                    bool has_trailers;
+                    std::int64_t window;
+                };
+
+                void start() {
+#if defined(NETLIBX_ENABLE_HTTPS)
+                    if (_server._tls) {
+                        _tls.reset(new tls_stream(_socket, *_server._tls));
+                        /* sent once the handshake is done */
+                        settings(_server._settings);
+                        auto self = shared_from_this();
+                        _tls->async_handshake(boost::asio::ssl::stream_base::server,
+                            [self] (const boost::system::error_code &ec) {
+                                if (!ec) {
+                                    self->read();
+                                    self->flush();
+                                }
+                            });
+                        return;
+                    }
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+                    settings(_server._settings);
+                    read();
+                }
+
+                void read() {
+                    auto self = shared_from_this();
+                    auto handler = [self] (const boost::system::error_code &ec, std::size_t n) {
+                        if (ec || self->_closed) {
+                            self->_closed = true;
+                            return;
+                        }
+                        self->_in.append(self->_chunk, n);
+                        if (self->parse()) {
+                            self->read();
+                        }
+                    };
+#if defined(NETLIBX_ENABLE_HTTPS)
+                    if (_tls) {
+                        _tls->async_read_some(boost::asio::buffer(_chunk), handler);
+                        return;
+                    }
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+                    _socket.async_read_some(boost::asio::buffer(_chunk), handler);
+                }
+
+                /* false once the connection is closed */
+                bool parse() {
+                    using namespace http::http2;
+
+                    if (!_preface) {
+                        if (_in.size() < connection_preface_size) {
+                            return true;
+                        }
+                        if (_in.compare(0, connection_preface_size, connection_preface()) != 0) {
+                            close();
+                            return false;
+                        }
+                        _in.erase(0, connection_preface_size);
+                        _preface = true;
+                    }
+
+                    std::size_t offset = 0;
+                    while (_in.size() - offset >= frame_header_size) {
+                        frame_header header = read_frame_header(_in.data() + offset);
+                        if (_in.size() - offset - frame_header_size < header.length) {
+                            break;
+                        }
+                        on_frame(header, _in.data() + offset + frame_header_size);
+                        offset += frame_header_size + header.length;
+                        if (_closed) {
+                            return false;
+                        }
+                    }
+                    _in.erase(0, offset);
+                    flush();
+                    return true;
+                }
+
+                void on_frame(const http::http2::frame_header &header, const char *payload) {
+                    using namespace http::http2;
+
+                    std::uint32_t length = header.length;
+                    if ((header.type == frame_type::data || header.type == frame_type::headers) &&
+                        (header.flags & frame_flags::padded) && length > 0) {
+                        std::uint32_t padding = static_cast<std::uint8_t>(payload[0]);
+                        ++payload;
+                        length -= std::min(length, padding + 1);
+                    }
+
+                    switch (header.type) {
+                    case frame_type::settings:
+                        if (!(header.flags & frame_flags::ack)) {
+                            on_settings(payload, length);
+                        }
+                        break;
+
+                    case frame_type::headers:
+                        if (header.flags & frame_flags::priority) {
+                            payload += 5;
+                            length -= std::min<std::uint32_t>(length, 5);
+                        }
+                        _block.assign(payload, length);
+                        _block_stream = header.stream_id;
+                        _block_end_stream = (header.flags & frame_flags::end_stream) != 0;
+                        if (header.flags & frame_flags::end_headers) {
+                            on_header_block();
+                        }
+                        break;
+
+                    case frame_type::continuation:
+                        _block.append(payload, length);
+                        if (header.flags & frame_flags::end_headers) {
+                            on_header_block();
+                        }
+                        break;
+
+                    case frame_type::data: {
+                        _server.count([length] (struct statistics &s) { s.data_received += length; });
+                        if (header.length > 0) {
+                            window_update(0, header.length);
+                        }
+                        auto it = _streams.find(header.stream_id);
+                        if (it == _streams.end()) {
+                            break;
+                        }
+                        if (header.length > 0 && !(header.flags & frame_flags::end_stream)) {
+                            window_update(header.stream_id, header.length);
+                        }
+                        it->second.request.body.append(payload, length);
+                        if (header.flags & frame_flags::end_stream) {
+                            dispatch(it->second.request);
+                        }
+                        break;
+                    }
+
+                    case frame_type::window_update: {
+                        std::uint32_t increment = read_uint32(payload) & 0x7fffffff;
+                        bool connection_level = header.stream_id == 0;
+                        _server.count([connection_level] (struct statistics &s) {
+                                ++(connection_level ? s.connection_window_updates : s.stream_window_updates);
+                            });
+                        if (connection_level) {
+                            _send_window += increment;
+                        } else {
+                            auto it = _streams.find(header.stream_id);
+                            if (it != _streams.end()) {
+                                it->second.window += increment;
+                            }
+                        }
+                        send_pending();
+                        break;
+                    }
+
+                    case frame_type::rst_stream: {
+                        std::uint32_t id = header.stream_id, code = read_uint32(payload);
+                        _server.count([id, code] (struct statistics &s) { s.resets.emplace_back(id, code); });
+                        finished(id);
+                        break;
+                    }
+
+                    case frame_type::goaway: {
+                        std::uint32_t code = read_uint32(payload + 4);
+                        _server.count([code] (struct statistics &s) { s.goaways.push_back(code); });
+                        break;
+                    }
+
+                    case frame_type::ping:
+                        if (!(header.flags & frame_flags::ack)) {
+                            append_frame_header(_out, 8, frame_type::ping, frame_flags::ack, 0);
+                            _out.append(payload, 8);
+                        }
+                        break;
+
+                    default:
+                        break;
+                    }
+                }
+
+                void on_settings(const char *payload, std::uint32_t length) {
+                    using namespace http::http2;
+
+                    for (const char *p = payload; p + 6 <= payload + length; p += 6) {
+                        auto id = static_cast<setting>((static_cast<std::uint8_t>(p[0]) << 8) |
+                            static_cast<std::uint8_t>(p[1]));
+                        std::uint32_t value = read_uint32(p + 2);
+                        if (id == setting::initial_window_size) {
+                            for (auto &e : _streams) {
+                                e.second.window += static_cast<std::int64_t>(value) - _peer_initial_window;
+                            }
+                            _peer_initial_window = value;
+                            _server.count([value] (struct statistics &s) { s.client_initial_window = value; });
+                        } else if (id == setting::max_frame_size) {
+                            _peer_max_frame_size = value;
+                        }
+                    }
+                    append_frame_header(_out, 0, frame_type::settings, frame_flags::ack, 0);
+                    send_pending();
+                }
+
+                void on_header_block() {
+                    std::uint32_t id = _block_stream;
+                    _block_stream = 0;
+                    fields headers;
+                    bool valid = _decoder.decode(_block.data(), _block.size(),
+                        [&headers] (boost::string_ref name, boost::string_ref value) {
+                            headers.emplace_back(std::string(name.data(), name.size()),
+                                std::string(value.data(), value.size()));
+                        });
+                    if (!valid) {
+                        close();
+                        return;
+                    }
+                    if (_streams.count(id)) {
+                        /* the request's trailers */
+                        if (_block_end_stream) {
+                            dispatch(_streams[id].request);
+                        }
+                        return;
+                    }
+
+                    stream &s = _streams[id];
+                    s.request.id = id;
+                    s.request.headers = std::move(headers);
+                    s.window = _peer_initial_window;
+                    std::size_t open = ++_open;
+                    _server.count([open] (struct statistics &st) {
+                            st.max_open_streams = std::max(st.max_open_streams, open);
+                        });
+                    if (_block_end_stream) {
+                        dispatch(s.request);
+                    }
+                }
+
+                void dispatch(const stream_request &request) {
+                    _server.count([] (struct statistics &s) { ++s.requests; });
+                    /* the handler may finish the stream, and with it the request */
+                    stream_request copy = request;
+                    if (_server._handler) {
+                        _server._handler(*this, copy);
+                    } else {
+                        respond(copy.id, 200, _server._body);
+                    }
+                }
+
+                /* sends what the windows allow of the queued bodies, and trailers once a body is out */
+                void send_pending() {
+                    using namespace http::http2;
+
+                    std::vector<std::uint32_t> done;
+                    for (auto &e : _streams) {
+                        stream &s = e.second;
+                        bool queued = s.sent < s.pending.size() || s.end || s.has_trailers;
+                        if (!queued) {
+                            continue;
+                        }
+                        while (s.sent < s.pending.size() && s.window > 0 && _send_window > 0) {
+                            std::size_t n = static_cast<std::size_t>(std::min<std::int64_t>(
+                                    std::min<std::int64_t>(s.window, _send_window),
+                                    std::min<std::size_t>(s.pending.size() - s.sent, _peer_max_frame_size)));
+                            bool last = s.sent + n == s.pending.size() && s.end && !s.has_trailers;
+                            append_frame_header(_out, static_cast<std::uint32_t>(n), frame_type::data,
+                                last ? frame_flags::end_stream : 0, e.first);
+                            _out.append(s.pending, s.sent, n);
+                            s.sent += n;
+                            s.window -= static_cast<std::int64_t>(n);
+                            _send_window -= static_cast<std::int64_t>(n);
+                            _server.count([n] (struct statistics &st) { st.data_sent += n; });
+                            if (last) {
+                                done.push_back(e.first);
+                            }
+                        }
+                        if (s.sent < s.pending.size()) {
+                            continue;
+                        }
+                        if (s.has_trailers) {
+                            fields trailers = std::move(s.trailers);
+                            s.has_trailers = false;
+                            s.end = false;
+                            _trailer_block.clear();
+                            _encoder.begin(_trailer_block);
+                            for (const auto &f : trailers) {
+                                _encoder.encode(_trailer_block, f.first, f.second);
+                            }
+                            append_frame_header(_out, static_cast<std::uint32_t>(_trailer_block.size()),
+                                frame_type::headers, frame_flags::end_stream | frame_flags::end_headers, e.first);
+                            _out.append(_trailer_block);
+                            done.push_back(e.first);
+                        } else if (s.end && s.pending.empty()) {
+                            append_frame_header(_out, 0, frame_type::data, frame_flags::end_stream, e.first);
+                            s.end = false;
+                            done.push_back(e.first);
+                        }
+                    }
+                    for (auto id : done) {
+                        finished(id);
+                    }
+                }
+
+                void finished(std::uint32_t id) {
+                    if (_streams.erase(id) != 0) {
+                        --_open;
+                    }
+                }
+
+                void flush() {
+                    if (_writing || _out.empty() || _closed) {
+                        return;
+                    }
+#if defined(NETLIBX_ENABLE_HTTPS)
+                    if (_tls && !handshake_done()) {
+                        return;
+                    }
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+                    _writing = true;
+                    _sending.swap(_out);
+                    _out.clear();
+                    auto self = shared_from_this();
+                    auto handler = [self] (const boost::system::error_code &ec, std::size_t) {
+                        self->_writing = false;
+                        if (ec) {
+                            self->_closed = true;
+                            return;
+                        }
+                        self->flush();
+                    };
+#if defined(NETLIBX_ENABLE_HTTPS)
+                    if (_tls) {
+                        boost::asio::async_write(*_tls, boost::asio::buffer(_sending), handler);
+                        return;
+                    }
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+                    boost::asio::async_write(_socket, boost::asio::buffer(_sending), handler);
+                }
+
+#if defined(NETLIBX_ENABLE_HTTPS)
+                bool handshake_done() const {
+                    return SSL_is_init_finished(_tls->native_handle()) != 0;
+                }
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+
+                boost::asio::ip::tcp::socket _socket;
+#if defined(NETLIBX_ENABLE_HTTPS)
+                typedef boost::asio::ssl::stream<boost::asio::ip::tcp::socket &> tls_stream;
+                std::unique_ptr<tls_stream> _tls;
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+                loopback_h2_server &_server;
+                std::uint64_t _index;
+                bool _preface;
+                bool _closed;
+                bool _writing;
+                char _chunk[16 * 1024];
+                std::string _in;
+                std::string _out;
+                std::string _sending;
+                http::http2::hpack::decoder _decoder;
+                http::http2::hpack::encoder _encoder;
+                std::int64_t _send_window;
+                std::uint32_t _peer_initial_window;
+                std::uint32_t _peer_max_frame_size;
+                std::string _block;
+                std::uint32_t _block_stream;
+                bool _block_end_stream;
+                std::string _trailer_block;
+                std::map<std::uint32_t, stream> _streams;
+                std::size_t _open;
+            };
+
+        private:
+#if defined(NETLIBX_ENABLE_HTTPS)
+            static int select_h2(SSL *, const unsigned char **out, unsigned char *out_length,
+                const unsigned char *in, unsigned int in_length, void *) {
+                for (unsigned int i = 0; i < in_length; i += 1 + in[i]) {
+                    if (in[i] == 2 && i + 3 <= in_length && in[i + 1] == 'h' && in[i + 2] == '2') {
+                        *out = in + i + 1;
+                        *out_length = 2;
+                        return SSL_TLSEXT_ERR_OK;
+                    }
+                }
+                return SSL_TLSEXT_ERR_NOACK;
+            }
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+
+            template <class F>
+                void count(F f) {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    f(_statistics);
+                }
+
+            void start() {
+                accept();
+                _thread = std::thread([this] () { _io_service.run(); });
+            }
+
+            void accept() {
+                std::uint64_t index;
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    index = _statistics.connections + 1;
+                }
+                auto next = std::make_shared<connection>(_io_service, *this, index);
+                _acceptor.async_accept(next->_socket, [this, next] (const boost::system::error_code &ec) {
+                        if (!ec) {
+                            count([] (struct statistics &s) { ++s.connections; });
+                            boost::asio::ip::tcp::no_delay nodelay(true);
+                            next->_socket.set_option(nodelay);
+                            next->start();
+                        }
+                        accept();
+                    });
+            }
+
+            boost::asio::io_service _io_service;
+            boost::asio::ip::tcp::acceptor _acceptor;
+#if defined(NETLIBX_ENABLE_HTTPS)
+            std::shared_ptr<boost::asio::ssl::context> _tls;
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+            std::string _body;
+            settings_list _settings;
+            request_handler _handler;
+            mutable std::mutex _mutex;
+            struct statistics _statistics;
+            std::thread _thread;
+        };
+    } // namespace bench
+} // namespace network
+
+#endif // NETWORK_BENCH_LOOPBACK_H2_SERVER_HPP
@@ -0,0 +1,372 @@
+#ifndef NETWORK_BENCH_LOOPBACK_SERVER_HPP
+#define NETWORK_BENCH_LOOPBACK_SERVER_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <thread>
+#include <cstdint>
+#include <map>
+#include <istream>
+#include <boost/asio.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#if defined(NETLIBX_ENABLE_HTTPS)
+#include <boost/asio/ssl.hpp>
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+
+namespace network {
+    namespace bench {
+#if defined(NETLIBX_ENABLE_HTTPS)
+        /* a server context with a throwaway self-signed P-256 certificate for 127.0.0.1 */
+        inline std::shared_ptr<boost::asio::ssl::context> self_signed_context() {
+            EVP_PKEY *key = nullptr;
+            EVP_PKEY_CTX *kctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+            EVP_PKEY_keygen_init(kctx);
+            EVP_PKEY_CTX_set_ec_paramgen_curve_nid(kctx, NID_X9_62_prime256v1);
+            EVP_PKEY_keygen(kctx, &key);
+            EVP_PKEY_CTX_free(kctx);
+
+            X509 *cert = X509_new();
+            X509_set_version(cert, 2);
+            ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+            X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+            X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 3600);
+            X509_set_pubkey(cert, key);
+            X509_NAME *name = X509_get_subject_name(cert);
+            X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                reinterpret_cast<const unsigned char *>("127.0.0.1"), -1, -1, 0);
+            X509_set_issuer_name(cert, name);
+            X509_sign(cert, key, EVP_sha256());
+
+            auto context = std::make_shared<boost::asio::ssl::context>(boost::asio::ssl::context::tls_server);
+            SSL_CTX_use_certificate(context->native_handle(), cert);
+            SSL_CTX_use_PrivateKey(context->native_handle(), key);
+            X509_free(cert);
+            EVP_PKEY_free(key);
+            return context;
+        }
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+
+        /*
+         * class loopback_server
+         *
+         * Minimal HTTP/1.1 server on 127.0.0.1 for the benchmarks: answers
+         * every request with a fixed body, or a redirect for the paths given
+         * to redirect(), honours "Connection: close" and discards request
+         * bodies announced with Content-Length. Given a Cache-Control, the
+         * body comes with it and an ETag, and requests carrying that ETag
+         * in If-None-Match are answered 304 Not Modified. It is run
+         * by `threads` threads. The body and its encoded form are set
+         * before the first request. Built with NETLIBX_ENABLE_HTTPS, it can
+         * speak TLS instead, on a server context such as
+         * self_signed_context().
+         */
+        class loopback_server {
+            loopback_server(const loopback_server &) = delete;
+            loopback_server &operator = (const loopback_server &) = delete;
+
+        public:
+            explicit loopback_server(std::size_t body_size = 64, std::size_t threads = 1) :
+                _acceptor(_io_service, boost::asio::ip::tcp::endpoint(
+                        boost::asio::ip::address_v4::loopback(), 0)),
+                _body(body_size, 'x'),
+                _accepted(0),
+                _bytes_sent(0),
+                _requests(0) {
+                start(threads);
+            }
+
+#if defined(NETLIBX_ENABLE_HTTPS)
+            loopback_server(std::shared_ptr<boost::asio::ssl::context> context,
+                std::size_t body_size = 64, std::size_t threads = 1) :
+                _acceptor(_io_service, boost::asio::ip::tcp::endpoint(
+                        boost::asio::ip::address_v4::loopback(), 0)),
+                _tls(std::move(context)),
+                _body(body_size, 'x'),
+                _accepted(0),
+                _bytes_sent(0),
+                _requests(0) {
+                start(threads);
+            }
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+
+            ~loopback_server() {
+                _io_service.stop();
+                for (auto &t : _threads) {
+                    t.join();
+                }
+            }
+
+            std::uint16_t port() const {
+                return _acceptor.local_endpoint().port();
+            }
+
+            std::string url(const std::string &path = "/") const {
+                return std::string(tls() ? "https" : "http") + "://127.0.0.1:" + std::to_string(port()) + path;
+            }
+
+            /* number of TCP connections accepted so far */
+            std::uint64_t accepted() const {
+                return _accepted;
+            }
+
+            void body(std::string body) {
+                _body = std::move(body);
+            }
+
+            /* the body as sent, Content-Encoding included, to requests whose Accept-Encoding names `encoding` */
+            void encoded_body(std::string encoding, std::string encoded) {
+                _encoding = std::move(encoding);
+                _encoded = std::move(encoded);
+            }
+
+            /* answers requests for path with code and a Location of location */
+            void redirect(std::string path, int code, std::string location) {
+                _redirects[std::move(path)] = std::make_pair(code, std::move(location));
+            }
+
+            /* sends cache_control, e.g. "max-age=60", and an ETag with the body */
+            void cache_control(std::string cache_control) {
+                _cache_control = std::move(cache_control);
+            }
+
+            /* number of requests answered so far */
+            std::uint64_t requests() const {
+                return _requests;
+            }
+
+            /* bytes of responses written so far */
+            std::uint64_t bytes_sent() const {
+                return _bytes_sent;
+            }
+
+            bool tls() const {
+#if defined(NETLIBX_ENABLE_HTTPS)
+                return _tls != nullptr;
+#else
+                return false;
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+            }
+
+        private:
+            struct session : std::enable_shared_from_this<session> {
+                session(boost::asio::io_service &io_service, loopback_server &server) :
+                    socket(io_service), server(server) {
+#if defined(NETLIBX_ENABLE_HTTPS)
+                    if (server._tls) {
+                        tls.reset(new tls_stream(socket, *server._tls));
+                    }
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+                }
+
+                void start() {
+#if defined(NETLIBX_ENABLE_HTTPS)
+                    if (tls) {
+                        auto self = shared_from_this();
+                        tls->async_handshake(boost::asio::ssl::stream_base::server,
+                            [self] (const boost::system::error_code &ec) {
+                                if (!ec) {
+                                    self->read_head();
+                                }
+                            });
+                        return;
+                    }
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+                    read_head();
+                }
+
+                void read_head() {
+                    auto self = shared_from_this();
+                    read_until([self] (const boost::system::error_code &ec, std::size_t) {
+                            if (!ec) {
+                                self->handle_head();
+                            }
+                        });
+                }
+
+                void handle_head() {
+                    std::istream is(&buffer);
+                    std::string line;
+                    std::size_t content_length = 0;
+                    close = false;
+                    encoded = false;
+                    not_modified = false;
+                    path.clear();
+                    if (std::getline(is, line)) {
+                        auto start = line.find(' ');
+                        auto end = line.find(' ', start + 1);
+                        if (start != std::string::npos && end != std::string::npos) {
+                            path = line.substr(start + 1, end - start - 1);
+                        }
+                    }
+                    while (std::getline(is, line) && line != "\r") {
+                        auto colon = line.find(':');
+                        if (colon == std::string::npos) {
+                            continue;
+                        }
+                        auto name = line.substr(0, colon);
+                        auto value = boost::algorithm::trim_copy(line.substr(colon + 1));
+                        if (boost::iequals(name, "Content-Length")) {
+                            content_length = std::stoul(value);
+                        } else if (boost::iequals(name, "Connection")) {
+                            close = boost::iequals(value, "close");
+                        } else if (boost::iequals(name, "Accept-Encoding") && !server._encoding.empty()) {
+                            encoded = boost::icontains(value, server._encoding);
+                        } else if (boost::iequals(name, "If-None-Match") && !server._cache_control.empty()) {
+                            not_modified = value == etag();
+                        }
+                    }
+                    skip_body(content_length);
+                }
+
+                void skip_body(std::size_t remaining) {
+                    std::size_t len = std::min(remaining, buffer.size());
+                    buffer.consume(len);
+                    remaining -= len;
+                    if (remaining == 0) {
+                        write_response();
+                        return;
+                    }
+
+                    auto self = shared_from_this();
+                    read_some([self, remaining] (const boost::system::error_code &ec, std::size_t) {
+                            if (!ec) {
+                                self->skip_body(remaining);
+                            }
+                        });
+                }
+
+                void write_response() {
+                    static const std::string none;
+                    auto redirect = server._redirects.find(path);
+                    bool redirected = redirect != server._redirects.end();
+                    const std::string &body = redirected || not_modified ? none :
+                        encoded ? server._encoded : server._body;
+                    if (redirected) {
+                        head = "HTTP/1.1 " + std::to_string(redirect->second.first) +
+                            " Redirect\r\nLocation: " + redirect->second.second + "\r\nContent-Length: 0";
+                    } else if (not_modified) {
+                        head = "HTTP/1.1 304 Not Modified\r\nETag: " + etag();
+                    } else {
+                        head = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) +
+                            (encoded ? "\r\nContent-Encoding: " + server._encoding : std::string());
+                        if (!server._cache_control.empty()) {
+                            head += "\r\nCache-Control: " + server._cache_control + "\r\nETag: " + etag();
+                        }
+                    }
+                    head += close ? "\r\nConnection: close\r\n\r\n" : "\r\n\r\n";
+
+                    /* counted before the client can read the response, not after */
+                    ++server._requests;
+                    auto self = shared_from_this();
+                    std::vector<boost::asio::const_buffer> buffers{
+                        boost::asio::buffer(head), boost::asio::buffer(body) };
+                    write(buffers, [self] (const boost::system::error_code &ec, std::size_t bytes) {
+                            if (ec) {
+                                return;
+                            }
+                            self->server._bytes_sent += bytes;
+                            if (self->close) {
+                                boost::system::error_code ignored;
+                                self->socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+                                return;
+                            }
+                            self->read_head();
+                        });
+                }
+
+                static const std::string &etag() {
+                    static const std::string tag("\"1\"");
+                    return tag;
+                }
+
+                /* the socket, or the TLS stream over it */
+                template <class Handler>
+                    void read_until(Handler handler) {
+#if defined(NETLIBX_ENABLE_HTTPS)
+                        if (tls) {
+                            boost::asio::async_read_until(*tls, buffer, "\r\n\r\n", handler);
+                            return;
+                        }
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+                        boost::asio::async_read_until(socket, buffer, "\r\n\r\n", handler);
+                    }
+
+                template <class Handler>
+                    void read_some(Handler handler) {
+#if defined(NETLIBX_ENABLE_HTTPS)
+                        if (tls) {
+                            boost::asio::async_read(*tls, buffer, boost::asio::transfer_at_least(1), handler);
+                            return;
+                        }
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+                        boost::asio::async_read(socket, buffer, boost::asio::transfer_at_least(1), handler);
+                    }
+
+                template <class Buffers, class Handler>
+                    void write(const Buffers &buffers, Handler handler) {
+#if defined(NETLIBX_ENABLE_HTTPS)
+                        if (tls) {
+                            boost::asio::async_write(*tls, buffers, handler);
+                            return;
+                        }
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+                        boost::asio::async_write(socket, buffers, handler);
+                    }
+
+                boost::asio::ip::tcp::socket socket;
+#if defined(NETLIBX_ENABLE_HTTPS)
+                typedef boost::asio::ssl::stream<boost::asio::ip::tcp::socket &> tls_stream;
+                std::unique_ptr<tls_stream> tls;
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+                boost::asio::streambuf buffer;
+                loopback_server &server;
+                std::string head;
+                std::string path;
+                bool close;
+                bool encoded;
+                bool not_modified;
+            };
+
+            void start(std::size_t threads) {
+                accept();
+                for (std::size_t i = 0; i < threads; ++i) {
+                    _threads.emplace_back([this] () { _io_service.run(); });
+                }
+            }
+
+            void accept() {
+                auto next = std::make_shared<session>(_io_service, *this);
+                _acceptor.async_accept(next->socket, [this, next] (const boost::system::error_code &ec) {
+                        if (!ec) {
+                            ++_accepted;
+                            boost::asio::ip::tcp::no_delay nodelay(true);
+                            next->socket.set_option(nodelay);
+                            next->start();
+                        }
+                        accept();
+                    });
+            }
+
+            boost::asio::io_service _io_service;
+            boost::asio::ip::tcp::acceptor _acceptor;
+#if defined(NETLIBX_ENABLE_HTTPS)
+            std::shared_ptr<boost::asio::ssl::context> _tls;
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+            std::string _body;
+            std::string _encoding;
+            std::string _encoded;
+            std::map<std::string, std::pair<int, std::string> > _redirects;
+            std::string _cache_control;
+            std::atomic<std::uint64_t> _accepted;
+            std::atomic<std::uint64_t> _bytes_sent;
+            std::atomic<std::uint64_t> _requests;
+            std::vector<std::thread> _threads;
+        };
+    } // namespace bench
+} // namespace network
+
+#endif // NETWORK_BENCH_LOOPBACK_SERVER_HPP
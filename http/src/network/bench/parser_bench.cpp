@@ -0,0 +1,173 @@
+/*
+ * response_parser cost on canned traces: MB/s and responses/s when whole
+ * responses are parsed, plus a fuzz pass that feeds every trace split at
+ * random points (and randomly corrupted) and checks the split results
+ * match a one-shot parse. Usage: parser_bench [iterations] [fuzz_rounds]
+ */
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <network/http/client/response_parser.hpp>
+
+namespace {
+    using network::http::client_message::response_parser;
+    typedef response_parser::string_ref string_ref;
+
+    struct counting_handler {
+        counting_handler() : status(0), headers(0), trailers(0), body_bytes(0), body_hash(0) { }
+
+        void on_status(string_ref, network::http::status::code code, string_ref) {
+            status = code;
+        }
+        void on_header(string_ref, string_ref) {
+            ++headers;
+        }
+        void on_headers_complete() { }
+        void on_body(string_ref data) {
+            body_bytes += data.size();
+            for (char c : data) {
+                body_hash = body_hash * 31 + static_cast<unsigned char>(c);
+            }
+        }
+        void on_trailer(string_ref, string_ref) {
+            ++trailers;
+        }
+
+        int status;
+        std::size_t headers;
+        std::size_t trailers;
+        std::size_t body_bytes;
+        std::size_t body_hash;
+    };
+
+    bool operator == (const counting_handler &lhs, const counting_handler &rhs) {
+        return lhs.status == rhs.status && lhs.headers == rhs.headers && lhs.trailers == rhs.trailers &&
+            lhs.body_bytes == rhs.body_bytes && lhs.body_hash == rhs.body_hash;
+    }
+
+    std::vector<std::pair<std::string, std::string> > traces() {
+        std::vector<std::pair<std::string, std::string> > result;
+
+        result.emplace_back("small",
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: application/json\r\n"
+            "Content-Length: 27\r\n"
+            "\r\n"
+            "{\"status\":\"ok\",\"count\":42}\n");
+
+        std::string proxied =
+            "HTTP/1.1 200 OK\r\n"
+            "Date: Mon, 12 Oct 2026 10:00:00 GMT\r\n"
+            "Server: nginx/1.25.3\r\n"
+            "Content-Type: text/html; charset=utf-8\r\n"
+            "Cache-Control: private, max-age=0, must-revalidate\r\n"
+            "ETag: \"5f8d0d55-1a2b3c\"\r\n"
+            "Last-Modified: Sun, 11 Oct 2026 09:00:00 GMT\r\n"
+            "Vary: Accept-Encoding, Cookie\r\n"
+            "Set-Cookie: session=0123456789abcdef0123456789abcdef; Path=/; HttpOnly; Secure\r\n"
+            "Set-Cookie: tracking=fedcba9876543210; Path=/; Max-Age=31536000\r\n"
+            "Strict-Transport-Security: max-age=63072000; includeSubDomains; preload\r\n"
+            "X-Content-Type-Options: nosniff\r\n"
+            "X-Frame-Options: SAMEORIGIN\r\n"
+            "X-Request-Id: 7b0c6f0e-6a3c-4c1b-9a55-3f1c2d4e5f60\r\n"
+            "Via: 1.1 varnish, 1.1 edge-proxy\r\n"
+            "Connection: keep-alive\r\n"
+            "Content-Length: 512\r\n"
+            "\r\n";
+        result.emplace_back("proxied", proxied + std::string(512, 'p'));
+
+        std::string chunked =
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: text/plain\r\n"
+            "Transfer-Encoding: chunked\r\n"
+            "Trailer: X-Checksum\r\n"
+            "\r\n";
+        for (int i = 0; i < 16; ++i) {
+            chunked += "100;ext=1\r\n" + std::string(256, 'a' + i) + "\r\n";
+        }
+        chunked += "0\r\nX-Checksum: abc\r\n\r\n";
+        result.emplace_back("chunked", chunked);
+
+        result.emplace_back("large",
+            "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: 65536\r\n\r\n" +
+            std::string(65536, 'L'));
+
+        return result;
+    }
+
+    /* feeds `trace` the way the client does: only unconsumed bytes plus newly read ones */
+    counting_handler feed(const std::string &trace, const std::vector<std::size_t> &cuts, bool &ok) {
+        response_parser parser;
+        counting_handler handler;
+        std::string pending;
+        std::size_t offset = 0;
+
+        for (std::size_t i = 0; i <= cuts.size() && !parser.is_complete() && !parser.has_error(); ++i) {
+            std::size_t end = i < cuts.size() ? cuts[i] : trace.size();
+            pending.append(trace, offset, end - offset);
+            offset = end;
+            pending.erase(0, parser.parse(pending.data(), pending.size(), handler));
+        }
+        ok = parser.is_complete() && pending.empty();
+        return handler;
+    }
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    std::size_t fuzz_rounds = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000;
+
+    std::mt19937 random(42);
+    bool all_ok = true;
+
+    for (const auto &trace : traces()) {
+        /* throughput */
+        std::size_t rounds = std::max<std::size_t>(1, iterations * 200 / trace.second.size());
+        auto start = std::chrono::steady_clock::now();
+        std::size_t sink = 0;
+        for (std::size_t i = 0; i < rounds; ++i) {
+            response_parser parser;
+            counting_handler handler;
+            parser.parse(trace.second.data(), trace.second.size(), handler);
+            sink += handler.body_bytes;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << trace.first << ": "
+                  << rounds * trace.second.size() / elapsed.count() / (1024 * 1024) << " MB/s, "
+                  << rounds / elapsed.count() << " responses/s"
+                  << (sink == 0 ? " (empty)" : "") << std::endl;
+
+        /* split fuzzing */
+        bool ok = false;
+        counting_handler expected = feed(trace.second, std::vector<std::size_t>(), ok);
+        all_ok = all_ok && ok;
+        for (std::size_t round = 0; round < fuzz_rounds; ++round) {
+            std::vector<std::size_t> cuts(random() % 16);
+            for (auto &cut : cuts) {
+                cut = random() % trace.second.size();
+            }
+            std::sort(cuts.begin(), cuts.end());
+            counting_handler actual = feed(trace.second, cuts, ok);
+            if (!ok || !(actual == expected)) {
+                std::cout << "  split mismatch in " << trace.first << std::endl;
+                all_ok = false;
+                break;
+            }
+
+            /* corrupted input must end in complete or error, never loop or crash */
+            std::string corrupted = trace.second;
+            for (int flips = random() % 4 + 1; flips > 0; --flips) {
+                corrupted[random() % corrupted.size()] = static_cast<char>(random());
+            }
+            feed(corrupted, cuts, ok);
+        }
+    }
+
+    std::cout << (all_ok ? "fuzz: ok" : "fuzz: FAILED") << std::endl;
+    return all_ok ? 0 : 1;
+}
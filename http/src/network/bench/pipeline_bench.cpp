@@ -0,0 +1,80 @@
+/*
+ * Throughput and latency of GET requests on one keep-alive connection to a
+ * loopback server, sent one at a time and pipelined. `window` requests are
+ * kept outstanding; latency runs from the call to get() to the response.
+ * Usage: pipeline_bench [requests] [depth] [window]
+ */
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <network/http/client.hpp>
+#include "loopback_server.hpp"
+
+namespace {
+    typedef std::chrono::steady_clock clock_type;
+
+    double run(std::size_t depth, std::size_t requests, std::size_t window) {
+        using namespace network::http;
+
+        network::bench::loopback_server server;
+        client c(client_options()
+            .max_connections_per_host(1)
+            .pipeline_depth(depth));
+        network::uri url(server.url());
+
+        /* connect before measuring */
+        c.get(request(url)).get();
+
+        struct outstanding {
+            std::future<response> result;
+            clock_type::time_point sent;
+        };
+        std::deque<outstanding> inflight;
+        std::vector<double> latencies;
+        latencies.reserve(requests);
+
+        auto start = clock_type::now();
+        std::size_t sent = 0;
+        while (sent < requests || !inflight.empty()) {
+            while (sent < requests && inflight.size() < window) {
+                inflight.push_back(outstanding{ c.get(request(url)), clock_type::now() });
+                ++sent;
+            }
+            /* one connection, the responses come in order */
+            inflight.front().result.get();
+            std::chrono::duration<double, std::micro> latency = clock_type::now() - inflight.front().sent;
+            latencies.push_back(latency.count());
+            inflight.pop_front();
+        }
+        std::chrono::duration<double> elapsed = clock_type::now() - start;
+
+        std::sort(latencies.begin(), latencies.end());
+        double mean = 0;
+        for (double l : latencies) {
+            mean += l / latencies.size();
+        }
+
+        std::cout << (depth > 1 ? "pipelined  " : "sequential ")
+                  << requests / elapsed.count() << " req/s, latency mean "
+                  << mean << " us, p50 "
+                  << latencies[latencies.size() / 2] << " us, p99 "
+                  << latencies[latencies.size() * 99 / 100] << " us, "
+                  << server.accepted() << " connections" << std::endl;
+        return requests / elapsed.count();
+    }
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::size_t requests = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    std::size_t depth = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 16;
+    std::size_t window = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : depth;
+
+    double sequential = run(0, requests, window);
+    double pipelined = run(depth, requests, window);
+    std::cout << "speedup    " << pipelined / sequential << "x" << std::endl;
+
+    return 0;
+}
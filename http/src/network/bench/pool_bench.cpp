@@ -0,0 +1,50 @@
+/*
+ * Requests/sec against a loopback server with and without connection
+ * pooling. Usage: pool_bench [requests] [concurrency]
+ */
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <network/http/client.hpp>
+#include "loopback_server.hpp"
+
+namespace {
+    double run(bool keep_alive, std::size_t requests, std::size_t concurrency) {
+        using namespace network::http;
+
+        network::bench::loopback_server server;
+        client c(client_options()
+            .keep_alive(keep_alive)
+            .max_connections_per_host(concurrency)
+            .max_idle_connections_per_host(concurrency));
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t done = 0; done < requests; done += concurrency) {
+            std::vector<std::future<response> > inflight;
+            for (std::size_t i = 0; i < concurrency && done + i < requests; ++i) {
+                inflight.push_back(c.get(request(network::uri(server.url()))));
+            }
+            for (auto &f : inflight) {
+                f.get();
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << (keep_alive ? "pooled    " : "no pool   ")
+                  << requests / elapsed.count() << " req/s, "
+                  << server.accepted() << " connections" << std::endl;
+        return requests / elapsed.count();
+    }
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::size_t requests = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    std::size_t concurrency = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 8;
+
+    double without = run(false, requests, concurrency);
+    double with = run(true, requests, concurrency);
+    std::cout << "speedup   " << with / without << "x" << std::endl;
+
+    return 0;
+}
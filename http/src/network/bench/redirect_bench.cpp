@@ -0,0 +1,50 @@
+/*
+ * Requests/sec for a GET answered directly, after a 302 to the same
+ * server, after a 301 (kept in the client's redirect cache, so only the
+ * first request sees it) and after a 302 to another server, with the
+ * requests each server answered and the connections it accepted.
+ * Usage: redirect_bench [requests]
+ */
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <network/http/client.hpp>
+#include "loopback_server.hpp"
+
+namespace {
+    using namespace network::http;
+
+    void run(const char *label, const std::string &path, std::size_t requests) {
+        network::bench::loopback_server server, other;
+        server.redirect("/found", 302, "/final");
+        server.redirect("/moved", 301, server.url("/final"));
+        server.redirect("/away", 302, other.url("/final"));
+        client c(client_options().follow_redirects(true));
+        network::uri url(server.url(path));
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < requests; ++i) {
+            if (c.get(request(url)).get().status() != status::ok) {
+                std::cerr << label << ": redirect not followed" << std::endl;
+                std::exit(1);
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << label << requests / elapsed.count() << " req/s, "
+                  << static_cast<double>(server.requests() + other.requests()) / requests << " server requests/request, "
+                  << server.accepted() + other.accepted() << " connections" << std::endl;
+    }
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::size_t requests = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+
+    run("direct           ", "/final", requests);
+    run("302 same server  ", "/found", requests);
+    run("301 cached       ", "/moved", requests);
+    run("302 other server ", "/away", requests);
+
+    return 0;
+}
@@ -0,0 +1,251 @@
+/*
+ * The client against a memory_transport replaying a capture file, mapped
+ * into memory, with no sockets involved: the recorded requests as fast as
+ * they go, one at a time and 64 at a time, then at the times they were
+ * recorded, divided by `speed`, with their responses as late as recorded,
+ * comparing the latencies seen with those of the capture. Without a
+ * capture file at `capture`, a synthetic one is written there first:
+ * 10000 exchanges at about 5000 requests/sec, GETs and some POSTs over 200
+ * paths, small, medium and large bodies, some chunked, some closing the
+ * connection, and latencies of about 2ms.
+ * Usage: replay_bench [capture] [speed]
+ */
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <future>
+#include <fstream>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <condition_variable>
+#include <network/http/client.hpp>
+#include <network/http/client/connection/memory_transport.hpp>
+
+namespace {
+    using namespace network::http;
+    using client_connection::capture_file;
+    using client_connection::capture_exchange;
+    using client_connection::memory_transport;
+
+    void write_synthetic(const std::string &path) {
+        std::mt19937 random(1);
+        std::exponential_distribution<double> interval(1.0 / 200000), latency(1.0 / 2000000);
+        std::uniform_real_distribution<double> uniform;
+        std::ofstream file(path, std::ios::binary);
+        client_connection::capture_writer writer(file);
+
+        double start = 0;
+        for (int i = 0; i < 10000; ++i) {
+            /* a few paths are asked for much more often than the others */
+            int item = static_cast<int>(200 * uniform(random) * uniform(random));
+            bool post = uniform(random) < 0.1;
+            std::string request = std::string(post ? "POST" : "GET") + " /api/items/" + std::to_string(item) +
+                " HTTP/1.1\r\nHost: api.example.com\r\nAccept: */*\r\n";
+            request += post ? "Content-Length: 200\r\n\r\n" + std::string(200, 'p') : "\r\n";
+
+            double kind = uniform(random);
+            std::size_t size = kind < 0.7 ? 300 : kind < 0.95 ? 4096 : 65536;
+            std::string response = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n";
+            if (uniform(random) < 0.01) {
+                response += "Connection: close\r\n";
+            }
+            if (uniform(random) < 0.05) {
+                response += "Transfer-Encoding: chunked\r\n\r\n";
+                for (std::size_t sent = 0; sent < size; sent += 1024) {
+                    std::size_t chunk = std::min<std::size_t>(1024, size - sent);
+                    char line[16];
+                    std::snprintf(line, sizeof(line), "%zx\r\n", chunk);
+                    response += line + std::string(chunk, 'r') + "\r\n";
+                }
+                response += "0\r\n\r\n";
+            } else {
+                response += "Content-Length: " + std::to_string(size) + "\r\n\r\n" + std::string(size, 'r');
+            }
+
+            writer.add(static_cast<std::uint64_t>(start), static_cast<std::uint64_t>(latency(random)),
+                request, response);
+            start += interval(random);
+        }
+    }
+
+    /* the request of an exchange, as the client would send it */
+    request request_of(const capture_exchange &e) {
+        std::string bytes = e.request.to_string();
+        auto head_end = bytes.find("\r\n\r\n");
+        std::string head = bytes.substr(0, head_end);
+        std::string body = head_end == std::string::npos ? std::string() : bytes.substr(head_end + 4);
+
+        auto line_end = head.find("\r\n");
+        std::string line = head.substr(0, line_end);
+        auto space = line.find(' ');
+        std::string name = line.substr(0, space);
+        std::string target = line.substr(space + 1, line.rfind(' ') - space - 1);
+
+        std::string host;
+        std::vector<std::pair<std::string, std::string> > headers;
+        for (auto at = line_end; at != std::string::npos && at < head.size(); ) {
+            auto next = head.find("\r\n", at + 2);
+            std::string header = head.substr(at + 2, next == std::string::npos ? std::string::npos : next - at - 2);
+            auto colon = header.find(':');
+            std::string value = header.substr(header.find_first_not_of(' ', colon + 1));
+            header.resize(colon);
+            if (boost::iequals(header, "Host")) {
+                host = value;
+            } else if (!boost::iequals(header, "Content-Length") && !boost::iequals(header, "Transfer-Encoding") &&
+                !boost::iequals(header, "Connection")) {
+                headers.emplace_back(header, value);
+            }
+            at = next;
+        }
+
+        request r(network::uri("http://" + host + target));
+        static const std::map<std::string, method> methods = {
+            { "GET", method::get }, { "POST", method::post }, { "PUT", method::put },
+            { "DELETE", method::delete_ }, { "HEAD", method::head }, { "PATCH", method::patch }
+        };
+        auto m = methods.find(name);
+        r.method(m == methods.end() ? method::get : m->second);
+        for (const auto &h : headers) {
+            r.append_header(h.first, h.second);
+        }
+        if (!body.empty()) {
+            r.body(std::make_shared<client_message::string_byte_source>(std::move(body)));
+        }
+        return r;
+    }
+
+    /* built before each run: request bodies are read as they are sent */
+    std::vector<request> requests_of(const capture_file &capture) {
+        std::vector<request> requests;
+        requests.reserve(capture.size());
+        for (const auto &e : capture) {
+            requests.push_back(request_of(e));
+        }
+        return requests;
+    }
+
+    /* as fast as they go, `concurrency` at a time */
+    void flat_out(const std::shared_ptr<const capture_file> &capture, std::size_t concurrency) {
+        std::vector<request> requests = requests_of(*capture);
+        auto transport = std::make_shared<memory_transport>(capture);
+        client c(client_options().transport(transport).record_latency(false)
+            .max_connections_per_host(concurrency).max_idle_connections_per_host(concurrency));
+
+        std::atomic<std::size_t> next(0), done(0);
+        std::atomic<std::size_t> errors(0);
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::function<void ()> send = [&] () {
+            std::size_t i = next++;
+            if (i >= requests.size()) {
+                return;
+            }
+            c.async_execute(requests[i], [&] (std::exception_ptr error, response r) {
+                    if (error || r.status() != status::ok) {
+                        ++errors;
+                    }
+                    send();
+                    if (++done == requests.size()) {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        finished.notify_one();
+                    }
+                });
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < concurrency; ++i) {
+            send();
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&] () { return done == requests.size(); });
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << "flat out, " << std::setw(2) << concurrency << " at a time  " << std::fixed << std::setprecision(0)
+                  << requests.size() / elapsed.count() << " req/s, " << transport->connections() << " connections, "
+                  << errors << " errors" << std::endl;
+    }
+
+    /* at the recorded times and latencies, divided by speed */
+    void timed(const std::shared_ptr<const capture_file> &capture, double speed) {
+        std::vector<request> requests = requests_of(*capture);
+        auto transport = std::make_shared<memory_transport>(capture, speed);
+        client c(client_options().transport(transport).record_latency(false)
+            .max_connections_per_host(256).max_idle_connections_per_host(256));
+
+        client_message::latency_histogram recorded, seen, late;
+        std::atomic<std::size_t> errors(0);
+        std::vector<std::future<void> > waits;
+        waits.reserve(requests.size());
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < requests.size(); ++i) {
+            const capture_exchange &e = (*capture)[i];
+            auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::nanoseconds(static_cast<std::int64_t>(e.start / speed)));
+            std::this_thread::sleep_until(due);
+            auto now = std::chrono::steady_clock::now();
+            late.record(now - due);
+            recorded.record(static_cast<std::uint64_t>(e.latency / speed / 1000));
+
+            auto promise = std::make_shared<std::promise<void> >();
+            waits.push_back(promise->get_future());
+            c.async_execute(requests[i], [&seen, &errors, now, promise] (std::exception_ptr error, response r) {
+                    seen.record(std::chrono::steady_clock::now() - now);
+                    if (error || r.status() != status::ok) {
+                        ++errors;
+                    }
+                    promise->set_value();
+                });
+        }
+        for (auto &w : waits) {
+            w.wait();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        client_message::latency_distribution r, s, l;
+        recorded.add_to(r);
+        seen.add_to(s);
+        late.add_to(l);
+        std::cout << "timed, speed " << speed << "        " << std::fixed << std::setprecision(2)
+                  << (*capture)[requests.size() - 1].start / speed / 1e9 << " s recorded, "
+                  << elapsed.count() << " s replayed, " << transport->connections() << " connections, "
+                  << errors << " errors" << std::endl;
+        std::cout << "    latency recorded p50 " << r.percentile(50) << " us, p99 " << r.percentile(99) << " us"
+                  << std::endl;
+        std::cout << "    latency seen     p50 " << s.percentile(50) << " us, p99 " << s.percentile(99) << " us"
+                  << std::endl;
+        std::cout << "    sent late by     p50 " << l.percentile(50) << " us, p99 " << l.percentile(99) << " us"
+                  << std::endl;
+    }
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::string path = argc > 1 ? argv[1] : "replay_bench.capture";
+    double speed = argc > 2 ? std::strtod(argv[2], nullptr) : 1.0;
+
+    if (!std::ifstream(path)) {
+        write_synthetic(path);
+        std::cout << "wrote a synthetic capture to " << path << std::endl;
+    }
+    std::shared_ptr<const capture_file> capture = std::make_shared<capture_file>(path);
+    if (capture->empty()) {
+        std::cerr << path << ": no exchanges" << std::endl;
+        return 1;
+    }
+    std::cout << capture->size() << " exchanges" << std::endl;
+
+    flat_out(capture, 1);
+    flat_out(capture, 64);
+    timed(capture, speed);
+
+    return 0;
+}
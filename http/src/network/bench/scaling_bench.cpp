@@ -0,0 +1,76 @@
+/*
+ * Requests/sec against a loopback server as the client's io_threads go
+ * from 1 to N, with `window` requests per thread kept outstanding by
+ * callbacks. The server runs N threads throughout.
+ * Usage: scaling_bench [requests] [max threads] [window]
+ */
+#include <iostream>
+#include <atomic>
+#include <future>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <network/http/client.hpp>
+#include "loopback_server.hpp"
+
+namespace {
+    using namespace network::http;
+
+    struct callback_run {
+        callback_run(client &c, const network::uri &url, std::size_t requests) :
+            c(c), url(url), to_send(requests), to_complete(requests) { }
+
+        void send() {
+            if (to_send.fetch_sub(1) <= 0) {
+                return;
+            }
+            c.async_get(request(url), [this] (std::exception_ptr, response) {
+                    send();
+                    if (--to_complete == 0) {
+                        done.set_value();
+                    }
+                });
+        }
+
+        client &c;
+        network::uri url;
+        std::atomic<std::ptrdiff_t> to_send;
+        std::atomic<std::size_t> to_complete;
+        std::promise<void> done;
+    };
+
+    double run(network::bench::loopback_server &server, std::size_t threads,
+        std::size_t requests, std::size_t window) {
+        client c(client_options()
+            .io_threads(threads)
+            .max_connections_per_host(window)
+            .max_idle_connections_per_host(window));
+        callback_run r(c, network::uri(server.url()), requests);
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < threads * window; ++i) {
+            r.send();
+        }
+        r.done.get_future().wait();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << threads << " threads " << requests / elapsed.count() << " req/s" << std::endl;
+        return requests / elapsed.count();
+    }
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::size_t requests = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    std::size_t max_threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) :
+        std::max(1u, std::thread::hardware_concurrency() / 2);
+    std::size_t window = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 8;
+
+    network::bench::loopback_server server(64, max_threads);
+    double single = run(server, 1, requests, window);
+    for (std::size_t threads = 2; threads <= max_threads; threads *= 2) {
+        double rate = run(server, threads, requests, window);
+        std::cout << "  scaling " << rate / single << "x" << std::endl;
+    }
+
+    return 0;
+}
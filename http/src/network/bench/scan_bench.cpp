@@ -0,0 +1,73 @@
+/*
+ * Header scanning kernels on a realistic response head: each line is
+ * scanned for its end (find_ctl) and its header name (find_non_token),
+ * as response_parser does. Usage: scan_bench [iterations]
+ */
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <network/http/header_scanner.hpp>
+
+namespace {
+    const char head[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Date: Mon, 12 Oct 2026 10:00:00 GMT\r\n"
+        "Server: nginx/1.25.3\r\n"
+        "Content-Type: text/html; charset=utf-8\r\n"
+        "Cache-Control: private, max-age=0, must-revalidate\r\n"
+        "ETag: \"5f8d0d55-1a2b3c\"\r\n"
+        "Last-Modified: Sun, 11 Oct 2026 09:00:00 GMT\r\n"
+        "Vary: Accept-Encoding, Cookie\r\n"
+        "Set-Cookie: session=0123456789abcdef0123456789abcdef; Path=/; HttpOnly; Secure\r\n"
+        "Set-Cookie: tracking=fedcba9876543210; Path=/; Max-Age=31536000\r\n"
+        "Strict-Transport-Security: max-age=63072000; includeSubDomains; preload\r\n"
+        "Content-Security-Policy: default-src 'self'; script-src 'self' https://cdn.example.com; "
+            "img-src 'self' data: https://images.example.com; style-src 'self' 'unsafe-inline'\r\n"
+        "X-Content-Type-Options: nosniff\r\n"
+        "X-Request-Id: 7b0c6f0e-6a3c-4c1b-9a55-3f1c2d4e5f60\r\n"
+        "Via: 1.1 varnish, 1.1 edge-proxy\r\n"
+        "Content-Length: 512\r\n"
+        "\r\n";
+
+    std::size_t scan(const network::http::header_scanner &scanner) {
+        const char *p = head;
+        const char *end = head + sizeof(head) - 1;
+        std::size_t names = 0;
+        while (p < end) {
+            const char *eol = scanner.find_ctl(p, end);
+            names += scanner.find_non_token(p, eol) - p;
+            p = eol + 2;
+        }
+        return names;
+    }
+
+    void run(const network::http::header_scanner *scanner, std::size_t iterations) {
+        if (!scanner) {
+            return;
+        }
+        std::size_t sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < iterations; ++i) {
+            sink += scan(*scanner);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << scanner->name << ": "
+                  << iterations * (sizeof(head) - 1) / elapsed.count() / (1024 * 1024) << " MB/s, "
+                  << elapsed.count() * 1e9 / iterations << " ns/head"
+                  << (sink == 0 ? " (empty)" : "") << std::endl;
+    }
+} // namespace
+
+int main(int argc, char *argv[]) {
+    using namespace network::http;
+
+    std::size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    run(&scalar_header_scanner(), iterations);
+    run(sse42_header_scanner(), iterations);
+    run(avx2_header_scanner(), iterations);
+    std::cout << "active: " << active_header_scanner().name << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,46 @@
+/*
+ * Cost of turning a request into bytes for the socket: the ostream
+ * operator<< versus the gather list from request::to_buffers.
+ * Usage: serialize_bench [iterations]
+ */
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <cstdlib>
+#include <network/http/client.hpp>
+
+int main(int argc, char *argv[]) {
+    using namespace network::http;
+
+    std::size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    request req(network::uri("http://www.example.com:8080/some/path/to/resource?with=query&and=more"));
+    req.append_header("User-Agent", "cpp-netlibx/" NETLIBX_VERSION)
+        .append_header("Accept", "*/*")
+        .append_header("Accept-Encoding", "identity;q=1.0, *;q=0")
+        .append_header("Cookie", std::string(200, 'c'));
+
+    std::size_t sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iterations; ++i) {
+        std::ostringstream os;
+        os << req;
+        sink += os.str().size();
+    }
+    std::chrono::duration<double, std::nano> ostream_ns = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iterations; ++i) {
+        client_connection::async_connection::const_buffers buffers;
+        req.to_buffers(buffers);
+        sink += boost::asio::buffer_size(buffers);
+    }
+    std::chrono::duration<double, std::nano> gather_ns = std::chrono::steady_clock::now() - start;
+
+    std::cout << "ostream     " << ostream_ns.count() / iterations << " ns/request" << std::endl;
+    std::cout << "to_buffers  " << gather_ns.count() / iterations << " ns/request" << std::endl;
+    std::cout << "(" << sink << " bytes)" << std::endl;
+
+    return 0;
+}
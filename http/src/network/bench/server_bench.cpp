@@ -0,0 +1,125 @@
+/*
+ * network::http::server under the load generator, next to the benchmarks'
+ * loopback_server under the same load: small and large bodies, keep-alive
+ * and a new connection per request, at 1, 16 and 64 requests in flight,
+ * then keep-alive again with the client pipelining 8 requests a
+ * connection. The server answers with a shared body, written from where
+ * it is. For each, requests/sec, throughput, latency percentiles and
+ * errors, and for network::http::server the heap allocations per request
+ * made by its threads. Only runs whose name contains `filter` are done,
+ * e.g. "netlibx pipelined".
+ * Usage: server_bench [seconds per run] [server threads] [filter]
+ */
+#include <chrono>
+#include <string>
+#include <thread>
+#include <memory>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <boost/asio/io_service.hpp>
+#include <network/http/client.hpp>
+#include <network/http/server.hpp>
+#include "loopback_server.hpp"
+#include "load_generator.hpp"
+#include "counting_allocator.hpp"
+
+namespace {
+    using namespace network::http;
+
+    using network::bench::allocations;
+    using network::bench::measuring;
+    using network::bench::counted;
+
+    struct scenario {
+        bool netlibx;
+        bool keep_alive;
+        std::size_t pipeline_depth;
+        std::size_t body_size;
+        std::size_t concurrency;
+    };
+
+    std::string name_of(const scenario &s) {
+        return std::string(s.netlibx ? "netlibx  " : "loopback ") +
+            (s.pipeline_depth > 1 ? "pipelined  " : s.keep_alive ? "keep-alive " : "close      ") +
+            (s.body_size >= 1024 ? std::to_string(s.body_size / 1024) + "KiB" : std::to_string(s.body_size) + "B") +
+            " c" + std::to_string(s.concurrency);
+    }
+
+    void run(const scenario &s, std::size_t threads, std::chrono::milliseconds duration) {
+        std::unique_ptr<network::bench::loopback_server> loopback;
+        std::unique_ptr<server> netlibx;
+        std::string url;
+        if (s.netlibx) {
+            auto body = std::make_shared<const std::string>(s.body_size, 'x');
+            netlibx.reset(new server("127.0.0.1", 0,
+                    [body] (const server_message::request &, server_message::response r) {
+                        /* the server's threads count */
+                        counted() = true;
+                        r.header("Content-Type", "text/plain").send(body);
+                    }, server_options().threads(threads)));
+            url = "http://127.0.0.1:" + std::to_string(netlibx->port()) + "/";
+        } else {
+            loopback.reset(new network::bench::loopback_server(s.body_size, threads));
+            url = loopback->url();
+        }
+
+        network::bench::load_result result;
+        std::uint64_t count = 0;
+        {
+            client c(client_options().keep_alive(s.keep_alive).pipeline_depth(s.pipeline_depth)
+                .max_connections_per_host(s.concurrency).max_idle_connections_per_host(s.concurrency));
+            network::bench::load_generator generator(c, network::uri(url), s.concurrency);
+
+            generator.run(duration / 5);
+            std::uint64_t before = allocations();
+            measuring() = true;
+            result = generator.run(duration);
+            measuring() = false;
+            count = allocations() - before;
+        }
+
+        const auto &latency = result.latency;
+        std::cout << std::left << std::setw(32) << name_of(s) << std::right << std::fixed
+                  << std::setprecision(0) << std::setw(9) << result.requests_per_second()
+                  << std::setprecision(1) << std::setw(9) << result.megabytes_per_second()
+                  << std::setw(8) << latency.percentile(50) << std::setw(8) << latency.percentile(99)
+                  << std::setw(9) << latency.max << std::setw(10);
+        if (s.netlibx) {
+            std::cout << (result.requests ? static_cast<double>(count) / result.requests : 0.0);
+        } else {
+            std::cout << "-";
+        }
+        std::cout << std::setw(8) << result.errors << std::endl;
+    }
+} // namespace
+
+int main(int argc, char *argv[]) {
+    double seconds = argc > 1 ? std::strtod(argv[1], nullptr) : 1.0;
+    std::size_t threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1;
+    std::string filter = argc > 3 ? argv[3] : "";
+    std::chrono::milliseconds duration(static_cast<long>(seconds * 1000));
+
+    std::cout << std::left << std::setw(32) << "run" << std::right << std::setw(9) << "req/s" << std::setw(9) << "MiB/s"
+              << std::setw(8) << "p50 us" << std::setw(8) << "p99" << std::setw(9) << "max"
+              << std::setw(10) << "allocs/rq" << std::setw(8) << "errors" << std::endl;
+
+    for (std::size_t body_size : { std::size_t(64), std::size_t(64 * 1024) }) {
+        for (std::size_t concurrency : { 1, 16, 64 }) {
+            for (bool netlibx : { false, true }) {
+                scenario runs[] = {
+                    { netlibx, true, 0, body_size, concurrency },
+                    { netlibx, false, 0, body_size, concurrency },
+                    { netlibx, true, 8, body_size, concurrency },
+                };
+                for (const scenario &s : runs) {
+                    if (name_of(s).find(filter) != std::string::npos) {
+                        run(s, threads, duration);
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+/*
+ * Deadline operations/sec with `outstanding` requests in flight, each
+ * with a total deadline and a read deadline re-armed on every read: one
+ * steady_timer per deadline, as the client had, against the entries of a
+ * timer_wheel. Usage: timer_bench [operations] [outstanding]
+ */
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstdlib>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <network/http/client/connection/timer_wheel.hpp>
+
+namespace {
+    using network::http::client_connection::timer_wheel;
+
+    /* reads per request before it completes */
+    enum : std::size_t { reads = 4 };
+
+    double run_timers(std::size_t operations, std::size_t outstanding) {
+        boost::asio::io_service io_service;
+        std::vector<std::unique_ptr<boost::asio::steady_timer> > total, read;
+        for (std::size_t i = 0; i < outstanding; ++i) {
+            total.emplace_back(new boost::asio::steady_timer(io_service));
+            read.emplace_back(new boost::asio::steady_timer(io_service));
+            total[i]->expires_from_now(std::chrono::seconds(30));
+            total[i]->async_wait([] (const boost::system::error_code &) { });
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t op = 0; op < operations; ++op) {
+            std::size_t i = op % outstanding;
+            if (op / outstanding % (reads + 1) == reads) {
+                /* the request completes, another takes its place */
+                total[i]->expires_from_now(std::chrono::seconds(30));
+                total[i]->async_wait([] (const boost::system::error_code &) { });
+            }
+            read[i]->expires_from_now(std::chrono::seconds(30));
+            read[i]->async_wait([] (const boost::system::error_code &) { });
+            if (op % 1024 == 0) {
+                io_service.poll();
+            }
+        }
+        io_service.poll();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << "steady_timer " << operations / elapsed.count() << " ops/s" << std::endl;
+        return operations / elapsed.count();
+    }
+
+    double run_wheel(std::size_t operations, std::size_t outstanding) {
+        timer_wheel wheel;
+        std::vector<std::unique_ptr<timer_wheel::entry> > total, read;
+        for (std::size_t i = 0; i < outstanding; ++i) {
+            total.emplace_back(new timer_wheel::entry(wheel));
+            read.emplace_back(new timer_wheel::entry(wheel));
+            wheel.arm(*total[i], timer_wheel::clock::now() + std::chrono::seconds(30));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t op = 0; op < operations; ++op) {
+            std::size_t i = op % outstanding;
+            if (op / outstanding % (reads + 1) == reads) {
+                wheel.arm(*total[i], timer_wheel::clock::now() + std::chrono::seconds(30));
+            }
+            wheel.arm(*read[i], timer_wheel::clock::now() + std::chrono::seconds(30));
+            if (op % 1024 == 0) {
+                wheel.advance(timer_wheel::clock::now(), [] (timer_wheel::entry &) { });
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << "timer_wheel  " << operations / elapsed.count() << " ops/s" << std::endl;
+        return operations / elapsed.count();
+    }
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::size_t operations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+    std::size_t outstanding = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 50000;
+
+    double timers = run_timers(operations, outstanding);
+    double wheel = run_wheel(operations, outstanding);
+    std::cout << "speedup      " << wheel / timers << "x" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,58 @@
+/*
+ * Connections/sec over https to a loopback server with a self-signed
+ * certificate, one new connection per request: full handshakes, with the
+ * session cache cleared before each, against handshakes resuming the
+ * session of the previous connection, for TLS 1.2 and TLS 1.3. Build with
+ * NETLIBX_ENABLE_HTTPS, linking OpenSSL. Usage: tls_bench [connections]
+ */
+#include <iostream>
+#include <memory>
+#include <chrono>
+#include <cstdlib>
+#include <network/http/client.hpp>
+#include "loopback_server.hpp"
+
+namespace {
+    using namespace network::http;
+
+    double run(const char *label, int version, bool resume, std::size_t connections) {
+        auto server_context = network::bench::self_signed_context();
+        SSL_CTX_set_min_proto_version(server_context->native_handle(), version);
+        SSL_CTX_set_max_proto_version(server_context->native_handle(), version);
+        network::bench::loopback_server server(server_context);
+
+        auto tls = std::make_shared<client_connection::tls_context>(
+            std::vector<std::string>(), std::vector<std::string>(), false);
+        client c(client_options().keep_alive(false).tls_context(tls));
+        network::uri url(server.url());
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < connections; ++i) {
+            if (!resume) {
+                tls->clear();
+            }
+            c.get(request(url)).get();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        auto stats = tls->statistics();
+        std::cout << label << connections / elapsed.count() << " connections/s, "
+                  << stats.full_handshakes << " full, "
+                  << stats.resumed_handshakes << " resumed, "
+                  << server.accepted() << " accepted" << std::endl;
+        return connections / elapsed.count();
+    }
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::size_t connections = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+
+    double full12 = run("TLS 1.2 full    ", TLS1_2_VERSION, false, connections);
+    double resumed12 = run("TLS 1.2 resumed ", TLS1_2_VERSION, true, connections);
+    double full13 = run("TLS 1.3 full    ", TLS1_3_VERSION, false, connections);
+    double resumed13 = run("TLS 1.3 resumed ", TLS1_3_VERSION, true, connections);
+    std::cout << "speedup         TLS 1.2 " << resumed12 / full12
+              << "x, TLS 1.3 " << resumed13 / full13 << "x" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+/*
+ * Cost of tracing: requests/sec over one keep-alive connection with
+ * trace_events off and on, best of 5 runs each, then what adding an event
+ * costs alone. Built without NETLIBX_ENABLE_TRACE both runs trace nothing;
+ * build it both ways to compare. With a path, the events of the last run
+ * are written there as a trace file and, with a second path, as Chrome
+ * trace JSON. Usage: trace_bench [requests [trace-file [json-file]]]
+ */
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <network/http/client.hpp>
+#include "loopback_server.hpp"
+
+namespace {
+    using namespace network::http;
+
+    double run(network::bench::loopback_server &server, std::size_t events, std::size_t requests,
+        std::vector<client_message::trace_record> &records, std::uint64_t &lost) {
+        client c(client_options().record_latency(false).trace_events(events));
+        network::uri url(server.url());
+
+        records.clear();
+        lost = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < requests; ++i) {
+            c.get(request(url)).get();
+            /* drained as it goes, as a process writing a trace file would */
+            if (i % 1024 == 1023) {
+                lost += c.drain_trace(records);
+            }
+        }
+        lost += c.drain_trace(records);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return requests / elapsed.count();
+    }
+
+    void adding_alone(std::size_t events) {
+        client_message::trace_buffer buffer(64 * 1024);
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < events; ++i) {
+            buffer.add(client_message::trace_event::first_byte, i);
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "adding alone    " << std::setprecision(1) << elapsed.count() / events << " ns/event" << std::endl;
+    }
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::size_t requests = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+
+#if defined(NETLIBX_ENABLE_TRACE)
+    std::cout << "built with NETLIBX_ENABLE_TRACE" << std::endl;
+#else
+    std::cout << "built without NETLIBX_ENABLE_TRACE" << std::endl;
+#endif // defined(NETLIBX_ENABLE_TRACE)
+
+    network::bench::loopback_server server;
+    std::vector<client_message::trace_record> records;
+    std::uint64_t lost = 0;
+    double off = 0, on = 0;
+    for (int i = 0; i < 5; ++i) {
+        off = std::max(off, run(server, 0, requests, records, lost));
+        on = std::max(on, run(server, 16 * 1024, requests, records, lost));
+    }
+    std::cout << std::fixed << std::setprecision(0) << "trace off       " << off << " req/s" << std::endl;
+    std::cout << "trace on        " << on << " req/s, " << records.size() << " events, " << lost << " lost" << std::endl;
+    adding_alone(requests * 100);
+
+    if (argc > 2) {
+        std::ofstream file(argv[2], std::ios::binary);
+        client_message::write_trace_header(file);
+        client_message::write_trace_records(file, records);
+    }
+    if (argc > 3) {
+        std::ifstream file(argv[2], std::ios::binary);
+        std::vector<client_message::trace_record> read;
+        if (!client_message::read_trace(file, read)) {
+            std::cerr << argv[2] << ": not a trace file" << std::endl;
+            return 1;
+        }
+        std::ofstream json(argv[3]);
+        client_message::write_chrome_trace(json, read);
+    }
+
+    return 0;
+}
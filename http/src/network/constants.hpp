@@ -28,6 +28,14 @@ namespace network {
         static char        hash_char();
         static char const* connection();
         static char const* close();
+        static char const* keep_alive();
+        static char const* content_length();
+        static char const* transfer_encoding();
+        static char const* content_encoding();
+        static char const* location();
+        static char const* authorization();
+        static char const* cookie();
+        static char const* chunked();
         static char const* https();
         static char const* http();
     };
@@ -36,68 +44,68 @@ namespace network {
 
 namespace network {
     
-    char const* constants::crlf() {
+    inline char const* constants::crlf() {
         static char crlf_[] = "\r\n";
         return crlf_;
     }
 
-    char const* constants::dot() {
+    inline char const* constants::dot() {
         static char dot_[] = ".";
         return dot_;
     }
 
-    char constants::dot_char() {
+    inline char constants::dot_char() {
         return '.';
     }
 
-    char const* constants::http_slash() {
+    inline char const* constants::http_slash() {
         static char http_slash_[] = "HTTP/";
         return http_slash_;
     }
 
-    char const* constants::space() {
+    inline char const* constants::space() {
         static char space_[] = {' ', 0};
         return space_;
     }
 
-    char constants::space_char() {
+    inline char constants::space_char() {
         return ' ';
     }
 
-    char const* constants::slash() {
+    inline char const* constants::slash() {
         static char slash_[] = {'/', 0};
         return slash_;
     }
 
-    char constants::slash_char() {
+    inline char constants::slash_char() {
         return '/';
     }
 
-    char const* constants::host() {
+    inline char const* constants::host() {
         static char host_[] = {'H', 'O', 'S', 'T', 0};
         return host_;
     }
 
-    char const* constants::colon() {
+    inline char const* constants::colon() {
         static char colon_[] = {':', 0};
         return colon_;
     }
 
-    char constants::colon_char() {
+    inline char constants::colon_char() {
         return ':';
     }
 
-    char const* constants::accept() {
+    inline char const* constants::accept() {
         static char accept_[] = {'A', 'c', 'c', 'e', 'p', 't', 0};
         return accept_;
     }
 
-    char const* constants::default_accept_mime() {
+    inline char const* constants::default_accept_mime() {
         static char mime_[] = {'*', '/', '*', 0};
         return mime_;
     }
 
-    char const* constants::accept_encoding() {
+    inline char const* constants::accept_encoding() {
         static char accept_encoding_[] = {
             'A',
             'c',
@@ -119,7 +127,7 @@ namespace network {
         return accept_encoding_;
     }
 
-    char const* constants::default_accept_encoding() {
+    inline char const* constants::default_accept_encoding() {
         static char default_accept_encoding_[] = { 
             'i',
             'd',
@@ -147,45 +155,85 @@ namespace network {
         return default_accept_encoding_;
     }
 
-    char const* constants::user_agent() {
+    inline char const* constants::user_agent() {
         static char user_agent_[] = { 'U', 's', 'e', 'r', '-', 'A', 'g', 'e', 'n', 't', 0 };
         return user_agent_;
     }
 
-    char const* constants::cpp_netlib_slash() {
+    inline char const* constants::cpp_netlib_slash() {
         static char cpp_netlib_slash_[] = { 'c', 'p', 'p', '-', 'n', 'e', 't', 'l', 'i', 'b', '/', 0 };
         return cpp_netlib_slash_;
     }
 
-    char constants::question_mark_char() {
+    inline char constants::question_mark_char() {
         return '?'; 
     }
 
-    char constants::hash_char() { 
+    inline char constants::hash_char() { 
         return '#';
     }
 
-    char const* constants::connection() {
+    inline char const* constants::connection() {
         static char connection_[] = "Connection";
         return connection_;
     }
 
-    char const* constants::close() {
+    inline char const* constants::close() {
         static char close_[] = "close";
         return close_;
     }
 
-    char const* constants::https() {
+    inline char const* constants::keep_alive() {
+        static char keep_alive_[] = "keep-alive";
+        return keep_alive_;
+    }
+
+    inline char const* constants::content_length() {
+        static char content_length_[] = "Content-Length";
+        return content_length_;
+    }
+
+    inline char const* constants::transfer_encoding() {
+        static char transfer_encoding_[] = "Transfer-Encoding";
+        return transfer_encoding_;
+    }
+
+    inline char const* constants::content_encoding() {
+        static char content_encoding_[] = "Content-Encoding";
+        return content_encoding_;
+    }
+
+    inline char const* constants::location() {
+        static char location_[] = "Location";
+        return location_;
+    }
+
+    inline char const* constants::authorization() {
+        static char authorization_[] = "Authorization";
+        return authorization_;
+    }
+
+    inline char const* constants::cookie() {
+        static char cookie_[] = "Cookie";
+        return cookie_;
+    }
+
+    inline char const* constants::chunked() {
+        static char chunked_[] = "chunked";
+        return chunked_;
+    }
+
+    inline char const* constants::https() {
         static char https_[] = "https";
         return https_;
     }
 
-    char const* constants::http() {
+    inline char const* constants::http() {
         static char http_[] = "http";
         return http_;
     }
 
-    char const* constants::default_user_agent() {
+    inline char const* constants::default_user_agent() {
         static char user_agent_[] = "cpp-netlib/" NETLIBX_VERSION;
         return user_agent_;
     }
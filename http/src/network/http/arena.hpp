@@ -0,0 +1,189 @@
+#ifndef NETWORK_HTTP_ARENA_INC
+#define NETWORK_HTTP_ARENA_INC
+
+#include <new>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <boost/intrusive_ptr.hpp>
+#include <network/config.hpp>
+
+namespace network {
+    namespace http {
+        class monotonic_arena;
+        typedef boost::intrusive_ptr<monotonic_arena> arena_ptr;
+
+        /*
+         * class monotonic_arena
+         *
+         * Bump allocator for the objects of one request/response exchange.
+         * The arena and its first block are a single allocation; when that
+         * block is full, further blocks grow geometrically. Memory is only
+         * given back all at once, when the last reference to the arena goes
+         * away; deallocating a single object is a no-op. Allocating is not
+         * thread safe, the reference count is.
+         */
+        class monotonic_arena {
+            monotonic_arena(const monotonic_arena &) = delete;
+            monotonic_arena &operator = (const monotonic_arena &) = delete;
+
+        public:
+            static arena_ptr create(std::size_t initial_block = 4096) {
+                void *p = ::operator new(sizeof(monotonic_arena) + initial_block);
+                return arena_ptr(new (p) monotonic_arena(initial_block));
+            }
+
+            void *allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t)) {
+                char *p = align(_cursor, alignment);
+                if (p + bytes > _end) {
+                    grow(bytes + alignment);
+                    p = align(_cursor, alignment);
+                }
+                _cursor = p + bytes;
+                _bytes_allocated += bytes;
+                return p;
+            }
+
+            /* bytes handed out over the lifetime of the arena */
+            std::size_t bytes_allocated() const {
+                return _bytes_allocated;
+            }
+
+            /* blocks requested from operator new besides the first one */
+            std::size_t blocks_allocated() const {
+                return _blocks_allocated;
+            }
+
+        private:
+            struct block {
+                block *next;
+            };
+
+            explicit monotonic_arena(std::size_t initial_block) :
+                _references(0),
+                _blocks(nullptr),
+                _cursor(reinterpret_cast<char *>(this + 1)),
+                _end(_cursor + initial_block),
+                _next_block(initial_block < 256 ? 512 : initial_block * 2),
+                _bytes_allocated(0),
+                _blocks_allocated(0) { }
+
+            ~monotonic_arena() {
+                while (_blocks) {
+                    block *next = _blocks->next;
+                    ::operator delete(_blocks);
+                    _blocks = next;
+                }
+            }
+
+            static char *align(char *p, std::size_t alignment) {
+                auto address = reinterpret_cast<std::uintptr_t>(p);
+                return reinterpret_cast<char *>((address + alignment - 1) & ~(alignment - 1));
+            }
+
+            void grow(std::size_t min_bytes) {
+                std::size_t size = _next_block;
+                while (size < min_bytes + sizeof(block)) {
+                    size *= 2;
+                }
+                auto b = static_cast<block *>(::operator new(size));
+                b->next = _blocks;
+                _blocks = b;
+                _cursor = reinterpret_cast<char *>(b + 1);
+                _end = reinterpret_cast<char *>(b) + size;
+                _next_block = size * 2;
+                ++_blocks_allocated;
+            }
+
+            friend void intrusive_ptr_add_ref(monotonic_arena *arena) {
+                arena->_references.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            friend void intrusive_ptr_release(monotonic_arena *arena) {
+                if (arena->_references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    arena->~monotonic_arena();
+                    ::operator delete(arena);
+                }
+            }
+
+            std::atomic<std::size_t> _references;
+            block *_blocks;
+            char *_cursor;
+            char *_end;
+            std::size_t _next_block;
+            std::size_t _bytes_allocated;
+            std::size_t _blocks_allocated;
+        };
+
+        /*
+         * class arena_allocator
+         *
+         * Allocator drawing from a monotonic_arena, which stays alive as long
+         * as any allocator (and so any container) refers to it. A default
+         * constructed arena_allocator uses operator new/delete.
+         *
+         * The arena goes with a container when it is moved or swapped, but
+         * not when it is copied: a copy allocates from the heap, so it can be
+         * used from another thread than the original.
+         */
+        template <class T>
+            class arena_allocator {
+            public:
+                typedef T value_type;
+                typedef std::false_type propagate_on_container_copy_assignment;
+                typedef std::true_type propagate_on_container_move_assignment;
+                typedef std::true_type propagate_on_container_swap;
+
+                template <class U>
+                    struct rebind {
+                        typedef arena_allocator<U> other;
+                    };
+
+                arena_allocator() noexcept { }
+
+                explicit arena_allocator(arena_ptr arena) noexcept :
+                    _arena(std::move(arena)) { }
+
+                template <class U>
+                    arena_allocator(const arena_allocator<U> &other) noexcept :
+                        _arena(other.arena()) { }
+
+                T *allocate(std::size_t n) {
+                    if (!_arena) {
+                        return static_cast<T *>(::operator new(n * sizeof(T)));
+                    }
+                    return static_cast<T *>(_arena->allocate(n * sizeof(T), alignof(T)));
+                }
+
+                void deallocate(T *p, std::size_t) noexcept {
+                    if (!_arena) {
+                        ::operator delete(p);
+                    }
+                }
+
+                arena_allocator select_on_container_copy_construction() const {
+                    return arena_allocator();
+                }
+
+                const arena_ptr &arena() const noexcept {
+                    return _arena;
+                }
+
+            private:
+                arena_ptr _arena;
+            };
+
+        template <class T, class U>
+            inline bool operator == (const arena_allocator<T> &lhs, const arena_allocator<U> &rhs) noexcept {
+                return lhs.arena() == rhs.arena();
+            }
+
+        template <class T, class U>
+            inline bool operator != (const arena_allocator<T> &lhs, const arena_allocator<U> &rhs) noexcept {
+                return !(lhs == rhs);
+            }
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_ARENA_INC
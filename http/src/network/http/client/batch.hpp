@@ -0,0 +1,161 @@
+#ifndef NETWORK_HTTP_CLIENT_BATCH_INC
+#define NETWORK_HTTP_CLIENT_BATCH_INC
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <cstdint>
+#include <iterator>
+#include <functional>
+#include <condition_variable>
+#include <boost/optional.hpp>
+#include <network/config.hpp>
+#include <network/http/client/response.hpp>
+
+namespace network {
+    namespace http {
+        namespace client_message {
+            /*
+             * Called with each request of a batch as it completes: index is
+             * its position in the batch, result is ready and holds the
+             * response or the error. Returning false starts no further
+             * requests of the batch; those in flight are still reported.
+             * Calls are made on the client's io_service.
+             */
+            typedef std::function<bool (std::size_t index, std::future<response> result)> batch_handler;
+
+            struct batch_result {
+                std::size_t index;
+                std::future<response> result;
+            };
+
+            /*
+             * class batch
+             *
+             * The results of client::execute_batch() in the order the
+             * requests complete, so that a slow request does not hold up
+             * the ones after it. next() and the iterators block until the
+             * next result is in. Destroying the batch starts no further
+             * requests.
+             */
+            class batch {
+                batch(const batch &) = delete;
+                batch &operator = (const batch &) = delete;
+
+                struct state {
+                    explicit state(std::size_t size) :
+                        remaining(size), abandoned(false) { }
+
+                    std::mutex mutex;
+                    std::condition_variable ready;
+                    std::deque<batch_result> done;
+                    std::size_t remaining;
+                    std::atomic<bool> abandoned;
+                };
+
+            public:
+                class iterator {
+                public:
+                    typedef std::input_iterator_tag iterator_category;
+                    typedef batch_result value_type;
+                    typedef std::ptrdiff_t difference_type;
+                    typedef batch_result *pointer;
+                    typedef batch_result &reference;
+
+                    iterator() : _batch(nullptr) { }
+
+                    explicit iterator(batch &b) : _batch(&b) {
+                        ++*this;
+                    }
+
+                    reference operator * () {
+                        return *_current;
+                    }
+
+                    pointer operator -> () {
+                        return &*_current;
+                    }
+
+                    iterator &operator ++ () {
+                        _current = _batch->next();
+                        if (!_current) {
+                            _batch = nullptr;
+                        }
+                        return *this;
+                    }
+
+                    bool operator == (const iterator &other) const {
+                        return _batch == other._batch;
+                    }
+
+                    bool operator != (const iterator &other) const {
+                        return _batch != other._batch;
+                    }
+
+                private:
+                    batch *_batch;
+                    boost::optional<batch_result> _current;
+                };
+
+                explicit batch(std::size_t size) :
+                    _state(std::make_shared<state>(size)), _size(size) { }
+
+                batch(batch &&other) noexcept :
+                    _state(std::move(other._state)), _size(other._size) { }
+
+                ~batch() {
+                    if (_state) {
+                        _state->abandoned = true;
+                    }
+                }
+
+                /* the number of requests in the batch */
+                std::size_t size() const {
+                    return _size;
+                }
+
+                /* the next request to complete; none once all were handed out */
+                boost::optional<batch_result> next() {
+                    std::unique_lock<std::mutex> lock(_state->mutex);
+                    if (_state->remaining == 0) {
+                        return boost::none;
+                    }
+                    _state->ready.wait(lock, [this] () { return !_state->done.empty(); });
+                    batch_result r = std::move(_state->done.front());
+                    _state->done.pop_front();
+                    --_state->remaining;
+                    return r;
+                }
+
+                iterator begin() {
+                    return iterator(*this);
+                }
+
+                iterator end() {
+                    return iterator();
+                }
+
+                /* feeds the batch; what client::execute_batch() passes on */
+                batch_handler handler() const {
+                    std::shared_ptr<state> s = _state;
+                    return [s] (std::size_t index, std::future<response> result) {
+                        {
+                            std::lock_guard<std::mutex> lock(s->mutex);
+                            s->done.push_back(batch_result{ index, std::move(result) });
+                        }
+                        s->ready.notify_one();
+                        return !s->abandoned;
+                    };
+                }
+
+            private:
+                std::shared_ptr<state> _state;
+                std::size_t _size;
+            };
+        } // namespace client_message
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_BATCH_INC
@@ -0,0 +1,264 @@
+#ifndef NETWORK_HTTP_CLIENT_BYTE_SOURCE_INC
+#define NETWORK_HTTP_CLIENT_BYTE_SOURCE_INC
+
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <boost/asio/buffer.hpp>
+#include <boost/optional.hpp>
+#include <boost/system/system_error.hpp>
+#include <network/config.hpp>
+
+namespace network {
+    namespace http {
+        namespace client_message {
+            /*
+             * class: byte_source
+             *
+             * Body of a request, handed out piece by piece as views so that
+             * it never has to be held in memory as a whole or copied into a
+             * string. Sources are not copyable.
+             */
+            class byte_source {
+                byte_source(const byte_source &) = delete;
+                byte_source &operator = (const byte_source &) = delete;
+
+            public:
+                typedef boost::asio::const_buffer const_buffer;
+
+                byte_source() = default;
+
+                virtual ~byte_source() { }
+
+                /*
+                 * The length of the body if it is known up front; it is then
+                 * sent with Content-Length, otherwise with the chunked
+                 * transfer coding. A body that turns out shorter or longer
+                 * fails the request.
+                 */
+                virtual boost::optional<std::uint64_t> size() const = 0;
+
+                /*
+                 * The next piece of the body, at most max_len bytes, valid
+                 * until the next call. An empty buffer ends the body.
+                 */
+                virtual const_buffer next(std::size_t max_len) = 0;
+
+                /* starts over, to send the body again; false if the source cannot */
+                virtual bool rewind() {
+                    return false;
+                }
+
+                /*
+                 * A file descriptor holding the whole body, for transports
+                 * that can send it without copying it through user space.
+                 */
+                virtual int native_handle() const {
+                    return -1;
+                }
+            };
+
+            /* a body held in memory; the string is moved in, not copied */
+            class string_byte_source : public byte_source {
+            public:
+                explicit string_byte_source(std::string source) :
+                    _source(std::move(source)), _offset(0) { }
+
+                virtual ~string_byte_source() { }
+
+                virtual boost::optional<std::uint64_t> size() const {
+                    return static_cast<std::uint64_t>(_source.size());
+                }
+
+                virtual const_buffer next(std::size_t max_len) {
+                    std::size_t len = std::min(max_len, _source.size() - _offset);
+                    const_buffer piece(_source.data() + _offset, len);
+                    _offset += len;
+                    return piece;
+                }
+
+                virtual bool rewind() {
+                    _offset = 0;
+                    return true;
+                }
+
+            private:
+                std::string _source;
+                std::size_t _offset;
+            };
+
+            /* a file mapped into memory, pages are read in as they are sent */
+            class mapped_file_byte_source : public byte_source {
+            public:
+                explicit mapped_file_byte_source(const std::string &path) :
+                    _data(nullptr), _size(0), _offset(0) {
+                    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                    if (fd < 0) {
+                        throw boost::system::system_error(errno, boost::system::system_category(), path);
+                    }
+
+                    struct stat st;
+                    if (::fstat(fd, &st) != 0) {
+                        int error = errno;
+                        ::close(fd);
+                        throw boost::system::system_error(error, boost::system::system_category(), path);
+                    }
+
+                    _size = static_cast<std::size_t>(st.st_size);
+                    if (_size != 0) {
+                        void *data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+                        if (data == MAP_FAILED) {
+                            int error = errno;
+                            ::close(fd);
+                            throw boost::system::system_error(error, boost::system::system_category(), path);
+                        }
+                        ::madvise(data, _size, MADV_SEQUENTIAL);
+                        _data = static_cast<const char *>(data);
+                    }
+                    ::close(fd);
+                }
+
+                virtual ~mapped_file_byte_source() {
+                    if (_data) {
+                        ::munmap(const_cast<char *>(_data), _size);
+                    }
+                }
+
+                virtual boost::optional<std::uint64_t> size() const {
+                    return static_cast<std::uint64_t>(_size);
+                }
+
+                virtual const_buffer next(std::size_t max_len) {
+                    std::size_t len = std::min(max_len, _size - _offset);
+                    const_buffer piece(_data + _offset, len);
+                    _offset += len;
+                    return piece;
+                }
+
+                virtual bool rewind() {
+                    _offset = 0;
+                    return true;
+                }
+
+            private:
+                const char *_data;
+                std::size_t _size;
+                std::size_t _offset;
+            };
+
+            /*
+             * A file sent with sendfile() over plain TCP connections; other
+             * transports read it through a fixed buffer.
+             */
+            class file_byte_source : public byte_source {
+            public:
+                explicit file_byte_source(const std::string &path, std::size_t buffer_size = 64 * 1024) :
+                    _fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC)),
+                    _size(0),
+                    _offset(0),
+                    _buffer(buffer_size == 0 ? 1 : buffer_size) {
+                    if (_fd < 0) {
+                        throw boost::system::system_error(errno, boost::system::system_category(), path);
+                    }
+
+                    struct stat st;
+                    if (::fstat(_fd, &st) != 0) {
+                        int error = errno;
+                        ::close(_fd);
+                        throw boost::system::system_error(error, boost::system::system_category(), path);
+                    }
+                    _size = static_cast<std::uint64_t>(st.st_size);
+                }
+
+                virtual ~file_byte_source() {
+                    ::close(_fd);
+                }
+
+                virtual boost::optional<std::uint64_t> size() const {
+                    return _size;
+                }
+
+                virtual const_buffer next(std::size_t max_len) {
+                    std::size_t len = static_cast<std::size_t>(
+                        std::min<std::uint64_t>(std::min(max_len, _buffer.size()), _size - _offset));
+                    if (len == 0) {
+                        return const_buffer();
+                    }
+
+                    ssize_t n;
+                    do {
+                        n = ::pread(_fd, &_buffer[0], len, static_cast<off_t>(_offset));
+                    } while (n < 0 && errno == EINTR);
+                    if (n < 0) {
+                        throw boost::system::system_error(errno, boost::system::system_category());
+                    }
+                    if (n == 0) {
+                        /* the file shrank, the announced length cannot be met */
+                        throw boost::system::system_error(
+                            make_error_code(boost::system::errc::io_error));
+                    }
+
+                    _offset += static_cast<std::uint64_t>(n);
+                    return const_buffer(_buffer.data(), static_cast<std::size_t>(n));
+                }
+
+                virtual bool rewind() {
+                    _offset = 0;
+                    return true;
+                }
+
+                virtual int native_handle() const {
+                    return _fd;
+                }
+
+            private:
+                int _fd;
+                std::uint64_t _size;
+                std::uint64_t _offset;
+                std::vector<char> _buffer;
+            };
+
+            /*
+             * A body of unknown length produced on the fly, sent with the
+             * chunked transfer coding. The generator returns the next piece,
+             * valid until it is called again, and an empty buffer at the end.
+             */
+            class generator_byte_source : public byte_source {
+            public:
+                typedef std::function<const_buffer ()> generator;
+
+                explicit generator_byte_source(generator gen) :
+                    _generator(std::move(gen)) { }
+
+                virtual ~generator_byte_source() { }
+
+                virtual boost::optional<std::uint64_t> size() const {
+                    return boost::none;
+                }
+
+                virtual const_buffer next(std::size_t max_len) {
+                    if (boost::asio::buffer_size(_pending) == 0) {
+                        _pending = _generator();
+                    }
+                    const_buffer piece(_pending.data(), std::min(max_len, _pending.size()));
+                    _pending += piece.size();
+                    return piece;
+                }
+
+            private:
+                generator _generator;
+                const_buffer _pending;
+            };
+        } // namespace client_message
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_BYTE_SOURCE_INC
@@ -3,23 +3,60 @@
 
 #include <future>
 #include <memory>
+#include <cstdio>
+#include <cstdlib>
 #include <cstdint>
 #include <string>
 #include <vector>
 #include <chrono>
 #include <algorithm>
+#include <atomic>
+#include <thread>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#if defined(__linux__)
+#include <sched.h>
+#include <pthread.h>
+#endif // defined(__linux__)
 #include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/io_service_strand.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/dispatch.hpp>
 #include <boost/optional.hpp>
 #include <network/config.hpp>
 #include <network/version.hpp>
+#include <network/constants.hpp>
+#include <network/http/arena.hpp>
 #include <network/http/client/request.hpp>
 #include <network/http/client/response.hpp>
+#include <network/http/client/response_parser.hpp>
+#include <network/http/client/batch.hpp>
+#include <network/http/client/content_decoder.hpp>
+#include <network/http/client/redirect_cache.hpp>
+#include <network/http/client/response_cache.hpp>
+#include <network/http/client/latency.hpp>
+#include <network/http/client/trace.hpp>
+#include <network/http/client/connection/resolver_cache.hpp>
+#include <network/http/client/connection/timer_wheel.hpp>
+#include <network/http/client/connection/async_resolver.hpp>
+#include <network/http/client/connection/async_connection.hpp>
+#include <network/http/client/connection/transport.hpp>
+#include <network/http/client/connection/normal_connection.hpp>
+#include <network/http/client/connection/connection_pool.hpp>
+#include <network/http/client/connection/happy_eyeballs.hpp>
+#include <network/http/client/connection/http2_session.hpp>
+#if defined(NETLIBX_ENABLE_HTTPS)
+#include <network/http/client/connection/ssl_connection.hpp>
+#endif // defined(NETLIBX_ENABLE_HTTPS)
 
 namespace network {
     namespace http {
         namespace client_connection {
-            class async_resolver;
-            class async_connection;
+            class tls_context;
         } // namespace client_connection
 
         class client_options {
@@ -31,7 +68,19 @@ namespace network {
                 _use_proxy(false),
                 _always_verify_peer(false),
                 _user_agent(std::string("cpp-netlibx/") + NETLIBX_VERSION),
-                _timeout(30000) { }
+                _timeout(30000),
+                _keep_alive(true),
+                _max_connections_per_host(8),
+                _max_idle_connections_per_host(4),
+                _idle_connection_timeout(30000),
+                _exchange_arena_size(0),
+                _connection_attempt_delay(250),
+                _pipeline_depth(0),
+                _http2(false),
+                _io_threads(1),
+                _decompress(true),
+                _record_latency(true),
+                _trace_events(0) { }
 
             client_options(const client_options &other) :
                 _io_service(other._io_service),
@@ -40,7 +89,27 @@ namespace network {
                 _use_proxy(other._use_proxy),
                 _always_verify_peer(other._always_verify_peer),
                 _user_agent(other._user_agent),
-                _timeout(other._timeout) { }
+                _timeout(other._timeout),
+                _openssl_certificate_paths(other._openssl_certificate_paths),
+                _openssl_verify_paths(other._openssl_verify_paths),
+                _tls_context(other._tls_context),
+                _keep_alive(other._keep_alive),
+                _max_connections_per_host(other._max_connections_per_host),
+                _max_idle_connections_per_host(other._max_idle_connections_per_host),
+                _idle_connection_timeout(other._idle_connection_timeout),
+                _exchange_arena_size(other._exchange_arena_size),
+                _resolver_cache(other._resolver_cache),
+                _redirect_cache(other._redirect_cache),
+                _response_cache(other._response_cache),
+                _connection_attempt_delay(other._connection_attempt_delay),
+                _connect_observer(other._connect_observer),
+                _transport(other._transport),
+                _pipeline_depth(other._pipeline_depth),
+                _http2(other._http2),
+                _io_threads(other._io_threads),
+                _decompress(other._decompress),
+                _record_latency(other._record_latency),
+                _trace_events(other._trace_events) { }
 
             client_options(client_options &&other) :
                 _io_service(std::move(other._io_service)),
@@ -49,7 +118,27 @@ namespace network {
                 _use_proxy(std::move(other._use_proxy)),
                 _always_verify_peer(std::move(other._always_verify_peer)),
                 _user_agent(std::move(other._user_agent)),
-                _timeout(std::move(other._timeout)) { }
+                _timeout(std::move(other._timeout)),
+                _openssl_certificate_paths(std::move(other._openssl_certificate_paths)),
+                _openssl_verify_paths(std::move(other._openssl_verify_paths)),
+                _tls_context(std::move(other._tls_context)),
+                _keep_alive(std::move(other._keep_alive)),
+                _max_connections_per_host(std::move(other._max_connections_per_host)),
+                _max_idle_connections_per_host(std::move(other._max_idle_connections_per_host)),
+                _idle_connection_timeout(std::move(other._idle_connection_timeout)),
+                _exchange_arena_size(std::move(other._exchange_arena_size)),
+                _resolver_cache(std::move(other._resolver_cache)),
+                _redirect_cache(std::move(other._redirect_cache)),
+                _response_cache(std::move(other._response_cache)),
+                _connection_attempt_delay(std::move(other._connection_attempt_delay)),
+                _connect_observer(std::move(other._connect_observer)),
+                _transport(std::move(other._transport)),
+                _pipeline_depth(std::move(other._pipeline_depth)),
+                _http2(std::move(other._http2)),
+                _io_threads(std::move(other._io_threads)),
+                _decompress(std::move(other._decompress)),
+                _record_latency(std::move(other._record_latency)),
+                _trace_events(std::move(other._trace_events)) { }
             
             client_options &operator = (client_options copts) {
                 copts.swap(*this);
@@ -70,6 +159,26 @@ namespace network {
                 swap(_always_verify_peer, other._always_verify_peer);
                 swap(_user_agent, other._user_agent);
                 swap(_timeout, other._timeout);
+                swap(_openssl_certificate_paths, other._openssl_certificate_paths);
+                swap(_openssl_verify_paths, other._openssl_verify_paths);
+                swap(_tls_context, other._tls_context);
+                swap(_keep_alive, other._keep_alive);
+                swap(_max_connections_per_host, other._max_connections_per_host);
+                swap(_max_idle_connections_per_host, other._max_idle_connections_per_host);
+                swap(_idle_connection_timeout, other._idle_connection_timeout);
+                swap(_exchange_arena_size, other._exchange_arena_size);
+                swap(_resolver_cache, other._resolver_cache);
+                swap(_redirect_cache, other._redirect_cache);
+                swap(_response_cache, other._response_cache);
+                swap(_connection_attempt_delay, other._connection_attempt_delay);
+                swap(_connect_observer, other._connect_observer);
+                swap(_transport, other._transport);
+                swap(_pipeline_depth, other._pipeline_depth);
+                swap(_http2, other._http2);
+                swap(_io_threads, other._io_threads);
+                swap(_decompress, other._decompress);
+                swap(_record_latency, other._record_latency);
+                swap(_trace_events, other._trace_events);
             }
 
             client_options &io_service(boost::asio::io_service &iosrv) {
@@ -77,14 +186,21 @@ namespace network {
                 return *this;
             }
 
-            boost::optional<boost::asio::io_service> io_service() const {
-                return _io_service;
-            }
-
-            const boost::optional<boost::asio::io_service> &io_service() const {
+            boost::optional<boost::asio::io_service &> io_service() const {
                 return _io_service;
             }
 
+            /*
+             * follow_redirects: responses 301, 302, 303, 307 and 308 with a
+             * Location are not returned, the request is sent again there,
+             * up to request_options::max_redirects() times. 303, and 301 or
+             * 302 to a POST, turn the request into a GET without body. The
+             * Authorization and Cookie headers are not sent to another
+             * origin: a different scheme, host or port.
+             * A redirect that cannot be followed, e.g. because the body
+             * cannot be sent again, is returned with its body in
+             * response::body(), even with a sink.
+             */
             client_options &follow_redirects(bool bredir) {
                 _follow_redirects = bredir;
                 return (*this);
@@ -94,10 +210,6 @@ namespace network {
                 return _follow_redirects;
             }
 
-            const bool &follow_redirects() const {
-                return _follow_redirects;
-            }
-
             client_options &cache_resolved(bool resolved) {
                 _cache_resolved = resolved;
                 return (*this);
@@ -107,8 +219,47 @@ namespace network {
                 return _cache_resolved;
             }
 
-            const bool &cache_resolved() const {
-                return _cache_resolved;
+            /*
+             * resolver_cache: the cache used when cache_resolved is set, e.g.
+             * one shared between clients or preloaded with add_host(). By
+             * default every client has its own.
+             */
+            client_options &resolver_cache(std::shared_ptr<client_connection::resolver_cache> cache) {
+                _resolver_cache = std::move(cache);
+                return *this;
+            }
+
+            const std::shared_ptr<client_connection::resolver_cache> &resolver_cache() const {
+                return _resolver_cache;
+            }
+
+            /*
+             * redirect_cache: where permanent redirects are kept when
+             * follow_redirects is set, e.g. one shared between clients. By
+             * default every client has its own.
+             */
+            client_options &redirect_cache(std::shared_ptr<client_message::redirect_cache> cache) {
+                _redirect_cache = std::move(cache);
+                return *this;
+            }
+
+            const std::shared_ptr<client_message::redirect_cache> &redirect_cache() const {
+                return _redirect_cache;
+            }
+
+            /*
+             * response_cache: GET requests are answered from it while the
+             * response it holds is fresh, and sent with its validators once
+             * it is stale; responses that may be cached are stored in it.
+             * Requests with a body sink bypass it. None by default.
+             */
+            client_options &response_cache(std::shared_ptr<client_message::response_cache> cache) {
+                _response_cache = std::move(cache);
+                return *this;
+            }
+
+            const std::shared_ptr<client_message::response_cache> &response_cache() const {
+                return _response_cache;
             }
 
             client_options &use_proxy(bool bproxy) {
@@ -120,11 +271,7 @@ namespace network {
                 return _use_proxy;
             }
 
-            const bool &use_proxy() const {
-                return _use_proxy;
-            }
-
-            /* _timeout */
+            /* timeout: how long connecting to a host may take, all of its endpoints together */
             client_options &timeout(std::chrono::milliseconds ms) {
                 _timeout = ms;
                 return (*this);
@@ -134,35 +281,23 @@ namespace network {
                 return _timeout;
             }
 
-            const std::chrono::milliseconds &timeout() const {
-                return _timeout;
-            }
-
             /* _openssl_certificate_paths */
-            client_options *openssl_certificate_path(string path) {
+            client_options &openssl_certificate_path(std::string path) {
                 _openssl_certificate_paths.emplace_back(std::move(path));
                 return (*this);
             }
 
-            vector<string> openssl_certificate_paths() const {
-                return _openssl_certificate_paths;
-            }
-
-            const vector<string> &openssl_certificate_paths() const {
+            const std::vector<std::string> &openssl_certificate_paths() const {
                 return _openssl_certificate_paths;
             }
 
             /* openssl_verify_path */
-            client_options &openssl_verify_path(string path) {
+            client_options &openssl_verify_path(std::string path) {
                 _openssl_verify_paths.emplace_back(std::move(path));
                 return *this;
             }
 
-            vector<string> openssl_verify_paths() const {
-                return _openssl_verify_paths;
-            }
-
-            const vector<string> &openssl_verify_paths() const {
+            const std::vector<std::string> &openssl_verify_paths() const {
                 return _openssl_verify_paths;
             }
 
@@ -176,17 +311,234 @@ namespace network {
                 return _always_verify_peer;
             }
 
+            /*
+             * tls_context: the SSL context and session cache of https
+             * connections, e.g. one shared between clients or kept to read
+             * its statistics. It replaces the openssl_* and
+             * always_verify_peer options. By default every client makes its
+             * own from them.
+             */
+            client_options &tls_context(std::shared_ptr<client_connection::tls_context> context) {
+                _tls_context = std::move(context);
+                return *this;
+            }
+
+            const std::shared_ptr<client_connection::tls_context> &tls_context() const {
+                return _tls_context;
+            }
+
             /* user_agent */
-            client_options &user_agent(const string &uagent) {
+            client_options &user_agent(const std::string &uagent) {
                 _user_agent = uagent;
                 return *this;
             }
 
-            string user_agent() const {
+            const std::string &user_agent() const {
                 return _user_agent;
             }
-            const string &user_agent() const {
-                return _user_agent;
+
+            /*
+             * keep_alive: keep connections open after a response and reuse
+             * them for later requests to the same scheme/host/port. When
+             * disabled every request is sent with "Connection: close".
+             */
+            client_options &keep_alive(bool bkeep_alive) {
+                _keep_alive = bkeep_alive;
+                return *this;
+            }
+
+            bool keep_alive() const {
+                return _keep_alive;
+            }
+
+            /* max_connections_per_host: connections in use at once, further requests wait */
+            client_options &max_connections_per_host(std::size_t max_conns) {
+                _max_connections_per_host = max_conns;
+                return *this;
+            }
+
+            std::size_t max_connections_per_host() const {
+                return _max_connections_per_host;
+            }
+
+            /* max_idle_connections_per_host: idle connections kept for reuse */
+            client_options &max_idle_connections_per_host(std::size_t max_idle) {
+                _max_idle_connections_per_host = max_idle;
+                return *this;
+            }
+
+            std::size_t max_idle_connections_per_host() const {
+                return _max_idle_connections_per_host;
+            }
+
+            /* idle_connection_timeout: idle connections older than this are closed */
+            client_options &idle_connection_timeout(std::chrono::milliseconds ms) {
+                _idle_connection_timeout = ms;
+                return *this;
+            }
+
+            std::chrono::milliseconds idle_connection_timeout() const {
+                return _idle_connection_timeout;
+            }
+
+            /*
+             * exchange_arena_size: when non-zero, the state of each request,
+             * the response headers and body and the future's shared state are
+             * carved from one arena whose first block has this size (8 KiB
+             * holds a typical exchange). The arena is freed in one go once the
+             * response and its future are gone. bench/arena_bench.cpp counts
+             * 11 heap allocations per plain GET without it and 8 with it; the
+             * rest are the arena itself, the caller's copy of the URL, asio's
+             * three operations and the connection layer's three callbacks.
+             */
+            client_options &exchange_arena_size(std::size_t bytes) {
+                _exchange_arena_size = bytes;
+                return *this;
+            }
+
+            std::size_t exchange_arena_size() const {
+                return _exchange_arena_size;
+            }
+
+            /*
+             * connection_attempt_delay: when a host has several addresses, a
+             * connection to the next one is started this long after the
+             * previous one if that has not succeeded yet (RFC 8305). Zero
+             * tries the addresses one after the other.
+             */
+            client_options &connection_attempt_delay(std::chrono::milliseconds ms) {
+                _connection_attempt_delay = ms;
+                return *this;
+            }
+
+            std::chrono::milliseconds connection_attempt_delay() const {
+                return _connection_attempt_delay;
+            }
+
+            /* connect_observer: called with the attempts made for every new connection */
+            client_options &connect_observer(
+                std::function<void (const std::vector<client_connection::connect_attempt> &)> observer) {
+                _connect_observer = std::move(observer);
+                return *this;
+            }
+
+            const std::function<void (const std::vector<client_connection::connect_attempt> &)> &
+                connect_observer() const {
+                    return _connect_observer;
+                }
+
+            /*
+             * transport: resolvers and connections come from it instead of
+             * the system resolver and sockets, e.g. a
+             * client_connection::memory_transport answering from a
+             * capture. https:// origins then need no NETLIBX_ENABLE_HTTPS.
+             */
+            client_options &transport(std::shared_ptr<client_connection::transport> transport) {
+                _transport = std::move(transport);
+                return *this;
+            }
+
+            const std::shared_ptr<client_connection::transport> &transport() const {
+                return _transport;
+            }
+
+            /*
+             * pipeline_depth: GET and HEAD requests without a body are
+             * written up to this many at a time on one connection, before
+             * their responses arrive (HTTP/1.1 pipelining). The requests of
+             * a connection the server closes or that fails are sent again on
+             * connections of their own. 0 or 1 disables pipelining.
+             */
+            client_options &pipeline_depth(std::size_t depth) {
+                _pipeline_depth = depth;
+                return *this;
+            }
+
+            std::size_t pipeline_depth() const {
+                return _pipeline_depth;
+            }
+
+            /*
+             * http2: requests to an origin share one HTTP/2 connection and
+             * are sent on it concurrently. https:// origins are asked with
+             * ALPN and are talked to with HTTP/1.1 if they decline; http://
+             * origins must know HTTP/2 without being asked (prior
+             * knowledge). Requests of version "1.0" always use HTTP/1.
+             */
+            client_options &http2(bool enable) {
+                _http2 = enable;
+                return *this;
+            }
+
+            bool http2() const {
+                return _http2;
+            }
+
+            /*
+             * io_threads: the number of threads running the client when it
+             * owns its io_service, 0 for one per CPU. Each thread has an
+             * io_service and connection pool of its own and is pinned to a
+             * CPU, a connection is only used on the thread that opened it,
+             * and a new request goes to the thread with the fewest
+             * outstanding. Connection limits apply per thread. Ignored when
+             * io_service() is set.
+             */
+            client_options &io_threads(std::size_t count) {
+                _io_threads = count;
+                return *this;
+            }
+
+            std::size_t io_threads() const {
+                return _io_threads;
+            }
+
+            /*
+             * decompress: requests without an Accept-Encoding header ask for
+             * the encodings the client was built to decode (gzip and deflate
+             * with NETLIBX_ENABLE_ZLIB, br with NETLIBX_ENABLE_BROTLI), and
+             * bodies so encoded are decoded as they arrive, for the response
+             * or the body sink. A decoded response has no Content-Encoding
+             * header, and its Content-Length is that of the decoded body, or
+             * is removed when the body went to a sink. Requests with an
+             * Accept-Encoding of their own get the body and headers as sent.
+             */
+            client_options &decompress(bool enable) {
+                _decompress = enable;
+                return *this;
+            }
+
+            bool decompress() const {
+                return _decompress;
+            }
+
+            /*
+             * record_latency: the time requests spend in each phase, see
+             * client_message::latency_phase, is kept in histograms per
+             * host, which client::latency() reads. Each thread of the
+             * client records into its own.
+             */
+            client_options &record_latency(bool enable) {
+                _record_latency = enable;
+                return *this;
+            }
+
+            bool record_latency() const {
+                return _record_latency;
+            }
+
+            /*
+             * trace_events: the number of events each thread of the client
+             * keeps for client::drain_trace(), see
+             * client_message::trace_event; 0 for none. Only a client built
+             * with NETLIBX_ENABLE_TRACE traces, others do not even check.
+             */
+            client_options &trace_events(std::size_t count) {
+                _trace_events = count;
+                return *this;
+            }
+
+            std::size_t trace_events() const {
+                return _trace_events;
             }
 
         private:
@@ -195,10 +547,28 @@ namespace network {
             bool _cache_resolved;
             bool _use_proxy;
             bool _always_verify_peer;
-            string _user_agent;
+            std::string _user_agent;
             std::chrono::milliseconds _timeout;
-            vector<string> _openssl_certificate_paths;
-            vector<string> _openssl_verify_paths;
+            std::vector<std::string> _openssl_certificate_paths;
+            std::vector<std::string> _openssl_verify_paths;
+            std::shared_ptr<client_connection::tls_context> _tls_context;
+            bool _keep_alive;
+            std::size_t _max_connections_per_host;
+            std::size_t _max_idle_connections_per_host;
+            std::chrono::milliseconds _idle_connection_timeout;
+            std::size_t _exchange_arena_size;
+            std::shared_ptr<client_connection::resolver_cache> _resolver_cache;
+            std::shared_ptr<client_message::redirect_cache> _redirect_cache;
+            std::shared_ptr<client_message::response_cache> _response_cache;
+            std::chrono::milliseconds _connection_attempt_delay;
+            std::function<void (const std::vector<client_connection::connect_attempt> &)> _connect_observer;
+            std::shared_ptr<client_connection::transport> _transport;
+            std::size_t _pipeline_depth;
+            bool _http2;
+            std::size_t _io_threads;
+            bool _decompress;
+            bool _record_latency;
+            std::size_t _trace_events;
         };
 
         inline void swap(client_options &lhs, client_options &rhs) {
@@ -209,14 +579,14 @@ namespace network {
         typedef client_message::request_options request_options;
         typedef client_message::request         request;
         typedef client_message::response        response;
+        typedef client_message::batch           batch;
+        typedef client_message::batch_handler   batch_handler;
 
         class client {
             client(const client &) = delete;
             client& operator = (const client &) = delete;
 
         public:
-            using std::string;
-
             explicit client(client_options options = client_options());
 
             client(std::unique_ptr<client_connection::async_resolver> mock_resolver,
@@ -227,7 +597,7 @@ namespace network {
 
             std::future<response> execute(request req, request_options options = request_options());
 
-            std::future<request> get(request req, request_options options = request_options());
+            std::future<response> get(request req, request_options options = request_options());
 
             std::future<response> post(request req, request_options options = request_options());
 
@@ -239,11 +609,2236 @@ namespace network {
 
             std::future<response> options(request req, request_options options = request_options());
 
+            /*
+             * Sends all of requests with the same options, at most
+             * `concurrency` of them at a time (0 for no limit), and passes
+             * each result to handler as it completes.
+             */
+            void execute_batch(std::vector<request> requests, request_options options,
+                std::size_t concurrency, batch_handler handler);
+
+            /* as above, the results are taken from the returned batch in the order they complete */
+            batch execute_batch(std::vector<request> requests, request_options options = request_options(),
+                std::size_t concurrency = 0);
+
+            /*
+             * Asio forms of execute() and the functions below. The token
+             * decides how the result is delivered: a callback
+             * void (std::exception_ptr, response), boost::asio::use_future,
+             * or boost::asio::use_awaitable for co_await in a coroutine.
+             * The completion is kept with the exchange, no promise is made
+             * unless the token asks for one, and it is called through the
+             * token's associated executor. The options come last so that
+             * they can be left out.
+             */
+            template <class CompletionToken>
+                BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void (std::exception_ptr, response))
+                async_execute(request req, CompletionToken &&token, request_options options = request_options());
+
+            template <class CompletionToken>
+                BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void (std::exception_ptr, response))
+                async_get(request req, CompletionToken &&token, request_options options = request_options());
+
+            template <class CompletionToken>
+                BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void (std::exception_ptr, response))
+                async_post(request req, CompletionToken &&token, request_options options = request_options());
+
+            template <class CompletionToken>
+                BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void (std::exception_ptr, response))
+                async_put(request req, CompletionToken &&token, request_options options = request_options());
+
+            template <class CompletionToken>
+                BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void (std::exception_ptr, response))
+                async_delete(request req, CompletionToken &&token, request_options options = request_options());
+
+            template <class CompletionToken>
+                BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void (std::exception_ptr, response))
+                async_head(request req, CompletionToken &&token, request_options options = request_options());
+
+            template <class CompletionToken>
+                BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void (std::exception_ptr, response))
+                async_options(request req, CompletionToken &&token, request_options options = request_options());
+
+            /* the phase histograms of all the client's threads so far, empty unless record_latency is set */
+            client_message::latency_snapshot latency() const;
+
+            /*
+             * Appends the events traced since the last call to records,
+             * thread by thread, and returns how many were lost because a
+             * thread's buffer was full. See client_options::trace_events().
+             */
+            std::uint64_t drain_trace(std::vector<client_message::trace_record> &records);
+
         private:
             struct impl;
-            impl *_pimpl;
+            struct initiate_execute;
+
+            /* the impl with the fewest outstanding requests */
+            impl &pick();
+
+            /* one per io thread */
+            std::vector<std::unique_ptr<impl> > _impls;
+            std::atomic<std::size_t> _turn;
+        };
+    } // namespace http
+} // namespace network
+
+/*
+ * implementation
+ */
+namespace network {
+    namespace http {
+        struct client::impl {
+            typedef client_connection::async_resolver async_resolver;
+            typedef client_connection::async_connection async_connection;
+            typedef client_connection::connection_pool::connection_ptr connection_ptr;
+            typedef client_connection::pool_key pool_key;
+
+            struct pipeline;
+
+            /* delivers the result of an exchange that was not given a promise */
+            struct completion {
+                virtual ~completion() { }
 
+                virtual void complete(std::exception_ptr error, response r) = 0;
+            };
+
+            /*
+             * Calls handler(error, response) through its associated executor,
+             * which is kept busy meanwhile, as for any Asio operation.
+             */
+            template <class Handler>
+                struct handler_completion : completion {
+                    typedef typename boost::asio::associated_executor<Handler,
+                        boost::asio::io_service::executor_type>::type executor_type;
+
+                    struct bound {
+                        void operator () () {
+                            handler(error, std::move(r));
+                        }
+
+                        Handler handler;
+                        std::exception_ptr error;
+                        response r;
+                    };
+
+                    handler_completion(Handler handler, boost::asio::io_service &io_service) :
+                        _handler(std::move(handler)),
+                        _work(boost::asio::get_associated_executor(_handler, io_service.get_executor())) { }
+
+                    virtual void complete(std::exception_ptr error, response r) {
+                        executor_type executor = _work.get_executor();
+                        boost::asio::dispatch(executor, bound{ std::move(_handler), error, std::move(r) });
+                        _work.reset();
+                    }
+
+                    Handler _handler;
+                    boost::asio::executor_work_guard<executor_type> _work;
+                };
+
+            /*
+             * State of one request/response round trip. Every asynchronous
+             * step holds a shared_ptr to it, the first of finish()/fail() to
+             * run completes the promise and gives the connection back. With
+             * an arena, the exchange itself, the response and the promise's
+             * shared state are allocated from it. _phase_deadline is that of
+             * the step in progress: resolving, connecting or reading.
+             */
+            struct exchange {
+                exchange(request req, request_options opts, client_connection::timer_wheel &wheel,
+                    const arena_allocator<char> &alloc) :
+                    _request(std::move(req)),
+                    _options(std::move(opts)),
+                    _progress(_options.progress()),
+                    _has_slot(false),
+                    _reused(false),
+                    _retried(false),
+                    _refusals(0),
+                    _chunked_body(false),
+                    _body_done(true),
+                    _send_file(false),
+                    _http1(false),
+                    _decode(false),
+                    _decode_error(false),
+                    _body_decoded(false),
+                    _redirects_left(0),
+                    _redirecting(false),
+                    _latency(nullptr),
+                    _queued(false),
+                    _response(alloc),
+                    _total_deadline(wheel),
+                    _phase_deadline(wheel),
+                    _completed(false) {
+                    _parser.reset(_request.method() != method::head);
+#if defined(NETLIBX_ENABLE_TRACE)
+                    _trace = nullptr;
+                    _trace_id = 0;
+#endif // defined(NETLIBX_ENABLE_TRACE)
+                }
+
+                request _request;
+                request_options _options;
+                std::function<void (client_message::transfer_direction, std::uint64_t)> _progress;
+                client_message::resume_function _resume;
+                pool_key _key;
+                std::shared_ptr<client_connection::happy_eyeballs> _race;
+                std::shared_ptr<pipeline> _pipeline;
+                std::shared_ptr<client_connection::http2_session> _session;
+                std::weak_ptr<client_connection::http2_stream_observer> _stream;
+                connection_ptr _connection;
+                bool _has_slot;
+                bool _reused;
+                bool _retried;
+                std::size_t _refusals;
+                bool _chunked_body;
+                bool _body_done;
+                /* what is left to send of a body sent with its Content-Length */
+                boost::optional<std::uint64_t> _body_left;
+                bool _send_file;
+                bool _http1;
+                /* the client asked for an encoded body, _decoder decodes it into _decoded */
+                bool _decode;
+                bool _decode_error;
+                /* the body of _response is decoded, its Content-Encoding undone */
+                bool _body_decoded;
+                client_message::content_decoder_pool::handle _decoder;
+                client_message::content_decoder::output _decoded;
+                /* hops still allowed; the response read is a redirect to follow, see redirect() */
+                int _redirects_left;
+                bool _redirecting;
+                /* the stale response the request revalidates, and when it was launched */
+                client_message::response_cache::entry_ptr _cached;
+                client_message::response_cache::clock::time_point _request_time;
+                /* where the phases of the request go, see lap(); _mark is when the current one began */
+                client_message::latency_recorder::host_histograms *_latency;
+                bool _queued;
+                std::chrono::steady_clock::time_point _started;
+                std::chrono::steady_clock::time_point _mark;
+#if defined(NETLIBX_ENABLE_TRACE)
+                /* the trace of the impl that started the exchange, if it keeps one */
+                client_message::trace_buffer *_trace;
+                std::uint64_t _trace_id;
+#endif // defined(NETLIBX_ENABLE_TRACE)
+                char _chunk_header[24];
+                async_connection::const_buffers _request_buffers;
+                client_message::response_parser _parser;
+                response _response;
+                /* the result goes to one of these */
+                boost::optional<std::promise<response> > _promise;
+                std::shared_ptr<completion> _completion;
+                client_connection::timer_wheel::entry _total_deadline;
+                client_connection::timer_wheel::entry _phase_deadline;
+                std::atomic<bool> _completed;
+                /* a paused exchange, which no handler holds, until resume_body() */
+                std::shared_ptr<exchange> _held;
+            };
+            typedef std::shared_ptr<exchange> exchange_ptr;
+
+            /*
+             * Requests written back to back on one connection. Responses come
+             * in the order of in_flight, only its first exchange reads; the
+             * others are written, or wait in to_write. The pipeline holds the
+             * pool slot until in_flight is empty or it is closed.
+             */
+            struct pipeline {
+                pool_key key;
+                connection_ptr connection;
+                std::deque<exchange_ptr> in_flight;
+                std::deque<exchange_ptr> to_write;
+                bool writing;
+                bool closed;
+            };
+
+            /*
+             * Requests of execute_batch() not started yet; `running` counts
+             * those in flight, up to concurrency.
+             */
+            struct batch_run {
+                std::vector<request> requests;
+                request_options options;
+                std::size_t concurrency;
+                batch_handler handler;
+                std::function<impl &()> pick;
+                std::size_t next;
+                std::size_t running;
+                bool stopped;
+                std::mutex mutex;
+            };
+
+            /* pipelinable exchanges of one origin waiting for a place in a pipeline */
+            struct pipeline_host {
+                pipeline_host() : opening(0) { }
+
+                std::deque<exchange_ptr> waiting;
+                std::vector<std::shared_ptr<pipeline> > open;
+                std::size_t opening;
+            };
+
+            /*
+             * The HTTP/2 session of one origin. Exchanges wait while one of
+             * them, the carrier, connects; http1 is set when the origin
+             * declined HTTP/2.
+             */
+            struct session_host {
+                session_host() : connecting(false), http1(false) { }
+
+                std::deque<exchange_ptr> waiting;
+                std::shared_ptr<client_connection::http2_session> session;
+                bool connecting;
+                bool http1;
+            };
+
+            /*
+             * Stores what the parser reports in the response, or hands the
+             * body to the request's sink.
+             */
+            struct response_handler {
+                typedef client_message::response_parser::string_ref string_ref;
+
+                void on_status(string_ref version, status::code code, string_ref reason) {
+                    response &r = _exchange._response;
+                    r = response(r.get_allocator());
+                    r.version(std::string(version.begin(), version.end()));
+                    r.status(code);
+                    r.status_message(std::string(reason.begin(), reason.end()));
+                }
+
+                void on_header(string_ref name, string_ref value) {
+                    _exchange._response.add_header(name, value);
+                }
+
+                void on_headers_complete() {
+                    if (static_cast<int>(_exchange._response.status()) >= 200) {
+                        trace(_exchange, client_message::trace_event::first_byte);
+                        lap(_exchange, client_message::latency_phase::first_byte);
+                    }
+                    check_redirect();
+                    /* one allocation for the body when its size is announced */
+                    auto length = _exchange._parser.content_length();
+                    if (length && (!_exchange._options.sink() || _exchange._redirecting)) {
+                        _exchange._response.reserve_body(static_cast<std::size_t>(
+                                std::min<std::uint64_t>(*length, max_body_reserve)));
+                    }
+                    start_decoding(*_exchange._connection);
+                }
+
+                void on_body(string_ref data) {
+                    if (_exchange._progress) {
+                        _exchange._progress(client_message::transfer_direction::bytes_read, data.size());
+                    }
+                    if (!consume(data)) {
+                        _exchange._parser.pause();
+                    }
+                }
+
+                /* the body of a redirect to follow goes to the response, not the sink */
+                void check_redirect() {
+                    const response &r = _exchange._response;
+                    _exchange._redirecting = _exchange._redirects_left > 0 &&
+                        client_message::is_redirect(r.status()) && r.header(constants::location());
+                }
+
+                /* a decoder for the body if the response is encoded; its decoders are the connection's */
+                void start_decoding(client_connection::async_connection &connection) {
+                    if (!_exchange._decode) {
+                        return;
+                    }
+                    /* one left from an attempt on another connection starts over */
+                    _exchange._decoder.reset();
+                    _exchange._body_decoded = false;
+                    auto encoding = _exchange._response.header(constants::content_encoding());
+                    if (!encoding) {
+                        return;
+                    }
+                    _exchange._decoder = connection.decoders()->acquire(*encoding);
+                    _exchange._body_decoded = static_cast<bool>(_exchange._decoder);
+                    if (_exchange._decoder && !_exchange._decoded) {
+                        exchange *ex = &_exchange;
+                        _exchange._decoded = [ex] (string_ref piece) {
+                            return response_handler{ *ex }.deliver(piece);
+                        };
+                    }
+                }
+
+                /* takes a piece of the body as received; false to stop reading for now */
+                bool consume(string_ref data) {
+                    if (!_exchange._decoder) {
+                        return deliver(data);
+                    }
+                    switch (_exchange._decoder->decode(data, _exchange._decoded)) {
+                    case client_message::content_decoder::ok:
+                        return true;
+                    case client_message::content_decoder::invalid:
+                        _exchange._decode_error = true;
+                        return false;
+                    default:
+                        return false;
+                    }
+                }
+
+                /* passes on a piece of the decoded body; false when the sink is full */
+                bool deliver(string_ref data) {
+                    if (!_exchange._options.sink() || _exchange._redirecting) {
+                        _exchange._response.append_body(data);
+                        return true;
+                    }
+                    return _exchange._options.sink()(data, _exchange._resume);
+                }
+
+                void on_trailer(string_ref name, string_ref value) {
+                    on_header(name, value);
+                }
+
+                enum : std::size_t { max_body_reserve = 1024 * 1024 };
+
+                exchange &_exchange;
+            };
+
+            /* reports a stream of an HTTP/2 session to its exchange, as response_handler does for HTTP/1 */
+            struct http2_exchange : client_connection::http2_stream_observer {
+                http2_exchange(impl &client, exchange_ptr ex) :
+                    _client(client), _exchange(std::move(ex)), _received(false) { }
+
+                virtual void on_header(string_ref name, string_ref value, bool trailer) {
+                    _received = true;
+                    _client.arm(_exchange->_phase_deadline, _exchange->_options.read_timeout());
+                    response_handler handler{ *_exchange };
+                    if (name.starts_with(':')) {
+                        /* trailers carry no pseudo-header fields; the session resets streams with a bad :status */
+                        if (!trailer && name == ":status") {
+                            handler.on_status("2", static_cast<status::code>(http2::parse_status(value)), "");
+                        }
+                    } else if (trailer) {
+                        handler.on_trailer(name, value);
+                    } else {
+                        handler.on_header(name, value);
+                    }
+                }
+
+                virtual void on_headers_complete() {
+                    trace(*_exchange, client_message::trace_event::first_byte);
+                    lap(*_exchange, client_message::latency_phase::first_byte);
+                    response_handler{ *_exchange }.check_redirect();
+                    auto length = _exchange->_response.header(constants::content_length());
+                    if (length && (!_exchange->_options.sink() || _exchange->_redirecting)) {
+                        _exchange->_response.reserve_body(static_cast<std::size_t>(
+                                std::min<std::uint64_t>(std::strtoull(std::string(length->data(),
+                                            length->size()).c_str(), nullptr, 10),
+                                    response_handler::max_body_reserve)));
+                    }
+                    if (auto session = _exchange->_session) {
+                        response_handler{ *_exchange }.start_decoding(*session->connection());
+                    }
+                }
+
+                virtual bool on_data(string_ref data) {
+                    if (_exchange->_progress) {
+                        _exchange->_progress(client_message::transfer_direction::bytes_read, data.size());
+                    }
+                    if (!response_handler{ *_exchange }.consume(data)) {
+                        if (_exchange->_decode_error) {
+                            /* not from within the session's call */
+                            impl &client = _client;
+                            exchange_ptr ex = _exchange;
+                            client._io_service.post([&client, ex] () {
+                                    client.fail(ex, std::make_exception_ptr(
+                                            client_exception(client_error::invalid_response)));
+                                });
+                        }
+                        /* a full sink is not the server being slow */
+                        _client._wheel.cancel(_exchange->_phase_deadline);
+                        return false;
+                    }
+                    _client.arm(_exchange->_phase_deadline, _exchange->_options.read_timeout());
+                    return true;
+                }
+
+                virtual void on_written(std::size_t bytes) {
+                    if (_exchange->_progress) {
+                        _exchange->_progress(client_message::transfer_direction::bytes_written, bytes);
+                    }
+                }
+
+                virtual void on_complete() {
+                    _client.finish(_exchange);
+                }
+
+                virtual void on_error(const boost::system::error_code &ec, bool unprocessed) {
+                    /* as retry_stale(): a broken connection that sent nothing back did not run a GET */
+                    bool stale = !_received && !_exchange->_request.has_body() &&
+                        (_exchange->_request.method() == method::get ||
+                            _exchange->_request.method() == method::head) &&
+                        (ec == boost::asio::error::eof ||
+                            ec == boost::asio::error::connection_reset ||
+                            ec == boost::asio::error::broken_pipe);
+                    if (unprocessed || stale) {
+                        _client.stream_failed(_exchange, ec, unprocessed);
+                    } else {
+                        _client.fail(_exchange, ec);
+                    }
+                }
+
+                impl &_client;
+                exchange_ptr _exchange;
+                bool _received;
+            };
+
+            static std::shared_ptr<client_connection::resolver_cache> resolver_cache_for(const client_options &options) {
+                if (!options.cache_resolved()) {
+                    return nullptr;
+                }
+                return options.resolver_cache() ?
+                    options.resolver_cache() : std::make_shared<client_connection::resolver_cache>();
+            }
+
+            static std::shared_ptr<client_message::redirect_cache> redirect_cache_for(const client_options &options) {
+                if (!options.follow_redirects()) {
+                    return nullptr;
+                }
+                return options.redirect_cache() ?
+                    options.redirect_cache() : std::make_shared<client_message::redirect_cache>();
+            }
+
+#if defined(NETLIBX_ENABLE_HTTPS)
+            static std::shared_ptr<client_connection::tls_context> tls_context_for(const client_options &options) {
+                return options.tls_context() ? options.tls_context() :
+                    std::make_shared<client_connection::tls_context>(
+                        options.openssl_certificate_paths(),
+                        options.openssl_verify_paths(),
+                        options.always_verify_peer());
+            }
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+
+            /* an owned io_service is run by a thread pinned to cpu, unless it is negative */
+            explicit impl(client_options options, int cpu = -1);
+
+            impl(std::unique_ptr<async_resolver> mock_resolver,
+                std::unique_ptr<async_connection> mock_connection,
+                client_options options);
+
+            ~impl();
+
+            /*
+             * Stops the io thread. The client stops all of its impls before
+             * destroying any, batches start requests on each other's.
+             */
+            void stop();
+
+            /* the CPUs this process may run on */
+            static std::vector<int> usable_cpus();
+            static void pin_thread(int cpu);
+
+            std::future<response> execute(request req, request_options options);
+
+            /* an exchange for req, which launch() sends once its promise or completion is set */
+            exchange_ptr make_exchange(request req, request_options options);
+
+            /* an exchange completing into handler */
+            template <class Handler>
+                exchange_ptr make_exchange(request req, request_options options, Handler handler);
+
+            void launch(exchange_ptr ex);
+
+            static void execute_batch(std::shared_ptr<batch_run> run);
+            static void batch_next(std::shared_ptr<batch_run> run);
+            void start(exchange_ptr ex);
+            void dispatch(exchange_ptr ex);
+            void checked_out(exchange_ptr ex, connection_ptr connection);
+            connection_ptr make_connection(const pool_key &key);
+            void connect(exchange_ptr ex);
+            void connect_to(exchange_ptr ex, const async_resolver::endpoints &endpoints);
+            void write_request(exchange_ptr ex);
+            void next_body_piece(exchange &ex);
+            void write_body(exchange_ptr ex);
+            bool written(exchange_ptr ex, const boost::system::error_code &ec, std::size_t bytes_transferred);
+            void read_response(exchange_ptr ex);
+            void resume_body(exchange_ptr ex);
+            bool pipelinable(const exchange &ex) const;
+            void open_pipeline(exchange_ptr ex);
+            void fill_pipeline(pipeline_host &host, const std::shared_ptr<pipeline> &p);
+            void pump(const pool_key &key);
+            void pipeline_slot(const pool_key &key, connection_ptr connection);
+            void pipeline_write(std::shared_ptr<pipeline> p);
+            void leave_pipeline(exchange_ptr ex, bool reusable);
+            void restart(exchange_ptr ex);
+            bool wants_http2(const exchange &ex) const;
+            void pump_sessions(const pool_key &key);
+            void carrier_lost(const pool_key &key);
+            void open_session(exchange_ptr ex);
+            void submit(exchange_ptr ex, std::shared_ptr<client_connection::http2_session> session);
+            void stream_failed(exchange_ptr ex, const boost::system::error_code &ec, bool unprocessed);
+            bool retry_stale(exchange_ptr ex, const boost::system::error_code &ec);
+            void release(exchange_ptr ex, bool reusable);
+            void give_back(exchange_ptr ex);
+            bool redirect(exchange_ptr ex);
+            void cache_response(exchange &ex);
+
+            /* ends ex before it started, as launch() would have had it */
+            void complete_now(exchange_ptr ex, std::exception_ptr error);
+
+            /* the origin of req's URL */
+            static void origin_of(const request &req, pool_key &key);
+            static void origin_of(const uri &url, pool_key &key);
+
+            /*
+             * Points ex's request at location, where a redirect with code
+             * sends it. Only what changes is rewritten. False if location
+             * is not an http or https URL.
+             */
+            static bool redirect_request(exchange &ex, const std::string &location, status::code code);
+
+            /* records the time since ex's last mark as phase, and marks now */
+            static void lap(exchange &ex, client_message::latency_phase phase);
+            /* ex leaves the queue dispatch() put it in */
+            static void dequeued(exchange &ex);
+
+            /* adds event to the trace of ex, if the client keeps one; a no-op without NETLIBX_ENABLE_TRACE */
+            static void trace(exchange &ex, client_message::trace_event event, std::uint16_t argument = 0);
+
+            void finish(exchange_ptr ex);
+            void fail(exchange_ptr ex, const boost::system::error_code &ec);
+            void fail(exchange_ptr ex, std::exception_ptr error);
+            void complete(exchange &ex, std::exception_ptr error);
+
+            /*
+             * Sets deadline ms from now, none for 0. Exchanges whose
+             * deadline passes fail with timed_out.
+             */
+            void arm(client_connection::timer_wheel::entry &deadline, std::uint64_t ms);
+            void wheel_wait();
+            void wheel_expire();
+
+            /* largest piece of a request body written at once */
+            enum : std::size_t { max_body_piece = 64 * 1024 };
+
+            /* times a request refused by HTTP/2 servers is sent again */
+            enum : std::size_t { max_refusals = 4 };
+
+            client_options _options;
+            /* before the io_service, the exchanges its handlers hold have entries in it */
+            client_connection::timer_wheel _wheel;
+            std::unique_ptr<boost::asio::io_service> _owned_io_service;
+            boost::asio::io_service &_io_service;
+            std::unique_ptr<boost::asio::io_service::work> _sentinel;
+            /* waits for the next deadline of _wheel, set on _wheel_strand */
+            boost::asio::steady_timer _wheel_timer;
+            boost::asio::io_service::strand _wheel_strand;
+            client_connection::timer_wheel::clock::time_point _wheel_wait;
+            std::thread _lifetime_thread;
+            std::unique_ptr<async_resolver> _resolver;
+            connection_ptr _mock_connection;
+            std::shared_ptr<client_message::redirect_cache> _redirects;
+            std::shared_ptr<client_message::response_cache> _cache;
+#if defined(NETLIBX_ENABLE_HTTPS)
+            std::shared_ptr<client_connection::tls_context> _tls_context;
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+            std::unique_ptr<client_message::latency_recorder> _latency;
+#if defined(NETLIBX_ENABLE_TRACE)
+            std::unique_ptr<client_message::trace_buffer> _trace;
+            /* drain_trace() may be called from any thread */
+            std::mutex _trace_mutex;
+#endif // defined(NETLIBX_ENABLE_TRACE)
+            client_connection::connection_pool _pool;
+            std::unordered_map<pool_key, pipeline_host, client_connection::pool_key_hash> _pipelines;
+            std::mutex _pipelines_mutex;
+            std::unordered_map<pool_key, session_host, client_connection::pool_key_hash> _sessions;
+            std::mutex _sessions_mutex;
+            /* exchanges launched and not completed, see client::pick() */
+            std::atomic<std::size_t> _outstanding;
         };
+
+        inline client::impl::impl(client_options options, int cpu) :
+            _options(std::move(options)),
+            _owned_io_service(_options.io_service() ? nullptr : new boost::asio::io_service),
+            _io_service(_options.io_service() ? *_options.io_service() : *_owned_io_service),
+            _sentinel(new boost::asio::io_service::work(_io_service)),
+            _wheel_timer(_io_service),
+            _wheel_strand(_io_service),
+            _wheel_wait(client_connection::timer_wheel::clock::time_point::max()),
+            _resolver(_options.transport() ? _options.transport()->resolver(_io_service) :
+                std::unique_ptr<async_resolver>(new async_resolver(_io_service, resolver_cache_for(_options)))),
+            _redirects(redirect_cache_for(_options)),
+            _cache(_options.response_cache()),
+#if defined(NETLIBX_ENABLE_HTTPS)
+            _tls_context(tls_context_for(_options)),
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+            _latency(_options.record_latency() ? new client_message::latency_recorder : nullptr),
+#if defined(NETLIBX_ENABLE_TRACE)
+            _trace(_options.trace_events() ? new client_message::trace_buffer(_options.trace_events()) : nullptr),
+#endif // defined(NETLIBX_ENABLE_TRACE)
+            _pool(_io_service,
+                _options.max_connections_per_host(),
+                _options.keep_alive() ? _options.max_idle_connections_per_host() : 0,
+                _options.idle_connection_timeout()),
+            _outstanding(0) {
+            if (_owned_io_service) {
+                _lifetime_thread = std::thread([this, cpu] () {
+                        if (cpu >= 0) {
+                            pin_thread(cpu);
+                        }
+                        _io_service.run();
+                    });
+            }
+        }
+
+        inline client::impl::impl(std::unique_ptr<async_resolver> mock_resolver,
+            std::unique_ptr<async_connection> mock_connection,
+            client_options options) :
+            _options(std::move(options)),
+            _owned_io_service(_options.io_service() ? nullptr : new boost::asio::io_service),
+            _io_service(_options.io_service() ? *_options.io_service() : *_owned_io_service),
+            _sentinel(new boost::asio::io_service::work(_io_service)),
+            _wheel_timer(_io_service),
+            _wheel_strand(_io_service),
+            _wheel_wait(client_connection::timer_wheel::clock::time_point::max()),
+            _resolver(std::move(mock_resolver)),
+            _mock_connection(std::move(mock_connection)),
+            _redirects(redirect_cache_for(_options)),
+            _cache(_options.response_cache()),
+            _latency(_options.record_latency() ? new client_message::latency_recorder : nullptr),
+#if defined(NETLIBX_ENABLE_TRACE)
+            _trace(_options.trace_events() ? new client_message::trace_buffer(_options.trace_events()) : nullptr),
+#endif // defined(NETLIBX_ENABLE_TRACE)
+            _pool(_io_service,
+                _options.max_connections_per_host(),
+                _options.keep_alive() ? _options.max_idle_connections_per_host() : 0,
+                _options.idle_connection_timeout()),
+            _outstanding(0) {
+            if (_owned_io_service) {
+                _lifetime_thread = std::thread([this] () { _io_service.run(); });
+            }
+        }
+
+        inline client::impl::~impl() {
+            stop();
+            _pool.clear();
+
+            /* exchanges and their pipelines refer to each other */
+            std::lock_guard<std::mutex> lock(_pipelines_mutex);
+            for (auto &host : _pipelines) {
+                for (auto &p : host.second.open) {
+                    p->in_flight.clear();
+                    p->to_write.clear();
+                }
+            }
+            _pipelines.clear();
+
+            /* as do exchanges and the sessions carrying them */
+            std::lock_guard<std::mutex> sessions_lock(_sessions_mutex);
+            for (auto &host : _sessions) {
+                if (host.second.session) {
+                    host.second.session->abandon();
+                }
+            }
+            _sessions.clear();
+        }
+
+        inline void client::impl::stop() {
+            _sentinel.reset();
+            if (_owned_io_service) {
+                _io_service.stop();
+                if (_lifetime_thread.joinable()) {
+                    _lifetime_thread.join();
+                }
+            }
+        }
+
+        inline std::vector<int> client::impl::usable_cpus() {
+            std::vector<int> cpus;
+#if defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+                for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                    if (CPU_ISSET(cpu, &set)) {
+                        cpus.push_back(cpu);
+                    }
+                }
+            }
+#endif // defined(__linux__)
+            return cpus;
+        }
+
+        /* best effort, the thread runs anywhere if this fails */
+        inline void client::impl::pin_thread(int cpu) {
+#if defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+            (void)cpu;
+#endif // defined(__linux__)
+        }
+
+        inline std::future<response> client::impl::execute(request req, request_options options) {
+            exchange_ptr ex = make_exchange(std::move(req), std::move(options));
+            ex->_promise.emplace(std::allocator_arg, ex->_response.get_allocator());
+            auto result = ex->_promise->get_future();
+            launch(ex);
+            return result;
+        }
+
+        inline client::impl::exchange_ptr client::impl::make_exchange(request req, request_options options) {
+            if (_options.exchange_arena_size() > 0) {
+                arena_allocator<char> alloc(monotonic_arena::create(_options.exchange_arena_size()));
+                exchange_ptr ex = std::allocate_shared<exchange>(arena_allocator<exchange>(alloc),
+                    std::move(req), std::move(options), _wheel, alloc);
+                ex->_total_deadline.owner = ex->_phase_deadline.owner = ex;
+                return ex;
+            }
+            exchange_ptr ex = std::make_shared<exchange>(std::move(req), std::move(options), _wheel,
+                arena_allocator<char>());
+            ex->_total_deadline.owner = ex->_phase_deadline.owner = ex;
+            return ex;
+        }
+
+        /* the completion comes from the exchange's arena too */
+        template <class Handler>
+            inline client::impl::exchange_ptr client::impl::make_exchange(request req, request_options options,
+                Handler handler) {
+                exchange_ptr ex = make_exchange(std::move(req), std::move(options));
+                ex->_completion = std::allocate_shared<handler_completion<Handler> >(
+                    arena_allocator<handler_completion<Handler> >(ex->_response.get_allocator()),
+                    std::move(handler), _io_service);
+                return ex;
+            }
+
+        inline void client::impl::launch(exchange_ptr ex) {
+            ++_outstanding;
+            const auto &url = ex->_request.url();
+            if (!url.host()) {
+                complete_now(ex, std::make_exception_ptr(invalid_url()));
+                return;
+            }
+
+            if (_redirects) {
+                ex->_redirects_left = ex->_options.max_redirects();
+                /* where a permanent redirect was seen, the request goes straight to its target */
+                client_message::redirect_cache::target cached;
+                while (ex->_redirects_left > 0 && _redirects->lookup(ex->_request.url().string(), cached) &&
+                    redirect_request(*ex, cached.location, cached.code)) {
+                    --ex->_redirects_left;
+                }
+            }
+            origin_of(ex->_request, ex->_key);
+
+            if (ex->_request.has_body() && !ex->_request.header(constants::content_length())) {
+                /* a body of unknown length goes out in chunks */
+                auto size = ex->_request.body()->size();
+                bool chunked = static_cast<bool>(ex->_request.header(constants::transfer_encoding()));
+                if (size && !chunked) {
+                    ex->_request.append_header(constants::content_length(), std::to_string(*size));
+                } else {
+                    ex->_chunked_body = true;
+                    if (!chunked) {
+                        ex->_request.append_header(constants::transfer_encoding(), constants::chunked());
+                    }
+                }
+            }
+
+            if (!ex->_request.header(constants::user_agent())) {
+                ex->_request.append_header(constants::user_agent(), _options.user_agent());
+            }
+
+            if (_options.decompress() && !ex->_request.header(constants::accept_encoding()) &&
+                *client_message::content_decoder_pool::accepted()) {
+                ex->_request.append_header(constants::accept_encoding(),
+                    client_message::content_decoder_pool::accepted());
+                ex->_decode = true;
+            }
+
+            if (!_options.keep_alive()) {
+                ex->_request.remove_header(constants::connection());
+                ex->_request.append_header(constants::connection(), constants::close());
+            } else if (ex->_request.version() == "1.0" && !ex->_request.header(constants::connection())) {
+                ex->_request.append_header(constants::connection(), constants::keep_alive());
+            }
+
+            if (ex->_options.sink()) {
+                std::weak_ptr<exchange> weak = ex;
+                ex->_resume = [this, weak] () {
+                    if (auto ex = weak.lock()) {
+                        _io_service.post([this, ex] () { resume_body(ex); });
+                    }
+                };
+            }
+
+            if (_cache && !ex->_options.sink() && client_message::response_cache::cacheable(ex->_request)) {
+                ex->_request_time = client_message::response_cache::clock::now();
+                client_message::response_cache::entry_ptr cached;
+                switch (_cache->lookup(ex->_request, cached, ex->_decode)) {
+                case client_message::response_cache::fresh:
+                    ex->_response = client_message::response_cache::serve(*cached);
+                    complete_now(ex, nullptr);
+                    return;
+                case client_message::response_cache::stale:
+                    /* conditions of the caller's own get the server's answer as is */
+                    if (!ex->_request.header(header_name::name(header_name::if_none_match)) &&
+                        !ex->_request.header(header_name::name(header_name::if_modified_since)) &&
+                        client_message::response_cache::add_validators(ex->_request, *cached)) {
+                        ex->_cached = std::move(cached);
+                    }
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            _io_service.post([this, ex] () { start(ex); });
+        }
+
+        inline void client::impl::complete_now(exchange_ptr ex, std::exception_ptr error) {
+            ex->_completed = true;
+            if (ex->_promise) {
+                complete(*ex, error);
+            } else {
+                /* a completion is not called from within the call that started it */
+                _io_service.post([this, ex, error] () { complete(*ex, error); });
+            }
+        }
+
+        inline void client::impl::execute_batch(std::shared_ptr<batch_run> run) {
+            std::size_t count = run->requests.size();
+            if (run->concurrency > 0) {
+                count = std::min(count, run->concurrency);
+            }
+            for (std::size_t i = 0; i < count; ++i) {
+                batch_next(run);
+            }
+        }
+
+        /* starts the next request of run, if it is not at its concurrency limit */
+        inline void client::impl::batch_next(std::shared_ptr<batch_run> run) {
+            std::size_t index;
+            request req;
+            {
+                std::lock_guard<std::mutex> lock(run->mutex);
+                if (run->stopped || run->next == run->requests.size() ||
+                    (run->concurrency > 0 && run->running == run->concurrency)) {
+                    return;
+                }
+                index = run->next++;
+                ++run->running;
+                req = std::move(run->requests[index]);
+            }
+
+            auto handler = [run, index] (std::exception_ptr error, response r) {
+                std::promise<response> result;
+                if (error) {
+                    result.set_exception(error);
+                } else {
+                    result.set_value(std::move(r));
+                }
+                bool more = run->handler(index, result.get_future());
+                {
+                    std::lock_guard<std::mutex> lock(run->mutex);
+                    --run->running;
+                    run->stopped = run->stopped || !more;
+                }
+                batch_next(run);
+            };
+            impl &target = run->pick();
+            target.launch(target.make_exchange(std::move(req), run->options, std::move(handler)));
+        }
+
+        inline void client::impl::start(exchange_ptr ex) {
+#if defined(NETLIBX_ENABLE_TRACE)
+            ex->_trace = _trace.get();
+            ex->_trace_id = _trace ? client_message::next_trace_id() : 0;
+#endif // defined(NETLIBX_ENABLE_TRACE)
+            trace(*ex, client_message::trace_event::start);
+            if (_latency) {
+                ex->_latency = _latency->host(ex->_key.host, ex->_key.port);
+                ex->_started = std::chrono::steady_clock::now();
+            }
+            arm(ex->_total_deadline, ex->_options.total_timeout());
+            dispatch(ex);
+        }
+
+        /* queues ex for an HTTP/2 session, a pipeline, or a connection of its own */
+        inline void client::impl::dispatch(exchange_ptr ex) {
+            /* only the total timeout runs while queued */
+            _wheel.cancel(ex->_phase_deadline);
+            trace(*ex, client_message::trace_event::checkout_start);
+            ex->_queued = true;
+            if (ex->_latency) {
+                ex->_mark = std::chrono::steady_clock::now();
+            }
+
+            if (wants_http2(*ex)) {
+                std::shared_ptr<client_connection::http2_session> session;
+                {
+                    std::lock_guard<std::mutex> lock(_sessions_mutex);
+                    session_host &host = _sessions[ex->_key];
+                    if (host.http1) {
+                        ex->_http1 = true;
+                    } else if (host.session && host.session->accepting()) {
+                        session = host.session;
+                    } else {
+                        host.waiting.push_back(ex);
+                    }
+                }
+
+                if (session) {
+                    submit(ex, session);
+                    return;
+                }
+                if (!ex->_http1) {
+                    pump_sessions(ex->_key);
+                    return;
+                }
+            }
+
+            if (pipelinable(*ex)) {
+                {
+                    std::lock_guard<std::mutex> lock(_pipelines_mutex);
+                    _pipelines[ex->_key].waiting.push_back(ex);
+                }
+                pump(ex->_key);
+                return;
+            }
+
+            _pool.async_checkout(ex->_key, [this, ex] (connection_ptr connection) {
+                    checked_out(ex, connection);
+                });
+        }
+
+        inline void client::impl::checked_out(exchange_ptr ex, connection_ptr connection) {
+            if (ex->_completed) {
+                /* timed out while queued for the slot */
+                _pool.checkin(ex->_key, connection, true);
+                if (wants_http2(*ex)) {
+                    carrier_lost(ex->_key);
+                }
+                return;
+            }
+
+            ex->_has_slot = true;
+            dequeued(*ex);
+            if (connection) {
+                ex->_connection = connection;
+                ex->_reused = true;
+                write_request(ex);
+            } else {
+                connect(ex);
+            }
+        }
+
+        inline client::impl::connection_ptr client::impl::make_connection(const pool_key &key) {
+            if (_mock_connection) {
+                return _mock_connection;
+            }
+            if (_options.transport()) {
+                return _options.transport()->connection(_io_service, key.scheme);
+            }
+#if defined(NETLIBX_ENABLE_HTTPS)
+            if (key.scheme == constants::https()) {
+                return std::make_shared<client_connection::ssl_connection>(_io_service,
+                    _tls_context,
+                    _options.http2() ?
+                        std::vector<std::string>{ "h2", "http/1.1" } : std::vector<std::string>());
+            }
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+            return std::make_shared<client_connection::normal_connection>(_io_service);
+        }
+
+        inline void client::impl::connect(exchange_ptr ex) {
+#if !defined(NETLIBX_ENABLE_HTTPS)
+            if (ex->_key.scheme == constants::https() && !_mock_connection && !_options.transport()) {
+                fail(ex, std::make_exception_ptr(invalid_url()));
+                return;
+            }
+#endif // !defined(NETLIBX_ENABLE_HTTPS)
+            arm(ex->_phase_deadline, ex->_options.resolver_timeout());
+            trace(*ex, client_message::trace_event::resolve_start);
+            _resolver->async_resolve(ex->_key.host, ex->_key.port,
+                [this, ex] (const boost::system::error_code &ec, const async_resolver::endpoints &endpoints) {
+                    if (ex->_completed) {
+                        return;
+                    }
+                    _wheel.cancel(ex->_phase_deadline);
+                    trace(*ex, client_message::trace_event::resolve_end);
+                    if (ec) {
+                        fail(ex, ec);
+                        return;
+                    }
+                    if (endpoints.empty()) {
+                        fail(ex, boost::asio::error::host_not_found);
+                        return;
+                    }
+                    lap(*ex, client_message::latency_phase::dns);
+                    connect_to(ex, endpoints);
+                });
+        }
+
+        /* races the endpoints, see happy_eyeballs */
+        inline void client::impl::connect_to(exchange_ptr ex, const async_resolver::endpoints &endpoints) {
+            pool_key key = ex->_key;
+            ex->_race = std::make_shared<client_connection::happy_eyeballs>(_io_service,
+                endpoints, ex->_key.host,
+                [this, key] () { return make_connection(key); },
+                /* there is only one mock connection to try endpoints on */
+                _mock_connection ? std::chrono::milliseconds(0) : _options.connection_attempt_delay());
+
+            arm(ex->_phase_deadline, static_cast<std::uint64_t>(_options.timeout().count()));
+            trace(*ex, client_message::trace_event::connect_start);
+            ex->_race->async_connect([this, ex] (const boost::system::error_code &ec, connection_ptr connection,
+                    const std::vector<client_connection::connect_attempt> &attempts) {
+                    ex->_race.reset();
+                    _wheel.cancel(ex->_phase_deadline);
+                    if (_options.connect_observer()) {
+                        _options.connect_observer()(attempts);
+                    }
+                    if (ex->_completed) {
+                        if (connection) {
+                            connection->disconnect();
+                        }
+                        return;
+                    }
+                    trace(*ex, client_message::trace_event::connect_end);
+                    if (ec) {
+                        fail(ex, ec);
+                        return;
+                    }
+                    if (ex->_latency) {
+                        /* the connection's handshake is timed apart from the TCP connect before it */
+                        auto now = std::chrono::steady_clock::now();
+                        auto handshake = connection->handshake_time();
+                        ex->_latency->record(client_message::latency_phase::connect, now - ex->_mark - handshake);
+                        if (handshake != std::chrono::steady_clock::duration::zero()) {
+                            ex->_latency->record(client_message::latency_phase::tls_handshake, handshake);
+                        }
+                        ex->_mark = now;
+                    }
+                    ex->_connection = connection;
+                    write_request(ex);
+                });
+        }
+
+        /*
+         * The head goes out together with the first piece of the body, the
+         * rest of the body follows piece by piece, so only one piece is in
+         * memory at a time. A file over plain TCP is sent with sendfile()
+         * after the head.
+         */
+        inline void client::impl::write_request(exchange_ptr ex) {
+            if (wants_http2(*ex)) {
+                open_session(ex);
+                return;
+            }
+            if (pipelinable(*ex) && !ex->_pipeline) {
+                open_pipeline(ex);
+                return;
+            }
+
+            trace(*ex, client_message::trace_event::write_start);
+            ex->_request_buffers.clear();
+            ex->_request.to_buffers(ex->_request_buffers);
+            ex->_body_done = !ex->_request.has_body();
+            ex->_send_file = false;
+
+            const auto &source = ex->_request.body();
+            ex->_body_left = source && !ex->_chunked_body ? source->size() : boost::none;
+            if (source && !ex->_chunked_body && source->native_handle() >= 0 && source->size() &&
+                ex->_connection->can_send_file()) {
+                ex->_body_done = true;
+                ex->_send_file = true;
+            }
+
+            write_body(ex);
+        }
+
+        /*
+         * Adds the next piece of the body to _request_buffers, framed as a
+         * chunk if needed. A source that ends before the size it announced,
+         * or runs past it, fails the request.
+         */
+        inline void client::impl::next_body_piece(exchange &ex) {
+            auto piece = ex._request.body()->next(max_body_piece);
+            std::size_t length = boost::asio::buffer_size(piece);
+            if (ex._chunked_body) {
+                if (length == 0) {
+                    ex._request_buffers.push_back(boost::asio::buffer("0\r\n\r\n", 5));
+                    ex._body_done = true;
+                    return;
+                }
+                int n = std::snprintf(ex._chunk_header, sizeof(ex._chunk_header), "%zx\r\n", length);
+                ex._request_buffers.push_back(boost::asio::buffer(ex._chunk_header, static_cast<std::size_t>(n)));
+                ex._request_buffers.push_back(piece);
+                ex._request_buffers.push_back(boost::asio::buffer("\r\n", 2));
+            } else if (length == 0) {
+                if (ex._body_left && *ex._body_left != 0) {
+                    /* the source ended before its announced size */
+                    throw client_exception(client_error::invalid_request);
+                }
+                ex._body_done = true;
+            } else {
+                if (ex._body_left) {
+                    if (length > *ex._body_left) {
+                        throw client_exception(client_error::invalid_request);
+                    }
+                    *ex._body_left -= length;
+                }
+                ex._request_buffers.push_back(piece);
+            }
+        }
+
+        /* writes _request_buffers, then what is left of the body */
+        inline void client::impl::write_body(exchange_ptr ex) {
+            if (!ex->_body_done) {
+                try {
+                    next_body_piece(*ex);
+                } catch (...) {
+                    fail(ex, std::current_exception());
+                    return;
+                }
+            }
+
+            if (!ex->_request_buffers.empty()) {
+                ex->_connection->async_write(ex->_request_buffers,
+                    [this, ex] (const boost::system::error_code &ec, std::size_t bytes_transferred) {
+                        if (written(ex, ec, bytes_transferred)) {
+                            ex->_request_buffers.clear();
+                            write_body(ex);
+                        }
+                    });
+            } else if (ex->_send_file) {
+                ex->_send_file = false;
+                const auto &source = ex->_request.body();
+                ex->_connection->async_send_file(source->native_handle(), 0, *source->size(),
+                    [this, ex] (const boost::system::error_code &ec, std::size_t bytes_transferred) {
+                        if (written(ex, ec, bytes_transferred)) {
+                            trace(*ex, client_message::trace_event::write_end);
+                            lap(*ex, client_message::latency_phase::request_write);
+                            read_response(ex);
+                        }
+                    });
+            } else {
+                trace(*ex, client_message::trace_event::write_end);
+                lap(*ex, client_message::latency_phase::request_write);
+                read_response(ex);
+            }
+        }
+
+        /* completion of a write of the request; false if the exchange ends here */
+        inline bool client::impl::written(exchange_ptr ex, const boost::system::error_code &ec,
+            std::size_t bytes_transferred) {
+            if (ex->_completed) {
+                return false;
+            }
+            if (ec) {
+                if (!retry_stale(ex, ec)) {
+                    fail(ex, ec);
+                }
+                return false;
+            }
+            if (ex->_progress) {
+                ex->_progress(client_message::transfer_direction::bytes_written, bytes_transferred);
+            }
+            return true;
+        }
+
+        /*
+         * Feeds the parser what is buffered on the connection, reading more
+         * until the response is complete.
+         */
+        inline void client::impl::read_response(exchange_ptr ex) {
+            auto &buffer = ex->_connection->buffer();
+            response_handler handler{ *ex };
+            buffer.consume(ex->_parser.parse(buffer.data(), buffer.size(), handler));
+
+            if (ex->_parser.has_error() || ex->_decode_error) {
+                fail(ex, std::make_exception_ptr(client_exception(client_error::invalid_response)));
+                return;
+            }
+            if (ex->_parser.is_complete() && !(ex->_decoder && ex->_decoder->has_pending())) {
+                finish(ex);
+                return;
+            }
+            if (ex->_parser.paused()) {
+                /* the sink is full, resume_body() carries on */
+                _wheel.cancel(ex->_phase_deadline);
+                ex->_held = ex;
+                return;
+            }
+
+            arm(ex->_phase_deadline, ex->_options.read_timeout());
+            ex->_connection->async_read_some(buffer.prepare(),
+                [this, ex] (const boost::system::error_code &ec, std::size_t bytes_transferred) {
+                    if (ex->_completed) {
+                        return;
+                    }
+
+                    bool end_of_stream = ec == boost::asio::error::eof;
+#if defined(NETLIBX_ENABLE_HTTPS)
+                    end_of_stream = end_of_stream || ec == boost::asio::ssl::error::stream_truncated;
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+                    if (ec && !(end_of_stream && !ex->_parser.is_idle())) {
+                        if (!retry_stale(ex, ec)) {
+                            fail(ex, ec);
+                        }
+                        return;
+                    }
+
+                    if (end_of_stream) {
+                        if (ex->_parser.eof()) {
+                            finish(ex);
+                        } else {
+                            fail(ex, std::make_exception_ptr(client_exception(client_error::invalid_response)));
+                        }
+                        return;
+                    }
+
+                    ex->_connection->buffer().commit(bytes_transferred);
+                    read_response(ex);
+                });
+        }
+
+        inline void client::impl::resume_body(exchange_ptr ex) {
+            ex->_held.reset();
+            if (ex->_completed) {
+                return;
+            }
+            if (ex->_decoder && ex->_decoder->has_pending()) {
+                /* the sink is taken what was decoded before the server is read again */
+                auto r = ex->_decoder->drain(ex->_decoded);
+                if (r == client_message::content_decoder::invalid) {
+                    fail(ex, std::make_exception_ptr(client_exception(client_error::invalid_response)));
+                    return;
+                }
+                if (r == client_message::content_decoder::stopped) {
+                    ex->_held = ex;
+                    return;
+                }
+            }
+            if (auto session = ex->_session) {
+                if (auto stream = ex->_stream.lock()) {
+                    arm(ex->_phase_deadline, ex->_options.read_timeout());
+                    session->resume(stream.get());
+                }
+                return;
+            }
+            if (!ex->_parser.paused()) {
+                return;
+            }
+            ex->_parser.resume();
+            read_response(ex);
+        }
+
+        inline bool client::impl::pipelinable(const exchange &ex) const {
+            return _options.pipeline_depth() > 1 && _options.keep_alive() && !ex._retried &&
+                !ex._request.has_body() && ex._request.version() == "1.1" &&
+                (ex._request.method() == method::get || ex._request.method() == method::head);
+        }
+
+        /*
+         * ex got a connection of its own: it becomes the first exchange of
+         * a pipeline on it, which takes over its pool slot.
+         */
+        inline void client::impl::open_pipeline(exchange_ptr ex) {
+            auto p = std::make_shared<pipeline>();
+            p->key = ex->_key;
+            p->connection = ex->_connection;
+            p->in_flight.push_back(ex);
+            p->to_write.push_back(ex);
+            p->writing = false;
+            p->closed = false;
+            ex->_pipeline = p;
+            ex->_has_slot = false;
+
+            {
+                std::lock_guard<std::mutex> lock(_pipelines_mutex);
+                pipeline_host &host = _pipelines[p->key];
+                host.open.push_back(p);
+                fill_pipeline(host, p);
+            }
+            pipeline_write(p);
+            read_response(ex);
+        }
+
+        /* moves waiting exchanges into p, called with _pipelines_mutex held */
+        inline void client::impl::fill_pipeline(pipeline_host &host, const std::shared_ptr<pipeline> &p) {
+            while (!p->closed && p->in_flight.size() < _options.pipeline_depth() && !host.waiting.empty()) {
+                exchange_ptr ex = std::move(host.waiting.front());
+                host.waiting.pop_front();
+                if (ex->_completed) {
+                    continue;
+                }
+                ex->_pipeline = p;
+                ex->_connection = p->connection;
+                ex->_reused = true;
+                dequeued(*ex);
+                p->in_flight.push_back(ex);
+                p->to_write.push_back(ex);
+            }
+        }
+
+        /*
+         * Hands waiting exchanges to the open pipelines of key, and asks the
+         * pool for another connection while more are waiting than the
+         * connections asked for so far can take.
+         */
+        inline void client::impl::pump(const pool_key &key) {
+            std::vector<std::shared_ptr<pipeline> > filled;
+            bool open_another = false;
+            {
+                std::lock_guard<std::mutex> lock(_pipelines_mutex);
+                pipeline_host &host = _pipelines[key];
+                for (auto &p : host.open) {
+                    std::size_t before = p->in_flight.size();
+                    fill_pipeline(host, p);
+                    if (p->in_flight.size() != before) {
+                        filled.push_back(p);
+                    }
+                }
+                while (!host.waiting.empty() && host.waiting.front()->_completed) {
+                    host.waiting.pop_front();
+                }
+                if (host.waiting.size() > host.opening * _options.pipeline_depth()) {
+                    ++host.opening;
+                    open_another = true;
+                }
+            }
+
+            for (auto &p : filled) {
+                pipeline_write(p);
+            }
+            if (open_another) {
+                _pool.async_checkout(key, [this, key] (connection_ptr connection) {
+                        pipeline_slot(key, connection);
+                    });
+            }
+        }
+
+        /* a slot for a new pipeline: the first waiting exchange connects and opens it */
+        inline void client::impl::pipeline_slot(const pool_key &key, connection_ptr connection) {
+            exchange_ptr ex;
+            {
+                std::lock_guard<std::mutex> lock(_pipelines_mutex);
+                pipeline_host &host = _pipelines[key];
+                --host.opening;
+                while (!ex && !host.waiting.empty()) {
+                    ex = std::move(host.waiting.front());
+                    host.waiting.pop_front();
+                    if (ex->_completed) {
+                        ex.reset();
+                    }
+                }
+            }
+
+            if (!ex) {
+                _pool.checkin(key, connection, true);
+                return;
+            }
+            checked_out(ex, connection);
+        }
+
+        /* writes the requests of a pipeline one after the other */
+        inline void client::impl::pipeline_write(std::shared_ptr<pipeline> p) {
+            exchange_ptr ex;
+            {
+                std::lock_guard<std::mutex> lock(_pipelines_mutex);
+                if (p->writing || p->closed || p->to_write.empty()) {
+                    return;
+                }
+                p->writing = true;
+                ex = p->to_write.front();
+            }
+
+            trace(*ex, client_message::trace_event::write_start);
+            ex->_request_buffers.clear();
+            ex->_request.to_buffers(ex->_request_buffers);
+            p->connection->async_write(ex->_request_buffers,
+                [this, p, ex] (const boost::system::error_code &ec, std::size_t bytes_transferred) {
+                    {
+                        std::lock_guard<std::mutex> lock(_pipelines_mutex);
+                        p->writing = false;
+                        if (p->closed) {
+                            return;
+                        }
+                        p->to_write.pop_front();
+                        p->closed = static_cast<bool>(ec);
+                    }
+
+                    if (ec) {
+                        /* the exchange reading fails and takes the pipeline down */
+                        p->connection->cancel();
+                        return;
+                    }
+                    if (ex->_progress) {
+                        ex->_progress(client_message::transfer_direction::bytes_written, bytes_transferred);
+                    }
+                    if (!ex->_completed) {
+                        trace(*ex, client_message::trace_event::write_end);
+                        lap(*ex, client_message::latency_phase::request_write);
+                    }
+                    pipeline_write(p);
+                });
+        }
+
+        /*
+         * Takes ex out of its pipeline once it is done. The next exchange
+         * starts reading its response. When the connection cannot be used
+         * any further, it is given back as soon as nobody reads from it and
+         * the exchanges left on it are sent again on their own. An exchange
+         * that fails before its turn only closes the pipeline: its response
+         * still has to be read out of the way.
+         */
+        inline void client::impl::leave_pipeline(exchange_ptr ex, bool reusable) {
+            std::shared_ptr<pipeline> p = std::move(ex->_pipeline);
+            exchange_ptr next;
+            std::deque<exchange_ptr> orphans;
+            bool writing = false;
+            {
+                std::lock_guard<std::mutex> lock(_pipelines_mutex);
+                if (p->in_flight.empty() || p->in_flight.front() != ex) {
+                    p->closed = true;
+                    return;
+                }
+
+                p->in_flight.pop_front();
+                pipeline_host &host = _pipelines[p->key];
+                p->closed = p->closed || !reusable;
+                fill_pipeline(host, p);
+                if (!p->closed && !p->in_flight.empty() && !p->in_flight.front()->_completed) {
+                    next = p->in_flight.front();
+                } else {
+                    p->closed = true;
+                    writing = p->writing;
+                    orphans.swap(p->in_flight);
+                    p->to_write.clear();
+                    host.open.erase(std::remove(host.open.begin(), host.open.end(), p), host.open.end());
+                }
+            }
+            ex->_connection.reset();
+
+            if (next) {
+                pipeline_write(p);
+                _io_service.post([this, next] () { read_response(next); });
+                return;
+            }
+
+            _pool.checkin(p->key, p->connection,
+                reusable && orphans.empty() && !writing && p->connection->buffer().empty());
+            for (auto &orphan : orphans) {
+                _io_service.post([this, orphan] () { restart(orphan); });
+            }
+            pump(p->key);
+        }
+
+        /* sends a request again, after its pipeline or HTTP/2 session broke up */
+        inline void client::impl::restart(exchange_ptr ex) {
+            ex->_pipeline.reset();
+            ex->_session.reset();
+            ex->_stream.reset();
+            ex->_connection.reset();
+            if (ex->_completed) {
+                return;
+            }
+            ex->_retried = true;
+            ex->_reused = false;
+            ex->_parser.reset(ex->_request.method() != method::head);
+            dispatch(ex);
+        }
+
+        inline bool client::impl::wants_http2(const exchange &ex) const {
+            return _options.http2() && _options.keep_alive() && !ex._http1 && !ex._session &&
+                ex._request.version() != "1.0";
+        }
+
+        /*
+         * Hands the exchanges waiting for key to its session; without one,
+         * the first of them checks out a pool slot and connects, see
+         * open_session().
+         */
+        inline void client::impl::pump_sessions(const pool_key &key) {
+            std::shared_ptr<client_connection::http2_session> session;
+            std::deque<exchange_ptr> waiting;
+            exchange_ptr carrier;
+            bool http1 = false;
+            {
+                std::lock_guard<std::mutex> lock(_sessions_mutex);
+                session_host &host = _sessions[key];
+                if (host.http1) {
+                    http1 = true;
+                    waiting.swap(host.waiting);
+                } else if (host.session && host.session->accepting()) {
+                    session = host.session;
+                    waiting.swap(host.waiting);
+                } else if (!host.connecting) {
+                    while (!host.waiting.empty() && host.waiting.front()->_completed) {
+                        host.waiting.pop_front();
+                    }
+                    if (!host.waiting.empty()) {
+                        carrier = std::move(host.waiting.front());
+                        host.waiting.pop_front();
+                        host.connecting = true;
+                    }
+                }
+            }
+
+            for (auto &ex : waiting) {
+                if (http1) {
+                    ex->_http1 = true;
+                    _io_service.post([this, ex] () { dispatch(ex); });
+                } else {
+                    submit(ex, session);
+                }
+            }
+            if (carrier) {
+                _pool.async_checkout(key, [this, carrier] (connection_ptr connection) {
+                        checked_out(carrier, connection);
+                    });
+            }
+        }
+
+        /* the carrier failed before it got a session, the next waiting exchange tries */
+        inline void client::impl::carrier_lost(const pool_key &key) {
+            {
+                std::lock_guard<std::mutex> lock(_sessions_mutex);
+                _sessions[key].connecting = false;
+            }
+            pump_sessions(key);
+        }
+
+        /*
+         * The carrier is connected: the connection becomes the origin's
+         * HTTP/2 session, which takes over the pool slot, unless TLS did not
+         * negotiate "h2". The origin is then remembered as HTTP/1 only and
+         * its exchanges go the HTTP/1 way, the carrier on this connection.
+         */
+        inline void client::impl::open_session(exchange_ptr ex) {
+            const pool_key &key = ex->_key;
+            bool http2 = key.scheme != constants::https() || ex->_connection->negotiated_protocol() == "h2";
+
+            std::shared_ptr<client_connection::http2_session> session;
+            if (http2) {
+                connection_ptr connection = ex->_connection;
+                session = std::make_shared<client_connection::http2_session>(_io_service, connection,
+                    _options.keep_alive() ? _options.idle_connection_timeout() : std::chrono::milliseconds(0),
+                    [this, key, connection] () {
+                        {
+                            std::lock_guard<std::mutex> lock(_sessions_mutex);
+                            session_host &host = _sessions[key];
+                            if (host.session && host.session->connection() == connection) {
+                                host.session.reset();
+                            }
+                        }
+                        _pool.checkin(key, connection, false);
+                        pump_sessions(key);
+                    });
+                ex->_has_slot = false;
+                session->start();
+            }
+
+            std::deque<exchange_ptr> waiting;
+            {
+                std::lock_guard<std::mutex> lock(_sessions_mutex);
+                session_host &host = _sessions[key];
+                host.connecting = false;
+                host.http1 = !http2;
+                host.session = session;
+                waiting.swap(host.waiting);
+            }
+
+            if (http2) {
+                submit(ex, session);
+                for (auto &w : waiting) {
+                    submit(w, session);
+                }
+                return;
+            }
+
+            ex->_http1 = true;
+            for (auto &w : waiting) {
+                w->_http1 = true;
+                _io_service.post([this, w] () { dispatch(w); });
+            }
+            write_request(ex);
+        }
+
+        inline void client::impl::submit(exchange_ptr ex, std::shared_ptr<client_connection::http2_session> session) {
+            if (ex->_completed) {
+                return;
+            }
+            dequeued(*ex);
+            auto stream = std::make_shared<http2_exchange>(*this, ex);
+            ex->_session = session;
+            ex->_stream = stream;
+            ex->_connection.reset();
+            arm(ex->_phase_deadline, ex->_options.read_timeout());
+            session->submit(std::shared_ptr<const request>(ex, &ex->_request), stream);
+        }
+
+        /*
+         * Requests that were not sent go to another session; those the
+         * server refused are sent again up to max_refusals times, on a new
+         * session since the refusing one no longer takes streams, stale
+         * ones once.
+         */
+        inline void client::impl::stream_failed(exchange_ptr ex, const boost::system::error_code &ec,
+            bool unprocessed) {
+            bool again = ec == boost::asio::error::try_again ||
+                (unprocessed ? ex->_refusals++ < max_refusals : !ex->_retried);
+            if (again && !ex->_completed && (!ex->_request.has_body() || ex->_request.body()->rewind())) {
+                restart(ex);
+                return;
+            }
+            fail(ex, ec);
+        }
+
+        /*
+         * A pooled connection may have been closed by the server while it was
+         * idle; if nothing of the response arrived yet, send the request once
+         * more on a fresh connection in the same pool slot.
+         */
+        inline bool client::impl::retry_stale(exchange_ptr ex, const boost::system::error_code &ec) {
+            if (ex->_pipeline) {
+                /* pipelined requests are idempotent, any broken connection will do */
+                if (!ex->_parser.is_idle()) {
+                    return false;
+                }
+                leave_pipeline(ex, false);
+                restart(ex);
+                return true;
+            }
+
+            if (!ex->_reused || ex->_retried || !ex->_parser.is_idle() || !ex->_connection->buffer().empty()) {
+                return false;
+            }
+            if (ec != boost::asio::error::eof &&
+                ec != boost::asio::error::connection_reset &&
+                ec != boost::asio::error::broken_pipe) {
+                return false;
+            }
+            if (ex->_request.has_body() && !ex->_request.body()->rewind()) {
+                /* what was sent of the body cannot be produced again */
+                return false;
+            }
+
+            ex->_retried = true;
+            ex->_reused = false;
+            ex->_connection->disconnect();
+            ex->_connection.reset();
+            connect(ex);
+            return true;
+        }
+
+        inline void client::impl::release(exchange_ptr ex, bool reusable) {
+            if (ex->_has_slot) {
+                ex->_has_slot = false;
+                trace(*ex, client_message::trace_event::checkin);
+                _pool.checkin(ex->_key, std::move(ex->_connection), reusable);
+            }
+            ex->_connection.reset();
+        }
+
+        /* once the response of ex is read: gives back its connection, or its place in a pipeline or session */
+        inline void client::impl::give_back(exchange_ptr ex) {
+            if (ex->_session) {
+                ex->_session.reset();
+                ex->_stream.reset();
+            } else if (ex->_pipeline) {
+                leave_pipeline(ex, ex->_parser.keep_alive());
+            } else {
+                /* bytes past the end of the response leave the connection in an unknown state */
+                release(ex, ex->_parser.keep_alive() && ex->_connection->buffer().empty());
+            }
+        }
+
+        /*
+         * Sends ex again where the redirect it read points, within its
+         * total timeout. The connection goes back to the pool first, so a
+         * hop to the same origin reuses it. False if ex cannot follow it
+         * and finishes with the redirect.
+         */
+        inline bool client::impl::redirect(exchange_ptr ex) {
+            ex->_redirecting = false;
+            status::code code = ex->_response.status();
+            std::string location = client_message::resolve_location(ex->_request.url(),
+                *ex->_response.header(constants::location()));
+            if (location.empty()) {
+                return false;
+            }
+            if (ex->_request.has_body() && !client_message::redirect_drops_body(code, ex->_request.method()) &&
+                !ex->_request.body()->rewind()) {
+                return false;
+            }
+            if (code == status::moved_permanently || code == status::permanent_redirect) {
+                _redirects->store(ex->_request.url().string(), location, code);
+            }
+
+            ex->_decoder.reset();
+            _wheel.cancel(ex->_phase_deadline);
+            ex->_held.reset();
+            give_back(ex);
+
+            if (ex->_cached) {
+                /* the validators were for this URL */
+                client_message::response_cache::remove_validators(ex->_request);
+                ex->_cached.reset();
+            }
+            if (!redirect_request(*ex, location, code)) {
+                fail(ex, std::make_exception_ptr(invalid_url()));
+                return true;
+            }
+            if (_latency) {
+                ex->_latency = _latency->host(ex->_key.host, ex->_key.port);
+            }
+            trace(*ex, client_message::trace_event::redirect);
+            --ex->_redirects_left;
+            ex->_response = response(ex->_response.get_allocator());
+            ex->_parser.reset(ex->_request.method() != method::head);
+            ex->_reused = false;
+            ex->_retried = false;
+            ex->_refusals = 0;
+            ex->_http1 = false;
+            ex->_decode_error = false;
+            /* not from within the pipeline or session that read the redirect */
+            _io_service.post([this, ex] () { dispatch(ex); });
+            return true;
+        }
+
+        inline void client::impl::origin_of(const request &req, pool_key &key) {
+            origin_of(req.url(), key);
+        }
+
+        inline void client::impl::origin_of(const uri &url, pool_key &key) {
+            bool https = url.scheme() && *url.scheme() == constants::https();
+            key.scheme = https ? constants::https() : constants::http();
+            key.host.assign(std::begin(*url.host()), std::end(*url.host()));
+            key.port = https ? 443 : 80;
+            if (url.port()) {
+                key.port = static_cast<std::uint16_t>(
+                    std::stoul(std::string(std::begin(*url.port()), std::end(*url.port()))));
+            }
+        }
+
+        inline bool client::impl::redirect_request(exchange &ex, const std::string &location, status::code code) {
+            uri url(location);
+            auto scheme = url.scheme();
+            if (!scheme || !url.host() || url.host()->empty() ||
+                (*scheme != constants::http() && *scheme != constants::https())) {
+                return false;
+            }
+
+            request &req = ex._request;
+            if (client_message::redirect_drops_body(code, req.method())) {
+                req.method(method::get);
+                if (req.has_body()) {
+                    req.body(nullptr);
+                    req.remove_header(constants::content_length());
+                    req.remove_header(constants::transfer_encoding());
+                    req.remove_header(header_name::name(header_name::content_type));
+                    ex._chunked_body = false;
+                }
+            }
+
+            /* credentials are for the origin they were given to: scheme, host and port */
+            pool_key from, to;
+            origin_of(req, from);
+            origin_of(url, to);
+            if (!(from == to)) {
+                req.remove_header(constants::authorization());
+                req.remove_header(constants::cookie());
+            }
+
+            std::string host(url.host()->begin(), url.host()->end());
+            if (auto port = url.port()) {
+                host.push_back(':');
+                host.append(port->begin(), port->end());
+            }
+            auto current = req.header(header_name::name(header_name::host));
+            if (!current || *current != host) {
+                req.remove_header(header_name::name(header_name::host));
+                req.append_header(header_name::name(header_name::host), host);
+            }
+
+            std::string path;
+            if (auto p = url.path()) {
+                path.assign(p->begin(), p->end());
+            }
+            if (auto query = url.query()) {
+                path.push_back('?');
+                path.append(query->begin(), query->end());
+            }
+            req.path(path.empty() ? std::string(constants::slash()) : path);
+            req.url(url);
+            origin_of(req, ex._key);
+            return true;
+        }
+
+        inline void client::impl::finish(exchange_ptr ex) {
+            if (ex->_decoder && ex->_decoder->truncated()) {
+                /* the message ended, its encoded body did not */
+                fail(ex, std::make_exception_ptr(client_exception(client_error::invalid_response)));
+                return;
+            }
+            if (!ex->_completed) {
+                lap(*ex, client_message::latency_phase::body);
+            }
+            if (ex->_redirecting && !ex->_completed && redirect(ex)) {
+                return;
+            }
+            if (ex->_completed.exchange(true)) {
+                return;
+            }
+            if (ex->_latency) {
+                ex->_latency->record(client_message::latency_phase::total, ex->_mark - ex->_started);
+            }
+            trace(*ex, client_message::trace_event::complete, static_cast<std::uint16_t>(ex->_response.status()));
+            ex->_decoder.reset();
+            if (ex->_body_decoded) {
+                /* the headers describe the body as it now is, not as it was sent */
+                ex->_response.remove_header(constants::content_encoding());
+                if (ex->_options.sink()) {
+                    ex->_response.remove_header(constants::content_length());
+                } else {
+                    ex->_response.set_header(constants::content_length(), std::to_string(ex->_response.body().size()));
+                }
+            }
+
+            _wheel.cancel(ex->_total_deadline);
+            _wheel.cancel(ex->_phase_deadline);
+            ex->_held.reset();
+
+            give_back(ex);
+            if (_cache) {
+                cache_response(*ex);
+            }
+            complete(*ex, nullptr);
+        }
+
+        inline void client::impl::lap(exchange &ex, client_message::latency_phase phase) {
+            if (!ex._latency) {
+                return;
+            }
+            auto now = std::chrono::steady_clock::now();
+            ex._latency->record(phase, now - ex._mark);
+            ex._mark = now;
+        }
+
+        inline void client::impl::dequeued(exchange &ex) {
+            if (ex._queued) {
+                ex._queued = false;
+                trace(ex, client_message::trace_event::checkout_end);
+                lap(ex, client_message::latency_phase::pool_wait);
+            }
+        }
+
+        inline void client::impl::trace(exchange &ex, client_message::trace_event event, std::uint16_t argument) {
+#if defined(NETLIBX_ENABLE_TRACE)
+            if (ex._trace) {
+                ex._trace->add(event, ex._trace_id, argument);
+            }
+#else
+            (void)ex;
+            (void)event;
+            (void)argument;
+#endif // defined(NETLIBX_ENABLE_TRACE)
+        }
+
+        /* stores the response of ex, or refreshes the one it revalidated; unsafe methods invalidate */
+        inline void client::impl::cache_response(exchange &ex) {
+            auto now = client_message::response_cache::clock::now();
+            if (ex._cached && ex._response.status() == status::not_modified) {
+                ex._response = _cache->revalidated(ex._cached, ex._request, ex._response, ex._request_time, now);
+            } else if (ex._request.method() == method::get) {
+                /* finish() has made the headers of a decoded body match it */
+                if (!ex._options.sink()) {
+                    _cache->store(ex._request, ex._response, ex._request_time, now, ex._decode);
+                }
+            } else if (ex._request.method() != method::head && ex._request.method() != method::options &&
+                ex._request.method() != method::trace && ex._response.status() < status::bad_request) {
+                _cache->invalidate(ex._request.url().string());
+            }
+            ex._cached.reset();
+        }
+
+        inline void client::impl::fail(exchange_ptr ex, const boost::system::error_code &ec) {
+            fail(ex, std::make_exception_ptr(boost::system::system_error(ec)));
+        }
+
+        inline void client::impl::fail(exchange_ptr ex, std::exception_ptr error) {
+            if (ex->_completed.exchange(true)) {
+                return;
+            }
+            trace(*ex, client_message::trace_event::failed);
+
+            _wheel.cancel(ex->_total_deadline);
+            _wheel.cancel(ex->_phase_deadline);
+            ex->_held.reset();
+            ex->_decoder.reset();
+            if (auto race = std::move(ex->_race)) {
+                race->cancel();
+            }
+            if (auto session = std::move(ex->_session)) {
+                if (auto stream = ex->_stream.lock()) {
+                    session->cancel(stream.get());
+                }
+            } else if (ex->_pipeline) {
+                leave_pipeline(ex, false);
+            } else {
+                bool carrier = ex->_has_slot && wants_http2(*ex);
+                release(ex, false);
+                if (carrier) {
+                    carrier_lost(ex->_key);
+                }
+                if (pipelinable(*ex)) {
+                    /* others may be waiting for the pipeline this one was to open */
+                    pump(ex->_key);
+                }
+            }
+            complete(*ex, error);
+        }
+
+        /* hands the response, or error, to the promise or completion of ex */
+        inline void client::impl::complete(exchange &ex, std::exception_ptr error) {
+            --_outstanding;
+            if (auto c = std::move(ex._completion)) {
+                c->complete(error, std::move(ex._response));
+            } else if (error) {
+                ex._promise->set_exception(error);
+            } else {
+                ex._promise->set_value(std::move(ex._response));
+            }
+        }
+
+        inline void client::impl::arm(client_connection::timer_wheel::entry &deadline, std::uint64_t ms) {
+            if (ms == 0) {
+                _wheel.cancel(deadline);
+                return;
+            }
+            if (_wheel.arm(deadline, client_connection::timer_wheel::clock::now() + std::chrono::milliseconds(ms))) {
+                _wheel_strand.dispatch([this] () { wheel_wait(); });
+            }
+        }
+
+        /* on _wheel_strand: waits for the next deadline, unless already waiting for an earlier one */
+        inline void client::impl::wheel_wait() {
+            auto next = _wheel.next_expiry();
+            if (next >= _wheel_wait) {
+                return;
+            }
+            _wheel_wait = next;
+            _wheel_timer.expires_at(next);
+            _wheel_timer.async_wait(_wheel_strand.wrap([this] (const boost::system::error_code &ec) {
+                        if (ec != boost::asio::error::operation_aborted) {
+                            wheel_expire();
+                        }
+                    }));
+        }
+
+        inline void client::impl::wheel_expire() {
+            _wheel_wait = client_connection::timer_wheel::clock::time_point::max();
+            std::vector<exchange_ptr> expired;
+            _wheel.advance(client_connection::timer_wheel::clock::now(),
+                [&expired] (client_connection::timer_wheel::entry &deadline) {
+                    if (auto owner = deadline.owner.lock()) {
+                        expired.push_back(std::static_pointer_cast<exchange>(owner));
+                    }
+                });
+            for (auto &ex : expired) {
+                fail(ex, boost::asio::error::timed_out);
+            }
+            wheel_wait();
+        }
+
+        inline client::client(client_options options) :
+            _turn(0) {
+            std::size_t threads = options.io_service() ? 1 : options.io_threads();
+            if (threads == 0) {
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+            if (threads == 1) {
+                _impls.emplace_back(new impl(std::move(options)));
+                return;
+            }
+
+            /* the threads share what they learn about hosts */
+            if (options.cache_resolved() && !options.resolver_cache()) {
+                options.resolver_cache(std::make_shared<client_connection::resolver_cache>());
+            }
+            if (options.follow_redirects() && !options.redirect_cache()) {
+                options.redirect_cache(std::make_shared<client_message::redirect_cache>());
+            }
+#if defined(NETLIBX_ENABLE_HTTPS)
+            options.tls_context(impl::tls_context_for(options));
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+            std::vector<int> cpus = impl::usable_cpus();
+            for (std::size_t i = 0; i < threads; ++i) {
+                _impls.emplace_back(new impl(options, cpus.empty() ? -1 : cpus[i % cpus.size()]));
+            }
+        }
+
+        inline client::client(std::unique_ptr<client_connection::async_resolver> mock_resolver,
+            std::unique_ptr<client_connection::async_connection> mock_connection,
+            client_options options) :
+            _turn(0) {
+            _impls.emplace_back(new impl(std::move(mock_resolver), std::move(mock_connection), std::move(options)));
+        }
+
+        inline client::~client() {
+            for (auto &i : _impls) {
+                i->stop();
+            }
+            _impls.clear();
+        }
+
+        /* ties go round, so that idle impls all get connections */
+        inline client::impl &client::pick() {
+            if (_impls.size() == 1) {
+                return *_impls.front();
+            }
+            std::size_t first = _turn++ % _impls.size();
+            impl *best = _impls[first].get();
+            for (std::size_t i = 1; i < _impls.size(); ++i) {
+                impl *candidate = _impls[(first + i) % _impls.size()].get();
+                if (candidate->_outstanding < best->_outstanding) {
+                    best = candidate;
+                }
+            }
+            return *best;
+        }
+
+        inline client_message::latency_snapshot client::latency() const {
+            client_message::latency_snapshot snapshot;
+            for (const auto &i : _impls) {
+                if (i->_latency) {
+                    i->_latency->add_to(snapshot);
+                }
+            }
+            return snapshot;
+        }
+
+        inline std::uint64_t client::drain_trace(std::vector<client_message::trace_record> &records) {
+            std::uint64_t lost = 0;
+#if defined(NETLIBX_ENABLE_TRACE)
+            for (auto &i : _impls) {
+                if (i->_trace) {
+                    std::lock_guard<std::mutex> lock(i->_trace_mutex);
+                    lost += i->_trace->drain(records);
+                }
+            }
+#else
+            (void)records;
+#endif // defined(NETLIBX_ENABLE_TRACE)
+            return lost;
+        }
+
+        inline std::future<response> client::execute(request req, request_options options) {
+            return pick().execute(std::move(req), std::move(options));
+        }
+
+        inline std::future<response> client::get(request req, request_options options) {
+            req.method(method::get);
+            return execute(std::move(req), std::move(options));
+        }
+
+        inline std::future<response> client::post(request req, request_options options) {
+            req.method(method::post);
+            return execute(std::move(req), std::move(options));
+        }
+
+        inline std::future<response> client::put(request req, request_options options) {
+            req.method(method::put);
+            return execute(std::move(req), std::move(options));
+        }
+
+        inline std::future<response> client::delete_(request req, request_options options) {
+            req.method(method::delete_);
+            return execute(std::move(req), std::move(options));
+        }
+
+        inline std::future<response> client::head(request req, request_options options) {
+            req.method(method::head);
+            return execute(std::move(req), std::move(options));
+        }
+
+        inline std::future<response> client::options(request req, request_options options) {
+            req.method(method::options);
+            return execute(std::move(req), std::move(options));
+        }
+
+        inline void client::execute_batch(std::vector<request> requests, request_options options,
+            std::size_t concurrency, batch_handler handler) {
+            auto run = std::make_shared<impl::batch_run>();
+            run->requests = std::move(requests);
+            run->options = std::move(options);
+            run->concurrency = concurrency;
+            run->handler = std::move(handler);
+            run->pick = [this] () -> impl & { return pick(); };
+            run->next = 0;
+            run->running = 0;
+            run->stopped = false;
+            impl::execute_batch(std::move(run));
+        }
+
+        /* starts an exchange completing into the handler Asio made of the token */
+        struct client::initiate_execute {
+            template <class Handler>
+                void operator () (Handler &&handler, impl *pimpl, request req, request_options options) const {
+                    pimpl->launch(pimpl->make_exchange(std::move(req), std::move(options),
+                            typename std::decay<Handler>::type(std::forward<Handler>(handler))));
+                }
+        };
+
+        template <class CompletionToken>
+            inline BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void (std::exception_ptr, response))
+            client::async_execute(request req, CompletionToken &&token, request_options options) {
+                return boost::asio::async_initiate<CompletionToken, void (std::exception_ptr, response)>(
+                    initiate_execute(), token, &pick(), std::move(req), std::move(options));
+            }
+
+        template <class CompletionToken>
+            inline BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void (std::exception_ptr, response))
+            client::async_get(request req, CompletionToken &&token, request_options options) {
+                req.method(method::get);
+                return async_execute(std::move(req), std::forward<CompletionToken>(token), std::move(options));
+            }
+
+        template <class CompletionToken>
+            inline BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void (std::exception_ptr, response))
+            client::async_post(request req, CompletionToken &&token, request_options options) {
+                req.method(method::post);
+                return async_execute(std::move(req), std::forward<CompletionToken>(token), std::move(options));
+            }
+
+        template <class CompletionToken>
+            inline BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void (std::exception_ptr, response))
+            client::async_put(request req, CompletionToken &&token, request_options options) {
+                req.method(method::put);
+                return async_execute(std::move(req), std::forward<CompletionToken>(token), std::move(options));
+            }
+
+        template <class CompletionToken>
+            inline BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void (std::exception_ptr, response))
+            client::async_delete(request req, CompletionToken &&token, request_options options) {
+                req.method(method::delete_);
+                return async_execute(std::move(req), std::forward<CompletionToken>(token), std::move(options));
+            }
+
+        template <class CompletionToken>
+            inline BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void (std::exception_ptr, response))
+            client::async_head(request req, CompletionToken &&token, request_options options) {
+                req.method(method::head);
+                return async_execute(std::move(req), std::forward<CompletionToken>(token), std::move(options));
+            }
+
+        template <class CompletionToken>
+            inline BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void (std::exception_ptr, response))
+            client::async_options(request req, CompletionToken &&token, request_options options) {
+                req.method(method::options);
+                return async_execute(std::move(req), std::forward<CompletionToken>(token), std::move(options));
+            }
+
+        inline batch client::execute_batch(std::vector<request> requests, request_options options,
+            std::size_t concurrency) {
+            batch b(requests.size());
+            execute_batch(std::move(requests), std::move(options), concurrency, b.handler());
+            return b;
+        }
     } // namespace http
 } // namespace network
 
@@ -29,10 +29,68 @@ namespace network {
         class client_exception : public std::system_error {
         public:
             explicit client_exception(client_error err);
-            virtual  client_exception() noexcept;
+            virtual ~client_exception() noexcept;
         };
 
     } // namespace http
 } // namespace network
 
+#if !defined(DOXYGEN_SHOULD_SKIP_THIS)
+namespace std {
+    template <>
+        struct is_error_code_enum<network::http::client_error> : public true_type { };
+} // namespace std
+#endif // if !defined(DOXYGEN_SHOULD_SKIP_THIS)
+
+
+/*
+ * implementation
+ */
+namespace network {
+    namespace http {
+        class client_category_impl : public std::error_category {
+        public:
+            client_category_impl() = default;
+
+            virtual ~client_category_impl() noexcept { }
+
+            virtual const char *name() const noexcept {
+                static const char name[] = "client_error";
+                return name;
+            }
+
+            virtual std::string message(int ev) const {
+                switch (client_error(ev)) {
+                case client_error::invalid_request:
+                    return "Invalid HTTP request.";
+                case client_error::invalid_response:
+                    return "Invalid HTTP response.";
+                default:
+                    break;
+                }
+                return "Unknown client error.";
+            }
+        };
+
+        inline const std::error_category &client_category() {
+            static client_category_impl category;
+            return category;
+        }
+
+        inline std::error_code make_error_code(client_error e) {
+            return std::error_code(static_cast<int>(e), client_category());
+        }
+
+        inline invalid_url::invalid_url() :
+            std::invalid_argument("Requires HTTP or HTTPS URL.") { }
+
+        inline invalid_url::~invalid_url() noexcept { }
+
+        inline client_exception::client_exception(client_error err) :
+            std::system_error(make_error_code(err)) { }
+
+        inline client_exception::~client_exception() noexcept { }
+    } // namespace http
+} // namespace network
+
 #endif // NETWORK_HTTP_CLIENT_ERRORS_INC
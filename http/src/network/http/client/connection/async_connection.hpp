@@ -0,0 +1,125 @@
+#ifndef NETWORK_HTTP_CLIENT_CONNECTION_ASYNC_CONNECTION_INC
+#define NETWORK_HTTP_CLIENT_CONNECTION_ASYNC_CONNECTION_INC
+
+#include <string>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/container/small_vector.hpp>
+#include <boost/system/error_code.hpp>
+#include <network/config.hpp>
+#include <network/http/client/content_decoder.hpp>
+#include <network/http/client/connection/receive_buffer.hpp>
+
+namespace network {
+    namespace http {
+        namespace client_connection {
+            /*
+             * class async_connection
+             *
+             * Transport used by the client to talk to one origin. Concrete
+             * connections wrap a plain TCP or an SSL socket; tests may supply
+             * their own implementation through the client's mock constructor.
+             */
+            class async_connection {
+                async_connection(const async_connection &) = delete;
+                async_connection &operator = (const async_connection &) = delete;
+
+            public:
+                typedef std::function<void (const boost::system::error_code &)> connect_callback;
+                typedef std::function<void (const boost::system::error_code &, std::size_t)> write_callback;
+                typedef std::function<void (const boost::system::error_code &, std::size_t)> read_callback;
+
+                /* gather list for one request; inline storage covers the usual header count */
+                typedef boost::container::small_vector<boost::asio::const_buffer, 64> const_buffers;
+
+                async_connection() :
+                    _completions(nullptr) { }
+
+                /* default operations complete through io_service, as asio's would */
+                explicit async_connection(boost::asio::io_service &io_service) :
+                    _completions(&io_service) { }
+
+                virtual ~async_connection() noexcept { }
+
+                virtual void async_connect(const boost::asio::ip::tcp::endpoint &endpoint,
+                    const std::string &host, connect_callback callback) = 0;
+
+                /*
+                 * Writes all of `buffers` with gather I/O. The buffers and the
+                 * memory they point to must stay alive until the callback runs.
+                 */
+                virtual void async_write(const const_buffers &buffers,
+                    write_callback callback) = 0;
+
+                virtual void async_read_some(const boost::asio::mutable_buffer &buffer,
+                    read_callback callback) = 0;
+
+                /* true if async_send_file() can be used */
+                virtual bool can_send_file() const {
+                    return false;
+                }
+
+                /*
+                 * Writes `length` bytes of the file `fd` from `offset` on,
+                 * without copying them through user space. The descriptor
+                 * must stay open until the callback runs.
+                 */
+                virtual void async_send_file(int, std::uint64_t, std::uint64_t,
+                    write_callback callback) {
+                    if (_completions) {
+                        _completions->post([callback] () { callback(boost::asio::error::operation_not_supported, 0); });
+                    } else {
+                        callback(boost::asio::error::operation_not_supported, 0);
+                    }
+                }
+
+                /* how long the TLS handshake of async_connect() took; zero without TLS */
+                virtual std::chrono::steady_clock::duration handshake_time() const {
+                    return std::chrono::steady_clock::duration::zero();
+                }
+
+                /* the application protocol agreed on with ALPN, e.g. "h2"; empty if none */
+                virtual std::string negotiated_protocol() const {
+                    return std::string();
+                }
+
+                /*
+                 * Called by the connection pool before an idle connection is
+                 * handed out again: returns false when the peer has closed the
+                 * connection or sent bytes nobody asked for.
+                 */
+                virtual bool is_reusable() = 0;
+
+                virtual void disconnect() = 0;
+
+                virtual void cancel() = 0;
+
+                /* bytes read on this connection and not parsed yet */
+                receive_buffer &buffer() {
+                    return _buffer;
+                }
+
+                /* decoders of the compressed responses read on this connection */
+                const std::shared_ptr<client_message::content_decoder_pool> &decoders() {
+                    if (!_decoders) {
+                        _decoders = std::make_shared<client_message::content_decoder_pool>();
+                    }
+                    return _decoders;
+                }
+
+            private:
+                boost::asio::io_service *_completions;
+                receive_buffer _buffer;
+                std::shared_ptr<client_message::content_decoder_pool> _decoders;
+            };
+        } // namespace client_connection
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_CONNECTION_ASYNC_CONNECTION_INC
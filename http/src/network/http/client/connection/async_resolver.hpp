@@ -0,0 +1,170 @@
+#ifndef NETWORK_HTTP_CLIENT_CONNECTION_ASYNC_RESOLVER_INC
+#define NETWORK_HTTP_CLIENT_CONNECTION_ASYNC_RESOLVER_INC
+
+#include <set>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <functional>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/system/error_code.hpp>
+#include <network/config.hpp>
+#include <network/http/client/connection/resolver_cache.hpp>
+
+namespace network {
+    namespace http {
+        namespace client_connection {
+            /*
+             * class async_resolver
+             *
+             * Resolves a host name to the list of endpoints the client may
+             * connect to. With a resolver_cache, answers come from the cache
+             * when possible and concurrent lookups of a name share a query.
+             * The query itself is async_query(), which a test can override
+             * to stand in for the system resolver.
+             *
+             * Queries this resolver started for the cache and that are still
+             * running when it is cancelled or destroyed are completed with
+             * operation_aborted, so other resolvers waiting on them are not
+             * left waiting. Answers for this resolver are dropped once it is
+             * gone.
+             */
+            class async_resolver {
+                async_resolver(const async_resolver &) = delete;
+                async_resolver &operator = (const async_resolver &) = delete;
+
+            public:
+                typedef boost::asio::ip::tcp::resolver resolver;
+                typedef boost::asio::ip::tcp::endpoint endpoint;
+                typedef std::vector<endpoint> endpoints;
+                typedef std::function<void (const boost::system::error_code &, const endpoints &)> resolve_callback;
+
+                explicit async_resolver(boost::asio::io_service &io_service,
+                    std::shared_ptr<resolver_cache> cache = nullptr) :
+                    _io_service(io_service),
+                    _resolver(io_service),
+                    _cache(std::move(cache)),
+                    _target(&io_service, [] (boost::asio::io_service *) { }),
+                    _queries(std::make_shared<queries>()) { }
+
+                virtual ~async_resolver() noexcept {
+                    _target.reset();
+                    abort_queries();
+                }
+
+                virtual void async_resolve(const std::string &host, std::uint16_t port,
+                    resolve_callback callback) {
+                    if (!_cache) {
+                        async_query(host, port, std::move(callback));
+                        return;
+                    }
+
+                    /* the cache may run callbacks on another resolver's thread, maybe after this one is gone */
+                    std::weak_ptr<boost::asio::io_service> target = _target;
+                    auto deliver = [target, callback] (const boost::system::error_code &ec, const endpoints &resolved) {
+                        if (auto io_service = target.lock()) {
+                            io_service->post(std::bind(callback, ec, resolved));
+                        }
+                    };
+
+                    if (!_cache->lookup(host, port, deliver)) {
+                        return;
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(_queries->mutex);
+                        _queries->hosts.insert(host);
+                    }
+
+                    std::shared_ptr<resolver_cache> cache = _cache;
+                    std::shared_ptr<queries> running = _queries;
+                    async_query(host, port,
+                        [cache, running, host] (const boost::system::error_code &ec, const endpoints &resolved) {
+                            {
+                                /* already completed by abort_queries() */
+                                std::lock_guard<std::mutex> lock(running->mutex);
+                                if (running->hosts.erase(host) == 0) {
+                                    return;
+                                }
+                            }
+
+                            std::vector<resolver_cache::address> addresses;
+                            addresses.reserve(resolved.size());
+                            for (const auto &e : resolved) {
+                                addresses.push_back(e.address());
+                            }
+                            cache->complete(host, ec, addresses);
+                        });
+                }
+
+                /* cancels the running queries, their callbacks get operation_aborted */
+                virtual void cancel() {
+                    _resolver.cancel();
+                    abort_queries();
+                }
+
+                virtual void clear_resolved_cache() {
+                    if (_cache) {
+                        _cache->clear();
+                    }
+                }
+
+                const std::shared_ptr<resolver_cache> &cache() const {
+                    return _cache;
+                }
+
+            protected:
+                /* resolves host without the cache */
+                virtual void async_query(const std::string &host, std::uint16_t port,
+                    resolve_callback callback) {
+                    resolver::query query(host, std::to_string(port));
+                    _resolver.async_resolve(query,
+                        [callback] (const boost::system::error_code &ec, resolver::iterator it) {
+                            endpoints resolved;
+                            for (; !ec && it != resolver::iterator(); ++it) {
+                                resolved.push_back(it->endpoint());
+                            }
+                            callback(ec, resolved);
+                        });
+                }
+
+                boost::asio::io_service &_io_service;
+
+            private:
+                /* the hosts this resolver is querying for the cache */
+                struct queries {
+                    std::mutex mutex;
+                    std::set<std::string> hosts;
+                };
+
+                void abort_queries() {
+                    if (!_cache) {
+                        return;
+                    }
+
+                    std::set<std::string> hosts;
+                    {
+                        std::lock_guard<std::mutex> lock(_queries->mutex);
+                        hosts.swap(_queries->hosts);
+                    }
+                    for (const auto &host : hosts) {
+                        _cache->complete(host, boost::asio::error::operation_aborted,
+                            std::vector<resolver_cache::address>());
+                    }
+                }
+
+                resolver _resolver;
+                std::shared_ptr<resolver_cache> _cache;
+                /* what deliver callbacks post to, without keeping it alive */
+                std::shared_ptr<boost::asio::io_service> _target;
+                std::shared_ptr<queries> _queries;
+            };
+        } // namespace client_connection
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_CONNECTION_ASYNC_RESOLVER_INC
@@ -0,0 +1,229 @@
+#ifndef NETWORK_HTTP_CLIENT_CONNECTION_CAPTURE_FILE_INC
+#define NETWORK_HTTP_CLIENT_CONNECTION_CAPTURE_FILE_INC
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <boost/utility/string_ref.hpp>
+#include <boost/system/system_error.hpp>
+#include <network/config.hpp>
+
+namespace network {
+    namespace http {
+        namespace client_connection {
+            /*
+             * A capture file is "NLXCAPTR", the format version, then for
+             * each exchange, in the order the requests were sent: when the
+             * request started and how long its response took to begin, in
+             * nanoseconds, the sizes of the request and of the response,
+             * then their bytes as they went over the connection. Numbers
+             * are in the byte order of the machine that wrote them.
+             */
+            static const char capture_file_magic[8] = { 'N', 'L', 'X', 'C', 'A', 'P', 'T', 'R' };
+            enum : std::uint32_t { capture_file_version = 1 };
+
+            /* one exchange of a capture_file, the bytes point into it */
+            struct capture_exchange {
+                /* since the first request of the capture */
+                std::uint64_t start;
+                /* from the end of the request to the first byte of the response */
+                std::uint64_t latency;
+                boost::string_ref request;
+                boost::string_ref response;
+            };
+
+            /*
+             * class capture_file
+             *
+             * The exchanges of a capture, read from a file mapped into
+             * memory, or from bytes in memory. Exchanges are views of the
+             * capture: they are valid as long as it is.
+             */
+            class capture_file {
+                capture_file(const capture_file &) = delete;
+                capture_file &operator = (const capture_file &) = delete;
+
+            public:
+                typedef std::vector<capture_exchange>::const_iterator const_iterator;
+
+                explicit capture_file(const std::string &path) :
+                    _data(nullptr), _size(0), _mapped(false) {
+                    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                    if (fd < 0) {
+                        throw boost::system::system_error(errno, boost::system::system_category(), path);
+                    }
+
+                    struct stat st;
+                    if (::fstat(fd, &st) != 0) {
+                        int error = errno;
+                        ::close(fd);
+                        throw boost::system::system_error(error, boost::system::system_category(), path);
+                    }
+
+                    _size = static_cast<std::size_t>(st.st_size);
+                    if (_size != 0) {
+                        void *data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+                        if (data == MAP_FAILED) {
+                            int error = errno;
+                            ::close(fd);
+                            throw boost::system::system_error(error, boost::system::system_category(), path);
+                        }
+                        _data = static_cast<const char *>(data);
+                        _mapped = true;
+                    }
+                    ::close(fd);
+
+                    try {
+                        index(path);
+                    } catch (...) {
+                        unmap();
+                        throw;
+                    }
+                }
+
+                /* a capture held in memory, e.g. written by a capture_writer to a string stream */
+                static std::unique_ptr<capture_file> from_bytes(std::string bytes) {
+                    std::unique_ptr<capture_file> capture(new capture_file);
+                    capture->_bytes = std::move(bytes);
+                    capture->_data = capture->_bytes.data();
+                    capture->_size = capture->_bytes.size();
+                    capture->index("capture");
+                    return capture;
+                }
+
+                ~capture_file() {
+                    unmap();
+                }
+
+                std::size_t size() const {
+                    return _exchanges.size();
+                }
+
+                bool empty() const {
+                    return _exchanges.empty();
+                }
+
+                const capture_exchange &operator [] (std::size_t i) const {
+                    return _exchanges[i];
+                }
+
+                const_iterator begin() const {
+                    return _exchanges.begin();
+                }
+
+                const_iterator end() const {
+                    return _exchanges.end();
+                }
+
+            private:
+                capture_file() :
+                    _data(nullptr), _size(0), _mapped(false) { }
+
+                void index(const std::string &name) {
+                    std::size_t offset = sizeof(capture_file_magic);
+                    std::uint32_t version = 0;
+                    if (_size < offset || std::memcmp(_data, capture_file_magic, offset) != 0 ||
+                        !read(offset, &version, sizeof(version)) || version != capture_file_version) {
+                        invalid(name);
+                    }
+
+                    while (offset < _size) {
+                        capture_exchange e;
+                        std::uint32_t request_size = 0, response_size = 0;
+                        if (!read(offset, &e.start, sizeof(e.start)) || !read(offset, &e.latency, sizeof(e.latency)) ||
+                            !read(offset, &request_size, sizeof(request_size)) ||
+                            !read(offset, &response_size, sizeof(response_size)) ||
+                            _size - offset < static_cast<std::size_t>(request_size) + response_size) {
+                            invalid(name);
+                        }
+                        e.request = boost::string_ref(_data + offset, request_size);
+                        offset += request_size;
+                        e.response = boost::string_ref(_data + offset, response_size);
+                        offset += response_size;
+                        _exchanges.push_back(e);
+                    }
+                }
+
+                /* copies size bytes from offset on, which need not be aligned */
+                bool read(std::size_t &offset, void *to, std::size_t size) const {
+                    if (_size - offset < size) {
+                        return false;
+                    }
+                    std::memcpy(to, _data + offset, size);
+                    offset += size;
+                    return true;
+                }
+
+                static void invalid(const std::string &name) {
+                    throw boost::system::system_error(
+                        boost::system::errc::make_error_code(boost::system::errc::invalid_argument),
+                        name + ": not a capture file");
+                }
+
+                void unmap() {
+                    if (_mapped) {
+                        ::munmap(const_cast<char *>(_data), _size);
+                        _mapped = false;
+                    }
+                }
+
+                const char *_data;
+                std::size_t _size;
+                bool _mapped;
+                std::string _bytes;
+                std::vector<capture_exchange> _exchanges;
+            };
+
+            /*
+             * class capture_writer
+             *
+             * Writes a capture file, one exchange at a time, in the order
+             * the requests were sent.
+             */
+            class capture_writer {
+                capture_writer(const capture_writer &) = delete;
+                capture_writer &operator = (const capture_writer &) = delete;
+
+            public:
+                explicit capture_writer(std::ostream &out) :
+                    _out(out) {
+                    std::uint32_t version = capture_file_version;
+                    _out.write(capture_file_magic, sizeof(capture_file_magic));
+                    _out.write(reinterpret_cast<const char *>(&version), sizeof(version));
+                }
+
+                /* throws invalid_argument if request or response is larger than the format's 4 GiB - 1 */
+                void add(std::uint64_t start, std::uint64_t latency,
+                    boost::string_ref request, boost::string_ref response) {
+                    if (request.size() > UINT32_MAX || response.size() > UINT32_MAX) {
+                        throw boost::system::system_error(
+                            boost::system::errc::make_error_code(boost::system::errc::invalid_argument),
+                            "exchange too large for a capture file");
+                    }
+                    std::uint32_t request_size = static_cast<std::uint32_t>(request.size());
+                    std::uint32_t response_size = static_cast<std::uint32_t>(response.size());
+                    _out.write(reinterpret_cast<const char *>(&start), sizeof(start));
+                    _out.write(reinterpret_cast<const char *>(&latency), sizeof(latency));
+                    _out.write(reinterpret_cast<const char *>(&request_size), sizeof(request_size));
+                    _out.write(reinterpret_cast<const char *>(&response_size), sizeof(response_size));
+                    _out.write(request.data(), static_cast<std::streamsize>(request.size()));
+                    _out.write(response.data(), static_cast<std::streamsize>(response.size()));
+                }
+
+            private:
+                std::ostream &_out;
+            };
+        } // namespace client_connection
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_CONNECTION_CAPTURE_FILE_INC
@@ -0,0 +1,258 @@
+#ifndef NETWORK_HTTP_CLIENT_CONNECTION_CONNECTION_POOL_INC
+#define NETWORK_HTTP_CLIENT_CONNECTION_CONNECTION_POOL_INC
+
+#include <string>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <functional>
+#include <unordered_map>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/functional/hash.hpp>
+#include <network/config.hpp>
+#include <network/http/client/connection/async_connection.hpp>
+
+namespace network {
+    namespace http {
+        namespace client_connection {
+            /*
+             * Connections are only shared between requests to the same
+             * scheme, host and port.
+             */
+            struct pool_key {
+                std::string   scheme;
+                std::string   host;
+                std::uint16_t port;
+            };
+
+            inline bool operator == (const pool_key &lhs, const pool_key &rhs) {
+                return lhs.port == rhs.port && lhs.host == rhs.host && lhs.scheme == rhs.scheme;
+            }
+
+            struct pool_key_hash {
+                std::size_t operator()(const pool_key &key) const {
+                    std::size_t seed = 0;
+                    boost::hash_combine(seed, key.scheme);
+                    boost::hash_combine(seed, key.host);
+                    boost::hash_combine(seed, key.port);
+                    return seed;
+                }
+            };
+
+            struct pool_statistics {
+                std::uint64_t opened;
+                std::uint64_t reused;
+                std::uint64_t discarded;
+            };
+
+            /*
+             * class connection_pool
+             *
+             * Keeps idle keep-alive connections per origin and bounds the
+             * number of connections in use per origin. A checkout either hands
+             * out a healthy idle connection, or grants a slot for a new
+             * connection (the callback receives nullptr), or queues the caller
+             * until a slot is returned. Every checkout must be balanced by
+             * exactly one checkin, with or without a connection.
+             */
+            class connection_pool {
+                connection_pool(const connection_pool &) = delete;
+                connection_pool &operator = (const connection_pool &) = delete;
+
+            public:
+                typedef std::shared_ptr<async_connection> connection_ptr;
+                typedef std::function<void (connection_ptr)> checkout_callback;
+                typedef std::chrono::steady_clock clock;
+
+                connection_pool(boost::asio::io_service &io_service,
+                    std::size_t max_active,
+                    std::size_t max_idle,
+                    std::chrono::milliseconds idle_timeout) :
+                    _io_service(io_service),
+                    _max_active(max_active == 0 ? 1 : max_active),
+                    _max_idle(max_idle),
+                    _idle_timeout(idle_timeout),
+                    _reaper(io_service),
+                    _reaper_armed(false),
+                    _statistics() { }
+
+                ~connection_pool() {
+                    clear();
+                }
+
+                void async_checkout(const pool_key &key, checkout_callback callback) {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    host_pool &pool = _hosts[key];
+
+                    while (!pool.idle.empty()) {
+                        idle_connection idle = std::move(pool.idle.back());
+                        pool.idle.pop_back();
+
+                        if (clock::now() - idle.since < _idle_timeout && idle.connection->is_reusable()) {
+                            ++pool.active;
+                            ++_statistics.reused;
+                            lock.unlock();
+                            _io_service.post(std::bind(std::move(callback), idle.connection));
+                            return;
+                        }
+
+                        ++_statistics.discarded;
+                        idle.connection->disconnect();
+                    }
+
+                    if (pool.active < _max_active) {
+                        ++pool.active;
+                        ++_statistics.opened;
+                        lock.unlock();
+                        _io_service.post(std::bind(std::move(callback), connection_ptr()));
+                        return;
+                    }
+
+                    pool.waiters.push_back(std::move(callback));
+                }
+
+                void checkin(const pool_key &key, connection_ptr connection, bool reusable) {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    auto host = _hosts.find(key);
+                    if (host == _hosts.end()) {
+                        host = _hosts.emplace(key, host_pool()).first;
+                    }
+                    host_pool &pool = host->second;
+
+                    if (connection && !reusable) {
+                        connection->disconnect();
+                        connection.reset();
+                    }
+
+                    if (!pool.waiters.empty()) {
+                        /* the slot goes straight to the next caller in line */
+                        checkout_callback waiter = std::move(pool.waiters.front());
+                        pool.waiters.pop_front();
+                        if (connection) {
+                            ++_statistics.reused;
+                        } else {
+                            ++_statistics.opened;
+                        }
+                        lock.unlock();
+                        _io_service.post(std::bind(std::move(waiter), connection));
+                        return;
+                    }
+
+                    --pool.active;
+                    if (connection && pool.idle.size() >= _max_idle) {
+                        ++_statistics.discarded;
+                        connection->disconnect();
+                        connection.reset();
+                    }
+                    if (!connection) {
+                        forget_if_unused(host);
+                        return;
+                    }
+
+                    pool.idle.push_back(idle_connection{ std::move(connection), clock::now() });
+                    arm_reaper();
+                }
+
+                void clear() {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    for (auto host = _hosts.begin(); host != _hosts.end(); ) {
+                        for (auto &idle : host->second.idle) {
+                            idle.connection->disconnect();
+                        }
+                        host->second.idle.clear();
+                        host = forget_if_unused(host);
+                    }
+                    boost::system::error_code ignored;
+                    _reaper.cancel(ignored);
+                    _reaper_armed = false;
+                }
+
+                pool_statistics statistics() const {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    return _statistics;
+                }
+
+            private:
+                struct idle_connection {
+                    connection_ptr    connection;
+                    clock::time_point since;
+                };
+
+                struct host_pool {
+                    host_pool() : active(0) { }
+
+                    std::deque<idle_connection>   idle;
+                    std::size_t                   active;
+                    std::deque<checkout_callback> waiters;
+                };
+
+                typedef std::unordered_map<pool_key, host_pool, pool_key_hash>::iterator host_iterator;
+
+                /*
+                 * Drops the entry of a host without connections or callers,
+                 * so that a client visiting many hosts does not keep them
+                 * all. Returns the next entry; called with _mutex held.
+                 */
+                host_iterator forget_if_unused(host_iterator host) {
+                    const host_pool &pool = host->second;
+                    if (pool.active == 0 && pool.idle.empty() && pool.waiters.empty()) {
+                        return _hosts.erase(host);
+                    }
+                    return ++host;
+                }
+
+                /* called with _mutex held */
+                void arm_reaper() {
+                    if (_reaper_armed) {
+                        return;
+                    }
+                    _reaper_armed = true;
+                    _reaper.expires_from_now(_idle_timeout);
+                    _reaper.async_wait([this] (const boost::system::error_code &ec) {
+                            if (!ec) {
+                                reap();
+                            }
+                        });
+                }
+
+                void reap() {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _reaper_armed = false;
+
+                    bool any_idle = false;
+                    auto deadline = clock::now() - _idle_timeout;
+                    for (auto host = _hosts.begin(); host != _hosts.end(); ) {
+                        auto &idle = host->second.idle;
+                        while (!idle.empty() && idle.front().since <= deadline) {
+                            ++_statistics.discarded;
+                            idle.front().connection->disconnect();
+                            idle.pop_front();
+                        }
+                        any_idle = any_idle || !idle.empty();
+                        host = forget_if_unused(host);
+                    }
+
+                    if (any_idle) {
+                        arm_reaper();
+                    }
+                }
+
+                boost::asio::io_service &_io_service;
+                std::size_t _max_active;
+                std::size_t _max_idle;
+                std::chrono::milliseconds _idle_timeout;
+                boost::asio::steady_timer _reaper;
+                bool _reaper_armed;
+                pool_statistics _statistics;
+                std::unordered_map<pool_key, host_pool, pool_key_hash> _hosts;
+                mutable std::mutex _mutex;
+            };
+        } // namespace client_connection
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_CONNECTION_CONNECTION_POOL_INC
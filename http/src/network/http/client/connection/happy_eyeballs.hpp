@@ -0,0 +1,214 @@
+#ifndef NETWORK_HTTP_CLIENT_CONNECTION_HAPPY_EYEBALLS_INC
+#define NETWORK_HTTP_CLIENT_CONNECTION_HAPPY_EYEBALLS_INC
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/system/error_code.hpp>
+#include <network/config.hpp>
+#include <network/http/client/connection/async_connection.hpp>
+
+namespace network {
+    namespace http {
+        namespace client_connection {
+            /* outcome of one connection attempt, times relative to the start of the race */
+            struct connect_attempt {
+                boost::asio::ip::tcp::endpoint endpoint;
+                std::chrono::steady_clock::duration started;
+                std::chrono::steady_clock::duration finished;
+                boost::system::error_code error;
+                bool won;
+            };
+
+            /*
+             * class happy_eyeballs
+             *
+             * Connects to the first of several endpoints that answers (RFC
+             * 8305). The endpoints are reordered to alternate between address
+             * families, starting with the family of the first one, and a new
+             * attempt starts every `attempt_delay` or as soon as the previous
+             * one fails, each on a connection of its own. The first attempt to
+             * succeed wins and the others are disconnected. An attempt_delay
+             * of zero tries the endpoints one after the other.
+             */
+            class happy_eyeballs : public std::enable_shared_from_this<happy_eyeballs> {
+                happy_eyeballs(const happy_eyeballs &) = delete;
+                happy_eyeballs &operator = (const happy_eyeballs &) = delete;
+
+            public:
+                typedef std::shared_ptr<async_connection> connection_ptr;
+                typedef std::vector<boost::asio::ip::tcp::endpoint> endpoints;
+                typedef std::function<connection_ptr ()> connection_factory;
+                typedef std::function<void (const boost::system::error_code &, connection_ptr,
+                    const std::vector<connect_attempt> &)> connect_callback;
+                typedef std::chrono::steady_clock clock;
+
+                happy_eyeballs(boost::asio::io_service &io_service,
+                    const endpoints &candidates,
+                    std::string host,
+                    connection_factory factory,
+                    std::chrono::milliseconds attempt_delay) :
+                    _io_service(io_service),
+                    _candidates(interleave(candidates)),
+                    _host(std::move(host)),
+                    _factory(std::move(factory)),
+                    _attempt_delay(attempt_delay),
+                    _timer(io_service),
+                    _next(0),
+                    _in_flight(0),
+                    _done(false) { }
+
+                /* callback runs once, with the winning connection or the last error */
+                void async_connect(connect_callback callback) {
+                    _callback = std::move(callback);
+                    _start = clock::now();
+                    if (_candidates.empty()) {
+                        auto self = shared_from_this();
+                        _io_service.post([self] () {
+                                self->complete(boost::asio::error::host_not_found, nullptr);
+                            });
+                        return;
+                    }
+                    start_attempt();
+                }
+
+                /* gives up: pending attempts are disconnected, the callback gets operation_aborted */
+                void cancel() {
+                    if (_done) {
+                        return;
+                    }
+                    complete(boost::asio::error::operation_aborted, nullptr);
+                }
+
+                const std::vector<connect_attempt> &attempts() const {
+                    return _attempts;
+                }
+
+                /* family of the first endpoint first, then alternating (RFC 8305, 4) */
+                static endpoints interleave(const endpoints &candidates) {
+                    if (candidates.empty()) {
+                        return candidates;
+                    }
+
+                    bool first_v6 = candidates.front().address().is_v6();
+                    endpoints preferred, other;
+                    for (const auto &e : candidates) {
+                        (e.address().is_v6() == first_v6 ? preferred : other).push_back(e);
+                    }
+
+                    endpoints ordered;
+                    ordered.reserve(candidates.size());
+                    for (std::size_t i = 0; i < preferred.size() || i < other.size(); ++i) {
+                        if (i < preferred.size()) {
+                            ordered.push_back(preferred[i]);
+                        }
+                        if (i < other.size()) {
+                            ordered.push_back(other[i]);
+                        }
+                    }
+                    return ordered;
+                }
+
+            private:
+                void start_attempt() {
+                    std::size_t index = _next++;
+                    connection_ptr connection = _factory();
+                    _connections.push_back(connection);
+                    _attempts.push_back(connect_attempt{ _candidates[index], clock::now() - _start,
+                            clock::duration::zero(), boost::system::error_code(), false });
+                    ++_in_flight;
+
+                    auto self = shared_from_this();
+                    connection->async_connect(_candidates[index], _host,
+                        [self, index] (const boost::system::error_code &ec) {
+                            self->attempt_finished(index, ec);
+                        });
+
+                    if (_next < _candidates.size() && _attempt_delay.count() > 0) {
+                        _timer.expires_from_now(_attempt_delay);
+                        _timer.async_wait([self] (const boost::system::error_code &ec) {
+                                if (!ec && !self->_done && self->_next < self->_candidates.size()) {
+                                    self->start_attempt();
+                                }
+                            });
+                    }
+                }
+
+                void attempt_finished(std::size_t index, const boost::system::error_code &ec) {
+                    --_in_flight;
+                    if (_done) {
+                        return;
+                    }
+
+                    connect_attempt &attempt = _attempts[index];
+                    attempt.finished = clock::now() - _start;
+                    attempt.error = ec;
+
+                    if (!ec) {
+                        attempt.won = true;
+                        connection_ptr winner = _connections[index];
+                        _connections[index].reset();
+                        complete(ec, winner);
+                        return;
+                    }
+
+                    _connections[index]->disconnect();
+                    _connections[index].reset();
+                    _last_error = ec;
+
+                    if (_next < _candidates.size()) {
+                        /* a failure starts the next attempt right away */
+                        boost::system::error_code ignored;
+                        _timer.cancel(ignored);
+                        start_attempt();
+                    } else if (_in_flight == 0) {
+                        complete(_last_error, nullptr);
+                    }
+                }
+
+                void complete(const boost::system::error_code &ec, connection_ptr winner) {
+                    _done = true;
+                    boost::system::error_code ignored;
+                    _timer.cancel(ignored);
+                    for (std::size_t i = 0; i < _connections.size(); ++i) {
+                        if (_connections[i]) {
+                            _attempts[i].finished = clock::now() - _start;
+                            _attempts[i].error = boost::asio::error::operation_aborted;
+                            _connections[i]->disconnect();
+                            _connections[i].reset();
+                        }
+                    }
+
+                    connect_callback callback = std::move(_callback);
+                    _callback = nullptr;
+                    if (callback) {
+                        callback(ec, winner, _attempts);
+                    }
+                }
+
+                boost::asio::io_service &_io_service;
+                endpoints _candidates;
+                std::string _host;
+                connection_factory _factory;
+                std::chrono::milliseconds _attempt_delay;
+                boost::asio::steady_timer _timer;
+                std::size_t _next;
+                std::size_t _in_flight;
+                bool _done;
+                clock::time_point _start;
+                boost::system::error_code _last_error;
+                std::vector<connection_ptr> _connections;
+                std::vector<connect_attempt> _attempts;
+                connect_callback _callback;
+            };
+        } // namespace client_connection
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_CONNECTION_HAPPY_EYEBALLS_INC
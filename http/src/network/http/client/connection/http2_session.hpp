@@ -0,0 +1,1148 @@
+#ifndef NETWORK_HTTP_CLIENT_CONNECTION_HTTP2_SESSION_INC
+#define NETWORK_HTTP_CLIENT_CONNECTION_HTTP2_SESSION_INC
+
+#include <map>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <boost/system/system_error.hpp>
+#include <network/config.hpp>
+#include <network/http/method.hpp>
+#include <network/http/header_map.hpp>
+#include <network/http/http2/frame.hpp>
+#include <network/http/http2/hpack.hpp>
+#include <network/http/client/request.hpp>
+#include <network/http/client/connection/async_connection.hpp>
+
+namespace network {
+    namespace http {
+        namespace client_connection {
+            /*
+             * class http2_stream_observer
+             *
+             * Receives what happens on one stream of an http2_session. All
+             * calls are made on the session's strand, none after
+             * on_complete() or on_error().
+             */
+            class http2_stream_observer {
+            public:
+                typedef boost::string_ref string_ref;
+
+                virtual ~http2_stream_observer() { }
+
+                /* a field of the response, pseudo-header fields included; trailer fields follow the body */
+                virtual void on_header(string_ref name, string_ref value, bool trailer) = 0;
+
+                virtual void on_headers_complete() = 0;
+
+                /*
+                 * A piece of the body. Returning false holds back the rest,
+                 * and the peer's flow control window, until the session's
+                 * resume() is called.
+                 */
+                virtual bool on_data(string_ref data) = 0;
+
+                /* bytes of the request body written */
+                virtual void on_written(std::size_t bytes) = 0;
+
+                virtual void on_complete() = 0;
+
+                /*
+                 * The stream failed. `unprocessed` is set when the server
+                 * guarantees it did not act on the request (REFUSED_STREAM,
+                 * or beyond the last stream of a GOAWAY), which may then be
+                 * sent again; ec is boost::asio::error::try_again when the
+                 * request was not even sent.
+                 */
+                virtual void on_error(const boost::system::error_code &ec, bool unprocessed) = 0;
+            };
+
+            /*
+             * class http2_session
+             *
+             * One HTTP/2 connection (RFC 9113) carrying any number of
+             * concurrent requests as streams, up to the limit the server
+             * announces; streams past it wait for others to close. Header
+             * blocks are compressed with HPACK, request bodies are sent
+             * within the server's flow control windows, a piece of each
+             * stream per write, and response bodies are granted windows as
+             * their observers take them. Server push and priorities are not
+             * used. All work is done on a strand, so the public functions
+             * can be called from any thread.
+             */
+            class http2_session : public std::enable_shared_from_this<http2_session> {
+                http2_session(const http2_session &) = delete;
+                http2_session &operator = (const http2_session &) = delete;
+
+            public:
+                typedef std::shared_ptr<async_connection> connection_ptr;
+                typedef std::shared_ptr<const client_message::request> request_ptr;
+                typedef std::shared_ptr<http2_stream_observer> observer_ptr;
+
+                /*
+                 * connection is connected, and for TLS has negotiated "h2".
+                 * The session is closed once it has been idle for
+                 * idle_timeout (zero keeps it open); on_close is called
+                 * when it is closed for whatever reason.
+                 */
+                http2_session(boost::asio::io_service &io_service, connection_ptr connection,
+                    std::chrono::milliseconds idle_timeout, std::function<void ()> on_close);
+
+                ~http2_session() noexcept { }
+
+                /* sends the connection preface and starts reading */
+                void start();
+
+                /* false once the session is closed, or draining after a GOAWAY or a refused stream */
+                bool accepting() const {
+                    return _accepting;
+                }
+
+                /* sends req on a new stream; the body is read from req's byte source */
+                void submit(request_ptr req, observer_ptr observer);
+
+                /* resets the stream of observer, which is not called any more */
+                void cancel(const http2_stream_observer *observer);
+
+                /* hands observer what it held back, and lets the server send more */
+                void resume(const http2_stream_observer *observer);
+
+                /* sends GOAWAY and closes the connection, open streams fail */
+                void close();
+
+                /*
+                 * Drops all streams without telling their observers; only
+                 * when no handler of the session can run any more, e.g.
+                 * after the io_service has been stopped.
+                 */
+                void abandon();
+
+                const connection_ptr &connection() const {
+                    return _connection;
+                }
+
+                enum : std::uint32_t {
+                    /* receive windows granted to the server */
+                    stream_window = 1 << 20,
+                    connection_window = 1 << 24,
+                    /* largest piece of a body taken from a byte source at once */
+                    max_body_piece = 64 * 1024,
+                    max_header_table_size = 4096,
+                    /* advertised as SETTINGS_MAX_HEADER_LIST_SIZE, bounds a header block as received */
+                    max_header_list_size = 64 * 1024,
+                };
+
+            private:
+                struct stream {
+                    stream(request_ptr req, observer_ptr obs) :
+                        id(0),
+                        request(std::move(req)),
+                        observer(std::move(obs)),
+                        send_window(0),
+                        unacked(0),
+                        sending(false),
+                        sent_end(false),
+                        headers_received(false),
+                        received_end(false),
+                        paused(false),
+                        closed(false) { }
+
+                    std::uint32_t id;
+                    request_ptr request;
+                    observer_ptr observer;
+                    boost::optional<std::uint64_t> remaining;
+                    std::int64_t send_window;
+                    std::uint32_t unacked;
+                    bool sending;
+                    bool sent_end;
+                    bool headers_received;
+                    bool received_end;
+                    bool paused;
+                    bool closed;
+                    std::string held;
+                };
+                typedef std::shared_ptr<stream> stream_ptr;
+
+                void read();
+                void on_read(const boost::system::error_code &ec, std::size_t bytes_transferred);
+                bool on_frame(const http2::frame_header &header, const char *payload);
+                bool on_headers_end();
+                bool on_settings(const char *payload, std::uint32_t length);
+                void on_goaway(std::uint32_t last_stream_id);
+                void open_stream(stream_ptr s);
+                void start_pending();
+                void encode_headers(const stream &s);
+                void deliver(stream &s, const char *data, std::size_t size);
+                void window_update(stream &s);
+                void complete(stream_ptr s);
+                void reset_stream(stream_ptr s, http2::error_code code);
+                void remove(stream_ptr s);
+                stream_ptr find(const http2_stream_observer *observer) const;
+                void flush();
+                void on_written(const boost::system::error_code &ec);
+                void connection_error(http2::error_code code);
+                void shutdown(const boost::system::error_code &ec, http2::error_code code);
+                void arm_idle_timer();
+
+                boost::asio::io_service::strand _strand;
+                connection_ptr _connection;
+                boost::asio::steady_timer _idle_timer;
+                std::chrono::milliseconds _idle_timeout;
+                std::function<void ()> _on_close;
+                http2::hpack::encoder _encoder;
+                http2::hpack::decoder _decoder;
+
+                std::map<std::uint32_t, stream_ptr> _streams;
+                std::deque<stream_ptr> _pending;
+                std::uint32_t _next_stream_id;
+                std::uint32_t _last_stream_id;
+                std::atomic<bool> _accepting;
+                bool _draining;
+                bool _closed;
+
+                /* frames queued, and the batch being written */
+                std::string _outbox;
+                std::string _writing;
+                std::vector<char> _data_headers;
+                std::vector<std::pair<stream_ptr, std::size_t> > _data_streams;
+                async_connection::const_buffers _buffers;
+                bool _write_in_progress;
+
+                std::int64_t _send_window;
+                std::uint32_t _recv_unacked;
+                std::uint32_t _peer_initial_window;
+                std::uint32_t _peer_max_frame_size;
+                std::uint32_t _peer_max_concurrent_streams;
+
+                /* a header block spread over CONTINUATION frames */
+                std::string _header_block;
+                std::uint32_t _header_stream;
+                bool _header_end_stream;
+                std::vector<std::pair<std::string, std::string> > _fields;
+                std::string _name;
+            };
+        } // namespace client_connection
+    } // namespace http
+} // namespace network
+
+/*
+ * implementation
+ */
+namespace network {
+    namespace http {
+        namespace client_connection {
+            inline http2_session::http2_session(boost::asio::io_service &io_service, connection_ptr connection,
+                std::chrono::milliseconds idle_timeout, std::function<void ()> on_close) :
+                _strand(io_service),
+                _connection(std::move(connection)),
+                _idle_timer(io_service),
+                _idle_timeout(idle_timeout),
+                _on_close(std::move(on_close)),
+                _decoder(max_header_table_size),
+                _next_stream_id(1),
+                _last_stream_id(0),
+                _accepting(true),
+                _draining(false),
+                _closed(false),
+                _write_in_progress(false),
+                _send_window(http2::default_window_size),
+                _recv_unacked(0),
+                _peer_initial_window(http2::default_window_size),
+                _peer_max_frame_size(http2::default_max_frame_size),
+                /* until the server's SETTINGS say otherwise */
+                _peer_max_concurrent_streams(100),
+                _header_stream(0),
+                _header_end_stream(false) { }
+
+            inline void http2_session::start() {
+                auto self = shared_from_this();
+                _strand.post([self] () {
+                        using namespace http2;
+                        self->_outbox.append(connection_preface(), connection_preface_size);
+
+                        append_frame_header(self->_outbox, 18, frame_type::settings, 0, 0);
+                        const std::pair<setting, std::uint32_t> settings[] = {
+                            { setting::enable_push, 0 },
+                            { setting::initial_window_size, stream_window },
+                            { setting::max_header_list_size, max_header_list_size },
+                        };
+                        for (const auto &s : settings) {
+                            self->_outbox.push_back(static_cast<char>(static_cast<std::uint16_t>(s.first) >> 8));
+                            self->_outbox.push_back(static_cast<char>(s.first));
+                            append_uint32(self->_outbox, s.second);
+                        }
+
+                        append_frame_header(self->_outbox, 4, frame_type::window_update, 0, 0);
+                        append_uint32(self->_outbox, connection_window - static_cast<std::uint32_t>(default_window_size));
+
+                        self->read();
+                        self->flush();
+                    });
+            }
+
+            inline void http2_session::submit(request_ptr req, observer_ptr observer) {
+                auto self = shared_from_this();
+                auto s = std::make_shared<stream>(std::move(req), std::move(observer));
+                _strand.post([self, s] () { self->open_stream(s); });
+            }
+
+            inline void http2_session::cancel(const http2_stream_observer *observer) {
+                auto self = shared_from_this();
+                _strand.post([self, observer] () {
+                        for (auto it = self->_pending.begin(); it != self->_pending.end(); ++it) {
+                            if ((*it)->observer.get() == observer) {
+                                self->_pending.erase(it);
+                                return;
+                            }
+                        }
+
+                        stream_ptr s = self->find(observer);
+                        if (s) {
+                            s->observer.reset();
+                            self->reset_stream(s, http2::error_code::cancel);
+                            self->flush();
+                        }
+                    });
+            }
+
+            inline void http2_session::resume(const http2_stream_observer *observer) {
+                auto self = shared_from_this();
+                _strand.post([self, observer] () {
+                        stream_ptr s = self->find(observer);
+                        if (!s || !s->paused) {
+                            return;
+                        }
+
+                        s->paused = false;
+                        if (!s->held.empty()) {
+                            std::string held;
+                            held.swap(s->held);
+                            self->deliver(*s, held.data(), held.size());
+                        }
+                        if (!s->paused) {
+                            if (s->received_end) {
+                                self->complete(s);
+                            } else {
+                                self->window_update(*s);
+                            }
+                        }
+                        self->flush();
+                    });
+            }
+
+            inline void http2_session::close() {
+                auto self = shared_from_this();
+                _strand.post([self] () {
+                        self->shutdown(boost::asio::error::operation_aborted, http2::error_code::no_error);
+                    });
+            }
+
+            inline void http2_session::abandon() {
+                _accepting = false;
+                _closed = true;
+                _streams.clear();
+                _pending.clear();
+                _data_streams.clear();
+                _on_close = nullptr;
+            }
+
+            inline void http2_session::read() {
+                auto self = shared_from_this();
+                _connection->async_read_some(_connection->buffer().prepare(),
+                    _strand.wrap([self] (const boost::system::error_code &ec, std::size_t bytes_transferred) {
+                            self->on_read(ec, bytes_transferred);
+                        }));
+            }
+
+            inline void http2_session::on_read(const boost::system::error_code &ec, std::size_t bytes_transferred) {
+                if (_closed) {
+                    return;
+                }
+                if (ec) {
+                    shutdown(ec, http2::error_code::no_error);
+                    return;
+                }
+
+                auto &buffer = _connection->buffer();
+                buffer.commit(bytes_transferred);
+                while (buffer.size() >= http2::frame_header_size) {
+                    http2::frame_header header = http2::read_frame_header(buffer.data());
+                    /* we never raise SETTINGS_MAX_FRAME_SIZE */
+                    if (header.length > http2::default_max_frame_size) {
+                        connection_error(http2::error_code::frame_size_error);
+                        return;
+                    }
+                    if (buffer.size() < http2::frame_header_size + header.length) {
+                        break;
+                    }
+                    if (!on_frame(header, buffer.data() + http2::frame_header_size) || _closed) {
+                        return;
+                    }
+                    buffer.consume(http2::frame_header_size + header.length);
+                }
+
+                read();
+                flush();
+            }
+
+            /* false after a connection error */
+            inline bool http2_session::on_frame(const http2::frame_header &header, const char *payload) {
+                using namespace http2;
+
+                if (_header_stream != 0 && header.type != frame_type::continuation) {
+                    connection_error(error_code::protocol_error);
+                    return false;
+                }
+
+                /* padding of DATA and HEADERS */
+                std::uint32_t length = header.length;
+                if ((header.type == frame_type::data || header.type == frame_type::headers) &&
+                    (header.flags & frame_flags::padded)) {
+                    std::uint32_t padding = length > 0 ? static_cast<std::uint8_t>(payload[0]) : 0;
+                    if (length == 0 || padding >= length) {
+                        connection_error(error_code::protocol_error);
+                        return false;
+                    }
+                    ++payload;
+                    length -= padding + 1;
+                }
+
+                switch (header.type) {
+                case frame_type::data: {
+                    if (header.stream_id == 0 || header.stream_id >= _next_stream_id) {
+                        connection_error(error_code::protocol_error);
+                        return false;
+                    }
+
+                    /* the connection window is given back right away, streams hold theirs while paused */
+                    _recv_unacked += header.length;
+                    if (_recv_unacked >= connection_window / 2) {
+                        append_frame_header(_outbox, 4, frame_type::window_update, 0, 0);
+                        append_uint32(_outbox, _recv_unacked);
+                        _recv_unacked = 0;
+                    }
+
+                    auto it = _streams.find(header.stream_id);
+                    if (it == _streams.end() || it->second->received_end) {
+                        /* reset by us, what was in flight is dropped */
+                        return true;
+                    }
+                    stream_ptr s = it->second;
+                    if (!s->headers_received) {
+                        reset_stream(s, error_code::protocol_error);
+                        return true;
+                    }
+
+                    s->unacked += header.length;
+                    deliver(*s, payload, length);
+                    if (header.flags & frame_flags::end_stream) {
+                        s->received_end = true;
+                    }
+                    if (!s->paused) {
+                        if (s->received_end) {
+                            complete(s);
+                        } else {
+                            window_update(*s);
+                        }
+                    }
+                    return true;
+                }
+
+                case frame_type::headers:
+                    if (header.stream_id == 0) {
+                        connection_error(error_code::protocol_error);
+                        return false;
+                    }
+                    if (header.flags & frame_flags::priority) {
+                        if (length < 5) {
+                            connection_error(error_code::frame_size_error);
+                            return false;
+                        }
+                        payload += 5;
+                        length -= 5;
+                    }
+                    _header_block.assign(payload, length);
+                    _header_stream = header.stream_id;
+                    _header_end_stream = (header.flags & frame_flags::end_stream) != 0;
+                    return (header.flags & frame_flags::end_headers) ? on_headers_end() : true;
+
+                case frame_type::continuation:
+                    if (header.stream_id == 0 || header.stream_id != _header_stream) {
+                        connection_error(error_code::protocol_error);
+                        return false;
+                    }
+                    if (_header_block.size() + length > max_header_list_size) {
+                        connection_error(error_code::enhance_your_calm);
+                        return false;
+                    }
+                    _header_block.append(payload, length);
+                    return (header.flags & frame_flags::end_headers) ? on_headers_end() : true;
+
+                case frame_type::rst_stream: {
+                    if (header.stream_id == 0 || header.stream_id >= _next_stream_id) {
+                        connection_error(error_code::protocol_error);
+                        return false;
+                    }
+                    if (length != 4) {
+                        connection_error(error_code::frame_size_error);
+                        return false;
+                    }
+
+                    auto it = _streams.find(header.stream_id);
+                    if (it == _streams.end()) {
+                        return true;
+                    }
+                    stream_ptr s = it->second;
+                    auto code = static_cast<error_code>(read_uint32(payload));
+                    std::deque<stream_ptr> pending;
+                    if (code == error_code::refused_stream) {
+                        /* a server refusing streams without GOAWAY is shedding this connection */
+                        _accepting = false;
+                        _draining = true;
+                        pending.swap(_pending);
+                    }
+                    remove(s);
+                    if (s->received_end) {
+                        /* the response is complete, the server only stops the upload */
+                        if (!s->paused) {
+                            complete(s);
+                        }
+                    } else if (s->observer) {
+                        s->observer->on_error(make_error_code(code), code == error_code::refused_stream);
+                    }
+                    for (auto &p : pending) {
+                        if (auto observer = std::move(p->observer)) {
+                            observer->on_error(boost::asio::error::try_again, true);
+                        }
+                    }
+                    return true;
+                }
+
+                case frame_type::settings:
+                    if (header.stream_id != 0) {
+                        connection_error(error_code::protocol_error);
+                        return false;
+                    }
+                    if (header.flags & frame_flags::ack) {
+                        return true;
+                    }
+                    return on_settings(payload, length);
+
+                case frame_type::push_promise:
+                    /* disabled in our SETTINGS */
+                    connection_error(error_code::protocol_error);
+                    return false;
+
+                case frame_type::ping:
+                    if (header.stream_id != 0) {
+                        connection_error(error_code::protocol_error);
+                        return false;
+                    }
+                    if (length != 8) {
+                        connection_error(error_code::frame_size_error);
+                        return false;
+                    }
+                    if (!(header.flags & frame_flags::ack)) {
+                        append_frame_header(_outbox, 8, frame_type::ping, frame_flags::ack, 0);
+                        _outbox.append(payload, 8);
+                    }
+                    return true;
+
+                case frame_type::goaway:
+                    if (header.stream_id != 0) {
+                        connection_error(error_code::protocol_error);
+                        return false;
+                    }
+                    if (length < 8) {
+                        connection_error(error_code::frame_size_error);
+                        return false;
+                    }
+                    on_goaway(read_uint32(payload) & 0x7fffffff);
+                    return true;
+
+                case frame_type::window_update: {
+                    if (length != 4) {
+                        connection_error(error_code::frame_size_error);
+                        return false;
+                    }
+                    std::uint32_t increment = read_uint32(payload) & 0x7fffffff;
+                    if (increment == 0) {
+                        connection_error(error_code::protocol_error);
+                        return false;
+                    }
+                    if (header.stream_id == 0) {
+                        _send_window += increment;
+                        if (_send_window > max_window_size) {
+                            connection_error(error_code::flow_control_error);
+                            return false;
+                        }
+                        return true;
+                    }
+
+                    auto it = _streams.find(header.stream_id);
+                    if (it != _streams.end()) {
+                        it->second->send_window += increment;
+                        if (it->second->send_window > max_window_size) {
+                            reset_stream(it->second, error_code::flow_control_error);
+                        }
+                    }
+                    return true;
+                }
+
+                default:
+                    /* PRIORITY and unknown frame types are ignored */
+                    return true;
+                }
+            }
+
+            /* a complete header block; it is decoded even for streams gone, to keep HPACK in sync */
+            inline bool http2_session::on_headers_end() {
+                using namespace http2;
+
+                _fields.clear();
+                /* counted as in RFC 9113, 6.5.2: a small block may still decode to a large list */
+                std::size_t list_size = 0;
+                bool valid = _decoder.decode(_header_block.data(), _header_block.size(),
+                    [this, &list_size] (boost::string_ref name, boost::string_ref value) {
+                        list_size += name.size() + value.size() + 32;
+                        if (list_size <= max_header_list_size) {
+                            _fields.emplace_back(std::string(name.data(), name.size()),
+                                std::string(value.data(), value.size()));
+                        }
+                    });
+                std::uint32_t id = _header_stream;
+                _header_stream = 0;
+                if (!valid) {
+                    connection_error(error_code::compression_error);
+                    return false;
+                }
+                if (list_size > max_header_list_size) {
+                    connection_error(error_code::enhance_your_calm);
+                    return false;
+                }
+                if (id >= _next_stream_id) {
+                    connection_error(error_code::protocol_error);
+                    return false;
+                }
+
+                auto it = _streams.find(id);
+                if (it == _streams.end() || it->second->received_end) {
+                    return true;
+                }
+                stream_ptr s = it->second;
+
+                if (!s->headers_received) {
+                    if (_fields.empty() || _fields.front().first != ":status") {
+                        reset_stream(s, error_code::protocol_error);
+                        return true;
+                    }
+                    /* 101 has no meaning in HTTP/2 (RFC 9113, 8.6) */
+                    int status = parse_status(_fields.front().second);
+                    if (status == 0 || status == 101) {
+                        reset_stream(s, error_code::protocol_error);
+                        return true;
+                    }
+                    if (status < 200) {
+                        /* interim responses are skipped */
+                        if (_header_end_stream) {
+                            reset_stream(s, error_code::protocol_error);
+                        }
+                        return true;
+                    }
+
+                    s->headers_received = true;
+                    for (const auto &field : _fields) {
+                        s->observer->on_header(field.first, field.second, false);
+                    }
+                    s->observer->on_headers_complete();
+                } else {
+                    /* trailers end the stream */
+                    if (!_header_end_stream) {
+                        reset_stream(s, error_code::protocol_error);
+                        return true;
+                    }
+                    for (const auto &field : _fields) {
+                        s->observer->on_header(field.first, field.second, true);
+                    }
+                }
+
+                if (_header_end_stream) {
+                    s->received_end = true;
+                    if (!s->paused) {
+                        complete(s);
+                    }
+                }
+                return true;
+            }
+
+            inline bool http2_session::on_settings(const char *payload, std::uint32_t length) {
+                using namespace http2;
+
+                if (length % 6 != 0) {
+                    connection_error(error_code::frame_size_error);
+                    return false;
+                }
+
+                for (const char *p = payload; p != payload + length; p += 6) {
+                    auto id = static_cast<setting>((static_cast<std::uint8_t>(p[0]) << 8) |
+                        static_cast<std::uint8_t>(p[1]));
+                    std::uint32_t value = read_uint32(p + 2);
+
+                    switch (id) {
+                    case setting::header_table_size: {
+                        std::size_t size = std::min<std::size_t>(value, max_header_table_size);
+                        if (size != _encoder.table().max_size()) {
+                            _encoder.max_table_size(size);
+                        }
+                        break;
+                    }
+                    case setting::max_concurrent_streams:
+                        _peer_max_concurrent_streams = value;
+                        break;
+                    case setting::initial_window_size:
+                        if (value > max_window_size) {
+                            connection_error(error_code::flow_control_error);
+                            return false;
+                        }
+                        /* applies to the open streams too */
+                        for (auto &e : _streams) {
+                            e.second->send_window += static_cast<std::int64_t>(value) - _peer_initial_window;
+                            if (e.second->send_window > max_window_size) {
+                                connection_error(error_code::flow_control_error);
+                                return false;
+                            }
+                        }
+                        _peer_initial_window = value;
+                        break;
+                    case setting::max_frame_size:
+                        if (value < default_max_frame_size || value > max_max_frame_size) {
+                            connection_error(error_code::protocol_error);
+                            return false;
+                        }
+                        _peer_max_frame_size = value;
+                        break;
+                    default:
+                        break;
+                    }
+                }
+
+                append_frame_header(_outbox, 0, frame_type::settings, frame_flags::ack, 0);
+                start_pending();
+                return true;
+            }
+
+            /* streams past last_stream_id were not processed, the others may still complete */
+            inline void http2_session::on_goaway(std::uint32_t last_stream_id) {
+                _accepting = false;
+                _draining = true;
+
+                std::vector<stream_ptr> refused;
+                for (auto it = _streams.upper_bound(last_stream_id); it != _streams.end(); ++it) {
+                    refused.push_back(it->second);
+                }
+                std::deque<stream_ptr> pending;
+                pending.swap(_pending);
+
+                for (auto &s : refused) {
+                    remove(s);
+                    if (auto observer = std::move(s->observer)) {
+                        observer->on_error(make_error_code(http2::error_code::refused_stream), true);
+                    }
+                }
+                for (auto &s : pending) {
+                    if (auto observer = std::move(s->observer)) {
+                        observer->on_error(boost::asio::error::try_again, true);
+                    }
+                }
+
+                if (_streams.empty()) {
+                    shutdown(boost::asio::error::operation_aborted, http2::error_code::no_error);
+                }
+            }
+
+            inline void http2_session::open_stream(stream_ptr s) {
+                if (_closed || _draining) {
+                    s->observer->on_error(boost::asio::error::try_again, true);
+                    return;
+                }
+                _pending.push_back(std::move(s));
+                start_pending();
+                flush();
+            }
+
+            /* opens waiting streams while the server allows more */
+            inline void http2_session::start_pending() {
+                while (!_pending.empty() && !_draining && _streams.size() < _peer_max_concurrent_streams) {
+                    stream_ptr s = std::move(_pending.front());
+                    _pending.pop_front();
+
+                    s->id = _next_stream_id;
+                    _next_stream_id += 2;
+                    if (_next_stream_id > http2::max_window_size) {
+                        /* stream ids are used up */
+                        _accepting = false;
+                        _draining = true;
+                    }
+
+                    s->send_window = _peer_initial_window;
+                    const auto &body = s->request->body();
+                    s->sending = static_cast<bool>(body);
+                    s->sent_end = !s->sending;
+                    if (body) {
+                        s->remaining = body->size();
+                    }
+                    _streams[s->id] = s;
+                    encode_headers(*s);
+                }
+
+                if (!_streams.empty()) {
+                    boost::system::error_code ignored;
+                    _idle_timer.cancel(ignored);
+                }
+            }
+
+            /*
+             * Queues HEADERS and CONTINUATION frames for s. Header names are
+             * sent in lower case, without the fields specific to HTTP/1
+             * connections (RFC 9113, 8.2.2).
+             */
+            inline void http2_session::encode_headers(const stream &s) {
+                using namespace http2;
+
+                const client_message::request &req = *s.request;
+                std::string block;
+                _encoder.begin(block);
+                _encoder.encode(block, ":method", method_name(req.method()));
+                _encoder.encode(block, ":scheme", req.is_https() ? "https" : "http");
+                if (auto host = req.header("Host")) {
+                    _encoder.encode(block, ":authority", *host);
+                } else if (auto host = req.url().host()) {
+                    _encoder.encode(block, ":authority", std::string(std::begin(*host), std::end(*host)));
+                }
+                std::string path = req.path();
+                path.erase(std::min(path.find('#'), path.size()));
+                _encoder.encode(block, ":path", path.empty() ? "/" : path);
+
+                for (auto hdr : req.headers()) {
+                    boost::string_ref name(hdr.first.data(), hdr.first.size());
+                    boost::string_ref value(hdr.second.data(), hdr.second.size());
+                    if (header_name::equals(name, "host") ||
+                        header_name::equals(name, "connection") ||
+                        header_name::equals(name, "keep-alive") ||
+                        header_name::equals(name, "proxy-connection") ||
+                        header_name::equals(name, "transfer-encoding") ||
+                        header_name::equals(name, "upgrade") ||
+                        (header_name::equals(name, "te") && value != "trailers")) {
+                        continue;
+                    }
+                    _name.assign(name.data(), name.size());
+                    std::transform(_name.begin(), _name.end(), _name.begin(), header_name::lower);
+                    _encoder.encode(block, _name, value);
+                }
+
+                std::uint8_t flags = s.sending ? 0 : frame_flags::end_stream;
+                std::size_t offset = 0;
+                frame_type type = frame_type::headers;
+                do {
+                    std::size_t length = std::min<std::size_t>(block.size() - offset, _peer_max_frame_size);
+                    bool last = offset + length == block.size();
+                    append_frame_header(_outbox, static_cast<std::uint32_t>(length), type,
+                        flags | (last ? frame_flags::end_headers : 0), s.id);
+                    _outbox.append(block, offset, length);
+                    offset += length;
+                    type = frame_type::continuation;
+                    flags = 0;
+                } while (offset != block.size());
+            }
+
+            /* passes data to the observer, or holds it while the observer is paused */
+            inline void http2_session::deliver(stream &s, const char *data, std::size_t size) {
+                if (size == 0) {
+                    return;
+                }
+                if (s.paused) {
+                    s.held.append(data, size);
+                    return;
+                }
+                if (!s.observer->on_data(boost::string_ref(data, size))) {
+                    s.paused = true;
+                }
+            }
+
+            /* gives the server back the window s consumed, once half of it is used up */
+            inline void http2_session::window_update(stream &s) {
+                if (s.unacked >= stream_window / 2) {
+                    http2::append_frame_header(_outbox, 4, http2::frame_type::window_update, 0, s.id);
+                    http2::append_uint32(_outbox, s.unacked);
+                    s.unacked = 0;
+                }
+            }
+
+            /* the response is complete; an upload still going on is stopped */
+            inline void http2_session::complete(stream_ptr s) {
+                if (!s->closed) {
+                    if (!s->sent_end) {
+                        http2::append_frame_header(_outbox, 4, http2::frame_type::rst_stream, 0, s->id);
+                        http2::append_uint32(_outbox, static_cast<std::uint32_t>(http2::error_code::cancel));
+                    }
+                    remove(s);
+                }
+                if (auto observer = std::move(s->observer)) {
+                    observer->on_complete();
+                }
+            }
+
+            inline void http2_session::reset_stream(stream_ptr s, http2::error_code code) {
+                http2::append_frame_header(_outbox, 4, http2::frame_type::rst_stream, 0, s->id);
+                http2::append_uint32(_outbox, static_cast<std::uint32_t>(code));
+                remove(s);
+                if (auto observer = std::move(s->observer)) {
+                    observer->on_error(http2::make_error_code(code), false);
+                }
+            }
+
+            inline void http2_session::remove(stream_ptr s) {
+                s->closed = true;
+                s->sending = false;
+                _streams.erase(s->id);
+                start_pending();
+
+                if (_streams.empty() && _pending.empty()) {
+                    if (_draining) {
+                        shutdown(boost::asio::error::operation_aborted, http2::error_code::no_error);
+                    } else {
+                        arm_idle_timer();
+                    }
+                }
+            }
+
+            inline http2_session::stream_ptr http2_session::find(const http2_stream_observer *observer) const {
+                for (const auto &e : _streams) {
+                    if (e.second->observer.get() == observer) {
+                        return e.second;
+                    }
+                }
+                return nullptr;
+            }
+
+            /*
+             * Writes the queued frames, followed by the next piece of the
+             * body of every stream that has window left, split into DATA
+             * frames. A byte source's piece is valid until it is asked for
+             * the next, so each stream contributes one piece per write.
+             */
+            inline void http2_session::flush() {
+                using namespace http2;
+
+                if (_write_in_progress || _closed) {
+                    return;
+                }
+
+                _writing.clear();
+                _writing.swap(_outbox);
+                _buffers.clear();
+                if (!_writing.empty()) {
+                    _buffers.push_back(boost::asio::buffer(_writing));
+                }
+
+                std::size_t senders = 0;
+                for (const auto &e : _streams) {
+                    senders += e.second->sending ? 1 : 0;
+                }
+                std::size_t frames_per_piece = (max_body_piece + _peer_max_frame_size - 1) / _peer_max_frame_size + 1;
+                _data_headers.resize(senders * frames_per_piece * frame_header_size);
+                _data_streams.clear();
+
+                std::vector<stream_ptr> failed;
+                char *frame_header = _data_headers.data();
+                for (const auto &e : _streams) {
+                    const stream_ptr &s = e.second;
+                    if (!s->sending || s->send_window < 0) {
+                        continue;
+                    }
+                    std::size_t allowance = static_cast<std::size_t>(std::min<std::int64_t>(
+                            std::min(_send_window, s->send_window), max_body_piece));
+                    if (s->remaining) {
+                        allowance = static_cast<std::size_t>(std::min<std::uint64_t>(allowance, *s->remaining));
+                    }
+                    if (allowance == 0 && (!s->remaining || *s->remaining != 0)) {
+                        /* no window left */
+                        continue;
+                    }
+
+                    boost::asio::const_buffer piece;
+                    if (allowance > 0) {
+                        try {
+                            piece = s->request->body()->next(allowance);
+                        } catch (...) {
+                            failed.push_back(s);
+                            continue;
+                        }
+                    }
+                    std::size_t length = boost::asio::buffer_size(piece);
+                    if (s->remaining) {
+                        if (length == 0 && *s->remaining != 0) {
+                            /* the source ended before its announced size */
+                            failed.push_back(s);
+                            continue;
+                        }
+                        *s->remaining -= length;
+                    }
+                    bool end = s->remaining ? *s->remaining == 0 : length == 0;
+
+                    const char *data = static_cast<const char *>(piece.data());
+                    std::size_t offset = 0;
+                    do {
+                        std::size_t n = std::min<std::size_t>(length - offset, _peer_max_frame_size);
+                        bool last = offset + n == length;
+                        write_frame_header(frame_header, static_cast<std::uint32_t>(n), frame_type::data,
+                            last && end ? frame_flags::end_stream : 0, s->id);
+                        _buffers.push_back(boost::asio::buffer(frame_header, frame_header_size));
+                        if (n > 0) {
+                            _buffers.push_back(boost::asio::buffer(data + offset, n));
+                        }
+                        frame_header += frame_header_size;
+                        offset += n;
+                    } while (offset != length);
+
+                    _send_window -= static_cast<std::int64_t>(length);
+                    s->send_window -= static_cast<std::int64_t>(length);
+                    if (end) {
+                        s->sending = false;
+                        s->sent_end = true;
+                    }
+                    _data_streams.emplace_back(s, length);
+                }
+
+                for (auto &s : failed) {
+                    reset_stream(s, error_code::internal_error);
+                }
+                if (_closed) {
+                    return;
+                }
+
+                if (_buffers.empty()) {
+                    if (!_outbox.empty()) {
+                        /* frames queued by the failed streams */
+                        flush();
+                    }
+                    return;
+                }
+
+                _write_in_progress = true;
+                auto self = shared_from_this();
+                _connection->async_write(_buffers,
+                    _strand.wrap([self] (const boost::system::error_code &ec, std::size_t) {
+                            self->on_written(ec);
+                        }));
+            }
+
+            inline void http2_session::on_written(const boost::system::error_code &ec) {
+                _write_in_progress = false;
+                if (_closed) {
+                    return;
+                }
+                if (ec) {
+                    shutdown(ec, http2::error_code::no_error);
+                    return;
+                }
+
+                std::vector<std::pair<stream_ptr, std::size_t> > written;
+                written.swap(_data_streams);
+                for (auto &w : written) {
+                    if (w.first->observer && w.second > 0) {
+                        w.first->observer->on_written(w.second);
+                    }
+                }
+                flush();
+            }
+
+            inline void http2_session::connection_error(http2::error_code code) {
+                shutdown(http2::make_error_code(code), code);
+            }
+
+            /*
+             * Closes the session: a GOAWAY is sent when the connection is
+             * free to write it, streams in flight fail with ec, those not
+             * sent yet with try_again.
+             */
+            inline void http2_session::shutdown(const boost::system::error_code &ec, http2::error_code code) {
+                if (_closed) {
+                    return;
+                }
+                _closed = true;
+                _accepting = false;
+                boost::system::error_code ignored;
+                _idle_timer.cancel(ignored);
+
+                if (!_write_in_progress) {
+                    auto farewell = std::make_shared<std::string>();
+                    http2::append_frame_header(*farewell, 8, http2::frame_type::goaway, 0, 0);
+                    http2::append_uint32(*farewell, 0);
+                    http2::append_uint32(*farewell, static_cast<std::uint32_t>(code));
+
+                    auto connection = _connection;
+                    _buffers.clear();
+                    _buffers.push_back(boost::asio::buffer(*farewell));
+                    _connection->async_write(_buffers,
+                        [connection, farewell] (const boost::system::error_code &, std::size_t) {
+                            connection->disconnect();
+                        });
+                } else {
+                    _connection->disconnect();
+                }
+
+                std::map<std::uint32_t, stream_ptr> streams;
+                streams.swap(_streams);
+                std::deque<stream_ptr> pending;
+                pending.swap(_pending);
+                for (auto &e : streams) {
+                    e.second->closed = true;
+                    if (auto observer = std::move(e.second->observer)) {
+                        observer->on_error(ec, false);
+                    }
+                }
+                for (auto &s : pending) {
+                    if (auto observer = std::move(s->observer)) {
+                        observer->on_error(boost::asio::error::try_again, true);
+                    }
+                }
+                _data_streams.clear();
+
+                if (auto on_close = std::move(_on_close)) {
+                    on_close();
+                }
+            }
+
+            inline void http2_session::arm_idle_timer() {
+                if (_idle_timeout.count() <= 0 || _closed) {
+                    return;
+                }
+
+                std::weak_ptr<http2_session> weak = shared_from_this();
+                _idle_timer.expires_from_now(_idle_timeout);
+                _idle_timer.async_wait(_strand.wrap([weak] (const boost::system::error_code &ec) {
+                            auto self = weak.lock();
+                            if (ec || !self || !self->_streams.empty() || !self->_pending.empty()) {
+                                return;
+                            }
+                            self->shutdown(boost::asio::error::timed_out, http2::error_code::no_error);
+                        }));
+            }
+        } // namespace client_connection
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_CONNECTION_HTTP2_SESSION_INC
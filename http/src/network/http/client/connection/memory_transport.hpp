@@ -0,0 +1,444 @@
+#ifndef NETWORK_HTTP_CLIENT_CONNECTION_MEMORY_TRANSPORT_INC
+#define NETWORK_HTTP_CLIENT_CONNECTION_MEMORY_TRANSPORT_INC
+
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <network/config.hpp>
+#include <network/http/client/connection/transport.hpp>
+#include <network/http/client/connection/capture_file.hpp>
+
+namespace network {
+    namespace http {
+        namespace client_connection {
+            class memory_transport;
+
+            /*
+             * class memory_resolver
+             *
+             * Resolves every host to 127.0.0.1 without asking anyone.
+             */
+            class memory_resolver : public async_resolver {
+            public:
+                explicit memory_resolver(boost::asio::io_service &io_service) :
+                    async_resolver(io_service) { }
+
+                virtual ~memory_resolver() noexcept { }
+
+            protected:
+                virtual void async_query(const std::string &, std::uint16_t port,
+                    resolve_callback callback) {
+                    endpoints resolved(1, endpoint(boost::asio::ip::address_v4::loopback(), port));
+                    _io_service.post([callback, resolved] () { callback(boost::system::error_code(), resolved); });
+                }
+            };
+
+            /*
+             * class memory_connection
+             *
+             * A connection of a memory_transport: it frames the requests
+             * written to it, by Content-Length or the chunked coding, and
+             * answers each with the response the transport picks for it,
+             * copied out of the capture as it is read. Responses that end
+             * with "Connection: close" close the connection once read.
+             * Like a socket, it is used from one thread at a time.
+             */
+            class memory_connection : public async_connection {
+            public:
+                memory_connection(boost::asio::io_service &io_service, std::shared_ptr<memory_transport> transport) :
+                    async_connection(io_service),
+                    _io_service(io_service),
+                    _timer(io_service),
+                    _transport(std::move(transport)),
+                    _state(request_state::head),
+                    _remaining(0),
+                    _connected(false),
+                    _closed(false),
+                    _peer_closed(false),
+                    _waiting(false),
+                    _read_data(nullptr),
+                    _read_size(0) { }
+
+                virtual ~memory_connection() noexcept { }
+
+                virtual void async_connect(const boost::asio::ip::tcp::endpoint &,
+                    const std::string &, connect_callback callback) {
+                    _connected = true;
+                    _io_service.post([callback] () { callback(boost::system::error_code()); });
+                }
+
+                virtual void async_write(const const_buffers &buffers,
+                    write_callback callback);
+
+                virtual void async_read_some(const boost::asio::mutable_buffer &buffer,
+                    read_callback callback) {
+                    if (_closed || !_connected) {
+                        _io_service.post([callback] () { callback(boost::asio::error::not_connected, 0); });
+                        return;
+                    }
+                    _read_data = boost::asio::buffer_cast<char *>(buffer);
+                    _read_size = boost::asio::buffer_size(buffer);
+                    _read = std::move(callback);
+                    deliver();
+                }
+
+                virtual bool is_reusable() {
+                    return _connected && !_closed && !_peer_closed && _responses.empty();
+                }
+
+                virtual void disconnect() {
+                    _closed = true;
+                    _responses.clear();
+                    cancel();
+                }
+
+                virtual void cancel() {
+                    boost::system::error_code ignored;
+                    _timer.cancel(ignored);
+                    _waiting = false;
+                    complete_read(boost::asio::error::operation_aborted, 0);
+                }
+
+            private:
+                enum class request_state { head, body, chunk_size, chunk_data, chunk_end, trailer };
+
+                struct pending_response {
+                    const char *data;
+                    std::size_t size;
+                    std::chrono::steady_clock::time_point ready;
+                    bool closes;
+                };
+
+                void feed(const char *data, std::size_t size);
+
+                /* the request framed so far is complete */
+                void answer();
+
+                /* hands the next bytes of a response to the waiting read, if any */
+                void deliver();
+
+                void complete_read(const boost::system::error_code &ec, std::size_t bytes) {
+                    if (!_read) {
+                        return;
+                    }
+                    read_callback read;
+                    std::swap(read, _read);
+                    _io_service.post([read, ec, bytes] () { read(ec, bytes); });
+                }
+
+                boost::asio::io_service &_io_service;
+                boost::asio::steady_timer _timer;
+                std::shared_ptr<memory_transport> _transport;
+                request_state _state;
+                /* the head of the request being framed, or the line of a chunk size or trailer */
+                std::string _line;
+                std::string _request_line;
+                std::uint64_t _remaining;
+                std::deque<pending_response> _responses;
+                bool _connected;
+                bool _closed;
+                bool _peer_closed;
+                bool _waiting;
+                char *_read_data;
+                std::size_t _read_size;
+                read_callback _read;
+            };
+
+            /*
+             * class memory_transport
+             *
+             * Connections that answer from a capture instead of a server,
+             * so that the client can be measured, or traffic played back,
+             * without the kernel's networking. A request gets the response
+             * of the next exchange of the capture with the same request
+             * line, going round; a request the capture does not have gets
+             * that of the next exchange of all. Given a speed, a response
+             * is only readable after the latency it was captured with,
+             * divided by the speed; otherwise right away.
+             */
+            class memory_transport : public transport, public std::enable_shared_from_this<memory_transport> {
+            public:
+                struct reply {
+                    boost::string_ref response;
+                    std::chrono::steady_clock::duration latency;
+                    bool closes;
+                };
+
+                explicit memory_transport(std::shared_ptr<const capture_file> capture, double speed = 0) :
+                    _capture(std::move(capture)),
+                    _speed(speed),
+                    _next(0),
+                    _connections(0),
+                    _requests(0) {
+                    _closes.reserve(_capture->size());
+                    for (std::size_t i = 0; i < _capture->size(); ++i) {
+                        const capture_exchange &e = (*_capture)[i];
+                        auto &line = _by_line[request_line(e.request).to_string()];
+                        if (!line) {
+                            line.reset(new line_exchanges);
+                        }
+                        line->exchanges.push_back(i);
+                        _closes.push_back(closes(e.response));
+                    }
+                }
+
+                virtual ~memory_transport() noexcept { }
+
+                virtual std::unique_ptr<async_resolver> resolver(boost::asio::io_service &io_service) {
+                    return std::unique_ptr<async_resolver>(new memory_resolver(io_service));
+                }
+
+                virtual std::shared_ptr<async_connection> connection(boost::asio::io_service &io_service,
+                    const std::string &) {
+                    ++_connections;
+                    return std::make_shared<memory_connection>(io_service, shared_from_this());
+                }
+
+                /* the response to a request starting with request_line, e.g. "GET / HTTP/1.1" */
+                reply answer(boost::string_ref request_line) {
+                    ++_requests;
+                    std::size_t i = 0;
+                    auto it = _by_line.find(request_line.to_string());
+                    if (it != _by_line.end()) {
+                        const auto &exchanges = it->second->exchanges;
+                        i = exchanges[it->second->next.fetch_add(1, std::memory_order_relaxed) % exchanges.size()];
+                    } else if (!_capture->empty()) {
+                        i = _next.fetch_add(1, std::memory_order_relaxed) % _capture->size();
+                    } else {
+                        return reply{ boost::string_ref(), std::chrono::steady_clock::duration::zero(), true };
+                    }
+
+                    const capture_exchange &e = (*_capture)[i];
+                    std::chrono::steady_clock::duration latency = std::chrono::steady_clock::duration::zero();
+                    if (_speed > 0) {
+                        latency = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                            std::chrono::nanoseconds(static_cast<std::int64_t>(e.latency / _speed)));
+                    }
+                    return reply{ e.response, latency, _closes[i] };
+                }
+
+                const capture_file &capture() const {
+                    return *_capture;
+                }
+
+                /* connections made and requests answered so far */
+                std::uint64_t connections() const {
+                    return _connections;
+                }
+
+                std::uint64_t requests() const {
+                    return _requests;
+                }
+
+                static boost::string_ref request_line(boost::string_ref request) {
+                    auto end = request.find("\r\n");
+                    return end == boost::string_ref::npos ? request : request.substr(0, end);
+                }
+
+            private:
+                struct line_exchanges {
+                    line_exchanges() : next(0) { }
+
+                    std::vector<std::size_t> exchanges;
+                    std::atomic<std::size_t> next;
+                };
+
+                /* whether the connection is closed after response, by its head */
+                static bool closes(boost::string_ref response) {
+                    std::string head = response.substr(0, response.find("\r\n\r\n")).to_string();
+                    bool http10 = boost::starts_with(head, "HTTP/1.0");
+                    bool keep_alive = false;
+                    for (auto line = head.find("\r\n"); line != std::string::npos; ) {
+                        auto next = head.find("\r\n", line + 2);
+                        std::string header = head.substr(line + 2, next == std::string::npos ? next : next - line - 2);
+                        if (boost::istarts_with(header, "Connection:")) {
+                            if (boost::icontains(header, "close")) {
+                                return true;
+                            }
+                            keep_alive = boost::icontains(header, "keep-alive");
+                        }
+                        line = next;
+                    }
+                    return http10 && !keep_alive;
+                }
+
+                std::shared_ptr<const capture_file> _capture;
+                double _speed;
+                std::unordered_map<std::string, std::unique_ptr<line_exchanges> > _by_line;
+                std::vector<bool> _closes;
+                std::atomic<std::size_t> _next;
+                std::atomic<std::uint64_t> _connections;
+                std::atomic<std::uint64_t> _requests;
+            };
+
+            inline void memory_connection::async_write(const const_buffers &buffers,
+                write_callback callback) {
+                if (_closed || _peer_closed || !_connected) {
+                    _io_service.post([callback] () { callback(boost::asio::error::not_connected, 0); });
+                    return;
+                }
+                std::size_t written = 0;
+                for (const auto &b : buffers) {
+                    std::size_t size = boost::asio::buffer_size(b);
+                    feed(boost::asio::buffer_cast<const char *>(b), size);
+                    written += size;
+                }
+                _io_service.post([callback, written] () { callback(boost::system::error_code(), written); });
+            }
+
+            inline void memory_connection::feed(const char *data, std::size_t size) {
+                while (size > 0) {
+                    switch (_state) {
+                    case request_state::head:
+                    case request_state::chunk_size:
+                    case request_state::trailer: {
+                        /* up to the end of the head, of the line, or of the trailer */
+                        const char *end = _state == request_state::head || _state == request_state::trailer ?
+                            "\r\n\r\n" : "\r\n";
+                        std::size_t kept = _line.size();
+                        _line.append(data, size);
+                        auto found = _line.find(end, kept >= 3 ? kept - 3 : 0);
+                        if (found == std::string::npos) {
+                            return;
+                        }
+                        std::size_t used = found + std::strlen(end) - kept;
+                        data += used;
+                        size -= used;
+                        _line.resize(found + std::strlen(end));
+
+                        if (_state == request_state::trailer) {
+                            _line.clear();
+                            answer();
+                        } else if (_state == request_state::chunk_size) {
+                            _remaining = std::strtoull(_line.c_str(), nullptr, 16);
+                            _line.clear();
+                            if (_remaining == 0) {
+                                /* the last chunk: the trailer, maybe empty, ends with the line */
+                                _line = "\r\n";
+                                _state = request_state::trailer;
+                            } else {
+                                _state = request_state::chunk_data;
+                            }
+                        } else {
+                            _request_line = memory_transport::request_line(_line).to_string();
+                            _remaining = 0;
+                            bool chunked = false;
+                            for (std::size_t line = _line.find("\r\n"); line < found; ) {
+                                std::size_t next = _line.find("\r\n", line + 2);
+                                boost::string_ref header(_line.data() + line + 2, next - line - 2);
+                                if (boost::istarts_with(header, "Content-Length:")) {
+                                    _remaining = std::strtoull(header.data() + 15, nullptr, 10);
+                                } else if (boost::istarts_with(header, "Transfer-Encoding:")) {
+                                    chunked = boost::icontains(header, "chunked");
+                                }
+                                line = next;
+                            }
+                            _line.clear();
+                            if (chunked) {
+                                _state = request_state::chunk_size;
+                            } else if (_remaining > 0) {
+                                _state = request_state::body;
+                            } else {
+                                answer();
+                            }
+                        }
+                        break;
+                    }
+                    case request_state::body:
+                    case request_state::chunk_data: {
+                        std::size_t used = static_cast<std::size_t>(std::min<std::uint64_t>(_remaining, size));
+                        data += used;
+                        size -= used;
+                        _remaining -= used;
+                        if (_remaining == 0) {
+                            if (_state == request_state::body) {
+                                answer();
+                            } else {
+                                _remaining = 2;
+                                _state = request_state::chunk_end;
+                            }
+                        }
+                        break;
+                    }
+                    case request_state::chunk_end: {
+                        /* the CRLF after the data of a chunk */
+                        std::size_t used = static_cast<std::size_t>(std::min<std::uint64_t>(_remaining, size));
+                        data += used;
+                        size -= used;
+                        _remaining -= used;
+                        if (_remaining == 0) {
+                            _state = request_state::chunk_size;
+                        }
+                        break;
+                    }
+                    }
+                }
+            }
+
+            inline void memory_connection::answer() {
+                _state = request_state::head;
+                memory_transport::reply r = _transport->answer(_request_line);
+                _responses.push_back(pending_response{ r.response.data(), r.response.size(),
+                        std::chrono::steady_clock::now() + r.latency, r.closes });
+                deliver();
+            }
+
+            inline void memory_connection::deliver() {
+                if (!_read || _waiting) {
+                    return;
+                }
+                if (_responses.empty()) {
+                    if (_peer_closed) {
+                        complete_read(boost::asio::error::eof, 0);
+                    }
+                    return;
+                }
+
+                pending_response &front = _responses.front();
+                if (front.ready > std::chrono::steady_clock::now()) {
+                    _waiting = true;
+                    _timer.expires_at(front.ready);
+                    _timer.async_wait([this] (const boost::system::error_code &ec) {
+                            if (ec) {
+                                return;
+                            }
+                            _waiting = false;
+                            deliver();
+                        });
+                    return;
+                }
+
+                std::size_t bytes = std::min(front.size, _read_size);
+                std::memcpy(_read_data, front.data, bytes);
+                front.data += bytes;
+                front.size -= bytes;
+                if (front.size == 0) {
+                    _peer_closed = front.closes;
+                    _responses.pop_front();
+                    if (_peer_closed) {
+                        /* nothing written after the close is answered */
+                        _responses.clear();
+                    }
+                }
+                complete_read(boost::system::error_code(), bytes);
+            }
+        } // namespace client_connection
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_CONNECTION_MEMORY_TRANSPORT_INC
@@ -0,0 +1,164 @@
+#ifndef NETWORK_HTTP_CLIENT_CONNECTION_NORMAL_CONNECTION_INC
+#define NETWORK_HTTP_CLIENT_CONNECTION_NORMAL_CONNECTION_INC
+
+#include <cerrno>
+#include <utility>
+#include <algorithm>
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif // defined(__linux__)
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/asio/error.hpp>
+#include <network/config.hpp>
+#include <network/http/client/connection/async_connection.hpp>
+
+namespace network {
+    namespace http {
+        namespace client_connection {
+            /*
+             * class normal_connection
+             *
+             * Plain TCP transport for http:// requests.
+             */
+            class normal_connection : public async_connection {
+                normal_connection(const normal_connection &) = delete;
+                normal_connection &operator = (const normal_connection &) = delete;
+
+            public:
+                explicit normal_connection(boost::asio::io_service &io_service) :
+                    async_connection(io_service),
+                    _io_service(io_service),
+                    _socket(io_service) { }
+
+                virtual ~normal_connection() noexcept { }
+
+                virtual void async_connect(const boost::asio::ip::tcp::endpoint &endpoint,
+                    const std::string &, connect_callback callback) {
+                    _socket.async_connect(endpoint, [this, callback] (const boost::system::error_code &ec) {
+                            if (!ec) {
+                                /*
+                                 * async_write() hands writev() 16 buffers at a time: without
+                                 * this, the rest of a request waits for the server's delayed ACK
+                                 */
+                                boost::system::error_code ignored;
+                                _socket.set_option(boost::asio::ip::tcp::no_delay(true), ignored);
+                            }
+                            callback(ec);
+                        });
+                }
+
+                virtual void async_write(const const_buffers &buffers,
+                    write_callback callback) {
+                    boost::asio::async_write(_socket, buffers, std::move(callback));
+                }
+
+                virtual void async_read_some(const boost::asio::mutable_buffer &buffer,
+                    read_callback callback) {
+                    _socket.async_read_some(buffer, std::move(callback));
+                }
+
+#if defined(__linux__)
+                virtual bool can_send_file() const {
+                    return true;
+                }
+
+                virtual void async_send_file(int fd, std::uint64_t offset, std::uint64_t length,
+                    write_callback callback) {
+                    boost::system::error_code ec;
+                    _socket.native_non_blocking(true, ec);
+                    if (ec) {
+                        _io_service.post([callback, ec] () { callback(ec, 0); });
+                        return;
+                    }
+                    send_file(fd, offset, length, 0, std::move(callback));
+                }
+#endif // defined(__linux__)
+
+                virtual bool is_reusable() {
+                    if (!_socket.is_open()) {
+                        return false;
+                    }
+
+                    /*
+                     * Peek without blocking: an idle keep-alive socket has
+                     * nothing to read, so anything other than would_block
+                     * means EOF, an error or a stray response.
+                     */
+                    boost::system::error_code ec;
+                    bool was_non_blocking = _socket.non_blocking();
+                    _socket.non_blocking(true, ec);
+                    if (ec) {
+                        return false;
+                    }
+
+                    char byte;
+                    _socket.receive(boost::asio::buffer(&byte, 1),
+                        boost::asio::socket_base::message_peek, ec);
+
+                    boost::system::error_code ignored;
+                    _socket.non_blocking(was_non_blocking, ignored);
+                    return ec == boost::asio::error::would_block;
+                }
+
+                virtual void disconnect() {
+                    if (_socket.is_open()) {
+                        boost::system::error_code ec;
+                        _socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+                        /* also while connecting, when shutdown fails with not_connected */
+                        _socket.close(ec);
+                    }
+                }
+
+                virtual void cancel() {
+                    boost::system::error_code ec;
+                    _socket.cancel(ec);
+                }
+
+            private:
+#if defined(__linux__)
+                /* sends until the socket buffer is full, then waits for it to drain */
+                void send_file(int fd, std::uint64_t offset, std::uint64_t length,
+                    std::uint64_t sent, write_callback callback) {
+                    boost::system::error_code ec;
+                    while (sent < length) {
+                        off_t position = static_cast<off_t>(offset + sent);
+                        ssize_t n = ::sendfile(_socket.native_handle(), fd, &position,
+                            static_cast<std::size_t>(std::min<std::uint64_t>(length - sent, 1u << 30)));
+                        if (n > 0) {
+                            sent += static_cast<std::uint64_t>(n);
+                        } else if (n == 0) {
+                            /* the file is shorter than announced */
+                            ec = boost::asio::error::eof;
+                            break;
+                        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                            _socket.async_wait(boost::asio::ip::tcp::socket::wait_write,
+                                [this, fd, offset, length, sent, callback] (const boost::system::error_code &ec) mutable {
+                                    if (ec) {
+                                        callback(ec, static_cast<std::size_t>(sent));
+                                        return;
+                                    }
+                                    send_file(fd, offset, length, sent, std::move(callback));
+                                });
+                            return;
+                        } else if (errno != EINTR) {
+                            ec = boost::system::error_code(errno, boost::system::system_category());
+                            break;
+                        }
+                    }
+
+                    _io_service.post([callback, ec, sent] () {
+                            callback(ec, static_cast<std::size_t>(sent));
+                        });
+                }
+#endif // defined(__linux__)
+
+                boost::asio::io_service &_io_service;
+                boost::asio::ip::tcp::socket _socket;
+            };
+        } // namespace client_connection
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_CONNECTION_NORMAL_CONNECTION_INC
@@ -0,0 +1,78 @@
+#ifndef NETWORK_HTTP_CLIENT_CONNECTION_RECEIVE_BUFFER_INC
+#define NETWORK_HTTP_CLIENT_CONNECTION_RECEIVE_BUFFER_INC
+
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <boost/asio/buffer.hpp>
+#include <network/config.hpp>
+
+namespace network {
+    namespace http {
+        namespace client_connection {
+            /*
+             * class receive_buffer
+             *
+             * Bytes read from a connection and not parsed yet. The storage
+             * belongs to the connection and is reused for every response
+             * read on it; consumed bytes are dropped by moving the tail to
+             * the front only when room is needed.
+             */
+            class receive_buffer {
+            public:
+                explicit receive_buffer(std::size_t initial_capacity = 8192) :
+                    _initial_capacity(initial_capacity),
+                    _begin(0),
+                    _end(0) { }
+
+                const char *data() const {
+                    return _storage.data() + _begin;
+                }
+
+                std::size_t size() const {
+                    return _end - _begin;
+                }
+
+                bool empty() const {
+                    return _begin == _end;
+                }
+
+                void consume(std::size_t len) {
+                    _begin += std::min(len, size());
+                    if (_begin == _end) {
+                        _begin = _end = 0;
+                    }
+                }
+
+                /* returns writable space of at least min_space bytes after the unparsed data */
+                boost::asio::mutable_buffer prepare(std::size_t min_space = 4096) {
+                    if (_storage.size() - _end < min_space && _begin > 0) {
+                        std::memmove(&_storage[0], &_storage[_begin], size());
+                        _end -= _begin;
+                        _begin = 0;
+                    }
+                    if (_storage.size() - _end < min_space) {
+                        _storage.resize(std::max(std::max(_storage.size() * 2, _initial_capacity), _end + min_space));
+                    }
+                    return boost::asio::buffer(&_storage[_end], _storage.size() - _end);
+                }
+
+                void commit(std::size_t len) {
+                    _end = std::min(_end + len, _storage.size());
+                }
+
+                void clear() {
+                    _begin = _end = 0;
+                }
+
+            private:
+                std::vector<char> _storage;
+                std::size_t _initial_capacity;
+                std::size_t _begin;
+                std::size_t _end;
+            };
+        } // namespace client_connection
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_CONNECTION_RECEIVE_BUFFER_INC
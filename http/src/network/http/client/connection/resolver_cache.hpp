@@ -0,0 +1,227 @@
+#ifndef NETWORK_HTTP_CLIENT_CONNECTION_RESOLVER_CACHE_INC
+#define NETWORK_HTTP_CLIENT_CONNECTION_RESOLVER_CACHE_INC
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/system/error_code.hpp>
+#include <network/config.hpp>
+
+namespace network {
+    namespace http {
+        namespace client_connection {
+            struct resolver_cache_statistics {
+                std::uint64_t hits;
+                std::uint64_t negative_hits;
+                std::uint64_t misses;
+                std::uint64_t coalesced;
+                std::uint64_t evicted;
+            };
+
+            /*
+             * class resolver_cache
+             *
+             * Host name to address cache shared by any number of resolvers,
+             * possibly running on different threads. Successful lookups are
+             * kept for `ttl`, failed ones for `negative_ttl`; the system
+             * resolver does not report record TTLs, so these are fixed. At
+             * most `max_entries` names are kept, the ones closest to expiry
+             * are dropped first. Names added with add_host() act as a hosts
+             * table: they take precedence, never expire and do not count
+             * towards max_entries.
+             *
+             * Lookups of a name that is already being resolved do not start a
+             * query of their own, they wait for the pending one.
+             */
+            class resolver_cache {
+                resolver_cache(const resolver_cache &) = delete;
+                resolver_cache &operator = (const resolver_cache &) = delete;
+
+            public:
+                typedef boost::asio::ip::address address;
+                typedef boost::asio::ip::tcp::endpoint endpoint;
+                typedef std::vector<endpoint> endpoints;
+                typedef std::function<void (const boost::system::error_code &, const endpoints &)> resolve_callback;
+                typedef std::chrono::steady_clock clock;
+
+                explicit resolver_cache(std::size_t max_entries = 1024,
+                    std::chrono::milliseconds ttl = std::chrono::seconds(60),
+                    std::chrono::milliseconds negative_ttl = std::chrono::seconds(5)) :
+                    _max_entries(max_entries == 0 ? 1 : max_entries),
+                    _ttl(ttl),
+                    _negative_ttl(negative_ttl),
+                    _statistics() { }
+
+                /* answers lookups of host with addresses, until remove_host() */
+                void add_host(const std::string &host, std::vector<address> addresses) {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _hosts[normalize(host)] = std::move(addresses);
+                }
+
+                void remove_host(const std::string &host) {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _hosts.erase(normalize(host));
+                }
+
+                /*
+                 * Looks host up. On a hit, callback is called before this
+                 * returns; otherwise it is queued until complete() is called
+                 * for host. Returns true if the caller has to start the query
+                 * and report it with complete(), false if one is pending.
+                 */
+                bool lookup(const std::string &host, std::uint16_t port, resolve_callback callback) {
+                    std::string name = normalize(host);
+                    std::unique_lock<std::mutex> lock(_mutex);
+
+                    auto pinned = _hosts.find(name);
+                    if (pinned != _hosts.end()) {
+                        ++_statistics.hits;
+                        endpoints resolved = to_endpoints(pinned->second, port);
+                        lock.unlock();
+                        callback(boost::system::error_code(), resolved);
+                        return false;
+                    }
+
+                    auto it = _entries.find(name);
+                    if (it != _entries.end() && clock::now() < it->second.expires) {
+                        const entry &e = it->second;
+                        ++(e.error ? _statistics.negative_hits : _statistics.hits);
+                        boost::system::error_code ec = e.error;
+                        endpoints resolved = to_endpoints(e.addresses, port);
+                        lock.unlock();
+                        callback(ec, resolved);
+                        return false;
+                    }
+
+                    auto &waiters = _pending[name];
+                    bool first = waiters.empty();
+                    ++(first ? _statistics.misses : _statistics.coalesced);
+                    waiters.push_back(waiter{ port, std::move(callback) });
+                    return first;
+                }
+
+                /* stores the outcome of the query for host and runs the waiting callbacks */
+                void complete(const std::string &host, const boost::system::error_code &ec,
+                    const std::vector<address> &addresses) {
+                    std::string name = normalize(host);
+                    std::vector<waiter> waiters;
+                    boost::system::error_code error = ec;
+                    if (!error && addresses.empty()) {
+                        error = boost::asio::error::host_not_found;
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        auto pending = _pending.find(name);
+                        if (pending != _pending.end()) {
+                            waiters = std::move(pending->second);
+                            _pending.erase(pending);
+                        }
+
+                        /* a cancelled query says nothing about the name */
+                        if (error != boost::asio::error::operation_aborted) {
+                            entry &e = _entries[name];
+                            e.addresses = addresses;
+                            e.error = error;
+                            e.expires = clock::now() + (error ? _negative_ttl : _ttl);
+                            evict();
+                        }
+                    }
+
+                    for (auto &w : waiters) {
+                        w.callback(error, to_endpoints(addresses, w.port));
+                    }
+                }
+
+                /* drops every cached lookup, the hosts table stays */
+                void clear() {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _entries.clear();
+                }
+
+                /* number of cached lookups, not counting the hosts table */
+                std::size_t size() const {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    return _entries.size();
+                }
+
+                resolver_cache_statistics statistics() const {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    return _statistics;
+                }
+
+            private:
+                struct entry {
+                    std::vector<address>      addresses;
+                    boost::system::error_code error;
+                    clock::time_point         expires;
+                };
+
+                struct waiter {
+                    std::uint16_t    port;
+                    resolve_callback callback;
+                };
+
+                static std::string normalize(const std::string &host) {
+                    std::string name(host);
+                    std::transform(name.begin(), name.end(), name.begin(), [] (char c) {
+                            return (c >= 'A' && c <= 'Z') ? static_cast<char>(c | 0x20) : c;
+                        });
+                    return name;
+                }
+
+                static endpoints to_endpoints(const std::vector<address> &addresses, std::uint16_t port) {
+                    endpoints resolved;
+                    resolved.reserve(addresses.size());
+                    for (const auto &a : addresses) {
+                        resolved.push_back(endpoint(a, port));
+                    }
+                    return resolved;
+                }
+
+                /* called with _mutex held */
+                void evict() {
+                    auto now = clock::now();
+                    for (auto it = _entries.begin(); _entries.size() > _max_entries && it != _entries.end(); ) {
+                        if (it->second.expires <= now) {
+                            it = _entries.erase(it);
+                            ++_statistics.evicted;
+                        } else {
+                            ++it;
+                        }
+                    }
+
+                    while (_entries.size() > _max_entries) {
+                        auto victim = _entries.begin();
+                        for (auto it = _entries.begin(); it != _entries.end(); ++it) {
+                            if (it->second.expires < victim->second.expires) {
+                                victim = it;
+                            }
+                        }
+                        _entries.erase(victim);
+                        ++_statistics.evicted;
+                    }
+                }
+
+                std::size_t _max_entries;
+                std::chrono::milliseconds _ttl;
+                std::chrono::milliseconds _negative_ttl;
+                resolver_cache_statistics _statistics;
+                std::unordered_map<std::string, entry> _entries;
+                std::unordered_map<std::string, std::vector<address> > _hosts;
+                std::unordered_map<std::string, std::vector<waiter> > _pending;
+                mutable std::mutex _mutex;
+            };
+        } // namespace client_connection
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_CONNECTION_RESOLVER_CACHE_INC
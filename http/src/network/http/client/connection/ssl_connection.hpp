@@ -0,0 +1,179 @@
+#ifndef NETWORK_HTTP_CLIENT_CONNECTION_SSL_CONNECTION_INC
+#define NETWORK_HTTP_CLIENT_CONNECTION_SSL_CONNECTION_INC
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/asio/ssl.hpp>
+#include <network/config.hpp>
+#include <network/http/client/connection/async_connection.hpp>
+#include <network/http/client/connection/tls_context.hpp>
+
+namespace network {
+    namespace http {
+        namespace client_connection {
+            /*
+             * class ssl_connection
+             *
+             * TLS transport for https:// requests, on the SSL context and
+             * session cache of `context`. application_protocols are offered
+             * with ALPN, see negotiated_protocol().
+             */
+            class ssl_connection : public async_connection {
+                ssl_connection(const ssl_connection &) = delete;
+                ssl_connection &operator = (const ssl_connection &) = delete;
+
+            public:
+                typedef boost::asio::ssl::stream<boost::asio::ip::tcp::socket> socket_type;
+
+                ssl_connection(boost::asio::io_service &io_service,
+                    std::shared_ptr<tls_context> context,
+                    std::vector<std::string> application_protocols = std::vector<std::string>()) :
+                    async_connection(io_service),
+                    _io_service(io_service),
+                    _context(std::move(context)),
+                    _application_protocols(std::move(application_protocols)),
+                    _handshake_time(std::chrono::steady_clock::duration::zero()) { }
+
+                virtual ~ssl_connection() noexcept {
+                    keep_session();
+                }
+
+                virtual void async_connect(const boost::asio::ip::tcp::endpoint &endpoint,
+                    const std::string &host, connect_callback callback) {
+                    boost::system::error_code ec;
+                    auto &context = _context->context(ec);
+                    if (ec) {
+                        _io_service.post([callback, ec] () { callback(ec); });
+                        return;
+                    }
+
+                    _socket.reset(new socket_type(_io_service, context));
+                    if (_context->verify_peer()) {
+                        _socket->set_verify_callback(boost::asio::ssl::rfc2818_verification(host));
+                    }
+                    SSL_set_tlsext_host_name(_socket->native_handle(), host.c_str());
+                    if (!_application_protocols.empty()) {
+                        /* ALPN wants the names length-prefixed, in order of preference */
+                        std::string protocols;
+                        for (const auto &protocol : _application_protocols) {
+                            protocols.push_back(static_cast<char>(protocol.size()));
+                            protocols.append(protocol);
+                        }
+                        SSL_set_alpn_protos(_socket->native_handle(),
+                            reinterpret_cast<const unsigned char *>(protocols.data()),
+                            static_cast<unsigned int>(protocols.size()));
+                    }
+                    _session_key = host + ':' + std::to_string(endpoint.port());
+                    _context->prepare(_socket->native_handle(), _session_key);
+
+                    _socket->lowest_layer().async_connect(endpoint,
+                        [this, callback] (const boost::system::error_code &ec) {
+                            if (ec) {
+                                callback(ec);
+                                return;
+                            }
+                            /* a request is written as several records, see normal_connection */
+                            boost::system::error_code ignored;
+                            _socket->lowest_layer().set_option(boost::asio::ip::tcp::no_delay(true), ignored);
+                            auto started = std::chrono::steady_clock::now();
+                            _socket->async_handshake(boost::asio::ssl::stream_base::client,
+                                [this, callback, started] (const boost::system::error_code &ec) {
+                                    _handshake_time = std::chrono::steady_clock::now() - started;
+                                    _context->handshake_done(_socket->native_handle(), ec);
+                                    callback(ec);
+                                });
+                        });
+                }
+
+                virtual void async_write(const const_buffers &buffers,
+                    write_callback callback) {
+                    boost::asio::async_write(*_socket, buffers, std::move(callback));
+                }
+
+                virtual void async_read_some(const boost::asio::mutable_buffer &buffer,
+                    read_callback callback) {
+                    _socket->async_read_some(buffer, std::move(callback));
+                }
+
+                virtual std::chrono::steady_clock::duration handshake_time() const {
+                    return _handshake_time;
+                }
+
+                virtual std::string negotiated_protocol() const {
+                    const unsigned char *protocol = nullptr;
+                    unsigned int length = 0;
+                    if (_socket) {
+                        SSL_get0_alpn_selected(_socket->native_handle(), &protocol, &length);
+                    }
+                    return protocol ? std::string(reinterpret_cast<const char *>(protocol), length) : std::string();
+                }
+
+                virtual bool is_reusable() {
+                    if (!_socket || !_socket->lowest_layer().is_open()) {
+                        return false;
+                    }
+
+                    /* same peek as normal_connection, on the raw socket */
+                    auto &socket = _socket->next_layer();
+                    boost::system::error_code ec;
+                    bool was_non_blocking = socket.non_blocking();
+                    socket.non_blocking(true, ec);
+                    if (ec) {
+                        return false;
+                    }
+
+                    char byte;
+                    socket.receive(boost::asio::buffer(&byte, 1),
+                        boost::asio::socket_base::message_peek, ec);
+
+                    boost::system::error_code ignored;
+                    socket.non_blocking(was_non_blocking, ignored);
+                    return ec == boost::asio::error::would_block;
+                }
+
+                virtual void disconnect() {
+                    keep_session();
+                    if (_socket && _socket->lowest_layer().is_open()) {
+                        boost::system::error_code ec;
+                        _socket->lowest_layer().shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+                        _socket->lowest_layer().close(ec);
+                    }
+                }
+
+                virtual void cancel() {
+                    if (_socket) {
+                        boost::system::error_code ec;
+                        _socket->lowest_layer().cancel(ec);
+                    }
+                }
+
+            private:
+                /*
+                 * OpenSSL makes the session of a connection closed without
+                 * close_notify unresumable; like other HTTP clients, the
+                 * connection is closed as if it had been sent.
+                 */
+                void keep_session() {
+                    if (_socket) {
+                        SSL_set_shutdown(_socket->native_handle(), SSL_SENT_SHUTDOWN);
+                    }
+                }
+
+                boost::asio::io_service &_io_service;
+                std::shared_ptr<tls_context> _context;
+                std::vector<std::string> _application_protocols;
+                /* what the sessions of the connection are cached under, see tls_context::prepare() */
+                std::string _session_key;
+                std::chrono::steady_clock::duration _handshake_time;
+                std::unique_ptr<socket_type> _socket;
+            };
+        } // namespace client_connection
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_CONNECTION_SSL_CONNECTION_INC
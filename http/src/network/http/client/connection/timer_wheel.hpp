@@ -0,0 +1,279 @@
+#ifndef NETWORK_HTTP_CLIENT_CONNECTION_TIMER_WHEEL_INC
+#define NETWORK_HTTP_CLIENT_CONNECTION_TIMER_WHEEL_INC
+
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <limits>
+#include <cstdint>
+#include <algorithm>
+#include <network/config.hpp>
+
+namespace network {
+    namespace http {
+        namespace client_connection {
+            /*
+             * class timer_wheel
+             *
+             * Deadlines of many operations, kept at a resolution of
+             * `resolution` in a hierarchical wheel: four levels of 64 slots,
+             * each slot of a level as long as the whole level below.
+             * Arming and cancelling unlink and link an entry in a slot, which
+             * is O(1) whatever the number of entries. Entries move down a
+             * level as their time comes closer; deadlines beyond the last
+             * level wait in it until they are in range. The wheel does not
+             * wait by itself: its owner calls advance() at next_expiry(),
+             * e.g. from a single steady_timer. All functions can be called
+             * from any thread.
+             */
+            class timer_wheel {
+                timer_wheel(const timer_wheel &) = delete;
+                timer_wheel &operator = (const timer_wheel &) = delete;
+
+            public:
+                typedef std::chrono::steady_clock clock;
+
+                /*
+                 * A deadline, armed on one wheel at a time. It is cancelled
+                 * when it is destroyed, so its wheel must outlive it.
+                 */
+                class entry {
+                    entry(const entry &) = delete;
+                    entry &operator = (const entry &) = delete;
+
+                public:
+                    explicit entry(timer_wheel &wheel) :
+                        _wheel(wheel),
+                        _prev(nullptr),
+                        _next(nullptr),
+                        _expiry(0),
+                        _level(0),
+                        _slot(0),
+                        _linked(false) { }
+
+                    ~entry() {
+                        _wheel.cancel(*this);
+                    }
+
+                    /* what the entry belongs to, for whoever advance() hands it to */
+                    std::weak_ptr<void> owner;
+
+                private:
+                    friend class timer_wheel;
+
+                    timer_wheel &_wheel;
+                    entry *_prev;
+                    entry *_next;
+                    std::uint64_t _expiry;
+                    unsigned _level;
+                    unsigned _slot;
+                    bool _linked;
+                };
+
+                explicit timer_wheel(std::chrono::milliseconds resolution = std::chrono::milliseconds(1)) :
+                    _origin(clock::now()),
+                    _resolution(resolution.count() > 0 ? resolution : std::chrono::milliseconds(1)),
+                    _now(0),
+                    _wake(never),
+                    _size(0) {
+                    std::fill(&_slots[0][0], &_slots[0][0] + levels * slots, nullptr);
+                    std::fill(_occupied, _occupied + levels, 0);
+                }
+
+                /* entries still armed are left unlinked, so they can be destroyed after the wheel */
+                ~timer_wheel() {
+                    for (unsigned level = 0; level < levels; ++level) {
+                        for (unsigned slot = 0; slot < slots; ++slot) {
+                            for (entry *e = _slots[level][slot]; e; e = e->_next) {
+                                e->_linked = false;
+                            }
+                        }
+                    }
+                }
+
+                /*
+                 * Sets the deadline of e, replacing the one it had. True when
+                 * it is due before the next_expiry() the owner last waited
+                 * for, which must then wait again.
+                 */
+                bool arm(entry &e, clock::time_point deadline) {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    if (e._linked) {
+                        unlink(e);
+                    }
+                    e._expiry = std::max(tick_after(deadline), _now + 1);
+                    link(e);
+                    if (e._expiry < _wake) {
+                        _wake = e._expiry;
+                        return true;
+                    }
+                    return false;
+                }
+
+                void cancel(entry &e) {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    if (e._linked) {
+                        unlink(e);
+                    }
+                }
+
+                /*
+                 * Expires what is due by now: each entry is unlinked and
+                 * passed to handler(entry &). The handler runs under the
+                 * wheel's lock, so it must not arm or cancel entries; it
+                 * should only note what to do once advance() returns.
+                 */
+                template <class Handler>
+                    void advance(clock::time_point now, Handler &&handler) {
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        std::uint64_t target = tick_before(now);
+                        while (_now < target) {
+                            if (_occupied[0] == 0) {
+                                /* nothing due before the next slot of level 1 comes down */
+                                _now = std::min(target - 1, _now | (slots - 1));
+                            }
+                            ++_now;
+                            cascade();
+
+                            unsigned slot = static_cast<unsigned>(_now & (slots - 1));
+                            while (entry *e = _slots[0][slot]) {
+                                unlink(*e);
+                                handler(*e);
+                            }
+                        }
+                        _wake = next_wake();
+                    }
+
+                /* when advance() has to run next; time_point::max() if nothing is armed */
+                clock::time_point next_expiry() {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _wake = next_wake();
+                    if (_wake == never) {
+                        return clock::time_point::max();
+                    }
+                    return _origin + _resolution * static_cast<std::int64_t>(_wake);
+                }
+
+                /* the number of armed entries */
+                std::size_t size() const {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    return _size;
+                }
+
+            private:
+                enum : unsigned { levels = 4, slots = 64, slot_bits = 6 };
+
+                static constexpr std::uint64_t never = std::numeric_limits<std::uint64_t>::max();
+
+                /* the first tick at or after t */
+                std::uint64_t tick_after(clock::time_point t) const {
+                    if (t <= _origin) {
+                        return 0;
+                    }
+                    auto ticks = (t - _origin + _resolution - clock::duration(1)) / _resolution;
+                    return static_cast<std::uint64_t>(ticks);
+                }
+
+                /* the last tick at or before t */
+                std::uint64_t tick_before(clock::time_point t) const {
+                    if (t <= _origin) {
+                        return 0;
+                    }
+                    return static_cast<std::uint64_t>((t - _origin) / _resolution);
+                }
+
+                void link(entry &e) {
+                    std::uint64_t delta = e._expiry - _now;
+                    unsigned level = 0;
+                    while (level + 1 < levels && delta >= (std::uint64_t(1) << (slot_bits * (level + 1)))) {
+                        ++level;
+                    }
+                    std::uint64_t expiry = e._expiry;
+                    if (delta >= (std::uint64_t(1) << (slot_bits * levels))) {
+                        /* out of range, it waits in the last slot there is */
+                        expiry = _now + (std::uint64_t(1) << (slot_bits * levels)) - 1;
+                    }
+                    unsigned slot = static_cast<unsigned>((expiry >> (slot_bits * level)) & (slots - 1));
+
+                    entry *&head = _slots[level][slot];
+                    e._level = level;
+                    e._slot = slot;
+                    e._prev = nullptr;
+                    e._next = head;
+                    if (head) {
+                        head->_prev = &e;
+                    }
+                    head = &e;
+                    _occupied[level] |= std::uint64_t(1) << slot;
+                    e._linked = true;
+                    ++_size;
+                }
+
+                void unlink(entry &e) {
+                    if (e._prev) {
+                        e._prev->_next = e._next;
+                    } else {
+                        _slots[e._level][e._slot] = e._next;
+                        if (!e._next) {
+                            _occupied[e._level] &= ~(std::uint64_t(1) << e._slot);
+                        }
+                    }
+                    if (e._next) {
+                        e._next->_prev = e._prev;
+                    }
+                    e._prev = e._next = nullptr;
+                    e._linked = false;
+                    --_size;
+                }
+
+                /* moves the entries of the slots whose time came down a level */
+                void cascade() {
+                    for (unsigned level = 1; level < levels; ++level) {
+                        if ((_now & ((std::uint64_t(1) << (slot_bits * level)) - 1)) != 0) {
+                            return;
+                        }
+                        unsigned slot = static_cast<unsigned>((_now >> (slot_bits * level)) & (slots - 1));
+                        entry *e = _slots[level][slot];
+                        _slots[level][slot] = nullptr;
+                        _occupied[level] &= ~(std::uint64_t(1) << slot);
+                        while (e) {
+                            entry *next = e->_next;
+                            --_size;
+                            link(*e);
+                            e = next;
+                        }
+                    }
+                }
+
+                /* the first tick after _now at which an occupied slot is due or comes down */
+                std::uint64_t next_wake() const {
+                    std::uint64_t wake = never;
+                    for (unsigned level = 0; level < levels; ++level) {
+                        std::uint64_t mask = _occupied[level];
+                        if (mask == 0) {
+                            continue;
+                        }
+                        unsigned shift = slot_bits * level;
+                        std::uint64_t base = (_now >> shift) + 1;
+                        unsigned start = static_cast<unsigned>(base & (slots - 1));
+                        std::uint64_t rotated = start == 0 ? mask : (mask >> start) | (mask << (slots - start));
+                        std::uint64_t tick = (base + static_cast<std::uint64_t>(__builtin_ctzll(rotated))) << shift;
+                        wake = std::min(wake, tick);
+                    }
+                    return wake;
+                }
+
+                mutable std::mutex _mutex;
+                clock::time_point _origin;
+                clock::duration _resolution;
+                std::uint64_t _now;
+                std::uint64_t _wake;
+                std::size_t _size;
+                entry *_slots[levels][slots];
+                std::uint64_t _occupied[levels];
+            };
+        } // namespace client_connection
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_CONNECTION_TIMER_WHEEL_INC
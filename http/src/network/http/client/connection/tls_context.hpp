@@ -0,0 +1,242 @@
+#ifndef NETWORK_HTTP_CLIENT_CONNECTION_TLS_CONTEXT_INC
+#define NETWORK_HTTP_CLIENT_CONNECTION_TLS_CONTEXT_INC
+
+#include <string>
+#include <vector>
+#include <list>
+#include <mutex>
+#include <memory>
+#include <cstdint>
+#include <utility>
+#include <unordered_map>
+#include <boost/asio/ssl.hpp>
+#include <boost/system/error_code.hpp>
+#include <network/config.hpp>
+
+namespace network {
+    namespace http {
+        namespace client_connection {
+            struct tls_context_statistics {
+                std::uint64_t full_handshakes;
+                std::uint64_t resumed_handshakes;
+                /* handshakes that offered a cached session, resumed or not */
+                std::uint64_t sessions_offered;
+                std::uint64_t sessions_stored;
+                std::uint64_t evicted;
+            };
+
+            /*
+             * class tls_context
+             *
+             * The SSL context of the https connections of a client, which
+             * loads the certificates once, on the first connection, and a
+             * cache of the sessions servers handed out (session IDs or
+             * tickets), by "host:port". A connection offers the last session
+             * of its host, so that the handshake can be abbreviated. At most
+             * `max_sessions` hosts are kept, the least recently used are
+             * dropped first. It can be shared by any number of connections
+             * and clients, on any thread.
+             */
+            class tls_context {
+                tls_context(const tls_context &) = delete;
+                tls_context &operator = (const tls_context &) = delete;
+
+            public:
+                tls_context(std::vector<std::string> certificate_paths,
+                    std::vector<std::string> verify_paths,
+                    bool always_verify_peer,
+                    std::size_t max_sessions = 256) :
+                    _certificate_paths(std::move(certificate_paths)),
+                    _verify_paths(std::move(verify_paths)),
+                    _always_verify_peer(always_verify_peer),
+                    _max_sessions(max_sessions == 0 ? 1 : max_sessions),
+                    _context(boost::asio::ssl::context::sslv23),
+                    _loaded(false),
+                    _statistics() {
+                    SSL_CTX *ctx = _context.native_handle();
+                    /* asio keeps its callbacks in the app data, so it goes in an index of its own */
+                    SSL_CTX_set_ex_data(ctx, context_index(), this);
+                    /* the sessions are kept here, by host, not by OpenSSL by session id */
+                    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+                    SSL_CTX_sess_set_new_cb(ctx, &tls_context::new_session);
+                }
+
+                ~tls_context() {
+                    for (auto &s : _sessions) {
+                        SSL_SESSION_free(s.second.session);
+                    }
+                }
+
+                /* whether the peer's certificate is checked against the host name */
+                bool verify_peer() const {
+                    return _always_verify_peer || !_certificate_paths.empty() || !_verify_paths.empty();
+                }
+
+                /*
+                 * The context, with its certificates loaded; ec is set if
+                 * they could not be, and loading is tried again next time.
+                 */
+                boost::asio::ssl::context &context(boost::system::error_code &ec) {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    ec = boost::system::error_code();
+                    if (!_loaded) {
+                        load(ec);
+                        _loaded = !ec;
+                    }
+                    return _context;
+                }
+
+                /*
+                 * Offers the session cached for key on ssl, before its
+                 * handshake; sessions the server sends on it are cached
+                 * under key. key must outlive ssl.
+                 */
+                void prepare(SSL *ssl, const std::string &key) {
+                    SSL_set_ex_data(ssl, key_index(), const_cast<std::string *>(&key));
+
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    auto it = _sessions.find(key);
+                    if (it == _sessions.end()) {
+                        return;
+                    }
+                    if (!SSL_SESSION_is_resumable(it->second.session)) {
+                        erase(it);
+                        return;
+                    }
+                    SSL_set_session(ssl, it->second.session);
+                    touch(it->second);
+                    ++_statistics.sessions_offered;
+                }
+
+                /* counts the handshake of ssl, or drops the session it offered if it failed */
+                void handshake_done(SSL *ssl, const boost::system::error_code &ec) {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    if (ec) {
+                        auto key = static_cast<std::string *>(SSL_get_ex_data(ssl, key_index()));
+                        auto it = key ? _sessions.find(*key) : _sessions.end();
+                        if (it != _sessions.end()) {
+                            erase(it);
+                        }
+                        return;
+                    }
+                    ++(SSL_session_reused(ssl) ? _statistics.resumed_handshakes : _statistics.full_handshakes);
+                }
+
+                /* drops the sessions cached for every host */
+                void clear() {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    while (!_sessions.empty()) {
+                        erase(_sessions.begin());
+                    }
+                }
+
+                /* number of hosts with a cached session */
+                std::size_t size() const {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    return _sessions.size();
+                }
+
+                tls_context_statistics statistics() const {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    return _statistics;
+                }
+
+            private:
+                struct cached {
+                    SSL_SESSION *session;
+                    std::list<std::string>::iterator use;
+                };
+
+                typedef std::unordered_map<std::string, cached> sessions;
+
+                static int context_index() {
+                    static int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+                    return index;
+                }
+
+                static int key_index() {
+                    static int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+                    return index;
+                }
+
+                /* called by OpenSSL for each session the server sends; taking it returns 1 */
+                static int new_session(SSL *ssl, SSL_SESSION *session) {
+                    auto self = static_cast<tls_context *>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), context_index()));
+                    auto key = static_cast<std::string *>(SSL_get_ex_data(ssl, key_index()));
+                    if (!self || !key) {
+                        return 0;
+                    }
+                    self->store(*key, session);
+                    return 1;
+                }
+
+                /* called with _mutex held */
+                void load(boost::system::error_code &ec) {
+                    if (_certificate_paths.empty() && _verify_paths.empty()) {
+                        _context.set_default_verify_paths(ec);
+                    } else {
+                        for (const auto &path : _certificate_paths) {
+                            if (_context.load_verify_file(path, ec)) {
+                                return;
+                            }
+                        }
+                        for (const auto &path : _verify_paths) {
+                            if (_context.add_verify_path(path, ec)) {
+                                return;
+                            }
+                        }
+                    }
+                    if (!ec) {
+                        _context.set_verify_mode(verify_peer() ?
+                            boost::asio::ssl::verify_peer : boost::asio::ssl::verify_none, ec);
+                    }
+                }
+
+                void store(const std::string &key, SSL_SESSION *session) {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    ++_statistics.sessions_stored;
+                    auto it = _sessions.find(key);
+                    if (it != _sessions.end()) {
+                        SSL_SESSION_free(it->second.session);
+                        it->second.session = session;
+                        touch(it->second);
+                        return;
+                    }
+
+                    _uses.push_front(key);
+                    _sessions.emplace(key, cached{ session, _uses.begin() });
+                    while (_sessions.size() > _max_sessions) {
+                        erase(_sessions.find(_uses.back()));
+                        ++_statistics.evicted;
+                    }
+                }
+
+                /* called with _mutex held */
+                void touch(cached &c) {
+                    _uses.splice(_uses.begin(), _uses, c.use);
+                }
+
+                /* called with _mutex held */
+                void erase(sessions::iterator it) {
+                    SSL_SESSION_free(it->second.session);
+                    _uses.erase(it->second.use);
+                    _sessions.erase(it);
+                }
+
+                std::vector<std::string> _certificate_paths;
+                std::vector<std::string> _verify_paths;
+                bool _always_verify_peer;
+                std::size_t _max_sessions;
+                boost::asio::ssl::context _context;
+                bool _loaded;
+                tls_context_statistics _statistics;
+                sessions _sessions;
+                /* keys of _sessions, most recently used first */
+                std::list<std::string> _uses;
+                mutable std::mutex _mutex;
+            };
+        } // namespace client_connection
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_CONNECTION_TLS_CONTEXT_INC
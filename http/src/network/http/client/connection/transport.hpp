@@ -0,0 +1,45 @@
+#ifndef NETWORK_HTTP_CLIENT_CONNECTION_TRANSPORT_INC
+#define NETWORK_HTTP_CLIENT_CONNECTION_TRANSPORT_INC
+
+#include <string>
+#include <memory>
+#include <boost/asio/io_service.hpp>
+#include <network/config.hpp>
+#include <network/http/client/connection/async_resolver.hpp>
+#include <network/http/client/connection/async_connection.hpp>
+
+namespace network {
+    namespace http {
+        namespace client_connection {
+            /*
+             * class transport
+             *
+             * Where the resolvers and connections of a client come from
+             * when they are not the system resolver and TCP or TLS sockets,
+             * see client_options::transport(). Unlike the connection given
+             * to the client's mock constructor, every connection it makes
+             * is a new one, so pooling, pipelining and concurrent requests
+             * work as they do over sockets. One transport may serve several
+             * clients and every thread of them.
+             */
+            class transport {
+                transport(const transport &) = delete;
+                transport &operator = (const transport &) = delete;
+
+            public:
+                transport() = default;
+
+                virtual ~transport() noexcept { }
+
+                /* the resolver of a client thread running io_service */
+                virtual std::unique_ptr<async_resolver> resolver(boost::asio::io_service &io_service) = 0;
+
+                /* a connection not yet connected, for an origin of scheme, "http" or "https" */
+                virtual std::shared_ptr<async_connection> connection(boost::asio::io_service &io_service,
+                    const std::string &scheme) = 0;
+            };
+        } // namespace client_connection
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_CONNECTION_TRANSPORT_INC
@@ -0,0 +1,456 @@
+#ifndef NETWORK_HTTP_CLIENT_CONTENT_DECODER_INC
+#define NETWORK_HTTP_CLIENT_CONTENT_DECODER_INC
+
+#include <new>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <boost/utility/string_ref.hpp>
+#include <network/config.hpp>
+#if defined(NETLIBX_ENABLE_ZLIB)
+#include <zlib.h>
+#endif // defined(NETLIBX_ENABLE_ZLIB)
+#if defined(NETLIBX_ENABLE_BROTLI)
+#include <brotli/decode.h>
+#endif // defined(NETLIBX_ENABLE_BROTLI)
+
+namespace network {
+    namespace http {
+        namespace client_message {
+            /*
+             * class content_decoder
+             *
+             * Undoes one Content-Encoding of a response body as it arrives.
+             * decode() is fed the encoded body in pieces of any size and
+             * passes the decoded bytes on to `out` in pieces of up to
+             * chunk_size. When out returns false, decoding stops and the
+             * input not decoded yet is kept for drain(), as is output the
+             * decoder holds, so that a full body sink holds up reading as
+             * without an encoding.
+             */
+            class content_decoder {
+                content_decoder(const content_decoder &) = delete;
+                content_decoder &operator = (const content_decoder &) = delete;
+
+            public:
+                typedef boost::string_ref string_ref;
+                typedef std::function<bool (string_ref)> output;
+
+                enum result {
+                    /* all input was decoded */
+                    ok,
+                    /* out returned false, drain() goes on */
+                    stopped,
+                    /* the body is not validly encoded */
+                    invalid,
+                };
+
+                enum : std::size_t { chunk_size = 16 * 1024 };
+
+                content_decoder() : _done(false), _fed(false), _stopped(false) { }
+
+                virtual ~content_decoder() noexcept { }
+
+                result decode(string_ref in, const output &out) {
+                    _fed = _fed || !in.empty();
+                    if (!_pending.empty()) {
+                        _pending.append(in.data(), in.size());
+                        return drain(out);
+                    }
+                    std::size_t used = 0;
+                    result r = run(in, out, used);
+                    if (r == stopped) {
+                        _pending.assign(in.data() + used, in.size() - used);
+                    }
+                    return r;
+                }
+
+                /* decodes the input kept when out last returned false */
+                result drain(const output &out) {
+                    std::size_t used = 0;
+                    result r = run(_pending, out, used);
+                    _pending.erase(0, used);
+                    return r;
+                }
+
+                /* true from a stop until drain() gets through: input or output may still be held */
+                bool has_pending() const {
+                    return _stopped || !_pending.empty();
+                }
+
+                /* true once the end of the encoded stream was decoded */
+                bool done() const {
+                    return _done;
+                }
+
+                /* true if the body was cut short: it began but its encoded stream did not end */
+                bool truncated() const {
+                    return _fed && !_done;
+                }
+
+                /* readies the decoder for another body, keeping what it allocated */
+                void reset() {
+                    _pending.clear();
+                    _done = false;
+                    _fed = false;
+                    _stopped = false;
+                    restart();
+                }
+
+            protected:
+                /* decodes in, stopping when out returns false; used is how much of in was consumed */
+                virtual result step(string_ref in, const output &out, std::size_t &used) = 0;
+
+                virtual void restart() = 0;
+
+                /* true if in, coming after the end of the stream, starts another one */
+                virtual bool more(string_ref) {
+                    return false;
+                }
+
+                char _out[chunk_size];
+                bool _done;
+
+            private:
+                result run(string_ref in, const output &out, std::size_t &used) {
+                    if (_done && !more(in)) {
+                        /* data past the end of the encoded stream is ignored */
+                        used = in.size();
+                        _stopped = false;
+                        return ok;
+                    }
+                    _done = false;
+                    result r = step(in, out, used);
+                    _stopped = r == stopped;
+                    return r;
+                }
+
+                std::string _pending;
+                bool _fed;
+                bool _stopped;
+            };
+
+#if defined(NETLIBX_ENABLE_ZLIB)
+            /*
+             * gzip and deflate. gzip may be several members back to back;
+             * deflate is meant to be zlib-wrapped, but raw deflate, which
+             * some servers send, is accepted too.
+             */
+            class zlib_decoder : public content_decoder {
+            public:
+                explicit zlib_decoder(bool gzip) :
+                    _gzip(gzip), _raw(false), _detected(gzip), _first(0), _has_first(false) {
+                    _stream.zalloc = Z_NULL;
+                    _stream.zfree = Z_NULL;
+                    _stream.opaque = Z_NULL;
+                    _stream.next_in = Z_NULL;
+                    _stream.avail_in = 0;
+                    if (inflateInit2(&_stream, window_bits()) != Z_OK) {
+                        throw std::bad_alloc();
+                    }
+                }
+
+                virtual ~zlib_decoder() noexcept {
+                    inflateEnd(&_stream);
+                }
+
+            protected:
+                virtual result step(string_ref in, const output &out, std::size_t &used) {
+                    if (!_detected && !detect(in, used)) {
+                        return ok;
+                    }
+                    _stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in.data() + used));
+                    _stream.avail_in = static_cast<uInt>(in.size() - used);
+                    for (;;) {
+                        _stream.next_out = reinterpret_cast<Bytef *>(_out);
+                        _stream.avail_out = sizeof(_out);
+                        int rc = inflate(&_stream, Z_NO_FLUSH);
+                        if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) {
+                            used = in.size() - _stream.avail_in;
+                            return invalid;
+                        }
+
+                        std::size_t produced = sizeof(_out) - _stream.avail_out;
+                        used = in.size() - _stream.avail_in;
+                        if (rc == Z_STREAM_END) {
+                            if (_gzip && _stream.avail_in > 0) {
+                                /* another member follows */
+                                inflateReset(&_stream);
+                            } else {
+                                _done = true;
+                            }
+                        }
+                        if (produced && !out(string_ref(_out, produced))) {
+                            /* even with all input taken, inflate may hold more output */
+                            return stopped;
+                        }
+                        if (_done) {
+                            used = in.size();
+                            return ok;
+                        }
+                        if (_stream.avail_in == 0 && _stream.avail_out != 0) {
+                            return ok;
+                        }
+                    }
+                }
+
+                virtual void restart() {
+                    _raw = false;
+                    _detected = _gzip;
+                    _has_first = false;
+                    inflateReset2(&_stream, window_bits());
+                }
+
+                /* the next gzip member, starting with its magic number */
+                virtual bool more(string_ref in) {
+                    if (!_gzip || in.empty() || static_cast<unsigned char>(in[0]) != 0x1f) {
+                        return false;
+                    }
+                    inflateReset(&_stream);
+                    return true;
+                }
+
+            private:
+                /* 32 lets zlib tell a gzip header from a zlib one */
+                int window_bits() const {
+                    return _gzip ? 15 + 32 : (_raw ? -15 : 15);
+                }
+
+                /*
+                 * Tells zlib-wrapped deflate from raw deflate by the first two
+                 * bytes, holding the first back until the second comes. False
+                 * if in was all taken for that.
+                 */
+                bool detect(string_ref in, std::size_t &used) {
+                    used = 0;
+                    if (in.empty()) {
+                        return false;
+                    }
+                    if (!_has_first) {
+                        _first = static_cast<unsigned char>(in[0]);
+                        _has_first = true;
+                        used = 1;
+                        if (in.size() == 1) {
+                            return false;
+                        }
+                    }
+                    unsigned header = (_first << 8) | static_cast<unsigned char>(in[used]);
+                    _raw = (_first & 0x0f) != Z_DEFLATED || (_first >> 4) > 7 || header % 31 != 0;
+                    _detected = true;
+                    inflateReset2(&_stream, window_bits());
+
+                    /* one byte does not complete a zlib header or a deflate code, there is no output */
+                    _stream.next_in = &_first;
+                    _stream.avail_in = 1;
+                    _stream.next_out = reinterpret_cast<Bytef *>(_out);
+                    _stream.avail_out = sizeof(_out);
+                    inflate(&_stream, Z_NO_FLUSH);
+                    _has_first = false;
+                    return true;
+                }
+
+                z_stream _stream;
+                bool _gzip;
+                bool _raw;
+                bool _detected;
+                Bytef _first;
+                bool _has_first;
+            };
+#endif // defined(NETLIBX_ENABLE_ZLIB)
+
+#if defined(NETLIBX_ENABLE_BROTLI)
+            /* br; the decoder has no reset, restart() replaces its state */
+            class brotli_decoder : public content_decoder {
+            public:
+                brotli_decoder() : _state(create()) { }
+
+                virtual ~brotli_decoder() noexcept {
+                    BrotliDecoderDestroyInstance(_state);
+                }
+
+            protected:
+                virtual result step(string_ref in, const output &out, std::size_t &used) {
+                    const std::uint8_t *next_in = reinterpret_cast<const std::uint8_t *>(in.data());
+                    std::size_t avail_in = in.size();
+                    for (;;) {
+                        std::uint8_t *next_out = reinterpret_cast<std::uint8_t *>(_out);
+                        std::size_t avail_out = sizeof(_out);
+                        BrotliDecoderResult rc = BrotliDecoderDecompressStream(_state,
+                            &avail_in, &next_in, &avail_out, &next_out, nullptr);
+                        used = in.size() - avail_in;
+                        if (rc == BROTLI_DECODER_RESULT_ERROR) {
+                            return invalid;
+                        }
+                        if (rc == BROTLI_DECODER_RESULT_SUCCESS) {
+                            _done = true;
+                            used = in.size();
+                        }
+
+                        std::size_t produced = sizeof(_out) - avail_out;
+                        bool more_output = rc == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT;
+                        if (produced && !out(string_ref(_out, produced))) {
+                            return stopped;
+                        }
+                        if (_done || (avail_in == 0 && !more_output)) {
+                            return ok;
+                        }
+                    }
+                }
+
+                virtual void restart() {
+                    BrotliDecoderState *fresh = create();
+                    BrotliDecoderDestroyInstance(_state);
+                    _state = fresh;
+                }
+
+            private:
+                static BrotliDecoderState *create() {
+                    BrotliDecoderState *state = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+                    if (!state) {
+                        throw std::bad_alloc();
+                    }
+                    return state;
+                }
+
+                BrotliDecoderState *_state;
+            };
+#endif // defined(NETLIBX_ENABLE_BROTLI)
+
+            /*
+             * class content_decoder_pool
+             *
+             * Decoders of one connection, so that its next compressed
+             * response reuses the inflate window or brotli state of the last
+             * one. acquire() hands a decoder out as a handle that gives it
+             * back when destroyed; handles outliving the pool delete theirs.
+             */
+            class content_decoder_pool : public std::enable_shared_from_this<content_decoder_pool> {
+            public:
+                typedef boost::string_ref string_ref;
+
+                struct recycler {
+                    void operator () (content_decoder *decoder) const {
+                        if (auto pool = _pool.lock()) {
+                            pool->give_back(decoder, _encoding);
+                        } else {
+                            delete decoder;
+                        }
+                    }
+
+                    std::weak_ptr<content_decoder_pool> _pool;
+                    unsigned _encoding;
+                };
+                typedef std::unique_ptr<content_decoder, recycler> handle;
+
+                /* the encodings there is a decoder for, as an Accept-Encoding value; empty if none */
+                static const char *accepted() {
+#if defined(NETLIBX_ENABLE_ZLIB) && defined(NETLIBX_ENABLE_BROTLI)
+                    return "gzip, deflate, br";
+#elif defined(NETLIBX_ENABLE_ZLIB)
+                    return "gzip, deflate";
+#elif defined(NETLIBX_ENABLE_BROTLI)
+                    return "br";
+#else
+                    return "";
+#endif
+                }
+
+                /* a decoder for a Content-Encoding value, none if it is not supported */
+                handle acquire(string_ref encoding) {
+                    unsigned index = index_of(encoding);
+                    if (index == unsupported) {
+                        return handle(nullptr, recycler{ std::weak_ptr<content_decoder_pool>(), index });
+                    }
+                    std::unique_ptr<content_decoder> decoder;
+                    {
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        if (!_idle[index].empty()) {
+                            decoder = std::move(_idle[index].back());
+                            _idle[index].pop_back();
+                        }
+                    }
+                    if (!decoder) {
+                        decoder = create(index);
+                    }
+                    return handle(decoder.release(), recycler{ shared_from_this(), index });
+                }
+
+            private:
+                enum : unsigned { gzip, deflate, br, encodings, unsupported = encodings };
+
+                /* idle decoders kept per encoding; more only for concurrent HTTP/2 streams */
+                enum : std::size_t { max_idle = 4 };
+
+                static unsigned index_of(string_ref encoding) {
+                    while (!encoding.empty() && (encoding.front() == ' ' || encoding.front() == '\t')) {
+                        encoding.remove_prefix(1);
+                    }
+                    while (!encoding.empty() && (encoding.back() == ' ' || encoding.back() == '\t')) {
+                        encoding.remove_suffix(1);
+                    }
+                    auto is = [&encoding] (const char *name) {
+                        std::size_t n = std::char_traits<char>::length(name);
+                        if (encoding.size() != n) {
+                            return false;
+                        }
+                        for (std::size_t i = 0; i < n; ++i) {
+                            if ((encoding[i] | 0x20) != name[i]) {
+                                return false;
+                            }
+                        }
+                        return true;
+                    };
+#if defined(NETLIBX_ENABLE_ZLIB)
+                    if (is("gzip") || is("x-gzip")) {
+                        return gzip;
+                    }
+                    if (is("deflate")) {
+                        return deflate;
+                    }
+#endif // defined(NETLIBX_ENABLE_ZLIB)
+#if defined(NETLIBX_ENABLE_BROTLI)
+                    if (is("br")) {
+                        return br;
+                    }
+#endif // defined(NETLIBX_ENABLE_BROTLI)
+                    (void)is;
+                    return unsupported;
+                }
+
+                static std::unique_ptr<content_decoder> create(unsigned index) {
+                    switch (index) {
+#if defined(NETLIBX_ENABLE_ZLIB)
+                    case gzip:
+                        return std::unique_ptr<content_decoder>(new zlib_decoder(true));
+                    case deflate:
+                        return std::unique_ptr<content_decoder>(new zlib_decoder(false));
+#endif // defined(NETLIBX_ENABLE_ZLIB)
+#if defined(NETLIBX_ENABLE_BROTLI)
+                    case br:
+                        return std::unique_ptr<content_decoder>(new brotli_decoder());
+#endif // defined(NETLIBX_ENABLE_BROTLI)
+                    default:
+                        return nullptr;
+                    }
+                }
+
+                void give_back(content_decoder *decoder, unsigned index) {
+                    std::unique_ptr<content_decoder> owned(decoder);
+                    owned->reset();
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    if (_idle[index].size() < max_idle) {
+                        _idle[index].push_back(std::move(owned));
+                    }
+                }
+
+                std::mutex _mutex;
+                std::vector<std::unique_ptr<content_decoder> > _idle[encodings];
+            };
+        } // namespace client_message
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_CONTENT_DECODER_INC
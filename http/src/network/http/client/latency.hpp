@@ -0,0 +1,327 @@
+#ifndef NETWORK_HTTP_CLIENT_LATENCY_INC
+#define NETWORK_HTTP_CLIENT_LATENCY_INC
+
+#include <map>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <algorithm>
+#include <unordered_map>
+#include <network/config.hpp>
+
+namespace network {
+    namespace http {
+        namespace client_message {
+            /*
+             * The phases of a request timed by the client, in the order they
+             * happen. pool_wait is the time queued for a connection, a
+             * pipeline or an HTTP/2 session; dns, connect and tls_handshake
+             * only happen on a new connection; first_byte runs from the end
+             * of the request to the end of the response head, body from
+             * there to the end of the response. HTTP/2 streams have no
+             * request_write: the session writes their frames. total runs
+             * from the start of a request to its response, redirects
+             * included.
+             */
+            enum class latency_phase {
+                pool_wait,
+                dns,
+                connect,
+                tls_handshake,
+                request_write,
+                first_byte,
+                body,
+                total
+            };
+
+            enum : std::size_t { latency_phase_count = 8 };
+
+            inline const char *latency_phase_name(latency_phase phase) {
+                static const char *names[latency_phase_count] = {
+                    "pool_wait", "dns", "connect", "tls_handshake", "request_write", "first_byte", "body", "total"
+                };
+                return names[static_cast<std::size_t>(phase)];
+            }
+
+            /*
+             * Counts of a latency_histogram at one point in time, which can
+             * be added up. Values are in microseconds.
+             */
+            struct latency_distribution {
+                latency_distribution() : count(0), sum(0), max(0) { }
+
+                /* the value below which p percent of the samples are, to the precision of the buckets */
+                std::uint64_t percentile(double p) const;
+
+                double mean() const {
+                    return count ? static_cast<double>(sum) / count : 0.0;
+                }
+
+                void merge(const latency_distribution &other);
+
+                /* per bucket, see latency_histogram::bucket_of(); empty if there are no samples */
+                std::vector<std::uint64_t> counts;
+                std::uint64_t count;
+                std::uint64_t sum;
+                std::uint64_t max;
+            };
+
+            /*
+             * class latency_histogram
+             *
+             * Durations in microseconds, in log-linear buckets as in HDR
+             * histograms: each power of two is split in 16, so a value is
+             * known to within 1/16th. Values past 2^36 microseconds, about
+             * 19 hours, go to the last bucket. Recording is a few relaxed
+             * atomic increments, safe from any thread and never blocking.
+             */
+            class latency_histogram {
+                latency_histogram(const latency_histogram &) = delete;
+                latency_histogram &operator = (const latency_histogram &) = delete;
+
+            public:
+                enum : std::size_t { sub_bucket_bits = 4, sub_buckets = 1 << sub_bucket_bits, max_magnitude = 35 };
+                enum : std::size_t { buckets = (max_magnitude - sub_bucket_bits + 2) * sub_buckets };
+
+                latency_histogram() : _counts(), _sum(0), _max(0) { }
+
+                void record(std::chrono::steady_clock::duration elapsed) {
+                    auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+                    record(us > 0 ? static_cast<std::uint64_t>(us) : 0);
+                }
+
+                void record(std::uint64_t us) {
+                    _counts[bucket_of(us)].fetch_add(1, std::memory_order_relaxed);
+                    _sum.fetch_add(us, std::memory_order_relaxed);
+                    std::uint64_t max = _max.load(std::memory_order_relaxed);
+                    while (us > max && !_max.compare_exchange_weak(max, us, std::memory_order_relaxed)) { }
+                }
+
+                /* adds the samples recorded so far to d */
+                void add_to(latency_distribution &d) const {
+                    std::uint64_t count = 0;
+                    for (std::size_t i = 0; i < buckets; ++i) {
+                        std::uint64_t n = _counts[i].load(std::memory_order_relaxed);
+                        if (n == 0) {
+                            continue;
+                        }
+                        if (d.counts.empty()) {
+                            d.counts.resize(buckets);
+                        }
+                        d.counts[i] += n;
+                        count += n;
+                    }
+                    d.count += count;
+                    d.sum += _sum.load(std::memory_order_relaxed);
+                    d.max = std::max(d.max, _max.load(std::memory_order_relaxed));
+                }
+
+                static std::size_t bucket_of(std::uint64_t us) {
+                    if (us < sub_buckets) {
+                        return static_cast<std::size_t>(us);
+                    }
+                    std::size_t magnitude = 63 - leading_zeros(us);
+                    if (magnitude > max_magnitude) {
+                        return buckets - 1;
+                    }
+                    std::size_t shift = magnitude - sub_bucket_bits;
+                    return shift * sub_buckets + static_cast<std::size_t>(us >> shift);
+                }
+
+                /* the smallest and largest values of bucket */
+                static std::uint64_t lowest(std::size_t bucket) {
+                    if (bucket < 2 * sub_buckets) {
+                        return bucket;
+                    }
+                    std::size_t shift = bucket / sub_buckets - 1;
+                    return static_cast<std::uint64_t>(bucket % sub_buckets + sub_buckets) << shift;
+                }
+
+                static std::uint64_t highest(std::size_t bucket) {
+                    if (bucket < 2 * sub_buckets) {
+                        return bucket;
+                    }
+                    std::size_t shift = bucket / sub_buckets - 1;
+                    return lowest(bucket) + (std::uint64_t(1) << shift) - 1;
+                }
+
+            private:
+                static std::size_t leading_zeros(std::uint64_t v) {
+#if defined(__GNUC__)
+                    return static_cast<std::size_t>(__builtin_clzll(v));
+#else
+                    std::size_t n = 0;
+                    for (std::uint64_t bit = std::uint64_t(1) << 63; !(v & bit); bit >>= 1) {
+                        ++n;
+                    }
+                    return n;
+#endif // defined(__GNUC__)
+                }
+
+                std::atomic<std::uint64_t> _counts[buckets];
+                std::atomic<std::uint64_t> _sum;
+                std::atomic<std::uint64_t> _max;
+            };
+
+            inline std::uint64_t latency_distribution::percentile(double p) const {
+                if (count == 0) {
+                    return 0;
+                }
+                auto rank = static_cast<std::uint64_t>(std::ceil(p / 100.0 * count));
+                rank = std::min(std::max<std::uint64_t>(rank, 1), count);
+                std::uint64_t seen = 0;
+                for (std::size_t i = 0; i < counts.size(); ++i) {
+                    seen += counts[i];
+                    if (seen >= rank) {
+                        return std::min(latency_histogram::highest(i), max);
+                    }
+                }
+                return max;
+            }
+
+            inline void latency_distribution::merge(const latency_distribution &other) {
+                if (!other.counts.empty()) {
+                    counts.resize(other.counts.size());
+                    for (std::size_t i = 0; i < other.counts.size(); ++i) {
+                        counts[i] += other.counts[i];
+                    }
+                }
+                count += other.count;
+                sum += other.sum;
+                max = std::max(max, other.max);
+            }
+
+            /* the phases of the requests of a client, overall and by "host:port" */
+            struct latency_snapshot {
+                typedef std::array<latency_distribution, latency_phase_count> phases;
+
+                const latency_distribution &operator [] (latency_phase phase) const {
+                    return overall[static_cast<std::size_t>(phase)];
+                }
+
+                phases overall;
+                std::map<std::string, phases> hosts;
+            };
+
+            /*
+             * class latency_recorder
+             *
+             * The histograms of one thread of a client, one per phase for
+             * each host. At most `max_hosts` hosts get histograms of their
+             * own, later ones are counted under "other", so that a client
+             * talking to many hosts does not grow without bound.
+             */
+            class latency_recorder {
+                latency_recorder(const latency_recorder &) = delete;
+                latency_recorder &operator = (const latency_recorder &) = delete;
+
+            public:
+                struct host_histograms {
+                    void record(latency_phase phase, std::chrono::steady_clock::duration elapsed) {
+                        phases[static_cast<std::size_t>(phase)].record(elapsed);
+                    }
+
+                    latency_histogram phases[latency_phase_count];
+                };
+
+                explicit latency_recorder(std::size_t max_hosts = 64) :
+                    _max_hosts(max_hosts) { }
+
+                /* the histograms of host:port, which live as long as the recorder */
+                host_histograms *host(const std::string &host, std::uint16_t port) {
+                    std::string name = host + ':' + std::to_string(port);
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    auto it = _hosts.find(name);
+                    if (it == _hosts.end()) {
+                        if (_hosts.size() >= _max_hosts) {
+                            name = "other";
+                            it = _hosts.find(name);
+                        }
+                        if (it == _hosts.end()) {
+                            it = _hosts.emplace(std::move(name), std::unique_ptr<host_histograms>(new host_histograms)).first;
+                        }
+                    }
+                    return it->second.get();
+                }
+
+                void add_to(latency_snapshot &s) const {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    for (const auto &h : _hosts) {
+                        auto &phases = s.hosts[h.first];
+                        for (std::size_t i = 0; i < latency_phase_count; ++i) {
+                            latency_distribution d;
+                            h.second->phases[i].add_to(d);
+                            phases[i].merge(d);
+                            s.overall[i].merge(d);
+                        }
+                    }
+                }
+
+            private:
+                std::size_t _max_hosts;
+                std::unordered_map<std::string, std::unique_ptr<host_histograms> > _hosts;
+                mutable std::mutex _mutex;
+            };
+
+            /*
+             * The snapshot in the Prometheus text format, as a histogram
+             * called `metric` with a host and a phase label, in seconds.
+             * Phases without samples are left out.
+             */
+            inline std::string prometheus_text(const latency_snapshot &s,
+                const std::string &metric = "netlibx_http_client_phase_seconds") {
+                /* the bucket bounds, in microseconds */
+                static const std::uint64_t bounds[] = {
+                    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+                    100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000
+                };
+
+                std::ostringstream out;
+                out.precision(12);
+                out << "# HELP " << metric << " Time spent in each phase of HTTP requests.\n";
+                out << "# TYPE " << metric << " histogram\n";
+                for (const auto &h : s.hosts) {
+                    std::string host;
+                    for (char c : h.first) {
+                        if (c == '\\' || c == '"') {
+                            host.push_back('\\');
+                        }
+                        host.push_back(c);
+                    }
+                    for (std::size_t i = 0; i < latency_phase_count; ++i) {
+                        const latency_distribution &d = h.second[i];
+                        if (d.count == 0) {
+                            continue;
+                        }
+                        std::string labels = "host=\"" + host + "\",phase=\"" +
+                            latency_phase_name(static_cast<latency_phase>(i)) + "\"";
+
+                        std::size_t bucket = 0;
+                        std::uint64_t cumulative = 0;
+                        for (auto bound : bounds) {
+                            /* a bucket is counted once all its values are within the bound */
+                            while (bucket < d.counts.size() && latency_histogram::highest(bucket) <= bound) {
+                                cumulative += d.counts[bucket++];
+                            }
+                            out << metric << "_bucket{" << labels << ",le=\"" << bound / 1e6 << "\"} "
+                                << cumulative << "\n";
+                        }
+                        out << metric << "_bucket{" << labels << ",le=\"+Inf\"} " << d.count << "\n";
+                        out << metric << "_sum{" << labels << "} " << d.sum / 1e6 << "\n";
+                        out << metric << "_count{" << labels << "} " << d.count << "\n";
+                    }
+                }
+                return out.str();
+            }
+        } // namespace client_message
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_LATENCY_INC
@@ -0,0 +1,233 @@
+#ifndef NETWORK_HTTP_CLIENT_REDIRECT_CACHE_INC
+#define NETWORK_HTTP_CLIENT_REDIRECT_CACHE_INC
+
+#include <string>
+#include <list>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+#include <boost/utility/string_ref.hpp>
+#include <network/config.hpp>
+#include <network/http/method.hpp>
+#include <network/http/status.hpp>
+#include <network/uri.hpp>
+
+namespace network {
+    namespace http {
+        namespace client_message {
+            /* the redirect statuses followed, see client_options::follow_redirects() */
+            inline bool is_redirect(status::code code) {
+                return code == status::moved_permanently || code == status::found ||
+                    code == status::see_other || code == status::temporary_redirect ||
+                    code == status::permanent_redirect;
+            }
+
+            /* whether a redirect with code turns a request with method m into a GET without body */
+            inline bool redirect_drops_body(status::code code, http::method m) {
+                return (code == status::see_other && m != method::head) ||
+                    ((code == status::moved_permanently || code == status::found) && m == method::post);
+            }
+
+            /*
+             * The absolute URL that location, the value of a Location
+             * header, refers to from base (RFC 3986, section 5.2). Empty if
+             * base has no scheme or host.
+             */
+            inline std::string resolve_location(const uri &base, boost::string_ref location) {
+                auto scheme = base.scheme();
+                auto host = base.host();
+                if (!scheme || !host) {
+                    return std::string();
+                }
+
+                /* an absolute URL: a scheme, then "://" */
+                auto colon = location.find(':');
+                auto delimiter = location.find_first_of("/?#");
+                if (colon != boost::string_ref::npos && colon > 0 &&
+                    (delimiter == boost::string_ref::npos || colon < delimiter)) {
+                    return std::string(location.begin(), location.end());
+                }
+
+                std::string result(scheme->begin(), scheme->end());
+                result.append(":");
+                if (location.starts_with("//")) {
+                    result.append(location.begin(), location.end());
+                    return result;
+                }
+
+                result.append("//");
+                result.append(host->begin(), host->end());
+                if (auto port = base.port()) {
+                    result.push_back(':');
+                    result.append(port->begin(), port->end());
+                }
+
+                std::string path;
+                boost::string_ref rest = location;
+                if (location.empty() || location.front() == '?' || location.front() == '#') {
+                    /* the same path, with the query of location if it has one */
+                    if (auto p = base.path()) {
+                        path.assign(p->begin(), p->end());
+                    }
+                    if (location.empty() || location.front() == '#') {
+                        if (auto query = base.query()) {
+                            path.push_back('?');
+                            path.append(query->begin(), query->end());
+                        }
+                    }
+                } else {
+                    auto end = location.find_first_of("?#");
+                    boost::string_ref reference = location.substr(0, end);
+                    rest = end == boost::string_ref::npos ? boost::string_ref() : location.substr(end);
+                    if (reference.front() != '/') {
+                        /* relative to the directory of the base path */
+                        auto p = base.path();
+                        if (p) {
+                            path.assign(p->begin(), p->end());
+                        }
+                        path.erase(path.rfind('/') == std::string::npos ? 0 : path.rfind('/') + 1);
+                        if (path.empty()) {
+                            path.push_back('/');
+                        }
+                    }
+                    path.append(reference.begin(), reference.end());
+
+                    /* dot segments, e.g. /a/b/../c is /a/c */
+                    std::vector<boost::string_ref> segments;
+                    bool directory = false;
+                    for (std::size_t i = 1; i <= path.size(); ) {
+                        std::size_t next = std::min(path.find('/', i), path.size());
+                        boost::string_ref segment(path.data() + i, next - i);
+                        directory = segment == "." || segment == "..";
+                        if (segment == "..") {
+                            if (!segments.empty()) {
+                                segments.pop_back();
+                            }
+                        } else if (!directory) {
+                            segments.push_back(segment);
+                        }
+                        i = next + 1;
+                    }
+                    std::string out;
+                    for (auto segment : segments) {
+                        out.push_back('/');
+                        out.append(segment.begin(), segment.end());
+                    }
+                    if (directory || out.empty()) {
+                        out.push_back('/');
+                    }
+                    path.swap(out);
+                }
+
+                result.append(path.empty() ? std::string("/") : path);
+                result.append(rest.begin(), rest.end());
+                return result;
+            }
+
+            struct redirect_cache_statistics {
+                std::uint64_t hits;
+                std::uint64_t stored;
+                std::uint64_t evicted;
+            };
+
+            /*
+             * class redirect_cache
+             *
+             * Permanent redirects (301 and 308) seen by a client, by the URL
+             * they were answered for, so that later requests for it go to
+             * the new location without asking first. At most `max_entries`
+             * URLs are kept, the least recently used are dropped first. It
+             * can be shared by any number of clients, on any thread.
+             */
+            class redirect_cache {
+                redirect_cache(const redirect_cache &) = delete;
+                redirect_cache &operator = (const redirect_cache &) = delete;
+
+            public:
+                struct target {
+                    std::string location;
+                    status::code code;
+                };
+
+                explicit redirect_cache(std::size_t max_entries = 1024) :
+                    _max_entries(max_entries == 0 ? 1 : max_entries),
+                    _statistics() { }
+
+                /* the absolute URL url was permanently redirected to, if any */
+                bool lookup(const std::string &url, target &found) {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    auto it = _entries.find(url);
+                    if (it == _entries.end()) {
+                        return false;
+                    }
+                    _uses.splice(_uses.begin(), _uses, it->second.use);
+                    found = it->second.to;
+                    ++_statistics.hits;
+                    return true;
+                }
+
+                void store(const std::string &url, std::string location, status::code code) {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    ++_statistics.stored;
+                    auto it = _entries.find(url);
+                    if (it != _entries.end()) {
+                        it->second.to = target{ std::move(location), code };
+                        _uses.splice(_uses.begin(), _uses, it->second.use);
+                        return;
+                    }
+
+                    _uses.push_front(url);
+                    _entries.emplace(url, entry{ target{ std::move(location), code }, _uses.begin() });
+                    while (_entries.size() > _max_entries) {
+                        _entries.erase(_uses.back());
+                        _uses.pop_back();
+                        ++_statistics.evicted;
+                    }
+                }
+
+                void remove(const std::string &url) {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    auto it = _entries.find(url);
+                    if (it != _entries.end()) {
+                        _uses.erase(it->second.use);
+                        _entries.erase(it);
+                    }
+                }
+
+                void clear() {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _entries.clear();
+                    _uses.clear();
+                }
+
+                std::size_t size() const {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    return _entries.size();
+                }
+
+                redirect_cache_statistics statistics() const {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    return _statistics;
+                }
+
+            private:
+                struct entry {
+                    target to;
+                    std::list<std::string>::iterator use;
+                };
+
+                std::size_t _max_entries;
+                redirect_cache_statistics _statistics;
+                std::unordered_map<std::string, entry> _entries;
+                /* keys of _entries, most recently used first */
+                std::list<std::string> _uses;
+                mutable std::mutex _mutex;
+            };
+        } // namespace client_message
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_REDIRECT_CACHE_INC
@@ -8,16 +8,18 @@
 #include <cstdint>
 #include <algorithm>
 #include <functional>
-#include <sstream>
 #include <iterator>
+#include <boost/asio/buffer.hpp>
 #include <boost/range/iterator_range.hpp>
 #include <boost/range/algorithm/equal.hpp>
 #include <boost/range/as_literal.hpp>
-#include <boost/algorithm/string/predicate.hpp>
 #include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
 #include <network/config.hpp>
 #include <network/http/method.hpp>
+#include <network/http/header_map.hpp>
 #include <network/http/client/client_errors.hpp>
+#include <network/http/client/byte_source.hpp>
 #include <network/uri.hpp>
 
 namespace network {
@@ -30,10 +32,21 @@ namespace network {
             };
             typedef enum transfer_direction transfer_direction;
 
+            /*
+             * Receives the response body piece by piece as it arrives, in
+             * place of response::body(). The view is only valid during the
+             * call. Returning false stops reading from the connection until
+             * the sink calls `resume`, which it may do from any thread while
+             * the client is alive.
+             */
+            typedef std::function<void ()> resume_function;
+            typedef std::function<bool (boost::string_ref data, const resume_function &resume)> body_sink;
+
             /*
              * class request_options
              */
             class request_options {
+            public:
                 request_options() :
                     _resolve_timeout(30000),
                     _read_timeout(30000),
@@ -45,14 +58,16 @@ namespace network {
                     _resolve_timeout(other._resolve_timeout),
                     _read_timeout(other._read_timeout),
                     _total_timeout(other._total_timeout),
-                    _max_redirects(other._max_redirects) {
+                    _max_redirects(other._max_redirects),
+                    _progress_handler(other._progress_handler),
+                    _sink(other._sink) {
 
                     }
                 /*
                  * assignment operator
                  */
                 request_options &operator = (request_options other) {
-                    other.swap(&this);
+                    other.swap(*this);
                     return (*this);
                 }
 
@@ -66,6 +81,8 @@ namespace network {
                     swap(_read_timeout, other._read_timeout);
                     swap(_total_timeout, other._total_timeout);
                     swap(_max_redirects, other._max_redirects);
+                    swap(_progress_handler, other._progress_handler);
+                    swap(_sink, other._sink);
                 }
 
                 request_options &resolver_timeout(std::uint64_t rl_to) {
@@ -104,6 +121,10 @@ namespace network {
                     return _max_redirects;
                 }
 
+                /*
+                 * Called with the size of the request as it is written and of
+                 * each piece of the response body as it is delivered.
+                 */
                 request_options &progress(std::function<void (transfer_direction, std::uint64_t)> handler) {
                     _progress_handler = handler;
                     return *this;
@@ -113,94 +134,88 @@ namespace network {
                     return _progress_handler;
                 }
 
+                /* streams the response body to sink, see body_sink */
+                request_options &sink(body_sink sink) {
+                    _sink = std::move(sink);
+                    return *this;
+                }
+
+                const body_sink &sink() const {
+                    return _sink;
+                }
+
             private:
                 std::uint64_t _resolve_timeout;
                 std::uint64_t _read_timeout;
                 std::uint64_t _total_timeout;
                 int           _max_redirects;
                 std::function<void (transfer_direction, std::uint64_t)> _progress_handler;
+                body_sink     _sink;
 
             };
 
 
 
-            inline void swap(request_options &lhs, request_options *rhs) {
+            inline void swap(request_options &lhs, request_options &rhs) {
                 lhs.swap(rhs);
             }
 
-            /*
-             * class: byte_source
-             */
-            class byte_source {
-            public:
-                using std::string;
-                using std::size_t;
-
-                virtual ~byte_source() { }
-
-                virtual size_t read(string &src, size_t len);
-            };
-
-            class string_byte_source : public byte_source {
-            public:
-                explicit string_byte_source(string source);
-                virtual ~string_byte_source() { }
-
-                virtual size_t read(string &source, size_t len);
-
-            private:
-                string _source;
-            };
-
             class request {
             public:
-                using std::string;
-                using std::size_t;
-                
-                typedef std::vector<std::pair<string, string> > header_t;
+                typedef std::string string;
+                typedef std::size_t size_t;
+
+                typedef network::http::header_map header_t;
                 typedef header_t::iterator header_iterator;
                 typedef header_t::const_iterator const_header_iterator;
-
-                using network::http::method;
-                using network::uri;
+                typedef header_t::allocator_type allocator_type;
 
             public:
-                request () : _byte_source(nullptr) { }
-                explicit request(uri url) : _url(url) {
+                request () :
+                    _method(http::method::get),
+                    _version("1.1"),
+                    _byte_source(nullptr) { }
+
+                explicit request(uri url) :
+                    request(std::move(url), allocator_type()) { }
+
+                /* header storage is drawn from alloc, e.g. an exchange's arena */
+                request(uri url, const allocator_type &alloc) :
+                    _url(std::move(url)),
+                    _method(http::method::get),
+                    _version("1.1"),
+                    _headers(alloc) {
                     /*
                      * The syntax is:
                      * scheme://domain:port/path?query_string#fragment_id
                      */
-                    if (auto scheme = url.scheme()) { // scheme/protocol name
+                    if (auto scheme = _url.scheme()) { // scheme/protocol name
                         if (!boost::equal(*scheme, boost::as_literal("http")) &&
                             !boost::equal(*scheme, boost::as_literal("https"))) {
                             throw invalid_url();
                         }
 
-                        if (auto path = url.path()) { // path
-                            std::copy(std::begin(*begin), std::end(*path), std::back_inserter(_path));
+                        if (auto path = _url.path()) { // path
+                            _path.append(std::begin(*path), std::end(*path));
+                        }
+                        if (_path.empty()) { // origin-form is never empty (RFC 9112, 3.2.1)
+                            _path.push_back('/');
                         }
 
-                        if (auto query = url.query()) { // query string
+                        if (auto query = _url.query()) { // query string
                             _path.push_back('?');
-                            std::copy(std::begin(*query), std::end(*query), std::back_inserter(_path));
+                            _path.append(std::begin(*query), std::end(*query));
                         }
 
-                        if (auto fragment = url.fragment()) { // fragment id
-                            _path.push_back('#');
-                            std::copy(std::begin(*fragment), std::end(*fragment), std::back_inserter(_path));
-                        }
+                        /* the fragment id stays with the client, it is not sent */
 
                         /* domain:port */
-                        std::ostringstream oss;
-                        std::copy(std::begin(*url.host()), std::end(*url.host()),
-                            std::ostream_iterator<char>(oss));
-                        if (url.port()) {
-                            oss << ":";
-                            std::copy(std::begin(*url.port()), std::end(*url.port()),
-                                std::ostream_iterator<char>(oss));
+                        string host(std::begin(*_url.host()), std::end(*_url.host()));
+                        if (auto port = _url.port()) {
+                            host.push_back(':');
+                            host.append(std::begin(*port), std::end(*port));
                         }
-                        append_header("Host", oss.str());
+                        append_header("Host", std::move(host));
                     } else {
                         throw invalid_url();
                     }
@@ -255,7 +270,7 @@ namespace network {
                     _url = url;
                     return *this;
                 }
-                uri url() const {
+                const uri &url() const {
                     return _url;
                 }
 
@@ -266,12 +281,12 @@ namespace network {
                         );
                 }
 
-                request &method(method md) {
+                request &method(http::method md) {
                     _method = md;
                     return *this;
                 }
 
-                method method() const {
+                http::method method() const {
                     return _method;
                 }
 
@@ -298,24 +313,23 @@ namespace network {
                     return (*this);
                 }
 
-                template <class Handler>
-                    void body(size_t len, Handler &&handler) {
-                        string body;
-                        _byte_source->read(body, len);
-                        handler(body);
-                    }
+                bool has_body() const {
+                    return static_cast<bool>(_byte_source);
+                }
 
-                request &append_header(string name, string value) {
-                    _headers.emplace_back(std::make_pair(name, value));
+                /* the body; shared by copies of the request, which read from the same position */
+                const std::shared_ptr<byte_source> &body() const {
+                    return _byte_source;
+                }
+
+                request &append_header(boost::string_ref name, boost::string_ref value) {
+                    _headers.append(name, value);
                     return (*this);
                 }
 
-                boost::optional<string> header(const string &name) {
-                    for (auto hdr : _headers) {
-                        if (boost::iequals(hdr.first, name))
-                            return hdr.second;
-                    }
-                    return boost::optional<string>();
+                /* the first value of the header, valid until the headers change */
+                boost::optional<boost::string_ref> header(boost::string_ref name) const {
+                    return _headers.find(name);
                 }
 
                 const_header_iterator headers_begin() const {
@@ -331,21 +345,51 @@ namespace network {
                         return boost::make_iterator_range(headers_begin(), headers_end());
                     }
 
-                void remove_header(const string &name) {
-                    auto it = std::remove_if(std::begin(_headers), std::end(_headers), 
-                        [&name] (const std::pair<string, string> &hdr) {
-                        return boost::iequals(hdr.first, name);
-                        });
-                    _headers.erase(it, std::end(_headers));
+                void remove_header(boost::string_ref name) {
+                    _headers.erase(name);
                 }
 
                 void clear_headers() {
-                    header_t().swap(_headers);
+                    _headers.clear();
+                }
+
+                allocator_type get_allocator() const {
+                    return _headers.get_allocator();
                 }
 
+                /*
+                 * Appends views over the request line and headers to `buffers`
+                 * (any container of boost::asio::const_buffer with push_back),
+                 * so the request can go out in one gather write without being
+                 * copied into an intermediate string. The views are valid until
+                 * the request is modified or destroyed; the body is not included.
+                 */
+                template <class Buffers>
+                    void to_buffers(Buffers &buffers) const {
+                        static const char version_prefix[] = " HTTP/";
+                        static const char separator[] = ": ";
+                        static const char crlf[] = "\r\n";
+
+                        const char *name = method_name(_method);
+                        buffers.push_back(boost::asio::buffer(name, std::char_traits<char>::length(name)));
+                        buffers.push_back(boost::asio::buffer(version_prefix, 1));
+                        buffers.push_back(boost::asio::buffer(_path));
+                        buffers.push_back(boost::asio::buffer(version_prefix, sizeof(version_prefix) - 1));
+                        buffers.push_back(boost::asio::buffer(_version));
+                        buffers.push_back(boost::asio::buffer(crlf, 2));
+
+                        for (auto hdr : _headers) {
+                            buffers.push_back(boost::asio::buffer(hdr.first.data(), hdr.first.size()));
+                            buffers.push_back(boost::asio::buffer(separator, 2));
+                            buffers.push_back(boost::asio::buffer(hdr.second.data(), hdr.second.size()));
+                            buffers.push_back(boost::asio::buffer(crlf, 2));
+                        }
+                        buffers.push_back(boost::asio::buffer(crlf, 2));
+                    }
+
             private:
                 network::uri   _url;
-                method         _method;
+                http::method   _method;
                 string         _path;
                 string         _version;
                 header_t       _headers;
@@ -357,8 +401,8 @@ namespace network {
                 friend std::ostream &operator << (std::ostream &os, const request &req) {
                     os << req._method << " " << req._path << " HTTP/" << req._version << "\r\n";
 
-                    for (auto hdr = req._headers.begin(); hdr != req._headers.end(); hrd++) {
-                        os << hdr.first << ": " << hdr.second << "\r\n";
+                    for (auto hdr = req._headers.begin(); hdr != req._headers.end(); hdr++) {
+                        os << hdr->first << ": " << hdr->second << "\r\n";
                     }
                     os << "\r\n";
 
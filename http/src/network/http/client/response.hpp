@@ -7,9 +7,12 @@
 #include <string>
 #include <future>
 #include <network/http/status.hpp>
+#include <network/http/header_map.hpp>
 #include <network/config.hpp>
 #include <network/uri.hpp>
 #include <boost/range/iterator_range.hpp>
+#include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
 
 
 namespace network {
@@ -17,17 +20,23 @@ namespace network {
         namespace client_message {
             class response {
                 public:
-                    using std::string;
-                    using std::vector;
-                    using network::http::status;
+                    typedef std::string string;
 
                 public:
-                    typedef vector<pair<string, string> > header_t;
+                    typedef network::http::header_map header_t;
                     typedef header_t::iterator header_iterator;
                     typedef header_t::const_iterator const_header_iterator;
+                    typedef header_t::allocator_type allocator_type;
+                    typedef std::basic_string<char, std::char_traits<char>, allocator_type> body_type;
 
                 public:
-                    response() { }
+                    response() : _status(status::code::ok) { }
+
+                    /* header and body storage is drawn from alloc, e.g. an exchange's arena */
+                    explicit response(const allocator_type &alloc) :
+                        _status(status::code::ok),
+                        _headers(alloc),
+                        _body(alloc) { }
 
                     response(const response &other) :
                         _version(other._version),
@@ -66,10 +75,6 @@ namespace network {
                         _version = ver;
                     }
 
-                    string version() const {
-                        return _version;
-                    }
-
                     const string &version() const {
                         return _version;
                     }
@@ -86,16 +91,30 @@ namespace network {
                         _status_msg = status_msg;
                     }
 
-                    string status_message() const {
+                    const string &status_message() const {
                         return _status_msg;
                     }
 
-                    const string &status_message() const {
-                        return _status_msg;
+                    void add_header(boost::string_ref name, boost::string_ref value) {
+                        _headers.append(name, value);
                     }
 
-                    void add_header(const string &name, const string &value) {
-                        _headers.push_back(std::make_pair(name, value));
+                    /* replaces every field called name with a single one */
+                    void set_header(boost::string_ref name, boost::string_ref value) {
+                        _headers.set(name, value);
+                    }
+
+                    void remove_header(boost::string_ref name) {
+                        _headers.erase(name);
+                    }
+
+                    void clear_headers() {
+                        _headers.clear();
+                    }
+
+                    /* the first value of the header, valid until the headers change */
+                    boost::optional<boost::string_ref> header(boost::string_ref name) const {
+                        return _headers.find(name);
                     }
 
                     const_header_iterator headers_begin() const {
@@ -108,11 +127,23 @@ namespace network {
 
                     boost::iterator_range<const_header_iterator>
                         headers() const {
-                            return boost::make_iterator_range(headers_begin(), headers());
+                            return boost::make_iterator_range(headers_begin(), headers_end());
                         }
 
-                    void append_body(const string &body) {
-                        _body.append(body);
+                    allocator_type get_allocator() const {
+                        return _headers.get_allocator();
+                    }
+
+                    void reserve_body(std::size_t len) {
+                        _body.reserve(len);
+                    }
+
+                    void append_body(boost::string_ref body) {
+                        _body.append(body.data(), body.size());
+                    }
+
+                    const body_type &body() const {
+                        return _body;
                     }
 
                 private:
@@ -120,7 +151,7 @@ namespace network {
                     status::code _status;
                     string       _status_msg;
                     header_t     _headers;
-                    string       _body;
+                    body_type    _body;
             };
             
             inline void swap(response &lhs, response &rhs) noexcept {
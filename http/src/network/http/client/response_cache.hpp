@@ -0,0 +1,503 @@
+#ifndef NETWORK_HTTP_CLIENT_RESPONSE_CACHE_INC
+#define NETWORK_HTTP_CLIENT_RESPONSE_CACHE_INC
+
+#include <string>
+#include <list>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+#include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <network/config.hpp>
+#include <network/http/method.hpp>
+#include <network/http/status.hpp>
+#include <network/http/client/request.hpp>
+#include <network/http/client/response.hpp>
+
+namespace network {
+    namespace http {
+        namespace client_message {
+            /*
+             * Parses an HTTP-date in its IMF-fixdate form, e.g. "Sun, 06 Nov
+             * 1994 08:49:37 GMT", the only one senders may generate.
+             */
+            inline bool parse_http_date(boost::string_ref value, std::chrono::system_clock::time_point &t) {
+                static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+                char weekday[4], month[4], zone[4];
+                int day, year, hour, minute, second;
+                std::string text(value.begin(), value.end());
+                if (std::sscanf(text.c_str(), "%3s, %2d %3s %4d %2d:%2d:%2d %3s",
+                        weekday, &day, month, &year, &hour, &minute, &second, zone) != 8 ||
+                    boost::string_ref(zone) != "GMT") {
+                    return false;
+                }
+                const char *m = std::strstr(months, month);
+                if (!m || (m - months) % 3 != 0 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+                    return false;
+                }
+
+                /* days since 1970-01-01 of a proleptic Gregorian date */
+                int mon = static_cast<int>(m - months) / 3 + 1;
+                int y = year - (mon <= 2);
+                int era = (y >= 0 ? y : y - 399) / 400;
+                int yoe = y - era * 400;
+                int doy = (153 * (mon + (mon > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+                int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+                long long days = static_cast<long long>(era) * 146097 + doe - 719468;
+
+                t = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                        std::chrono::seconds(days * 86400 + hour * 3600 + minute * 60 + second)));
+                return true;
+            }
+
+            /* the directives of Cache-Control headers that a private cache acts on */
+            struct cache_control {
+                cache_control() : no_store(false), no_cache(false) { }
+
+                template <class Message>
+                    explicit cache_control(const Message &message) : no_store(false), no_cache(false) {
+                        for (auto field : message.headers()) {
+                            if (header_name::equals(field.first, "Cache-Control")) {
+                                parse(field.second);
+                            } else if (header_name::equals(field.first, "Pragma") &&
+                                field.second.find("no-cache") != boost::string_ref::npos) {
+                                no_cache = true;
+                            }
+                        }
+                    }
+
+                void parse(boost::string_ref value) {
+                    while (!value.empty()) {
+                        auto comma = std::min(value.find(','), value.size());
+                        boost::string_ref directive = trim(value.substr(0, comma));
+                        value.remove_prefix(std::min(comma + 1, value.size()));
+
+                        auto equals = std::min(directive.find('='), directive.size());
+                        boost::string_ref name = trim(directive.substr(0, equals));
+                        if (header_name::equals(name, "no-store")) {
+                            no_store = true;
+                        } else if (header_name::equals(name, "no-cache")) {
+                            no_cache = true;
+                        } else if (header_name::equals(name, "max-age") && equals < directive.size()) {
+                            std::string seconds(directive.begin() + equals + 1, directive.end());
+                            if (seconds.size() > 1 && seconds.front() == '"') {
+                                seconds = seconds.substr(1, seconds.size() - 2);
+                            }
+                            max_age = std::chrono::seconds(std::strtoll(seconds.c_str(), nullptr, 10));
+                        }
+                    }
+                }
+
+                static boost::string_ref trim(boost::string_ref s) {
+                    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+                        s.remove_prefix(1);
+                    }
+                    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+                        s.remove_suffix(1);
+                    }
+                    return s;
+                }
+
+                bool no_store;
+                bool no_cache;
+                boost::optional<std::chrono::seconds> max_age;
+            };
+
+            struct response_cache_statistics {
+                /* answered from the cache without asking the server */
+                std::uint64_t hits;
+                /* sent with validators, and of those answered 304 Not Modified */
+                std::uint64_t revalidations;
+                std::uint64_t revalidated;
+                std::uint64_t misses;
+                std::uint64_t stored;
+                std::uint64_t evicted;
+                std::uint64_t invalidated;
+                std::size_t bytes;
+            };
+
+            /*
+             * class response_cache
+             *
+             * A private HTTP cache (RFC 9111) of responses to GET requests,
+             * by URL and the request headers their Vary names. Responses
+             * whose content codings the client undid are kept apart from
+             * those as sent, without their Content-Encoding. A response
+             * is fresh for its max-age, or until Expires, or for a tenth of
+             * the time since its Last-Modified, at most a day; one that is
+             * not has to be revalidated with the ETag and Last-Modified it
+             * came with, and a 304 Not Modified refreshes it. Cache-Control
+             * no-store and no-cache are honoured in requests and responses,
+             * as is max-age in requests. The responses take at most
+             * `max_bytes`, the least recently used are dropped first. It can
+             * be shared by any number of clients, on any thread.
+             */
+            class response_cache {
+                response_cache(const response_cache &) = delete;
+                response_cache &operator = (const response_cache &) = delete;
+
+            public:
+                typedef std::chrono::system_clock clock;
+
+                struct entry {
+                    response stored;
+                    std::string url;
+                    /* the values the request had of the headers the response varies on */
+                    std::vector<std::pair<std::string, boost::optional<std::string> > > vary;
+                    clock::time_point response_time;
+                    clock::duration initial_age;
+                    clock::duration lifetime;
+                    bool no_cache;
+                    /* stored is the body as decoded by the client */
+                    bool decoded;
+                    std::size_t size;
+                };
+                typedef std::shared_ptr<const entry> entry_ptr;
+
+                enum lookup_result { miss, fresh, stale };
+
+                explicit response_cache(std::size_t max_bytes = 64 * 1024 * 1024) :
+                    _max_bytes(max_bytes),
+                    _statistics() { }
+
+                /* whether req may be answered from, or stored in, a cache */
+                static bool cacheable(const request &req) {
+                    return req.method() == method::get && !req.has_body() && !req.header("Range") &&
+                        !cache_control(req).no_store;
+                }
+
+                /*
+                 * The entry for req, fresh or to be revalidated, among the
+                 * decoded or the raw responses. Requests with no-cache or
+                 * max-age=0 are never answered fresh.
+                 */
+                lookup_result lookup(const request &req, entry_ptr &found, bool decoded = false) {
+                    auto now = clock::now();
+                    std::string url = req.url().string();
+                    cache_control directives(req);
+
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    auto it = _index.find(url);
+                    if (it != _index.end()) {
+                        for (auto use : it->second) {
+                            const entry &e = **use;
+                            if (e.decoded != decoded || !matches(e, req)) {
+                                continue;
+                            }
+                            _uses.splice(_uses.begin(), _uses, use);
+                            found = *use;
+
+                            auto age = current_age(e, now);
+                            bool is_fresh = !e.no_cache && !directives.no_cache && age < e.lifetime &&
+                                (!directives.max_age || age <= *directives.max_age);
+                            ++(is_fresh ? _statistics.hits : _statistics.revalidations);
+                            return is_fresh ? fresh : stale;
+                        }
+                    }
+                    ++_statistics.misses;
+                    return miss;
+                }
+
+                /* adds the validators of e to req, false if it has none */
+                static bool add_validators(request &req, const entry &e) {
+                    bool added = false;
+                    if (auto etag = e.stored.header("ETag")) {
+                        req.append_header("If-None-Match", *etag);
+                        added = true;
+                    }
+                    if (auto modified = e.stored.header("Last-Modified")) {
+                        req.append_header("If-Modified-Since", *modified);
+                        added = true;
+                    }
+                    return added;
+                }
+
+                static void remove_validators(request &req) {
+                    req.remove_header("If-None-Match");
+                    req.remove_header("If-Modified-Since");
+                }
+
+                /* the response e holds, as served now */
+                static response serve(const entry &e) {
+                    response r(e.stored);
+                    auto age = std::chrono::duration_cast<std::chrono::seconds>(current_age(e, clock::now()));
+                    r.set_header("Age", std::to_string(age.count()));
+                    return r;
+                }
+
+                /*
+                 * Keeps r, the response to req, if it may be cached. It was
+                 * asked for at request_time and arrived at response_time.
+                 * With decoded, r is kept for lookups of decoded responses;
+                 * if its body was decoded, its Content-Encoding has to go and
+                 * its Content-Length has to be that of the decoded body.
+                 */
+                void store(const request &req, const response &r,
+                    clock::time_point request_time, clock::time_point response_time, bool decoded = false) {
+                    auto e = make_entry(req, r, request_time, response_time, decoded);
+                    if (e) {
+                        insert(std::move(e));
+                    }
+                }
+
+                /*
+                 * e was revalidated with not_modified: its headers are
+                 * updated from it and its age starts over. Returns the
+                 * response to deliver.
+                 */
+                response revalidated(const entry_ptr &e, const request &req, const response &not_modified,
+                    clock::time_point request_time, clock::time_point response_time) {
+                    /* the 304 describes the stored body, not one of its own */
+                    auto updates = [] (boost::string_ref name) {
+                        return !header_name::equals(name, "Content-Length") &&
+                            !header_name::equals(name, "Transfer-Encoding") &&
+                            !header_name::equals(name, "Content-Encoding");
+                    };
+                    /* rebuilt rather than set() field by field, which would grow its storage each time */
+                    response merged(e->stored);
+                    merged.clear_headers();
+                    for (auto field : e->stored.headers()) {
+                        if (!updates(field.first) || !not_modified.header(field.first)) {
+                            merged.add_header(field.first, field.second);
+                        }
+                    }
+                    for (auto field : not_modified.headers()) {
+                        if (updates(field.first)) {
+                            merged.add_header(field.first, field.second);
+                        }
+                    }
+
+                    auto updated = make_entry(req, merged, request_time, response_time, e->decoded);
+                    {
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        ++_statistics.revalidated;
+                    }
+                    if (updated) {
+                        insert(updated);
+                        return serve(*updated);
+                    }
+                    remove(e);
+                    return merged;
+                }
+
+                /* drops every response for url, e.g. after an unsafe request to it */
+                void invalidate(const std::string &url) {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    auto it = _index.find(url);
+                    if (it == _index.end()) {
+                        return;
+                    }
+                    for (auto use : it->second) {
+                        _statistics.bytes -= (*use)->size;
+                        _uses.erase(use);
+                        ++_statistics.invalidated;
+                    }
+                    _index.erase(it);
+                }
+
+                void clear() {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _index.clear();
+                    _uses.clear();
+                    _statistics.bytes = 0;
+                }
+
+                /* number of responses kept */
+                std::size_t size() const {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    return _uses.size();
+                }
+
+                response_cache_statistics statistics() const {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    return _statistics;
+                }
+
+            private:
+                typedef std::list<entry_ptr> uses;
+
+                static clock::duration current_age(const entry &e, clock::time_point now) {
+                    return e.initial_age + std::max(clock::duration::zero(), now - e.response_time);
+                }
+
+                static bool matches(const entry &e, const request &req) {
+                    for (const auto &v : e.vary) {
+                        auto value = req.header(v.first);
+                        if (static_cast<bool>(value) != static_cast<bool>(v.second) ||
+                            (value && *value != *v.second)) {
+                            return false;
+                        }
+                    }
+                    return true;
+                }
+
+                /* the status codes that may be cached without explicit freshness */
+                static bool heuristically_cacheable(status::code code) {
+                    switch (code) {
+                    case status::ok: case status::non_auth_info: case status::no_content:
+                    case status::multiple_choices: case status::moved_permanently:
+                    case status::permanent_redirect: case status::not_found:
+                    case status::method_not_allowed: case status::gone:
+                    case status::request_uri_too_long: case status::not_implemented:
+                        return true;
+                    default:
+                        return false;
+                    }
+                }
+
+                static std::shared_ptr<entry> make_entry(const request &req, const response &r,
+                    clock::time_point request_time, clock::time_point response_time, bool decoded) {
+                    cache_control directives(r);
+                    if (!cacheable(req) || directives.no_store || r.status() == status::partial_content ||
+                        r.status() == status::not_modified || r.status() < status::ok) {
+                        return nullptr;
+                    }
+
+                    auto e = std::make_shared<entry>();
+                    e->url = req.url().string();
+                    if (auto vary = r.header("Vary")) {
+                        boost::string_ref names = *vary;
+                        while (!names.empty()) {
+                            auto comma = std::min(names.find(','), names.size());
+                            boost::string_ref name = cache_control::trim(names.substr(0, comma));
+                            names.remove_prefix(std::min(comma + 1, names.size()));
+                            if (name == "*") {
+                                return nullptr;
+                            }
+                            if (name.empty()) {
+                                continue;
+                            }
+                            auto value = req.header(name);
+                            e->vary.emplace_back(std::string(name.begin(), name.end()),
+                                value ? boost::optional<std::string>(std::string(value->begin(), value->end())) :
+                                boost::none);
+                        }
+                    }
+
+                    /* age, RFC 9111 section 4.2.3 */
+                    clock::time_point date = response_time;
+                    if (auto value = r.header("Date")) {
+                        if (!parse_http_date(*value, date)) {
+                            date = response_time;
+                        }
+                    }
+                    clock::duration age_value = clock::duration::zero();
+                    if (auto value = r.header("Age")) {
+                        age_value = std::chrono::seconds(std::strtoll(std::string(value->begin(), value->end()).c_str(),
+                                nullptr, 10));
+                    }
+                    auto apparent_age = std::max(clock::duration::zero(), response_time - date);
+                    auto corrected_age = age_value + (response_time - request_time);
+                    e->initial_age = std::max(apparent_age, corrected_age);
+
+                    /* freshness lifetime, section 4.2.1, heuristics as in 4.2.2 */
+                    bool explicit_lifetime = true;
+                    clock::time_point expires;
+                    clock::time_point modified;
+                    if (directives.max_age) {
+                        e->lifetime = *directives.max_age;
+                    } else if (auto value = r.header("Expires")) {
+                        /* an invalid date is one in the past */
+                        e->lifetime = parse_http_date(*value, expires) ? expires - date : clock::duration::zero();
+                    } else {
+                        explicit_lifetime = false;
+                        e->lifetime = clock::duration::zero();
+                        auto last_modified = r.header("Last-Modified");
+                        if (last_modified && parse_http_date(*last_modified, modified) && modified < date) {
+                            e->lifetime = std::min<clock::duration>((date - modified) / 10, std::chrono::hours(24));
+                        }
+                    }
+                    if (!explicit_lifetime && !heuristically_cacheable(r.status())) {
+                        return nullptr;
+                    }
+
+                    e->no_cache = directives.no_cache;
+                    e->decoded = decoded;
+                    if ((e->no_cache || e->lifetime <= e->initial_age) &&
+                        !r.header("ETag") && !r.header("Last-Modified")) {
+                        /* never fresh, and nothing to revalidate it with */
+                        return nullptr;
+                    }
+
+                    e->stored = r;
+                    e->response_time = response_time;
+                    e->size = sizeof(entry) + e->url.size() + r.body().size();
+                    for (auto field : r.headers()) {
+                        e->size += field.first.size() + field.second.size();
+                    }
+                    return e;
+                }
+
+                void insert(std::shared_ptr<const entry> e) {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    if (e->size > _max_bytes) {
+                        return;
+                    }
+                    ++_statistics.stored;
+
+                    auto &variants = _index[e->url];
+                    for (auto it = variants.begin(); it != variants.end(); ++it) {
+                        if ((**it)->decoded == e->decoded && (**it)->vary == e->vary) {
+                            _statistics.bytes -= (**it)->size;
+                            _uses.erase(*it);
+                            variants.erase(it);
+                            break;
+                        }
+                    }
+                    _uses.push_front(e);
+                    variants.push_back(_uses.begin());
+                    _statistics.bytes += e->size;
+
+                    while (_statistics.bytes > _max_bytes) {
+                        erase(--_uses.end());
+                        ++_statistics.evicted;
+                    }
+                }
+
+                void remove(const entry_ptr &e) {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    auto it = _index.find(e->url);
+                    if (it == _index.end()) {
+                        return;
+                    }
+                    for (auto use : it->second) {
+                        if (*use == e) {
+                            erase(use);
+                            return;
+                        }
+                    }
+                }
+
+                /* called with _mutex held */
+                void erase(uses::iterator use) {
+                    auto it = _index.find((*use)->url);
+                    auto &variants = it->second;
+                    variants.erase(std::find(variants.begin(), variants.end(), use));
+                    if (variants.empty()) {
+                        _index.erase(it);
+                    }
+                    _statistics.bytes -= (*use)->size;
+                    _uses.erase(use);
+                }
+
+                std::size_t _max_bytes;
+                response_cache_statistics _statistics;
+                /* the responses, most recently used first */
+                uses _uses;
+                /* the responses by URL, one for each combination of the headers named by Vary */
+                std::unordered_map<std::string, std::vector<uses::iterator> > _index;
+                mutable std::mutex _mutex;
+            };
+        } // namespace client_message
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_RESPONSE_CACHE_INC
@@ -0,0 +1,477 @@
+#ifndef NETWORK_HTTP_CLIENT_RESPONSE_PARSER_INC
+#define NETWORK_HTTP_CLIENT_RESPONSE_PARSER_INC
+
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <network/config.hpp>
+#include <network/constants.hpp>
+#include <network/http/status.hpp>
+#include <network/http/header_scanner.hpp>
+
+namespace network {
+    namespace http {
+        namespace client_message {
+            /*
+             * class response_parser
+             *
+             * Resumable HTTP/1.1 response parser. parse() is fed the bytes
+             * received so far that it has not consumed yet, in chunks of any
+             * size, and reports the parts of the response to a handler as
+             * views into those bytes; it never copies or allocates. A line
+             * is only consumed once it is complete, so a caller keeps the
+             * unconsumed tail and passes it again, followed by new data.
+             *
+             * The handler must provide:
+             *
+             *   void on_status(string_ref version, status::code code, string_ref reason);
+             *   void on_header(string_ref name, string_ref value);
+             *   void on_headers_complete();
+             *   void on_body(string_ref data);
+             *   void on_trailer(string_ref name, string_ref value);
+             *
+             * The views are valid only during the call. An interim (1xx)
+             * response is reported like any other and followed by on_status
+             * for the final one. A handler that cannot take more body data
+             * for now calls pause() from on_body: parse() then returns at
+             * once and consumes nothing more until resume().
+             *
+             * A head, trailers included, of more than max_head bytes or
+             * max_fields header lines is an error, as is a line longer than
+             * max_line: a server cannot make the client keep any amount of
+             * headers.
+             */
+            class response_parser {
+            public:
+                typedef boost::string_ref string_ref;
+
+                enum state {
+                    status_line,
+                    header_line,
+                    body_fixed,
+                    body_until_close,
+                    chunk_size,
+                    chunk_data,
+                    chunk_data_end,
+                    trailer_line,
+                    complete,
+                    error,
+                };
+
+                explicit response_parser(std::size_t max_line = 64 * 1024,
+                    const header_scanner &scanner = active_header_scanner(),
+                    std::size_t max_head = 1024 * 1024,
+                    std::size_t max_fields = 1000) :
+                    _scanner(&scanner),
+                    _max_line(max_line),
+                    _max_head(max_head),
+                    _max_fields(max_fields) {
+                    reset();
+                }
+
+                /* prepares for the next response; HEAD responses carry no body */
+                void reset(bool expect_body = true) {
+                    _head_size = 0;
+                    _fields = 0;
+                    next_response(expect_body);
+                }
+
+                /* returns the number of bytes consumed from data */
+                template <class Handler>
+                    std::size_t parse(const char *data, std::size_t len, Handler &handler) {
+                        std::size_t consumed = 0;
+                        while (consumed < len && _state != complete && _state != error && !_paused) {
+                            const char *begin = data + consumed;
+                            std::size_t available = len - consumed;
+
+                            switch (_state) {
+                            case body_fixed:
+                            case chunk_data: {
+                                auto n = static_cast<std::size_t>(std::min<std::uint64_t>(available, _remaining));
+                                handler.on_body(string_ref(begin, n));
+                                consumed += n;
+                                _remaining -= n;
+                                if (_remaining == 0) {
+                                    _state = _state == body_fixed ? complete : chunk_data_end;
+                                }
+                                break;
+                            }
+
+                            case body_until_close:
+                                handler.on_body(string_ref(begin, available));
+                                consumed += available;
+                                break;
+
+                            default: {
+                                /*
+                                 * The first control character ends the line;
+                                 * anything but CRLF or a bare LF is invalid.
+                                 */
+                                const char *end = begin + available;
+                                const char *hit = _scanner->find_ctl(begin + _scanned, end);
+                                std::size_t line_len = hit - begin;
+                                if (hit == end || (*hit == '\r' && hit + 1 == end)) {
+                                    _scanned = line_len;
+                                    if (_scanned > _max_line) {
+                                        _state = error;
+                                    }
+                                    return consumed;
+                                }
+
+                                std::size_t terminator = *hit == '\r' ? 2 : 1;
+                                if (hit[terminator - 1] != '\n') {
+                                    _state = error;
+                                    break;
+                                }
+
+                                consumed += line_len + terminator;
+                                _scanned = 0;
+                                if (line_len > _max_line || !parse_line(string_ref(begin, line_len), handler)) {
+                                    _state = error;
+                                }
+                                break;
+                            }
+                            }
+                        }
+                        return consumed;
+                    }
+
+                /*
+                 * Tells the parser that the peer closed the connection. Returns
+                 * true if that ended the response (a body delimited by the
+                 * close), false if the response is truncated.
+                 */
+                bool eof() {
+                    if (_state == body_until_close) {
+                        _state = complete;
+                        return true;
+                    }
+                    if (_state != complete) {
+                        _state = error;
+                    }
+                    return _state == complete;
+                }
+
+                void pause() {
+                    _paused = true;
+                }
+
+                void resume() {
+                    _paused = false;
+                }
+
+                bool paused() const {
+                    return _paused;
+                }
+
+                state current() const {
+                    return _state;
+                }
+
+                bool is_complete() const {
+                    return _state == complete;
+                }
+
+                bool has_error() const {
+                    return _state == error;
+                }
+
+                /* true until the first byte of the status line is consumed */
+                bool is_idle() const {
+                    return _state == status_line && _scanned == 0;
+                }
+
+                /* whether the connection may carry another response after this one */
+                bool keep_alive() const {
+                    return !_close && (!_http_1_0 || _keep_alive);
+                }
+
+                boost::optional<std::uint64_t> content_length() const {
+                    return _content_length;
+                }
+
+                bool chunked() const {
+                    return _chunked;
+                }
+
+            private:
+                /* an interim response counts towards the limits of the final one */
+                void next_response(bool expect_body) {
+                    _state = status_line;
+                    _paused = false;
+                    _expect_body = expect_body;
+                    _scanned = 0;
+                    _status = 0;
+                    _http_1_0 = false;
+                    _chunked = false;
+                    _transfer_encoding = false;
+                    _close = false;
+                    _keep_alive = false;
+                    _content_length = boost::none;
+                    _remaining = 0;
+                }
+
+                template <class Handler>
+                    bool parse_line(string_ref line, Handler &handler) {
+                        if (_state == status_line || _state == header_line || _state == trailer_line) {
+                            _head_size += line.size() + 2;
+                            if (_head_size > _max_head ||
+                                (_state != status_line && !line.empty() && ++_fields > _max_fields)) {
+                                return false;
+                            }
+                        }
+
+                        switch (_state) {
+                        case status_line:
+                            return parse_status(line, handler);
+                        case header_line:
+                            if (line.empty()) {
+                                return headers_complete(handler);
+                            }
+                            return parse_header(line, handler, false);
+                        case chunk_size:
+                            return parse_chunk_size(line);
+                        case chunk_data_end:
+                            _state = chunk_size;
+                            return line.empty();
+                        case trailer_line:
+                            if (line.empty()) {
+                                _state = complete;
+                                return true;
+                            }
+                            return parse_header(line, handler, true);
+                        default:
+                            return false;
+                        }
+                    }
+
+                /* HTTP/1.1 200 OK */
+                template <class Handler>
+                    bool parse_status(string_ref line, Handler &handler) {
+                        static const std::size_t prefix = 5; // "HTTP/"
+                        if (line.size() < prefix + 7 ||
+                            !line.starts_with(constants::http_slash()) ||
+                            !is_digit(line[prefix]) || line[prefix + 1] != '.' || !is_digit(line[prefix + 2]) ||
+                            line[prefix + 3] != ' ' ||
+                            !is_digit(line[prefix + 4]) || !is_digit(line[prefix + 5]) || !is_digit(line[prefix + 6])) {
+                            return false;
+                        }
+                        if (line.size() > prefix + 7 && line[prefix + 7] != ' ') {
+                            return false;
+                        }
+
+                        _http_1_0 = line[prefix] == '1' && line[prefix + 2] == '0';
+                        _status = (line[prefix + 4] - '0') * 100 + (line[prefix + 5] - '0') * 10 + (line[prefix + 6] - '0');
+
+                        string_ref reason = line.size() > prefix + 8 ? line.substr(prefix + 8) : string_ref();
+                        handler.on_status(line.substr(prefix, 3), static_cast<status::code>(_status), reason);
+                        _state = header_line;
+                        return true;
+                    }
+
+                template <class Handler>
+                    bool parse_header(string_ref line, Handler &handler, bool trailer) {
+                        /*
+                         * The name must be a non-empty token directly followed
+                         * by ':', which also rejects obsolete line folding
+                         * (RFC 7230, 3.2.4).
+                         */
+                        const char *colon = _scanner->find_non_token(line.begin(), line.end());
+                        if (colon == line.begin() || colon == line.end() || *colon != ':') {
+                            return false;
+                        }
+
+                        string_ref name(line.begin(), colon - line.begin());
+                        string_ref value = trim(line.substr(name.size() + 1));
+
+                        if (trailer) {
+                            handler.on_trailer(name, value);
+                            return true;
+                        }
+
+                        if (equals_ignore_case(name, constants::content_length())) {
+                            std::uint64_t length = 0;
+                            if (!parse_decimal(value, length) ||
+                                (_content_length && *_content_length != length)) {
+                                return false;
+                            }
+                            _content_length = length;
+                        } else if (equals_ignore_case(name, constants::transfer_encoding())) {
+                            _transfer_encoding = true;
+                            _chunked = equals_ignore_case(last_token(value), constants::chunked());
+                        } else if (equals_ignore_case(name, constants::connection())) {
+                            _close = _close || contains_ignore_case(value, constants::close());
+                            _keep_alive = _keep_alive || contains_ignore_case(value, constants::keep_alive());
+                        }
+
+                        handler.on_header(name, value);
+                        return true;
+                    }
+
+                template <class Handler>
+                    bool headers_complete(Handler &handler) {
+                        handler.on_headers_complete();
+
+                        if (_status >= 100 && _status < 200 && _status != status::code::switch_protocols) {
+                            /* interim response, the final one follows */
+                            next_response(_expect_body);
+                            return true;
+                        }
+
+                        if (!_expect_body ||
+                            _status == status::code::no_content ||
+                            _status == status::code::not_modified ||
+                            _status == status::code::switch_protocols) {
+                            _state = complete;
+                        } else if (_chunked) {
+                            /*
+                             * Transfer-Encoding overrides Content-Length; a
+                             * response with both may be an attempt at response
+                             * splitting, so the connection is not reused
+                             * (RFC 9112, 6.3)
+                             */
+                            _close = _close || _content_length;
+                            _content_length = boost::none;
+                            _state = chunk_size;
+                        } else if (_transfer_encoding) {
+                            /* chunked is not the final coding: the body ends with the connection */
+                            _close = true;
+                            _content_length = boost::none;
+                            _state = body_until_close;
+                        } else if (_content_length) {
+                            _remaining = *_content_length;
+                            _state = _remaining == 0 ? complete : body_fixed;
+                        } else {
+                            _close = true;
+                            _state = body_until_close;
+                        }
+                        return true;
+                    }
+
+                /* chunk-size [ chunk-ext ] */
+                bool parse_chunk_size(string_ref line) {
+                    std::uint64_t size = 0;
+                    std::size_t digits = 0;
+                    for (; digits < line.size(); ++digits) {
+                        int value = hex_value(line[digits]);
+                        if (value < 0) {
+                            break;
+                        }
+                        if (size > (std::numeric_limits<std::uint64_t>::max() >> 4)) {
+                            return false;
+                        }
+                        size = (size << 4) | static_cast<std::uint64_t>(value);
+                    }
+                    if (digits == 0) {
+                        return false;
+                    }
+
+                    string_ref rest = trim(line.substr(digits));
+                    if (!rest.empty() && rest[0] != ';') {
+                        return false;
+                    }
+
+                    _remaining = size;
+                    _state = size == 0 ? trailer_line : chunk_data;
+                    return true;
+                }
+
+                static bool parse_decimal(string_ref value, std::uint64_t &result) {
+                    if (value.empty()) {
+                        return false;
+                    }
+                    result = 0;
+                    for (char c : value) {
+                        if (!is_digit(c) || result > (std::numeric_limits<std::uint64_t>::max() - 9) / 10) {
+                            return false;
+                        }
+                        result = result * 10 + static_cast<std::uint64_t>(c - '0');
+                    }
+                    return true;
+                }
+
+                /*
+                 * ASCII case-insensitive comparisons; header names and the
+                 * tokens looked for are ASCII, and boost::iequals goes through
+                 * std::locale for every character.
+                 */
+                static bool equals_ignore_case(string_ref lhs, string_ref rhs) {
+                    if (lhs.size() != rhs.size()) {
+                        return false;
+                    }
+                    for (std::size_t i = 0; i < lhs.size(); ++i) {
+                        if ((lhs[i] | 0x20) != (rhs[i] | 0x20)) {
+                            return false;
+                        }
+                    }
+                    return true;
+                }
+
+                static bool contains_ignore_case(string_ref value, string_ref token) {
+                    for (std::size_t i = 0; i + token.size() <= value.size(); ++i) {
+                        if (equals_ignore_case(value.substr(i, token.size()), token)) {
+                            return true;
+                        }
+                    }
+                    return false;
+                }
+
+                /* the last element of a comma-separated list */
+                static string_ref last_token(string_ref value) {
+                    auto comma = value.rfind(',');
+                    return trim(comma == string_ref::npos ? value : value.substr(comma + 1));
+                }
+
+                static string_ref trim(string_ref value) {
+                    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+                        value.remove_prefix(1);
+                    }
+                    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+                        value.remove_suffix(1);
+                    }
+                    return value;
+                }
+
+                static bool is_digit(char c) {
+                    return c >= '0' && c <= '9';
+                }
+
+                static int hex_value(char c) {
+                    if (c >= '0' && c <= '9') {
+                        return c - '0';
+                    }
+                    if (c >= 'a' && c <= 'f') {
+                        return c - 'a' + 10;
+                    }
+                    if (c >= 'A' && c <= 'F') {
+                        return c - 'A' + 10;
+                    }
+                    return -1;
+                }
+
+                state _state;
+                bool _paused;
+                const header_scanner *_scanner;
+                std::size_t _max_line;
+                std::size_t _max_head;
+                std::size_t _max_fields;
+                std::size_t _head_size;
+                std::size_t _fields;
+                std::size_t _scanned;
+                bool _expect_body;
+                int _status;
+                bool _http_1_0;
+                bool _chunked;
+                bool _transfer_encoding;
+                bool _close;
+                bool _keep_alive;
+                boost::optional<std::uint64_t> _content_length;
+                std::uint64_t _remaining;
+            };
+        } // namespace client_message
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_RESPONSE_PARSER_INC
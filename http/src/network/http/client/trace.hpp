@@ -0,0 +1,311 @@
+#ifndef NETWORK_HTTP_CLIENT_TRACE_INC
+#define NETWORK_HTTP_CLIENT_TRACE_INC
+
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <network/config.hpp>
+
+namespace network {
+    namespace http {
+        namespace client_message {
+            /*
+             * The state transitions of a request that the client traces
+             * when built with NETLIBX_ENABLE_TRACE. Those that end a step
+             * follow the one that began it; checkin is a connection going
+             * back to the pool, redirect a request sent on elsewhere.
+             * complete carries the status code, failed nothing.
+             */
+            enum class trace_event : std::uint8_t {
+                start,
+                checkout_start,
+                checkout_end,
+                resolve_start,
+                resolve_end,
+                connect_start,
+                connect_end,
+                write_start,
+                write_end,
+                first_byte,
+                checkin,
+                redirect,
+                complete,
+                failed
+            };
+
+            inline const char *trace_event_name(trace_event event) {
+                static const char *names[] = {
+                    "start", "checkout_start", "checkout_end", "resolve_start", "resolve_end",
+                    "connect_start", "connect_end", "write_start", "write_end", "first_byte",
+                    "checkin", "redirect", "complete", "failed"
+                };
+                return names[static_cast<std::size_t>(event)];
+            }
+
+            /* one event as written out by trace_buffer::drain(), 24 bytes */
+            struct trace_record {
+                /* nanoseconds of the steady clock */
+                std::uint64_t time;
+                std::uint64_t request;
+                std::uint32_t thread;
+                trace_event event;
+                std::uint8_t reserved;
+                std::uint16_t argument;
+            };
+
+            /* identifies a request across the threads of every client */
+            inline std::uint64_t next_trace_id() {
+                static std::atomic<std::uint64_t> next(1);
+                return next.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            /*
+             * class trace_buffer
+             *
+             * The last `capacity` events of one thread of a client, rounded
+             * up to a power of two. Adding one takes no lock and never
+             * waits: older events are overwritten once the buffer is full,
+             * and drain() tells how many were. A slot carries the position
+             * it was written at, so that drain() can skip one written over
+             * while it read it.
+             */
+            class trace_buffer {
+                trace_buffer(const trace_buffer &) = delete;
+                trace_buffer &operator = (const trace_buffer &) = delete;
+
+            public:
+                explicit trace_buffer(std::size_t capacity) :
+                    _slots(round_up(capacity)),
+                    _mask(_slots.size() - 1),
+                    _thread(next_thread()),
+                    _head(0),
+                    _drained(0) { }
+
+                void add(trace_event event, std::uint64_t request, std::uint16_t argument = 0) {
+                    std::uint64_t position = _head.fetch_add(1, std::memory_order_relaxed);
+                    slot &s = _slots[position & _mask];
+                    /* odd while being written */
+                    s.sequence.store(position * 2 + 1, std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_release);
+                    s.time.store(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now().time_since_epoch()).count()), std::memory_order_relaxed);
+                    s.request.store(request, std::memory_order_relaxed);
+                    s.detail.store(static_cast<std::uint32_t>(event) | static_cast<std::uint32_t>(argument) << 16,
+                        std::memory_order_relaxed);
+                    s.sequence.store(position * 2 + 2, std::memory_order_release);
+                }
+
+                /*
+                 * Appends the events added since the last drain to out,
+                 * oldest first; returns how many were lost, overwritten
+                 * before they could be read. Only one thread drains at a
+                 * time.
+                 */
+                std::uint64_t drain(std::vector<trace_record> &out) {
+                    std::uint64_t head = _head.load(std::memory_order_acquire);
+                    std::uint64_t from = _drained;
+                    std::uint64_t lost = 0;
+                    if (head - from > _slots.size()) {
+                        lost = head - from - _slots.size();
+                        from = head - _slots.size();
+                    }
+                    for (std::uint64_t position = from; position < head; ++position) {
+                        const slot &s = _slots[position & _mask];
+                        std::uint64_t sequence = s.sequence.load(std::memory_order_acquire);
+                        if (sequence < position * 2 + 2) {
+                            /* not written yet, the next drain starts here */
+                            head = position;
+                            break;
+                        }
+                        trace_record r;
+                        r.time = s.time.load(std::memory_order_relaxed);
+                        r.request = s.request.load(std::memory_order_relaxed);
+                        std::uint32_t detail = s.detail.load(std::memory_order_relaxed);
+                        std::atomic_thread_fence(std::memory_order_acquire);
+                        if (sequence != position * 2 + 2 || s.sequence.load(std::memory_order_relaxed) != sequence) {
+                            /* written over while it was read */
+                            ++lost;
+                            continue;
+                        }
+                        r.thread = _thread;
+                        r.event = static_cast<trace_event>(detail & 0xff);
+                        r.reserved = 0;
+                        r.argument = static_cast<std::uint16_t>(detail >> 16);
+                        out.push_back(r);
+                    }
+                    _drained = head;
+                    return lost;
+                }
+
+                std::size_t capacity() const {
+                    return _slots.size();
+                }
+
+            private:
+                struct slot {
+                    slot() : sequence(0), time(0), request(0), detail(0) { }
+
+                    std::atomic<std::uint64_t> sequence;
+                    std::atomic<std::uint64_t> time;
+                    std::atomic<std::uint64_t> request;
+                    std::atomic<std::uint32_t> detail;
+                };
+
+                static std::size_t round_up(std::size_t capacity) {
+                    std::size_t size = 1;
+                    while (size < capacity) {
+                        size <<= 1;
+                    }
+                    return size;
+                }
+
+                static std::uint32_t next_thread() {
+                    static std::atomic<std::uint32_t> next(1);
+                    return next.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                std::vector<slot> _slots;
+                std::size_t _mask;
+                std::uint32_t _thread;
+                std::atomic<std::uint64_t> _head;
+                std::uint64_t _drained;
+            };
+
+            /*
+             * A trace file is "NLXTRACE", the format version, then the
+             * records as they are in memory: it is read back on the
+             * machine that wrote it.
+             */
+            static const char trace_file_magic[8] = { 'N', 'L', 'X', 'T', 'R', 'A', 'C', 'E' };
+            enum : std::uint32_t { trace_file_version = 1 };
+
+            inline void write_trace_header(std::ostream &out) {
+                std::uint32_t version = trace_file_version;
+                out.write(trace_file_magic, sizeof(trace_file_magic));
+                out.write(reinterpret_cast<const char *>(&version), sizeof(version));
+            }
+
+            inline void write_trace_records(std::ostream &out, const std::vector<trace_record> &records) {
+                out.write(reinterpret_cast<const char *>(records.data()),
+                    static_cast<std::streamsize>(records.size() * sizeof(trace_record)));
+            }
+
+            /* the records of a trace file, false if it is not one */
+            inline bool read_trace(std::istream &in, std::vector<trace_record> &records) {
+                char magic[sizeof(trace_file_magic)];
+                std::uint32_t version = 0;
+                if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, trace_file_magic, sizeof(magic)) != 0 ||
+                    !in.read(reinterpret_cast<char *>(&version), sizeof(version)) || version != trace_file_version) {
+                    return false;
+                }
+                trace_record r;
+                while (in.read(reinterpret_cast<char *>(&r), sizeof(r))) {
+                    records.push_back(r);
+                }
+                return true;
+            }
+
+            /*
+             * The records in the Chrome trace event format, which
+             * chrome://tracing and Perfetto open. A client thread is a
+             * process and a request a thread of it. Each step is a
+             * complete event from the event that began it to the one that
+             * ended it; waiting runs from the end of the write to the first
+             * byte, body from there to the end. Checkins and redirects are
+             * instant events.
+             */
+            inline void write_chrome_trace(std::ostream &out, const std::vector<trace_record> &records) {
+                struct request_state {
+                    std::uint64_t began[static_cast<std::size_t>(trace_event::failed) + 1];
+                };
+                std::map<std::pair<std::uint32_t, std::uint64_t>, request_state> requests;
+                std::uint64_t origin = records.empty() ? 0 : records.front().time;
+                for (const auto &r : records) {
+                    origin = std::min(origin, r.time);
+                }
+
+                bool first = true;
+                auto emit = [&] (const trace_record &r, const char *name, const char *phase,
+                    std::uint64_t from, const std::string &args) {
+                    out << (first ? "\n" : ",\n");
+                    first = false;
+                    out << "{\"name\":\"" << name << "\",\"ph\":\"" << phase << "\",\"pid\":" << r.thread
+                        << ",\"tid\":" << r.request << ",\"ts\":" << (from - origin) / 1000.0;
+                    if (*phase == 'X') {
+                        out << ",\"dur\":" << (r.time - from) / 1000.0;
+                    } else {
+                        out << ",\"s\":\"t\"";
+                    }
+                    if (!args.empty()) {
+                        out << ",\"args\":{" << args << "}";
+                    }
+                    out << "}";
+                };
+
+                out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+                for (const auto &r : records) {
+                    request_state &state = requests[std::make_pair(r.thread, r.request)];
+                    state.began[static_cast<std::size_t>(r.event)] = r.time;
+                    auto began = [&state] (trace_event e) {
+                        return state.began[static_cast<std::size_t>(e)];
+                    };
+                    switch (r.event) {
+                    case trace_event::checkout_end:
+                        if (began(trace_event::checkout_start)) {
+                            emit(r, "pool wait", "X", began(trace_event::checkout_start), std::string());
+                        }
+                        break;
+                    case trace_event::resolve_end:
+                        if (began(trace_event::resolve_start)) {
+                            emit(r, "resolve", "X", began(trace_event::resolve_start), std::string());
+                        }
+                        break;
+                    case trace_event::connect_end:
+                        if (began(trace_event::connect_start)) {
+                            emit(r, "connect", "X", began(trace_event::connect_start), std::string());
+                        }
+                        break;
+                    case trace_event::write_end:
+                        if (began(trace_event::write_start)) {
+                            emit(r, "write", "X", began(trace_event::write_start), std::string());
+                        }
+                        break;
+                    case trace_event::first_byte:
+                        if (began(trace_event::write_end)) {
+                            emit(r, "waiting", "X", began(trace_event::write_end), std::string());
+                        }
+                        break;
+                    case trace_event::checkin:
+                    case trace_event::redirect:
+                        emit(r, trace_event_name(r.event), "i", r.time, std::string());
+                        break;
+                    case trace_event::complete:
+                    case trace_event::failed:
+                        if (began(trace_event::first_byte)) {
+                            emit(r, "body", "X", began(trace_event::first_byte), std::string());
+                        }
+                        if (began(trace_event::start)) {
+                            emit(r, "request", "X", began(trace_event::start), r.event == trace_event::complete ?
+                                "\"status\":" + std::to_string(r.argument) : std::string("\"failed\":true"));
+                        }
+                        requests.erase(std::make_pair(r.thread, r.request));
+                        break;
+                    default:
+                        break;
+                    }
+                }
+                out << "\n]}\n";
+            }
+        } // namespace client_message
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_CLIENT_TRACE_INC
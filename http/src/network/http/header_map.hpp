@@ -0,0 +1,421 @@
+#ifndef NETWORK_HTTP_HEADER_MAP_INC
+#define NETWORK_HTTP_HEADER_MAP_INC
+
+#include <array>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/container/small_vector.hpp>
+#include <network/config.hpp>
+#include <network/http/arena.hpp>
+
+namespace network {
+    namespace http {
+        namespace header_name {
+            /*
+             * Header names with a fixed slot in header_map: lookups of these
+             * by id, or by a name that hashes to one of them, do not scan.
+             */
+            enum known {
+                host,
+                content_length,
+                transfer_encoding,
+                connection,
+                content_type,
+                content_encoding,
+                accept,
+                accept_encoding,
+                user_agent,
+                location,
+                date,
+                cache_control,
+                expires,
+                etag,
+                last_modified,
+                if_none_match,
+                if_modified_since,
+                vary,
+                age,
+                pragma,
+                known_count,
+            };
+
+            constexpr char lower(char c) {
+                return (c >= 'A' && c <= 'Z') ? static_cast<char>(c | 0x20) : c;
+            }
+
+            /* case-insensitive FNV-1a, usable in constant expressions */
+            constexpr std::uint32_t hash(const char *name, std::uint32_t h = 2166136261u) {
+                return *name == 0 ? h :
+                    hash(name + 1, (h ^ static_cast<unsigned char>(lower(*name))) * 16777619u);
+            }
+
+            inline std::uint32_t hash(boost::string_ref name) {
+                std::uint32_t h = 2166136261u;
+                for (char c : name) {
+                    h = (h ^ static_cast<unsigned char>(lower(c))) * 16777619u;
+                }
+                return h;
+            }
+
+            inline bool equals(boost::string_ref lhs, boost::string_ref rhs) {
+                if (lhs.size() != rhs.size()) {
+                    return false;
+                }
+                for (std::size_t i = 0; i < lhs.size(); ++i) {
+                    if (lower(lhs[i]) != lower(rhs[i])) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            inline const char *name(known id) {
+                static const char *const names[known_count] = {
+                    "Host", "Content-Length", "Transfer-Encoding", "Connection", "Content-Type",
+                    "Content-Encoding", "Accept", "Accept-Encoding", "User-Agent", "Location",
+                    "Date", "Cache-Control", "Expires", "ETag", "Last-Modified",
+                    "If-None-Match", "If-Modified-Since", "Vary", "Age", "Pragma",
+                };
+                return names[id];
+            }
+
+            /* maps a name to its known id, or known_count */
+            inline known identify(boost::string_ref name, std::uint32_t h) {
+                known id = known_count;
+                switch (h) {
+                case hash("host"):              id = host; break;
+                case hash("content-length"):    id = content_length; break;
+                case hash("transfer-encoding"): id = transfer_encoding; break;
+                case hash("connection"):        id = connection; break;
+                case hash("content-type"):      id = content_type; break;
+                case hash("content-encoding"):  id = content_encoding; break;
+                case hash("accept"):            id = accept; break;
+                case hash("accept-encoding"):   id = accept_encoding; break;
+                case hash("user-agent"):        id = user_agent; break;
+                case hash("location"):          id = location; break;
+                case hash("date"):              id = date; break;
+                case hash("cache-control"):     id = cache_control; break;
+                case hash("expires"):           id = expires; break;
+                case hash("etag"):              id = etag; break;
+                case hash("last-modified"):     id = last_modified; break;
+                case hash("if-none-match"):     id = if_none_match; break;
+                case hash("if-modified-since"): id = if_modified_since; break;
+                case hash("vary"):              id = vary; break;
+                case hash("age"):               id = age; break;
+                case hash("pragma"):            id = pragma; break;
+                default:
+                    return known_count;
+                }
+                return equals(name, header_name::name(id)) ? id : known_count;
+            }
+        } // namespace header_name
+
+        /*
+         * class header_map
+         *
+         * Ordered, case-insensitive multimap of header fields used by
+         * request and response. Names and values are stored back to back in
+         * one character buffer with a small inline capacity, and each field
+         * records offsets into it together with the hash of its name, so
+         * copying the map copies two flat arrays and lookups never allocate.
+         * Views handed out are valid until the map is modified.
+         *
+         * Storage that outgrows the inline capacity comes from the
+         * allocator, which may draw from an exchange's arena.
+         */
+        class header_map {
+        public:
+            typedef boost::string_ref string_ref;
+            typedef std::pair<string_ref, string_ref> value_type;
+            typedef arena_allocator<char> allocator_type;
+
+        private:
+            struct field {
+                std::uint32_t name_offset;
+                std::uint32_t name_length;
+                std::uint32_t value_offset;
+                std::uint32_t value_length;
+                std::uint32_t hash;
+                /* a peer decides how many fields there are: this must not wrap */
+                std::uint32_t next_known;
+            };
+
+            enum : std::uint32_t { npos = 0xffffffff };
+
+        public:
+            class const_iterator : public boost::iterator_facade<
+                const_iterator, value_type, boost::random_access_traversal_tag, value_type> {
+            public:
+                const_iterator() : _map(nullptr), _index(0) { }
+
+            private:
+                friend class header_map;
+                friend class boost::iterator_core_access;
+
+                const_iterator(const header_map *map, std::size_t index) :
+                    _map(map), _index(index) { }
+
+                value_type dereference() const {
+                    return _map->at(_index);
+                }
+
+                bool equal(const const_iterator &other) const {
+                    return _index == other._index;
+                }
+
+                void increment() {
+                    ++_index;
+                }
+
+                void decrement() {
+                    --_index;
+                }
+
+                void advance(std::ptrdiff_t n) {
+                    _index += n;
+                }
+
+                std::ptrdiff_t distance_to(const const_iterator &other) const {
+                    return static_cast<std::ptrdiff_t>(other._index) - static_cast<std::ptrdiff_t>(_index);
+                }
+
+                const header_map *_map;
+                std::size_t _index;
+            };
+            typedef const_iterator iterator;
+
+            header_map() :
+                _dead(0) {
+                _first_known.fill(npos);
+                _last_known.fill(npos);
+            }
+
+            explicit header_map(const allocator_type &alloc) :
+                _fields(field_vector::allocator_type(arena_allocator<field>(alloc))),
+                _storage(storage_vector::allocator_type(alloc)),
+                _dead(0) {
+                _first_known.fill(npos);
+                _last_known.fill(npos);
+            }
+
+            allocator_type get_allocator() const {
+                return allocator_type(_storage.get_allocator());
+            }
+
+            void append(string_ref name, string_ref value) {
+                field f;
+                f.hash = header_name::hash(name);
+                f.name_offset = store(name);
+                f.name_length = static_cast<std::uint32_t>(name.size());
+                f.value_offset = store(value);
+                f.value_length = static_cast<std::uint32_t>(value.size());
+                f.next_known = npos;
+
+                header_name::known id = header_name::identify(name, f.hash);
+                if (id != header_name::known_count) {
+                    /* keep the per-name chain in insertion order */
+                    auto index = static_cast<std::uint32_t>(_fields.size());
+                    if (_first_known[id] == npos) {
+                        _first_known[id] = index;
+                    } else {
+                        _fields[_last_known[id]].next_known = index;
+                    }
+                    _last_known[id] = index;
+                }
+                _fields.push_back(f);
+            }
+
+            /* replaces every field called name with a single one */
+            void set(string_ref name, string_ref value) {
+                erase(name);
+                append(name, value);
+            }
+
+            boost::optional<string_ref> find(header_name::known id) const {
+                if (_first_known[id] == npos) {
+                    return boost::none;
+                }
+                return value(_fields[_first_known[id]]);
+            }
+
+            /* the first value of the field called name */
+            boost::optional<string_ref> find(string_ref name) const {
+                std::uint32_t h = header_name::hash(name);
+                header_name::known id = header_name::identify(name, h);
+                if (id != header_name::known_count) {
+                    return find(id);
+                }
+                for (const auto &f : _fields) {
+                    if (f.hash == h && header_name::equals(this->name(f), name)) {
+                        return value(f);
+                    }
+                }
+                return boost::none;
+            }
+
+            bool contains(string_ref name) const {
+                return static_cast<bool>(find(name));
+            }
+
+            /* calls visitor(value) for every field called name, in order */
+            template <class Visitor>
+                void for_each(string_ref name, Visitor visitor) const {
+                    std::uint32_t h = header_name::hash(name);
+                    header_name::known id = header_name::identify(name, h);
+                    if (id != header_name::known_count) {
+                        for (auto i = _first_known[id]; i != npos; i = _fields[i].next_known) {
+                            visitor(value(_fields[i]));
+                        }
+                        return;
+                    }
+                    for (const auto &f : _fields) {
+                        if (f.hash == h && header_name::equals(this->name(f), name)) {
+                            visitor(value(f));
+                        }
+                    }
+                }
+
+            std::size_t count(string_ref name) const {
+                std::size_t n = 0;
+                for_each(name, [&n] (string_ref) { ++n; });
+                return n;
+            }
+
+            /*
+             * removes every field called name, returns how many were removed;
+             * the bytes they leave in the storage are reclaimed once they
+             * outweigh those of the remaining fields
+             */
+            std::size_t erase(string_ref name) {
+                std::uint32_t h = header_name::hash(name);
+                std::size_t dead = 0;
+                auto it = std::remove_if(_fields.begin(), _fields.end(), [&] (const field &f) {
+                        if (f.hash == h && header_name::equals(this->name(f), name)) {
+                            dead += f.name_length + f.value_length;
+                            return true;
+                        }
+                        return false;
+                    });
+                std::size_t removed = _fields.end() - it;
+                if (removed != 0) {
+                    _fields.erase(it, _fields.end());
+                    _dead += dead;
+                    if (_dead > _storage.size() - _dead) {
+                        compact();
+                    }
+                    reindex();
+                }
+                return removed;
+            }
+
+            void clear() {
+                _fields.clear();
+                _storage.clear();
+                _dead = 0;
+                _first_known.fill(npos);
+            }
+
+            void reserve(std::size_t fields, std::size_t bytes) {
+                _fields.reserve(fields);
+                _storage.reserve(bytes);
+            }
+
+            std::size_t size() const {
+                return _fields.size();
+            }
+
+            bool empty() const {
+                return _fields.empty();
+            }
+
+            value_type at(std::size_t index) const {
+                return value_type(name(_fields[index]), value(_fields[index]));
+            }
+
+            const_iterator begin() const {
+                return const_iterator(this, 0);
+            }
+
+            const_iterator end() const {
+                return const_iterator(this, _fields.size());
+            }
+
+            void swap(header_map &other) {
+                using std::swap;
+                swap(_fields, other._fields);
+                swap(_storage, other._storage);
+                swap(_dead, other._dead);
+                swap(_first_known, other._first_known);
+                swap(_last_known, other._last_known);
+            }
+
+        private:
+            std::uint32_t store(string_ref s) {
+                auto offset = static_cast<std::uint32_t>(_storage.size());
+                _storage.insert(_storage.end(), s.begin(), s.end());
+                return offset;
+            }
+
+            string_ref name(const field &f) const {
+                return string_ref(_storage.data() + f.name_offset, f.name_length);
+            }
+
+            string_ref value(const field &f) const {
+                return string_ref(_storage.data() + f.value_offset, f.value_length);
+            }
+
+            /* moves the bytes of the remaining fields to the front of a new storage */
+            void compact() {
+                storage_vector live(_storage.get_allocator());
+                live.reserve(_storage.size() - _dead);
+                for (auto &f : _fields) {
+                    string_ref n = name(f), v = value(f);
+                    f.name_offset = static_cast<std::uint32_t>(live.size());
+                    live.insert(live.end(), n.begin(), n.end());
+                    f.value_offset = static_cast<std::uint32_t>(live.size());
+                    live.insert(live.end(), v.begin(), v.end());
+                }
+                _storage.swap(live);
+                _dead = 0;
+            }
+
+            void reindex() {
+                _first_known.fill(npos);
+                for (std::size_t i = 0; i < _fields.size(); ++i) {
+                    _fields[i].next_known = npos;
+                    header_name::known id = header_name::identify(name(_fields[i]), _fields[i].hash);
+                    if (id != header_name::known_count) {
+                        auto index = static_cast<std::uint32_t>(i);
+                        if (_first_known[id] == npos) {
+                            _first_known[id] = index;
+                        } else {
+                            _fields[_last_known[id]].next_known = index;
+                        }
+                        _last_known[id] = index;
+                    }
+                }
+            }
+
+            typedef boost::container::small_vector<field, 16, arena_allocator<field> > field_vector;
+            typedef boost::container::small_vector<char, 512, allocator_type> storage_vector;
+
+            field_vector _fields;
+            storage_vector _storage;
+            /* bytes of erased fields still in _storage */
+            std::size_t _dead;
+            std::array<std::uint32_t, header_name::known_count> _first_known;
+            /* the end of each chain, valid where _first_known is not npos */
+            std::array<std::uint32_t, header_name::known_count> _last_known;
+        };
+
+        inline void swap(header_map &lhs, header_map &rhs) {
+            lhs.swap(rhs);
+        }
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_HEADER_MAP_INC
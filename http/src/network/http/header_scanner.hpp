@@ -0,0 +1,218 @@
+#ifndef NETWORK_HTTP_HEADER_SCANNER_INC
+#define NETWORK_HTTP_HEADER_SCANNER_INC
+
+#include <cstdint>
+#include <network/config.hpp>
+
+#if !defined(NETLIBX_DISABLE_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NETLIBX_HEADER_SCANNER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace network {
+    namespace http {
+        /*
+         * Scanning kernels used when parsing message heads. Each takes a
+         * byte range and returns a pointer to the first byte of interest,
+         * or `end` if there is none:
+         *
+         *   find_ctl       - first control character other than HTAB (this
+         *                    includes CR, LF and DEL); in a valid status or
+         *                    header line the first hit is the line ending.
+         *   find_non_token - first byte that is not a tchar (RFC 7230,
+         *                    3.2.6); in a valid header line that is the ':'.
+         *
+         * Vector versions (SSE4.2, AVX2) are selected at run time from what
+         * the CPU supports; NETLIBX_DISABLE_SIMD forces the scalar one.
+         */
+        struct header_scanner {
+            typedef const char *(*scan_function)(const char *begin, const char *end);
+
+            const char   *name;
+            scan_function find_ctl;
+            scan_function find_non_token;
+        };
+
+        namespace header_scan {
+            struct tables {
+                bool ctl[256];
+                bool token[256];
+
+                tables() {
+                    for (int c = 0; c < 256; ++c) {
+                        ctl[c] = (c < 0x20 && c != '\t') || c == 0x7f;
+                        token[c] = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+                    }
+                    for (const char *p = "!#$%&'*+-.^_`|~"; *p; ++p) {
+                        token[static_cast<unsigned char>(*p)] = true;
+                    }
+                }
+            };
+
+            inline const tables &lookup() {
+                static const tables instance;
+                return instance;
+            }
+
+            inline const char *scalar_find_ctl(const char *begin, const char *end) {
+                const bool *ctl = lookup().ctl;
+                for (; begin != end; ++begin) {
+                    if (ctl[static_cast<unsigned char>(*begin)]) {
+                        break;
+                    }
+                }
+                return begin;
+            }
+
+            inline const char *scalar_find_non_token(const char *begin, const char *end) {
+                const bool *token = lookup().token;
+                for (; begin != end; ++begin) {
+                    if (!token[static_cast<unsigned char>(*begin)]) {
+                        break;
+                    }
+                }
+                return begin;
+            }
+
+#if defined(NETLIBX_HEADER_SCANNER_X86)
+            /*
+             * tchar classification with two 16-entry tables indexed by the low
+             * and high nibble of each byte: a byte is a token character iff
+             * low[c & 0xf] & high[c >> 4] is non-zero. Each bit stands for the
+             * set of token low nibbles shared by one high nibble (0x2_ .. 0x7_).
+             */
+#define NETLIBX_TOKEN_LOW_NIBBLES \
+    0x3a, 0x3f, 0x3e, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3e, 0x3e, 0x3d, 0x15, 0x34, 0x15, 0x3d, 0x1c
+#define NETLIBX_TOKEN_HIGH_NIBBLES \
+    0x00, 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+
+            __attribute__((target("sse4.2")))
+            inline const char *sse42_find_ctl(const char *begin, const char *end) {
+                /* 0x00-0x08, 0x0a-0x1f, 0x7f */
+                static const char ranges[16] = { '\x00', '\x08', '\x0a', '\x1f', '\x7f', '\x7f' };
+                const __m128i set = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ranges));
+
+                while (end - begin >= 16) {
+                    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+                    int index = _mm_cmpestri(set, 6, block, 16,
+                        _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+                    if (index != 16) {
+                        return begin + index;
+                    }
+                    begin += 16;
+                }
+                return scalar_find_ctl(begin, end);
+            }
+
+            __attribute__((target("sse4.2")))
+            inline const char *sse42_find_non_token(const char *begin, const char *end) {
+                const __m128i low = _mm_setr_epi8(NETLIBX_TOKEN_LOW_NIBBLES);
+                const __m128i high = _mm_setr_epi8(NETLIBX_TOKEN_HIGH_NIBBLES);
+                const __m128i nibble = _mm_set1_epi8(0x0f);
+                const __m128i zero = _mm_setzero_si128();
+
+                while (end - begin >= 16) {
+                    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+                    __m128i lo = _mm_shuffle_epi8(low, _mm_and_si128(block, nibble));
+                    __m128i hi = _mm_shuffle_epi8(high, _mm_and_si128(_mm_srli_epi16(block, 4), nibble));
+                    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), zero));
+                    if (mask != 0) {
+                        return begin + __builtin_ctz(mask);
+                    }
+                    begin += 16;
+                }
+                return scalar_find_non_token(begin, end);
+            }
+
+            __attribute__((target("avx2")))
+            inline const char *avx2_find_ctl(const char *begin, const char *end) {
+                const __m256i space = _mm256_set1_epi8(0x20);
+                const __m256i tab = _mm256_set1_epi8('\t');
+                const __m256i del = _mm256_set1_epi8(0x7f);
+                const __m256i minus_one = _mm256_set1_epi8(-1);
+
+                while (end - begin >= 32) {
+                    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin));
+                    /* signed compares: bytes >= 0x80 are negative and allowed (obs-text) */
+                    __m256i below_space = _mm256_and_si256(
+                        _mm256_cmpgt_epi8(space, block), _mm256_cmpgt_epi8(block, minus_one));
+                    __m256i ctl = _mm256_or_si256(
+                        _mm256_andnot_si256(_mm256_cmpeq_epi8(block, tab), below_space),
+                        _mm256_cmpeq_epi8(block, del));
+                    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(ctl));
+                    if (mask != 0) {
+                        return begin + __builtin_ctz(mask);
+                    }
+                    begin += 32;
+                }
+                return scalar_find_ctl(begin, end);
+            }
+
+            __attribute__((target("avx2")))
+            inline const char *avx2_find_non_token(const char *begin, const char *end) {
+                const __m256i low = _mm256_setr_epi8(NETLIBX_TOKEN_LOW_NIBBLES, NETLIBX_TOKEN_LOW_NIBBLES);
+                const __m256i high = _mm256_setr_epi8(NETLIBX_TOKEN_HIGH_NIBBLES, NETLIBX_TOKEN_HIGH_NIBBLES);
+                const __m256i nibble = _mm256_set1_epi8(0x0f);
+                const __m256i zero = _mm256_setzero_si256();
+
+                while (end - begin >= 32) {
+                    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin));
+                    __m256i lo = _mm256_shuffle_epi8(low, _mm256_and_si256(block, nibble));
+                    __m256i hi = _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble));
+                    unsigned mask = static_cast<unsigned>(
+                        _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), zero)));
+                    if (mask != 0) {
+                        return begin + __builtin_ctz(mask);
+                    }
+                    begin += 32;
+                }
+                return sse42_find_non_token(begin, end);
+            }
+
+#undef NETLIBX_TOKEN_LOW_NIBBLES
+#undef NETLIBX_TOKEN_HIGH_NIBBLES
+#endif // defined(NETLIBX_HEADER_SCANNER_X86)
+        } // namespace header_scan
+
+        inline const header_scanner &scalar_header_scanner() {
+            static const header_scanner scanner = {
+                "scalar", header_scan::scalar_find_ctl, header_scan::scalar_find_non_token
+            };
+            return scanner;
+        }
+
+        /* returns nullptr when the CPU or the build does not support it */
+        inline const header_scanner *sse42_header_scanner() {
+#if defined(NETLIBX_HEADER_SCANNER_X86)
+            static const header_scanner scanner = {
+                "sse4.2", header_scan::sse42_find_ctl, header_scan::sse42_find_non_token
+            };
+            return __builtin_cpu_supports("sse4.2") ? &scanner : nullptr;
+#else
+            return nullptr;
+#endif // defined(NETLIBX_HEADER_SCANNER_X86)
+        }
+
+        inline const header_scanner *avx2_header_scanner() {
+#if defined(NETLIBX_HEADER_SCANNER_X86)
+            static const header_scanner scanner = {
+                "avx2", header_scan::avx2_find_ctl, header_scan::avx2_find_non_token
+            };
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("sse4.2") ? &scanner : nullptr;
+#else
+            return nullptr;
+#endif // defined(NETLIBX_HEADER_SCANNER_X86)
+        }
+
+        /* the best scanner for this CPU, chosen on first use */
+        inline const header_scanner &active_header_scanner() {
+            static const header_scanner &scanner =
+                avx2_header_scanner() ? *avx2_header_scanner() :
+                sse42_header_scanner() ? *sse42_header_scanner() :
+                scalar_header_scanner();
+            return scanner;
+        }
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_HEADER_SCANNER_INC
@@ -0,0 +1,207 @@
+#ifndef NETWORK_HTTP_HTTP2_FRAME_INC
+#define NETWORK_HTTP_HTTP2_FRAME_INC
+
+#include <string>
+#include <cstdint>
+#include <boost/system/error_code.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <network/config.hpp>
+
+namespace network {
+    namespace http {
+        namespace http2 {
+            /*
+             * HTTP/2 framing (RFC 9113, section 4 and 6).
+             */
+            enum class frame_type : std::uint8_t {
+                data = 0x0,
+                headers = 0x1,
+                priority = 0x2,
+                rst_stream = 0x3,
+                settings = 0x4,
+                push_promise = 0x5,
+                ping = 0x6,
+                goaway = 0x7,
+                window_update = 0x8,
+                continuation = 0x9,
+            };
+
+            namespace frame_flags {
+                enum : std::uint8_t {
+                    end_stream = 0x1,
+                    ack = 0x1,
+                    end_headers = 0x4,
+                    padded = 0x8,
+                    priority = 0x20,
+                };
+            } // namespace frame_flags
+
+            enum class setting : std::uint16_t {
+                header_table_size = 0x1,
+                enable_push = 0x2,
+                max_concurrent_streams = 0x3,
+                initial_window_size = 0x4,
+                max_frame_size = 0x5,
+                max_header_list_size = 0x6,
+            };
+
+            enum : std::uint32_t {
+                frame_header_size = 9,
+                default_window_size = 65535,
+                default_max_frame_size = 16384,
+                max_max_frame_size = (1 << 24) - 1,
+                max_window_size = 0x7fffffff,
+            };
+
+            /* sent by the client before anything else */
+            inline const char *connection_preface() {
+                static const char preface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+                return preface;
+            }
+
+            enum : std::size_t { connection_preface_size = 24 };
+
+            /*
+             * The code of a :status pseudo-header field (section 8.3.1):
+             * exactly three digits, 100 to 599; 0 for anything else.
+             */
+            inline int parse_status(boost::string_ref value) {
+                if (value.size() != 3) {
+                    return 0;
+                }
+                int code = 0;
+                for (char c : value) {
+                    if (c < '0' || c > '9') {
+                        return 0;
+                    }
+                    code = code * 10 + (c - '0');
+                }
+                return code >= 100 && code <= 599 ? code : 0;
+            }
+
+            struct frame_header {
+                std::uint32_t length;
+                frame_type type;
+                std::uint8_t flags;
+                std::uint32_t stream_id;
+            };
+
+            inline std::uint32_t read_uint32(const char *p) {
+                return (std::uint32_t(static_cast<std::uint8_t>(p[0])) << 24) |
+                    (std::uint32_t(static_cast<std::uint8_t>(p[1])) << 16) |
+                    (std::uint32_t(static_cast<std::uint8_t>(p[2])) << 8) |
+                    std::uint32_t(static_cast<std::uint8_t>(p[3]));
+            }
+
+            inline void write_uint32(char *p, std::uint32_t value) {
+                p[0] = static_cast<char>(value >> 24);
+                p[1] = static_cast<char>(value >> 16);
+                p[2] = static_cast<char>(value >> 8);
+                p[3] = static_cast<char>(value);
+            }
+
+            /* parses the first frame_header_size bytes at p */
+            inline frame_header read_frame_header(const char *p) {
+                frame_header header;
+                header.length = read_uint32(p) >> 8;
+                header.type = static_cast<frame_type>(p[3]);
+                header.flags = static_cast<std::uint8_t>(p[4]);
+                header.stream_id = read_uint32(p + 5) & 0x7fffffff;
+                return header;
+            }
+
+            inline void write_frame_header(char *p, std::uint32_t length, frame_type type,
+                std::uint8_t flags, std::uint32_t stream_id) {
+                write_uint32(p, length << 8);
+                p[3] = static_cast<char>(type);
+                p[4] = static_cast<char>(flags);
+                write_uint32(p + 5, stream_id);
+            }
+
+            inline void append_frame_header(std::string &out, std::uint32_t length, frame_type type,
+                std::uint8_t flags, std::uint32_t stream_id) {
+                char header[frame_header_size];
+                write_frame_header(header, length, type, flags, stream_id);
+                out.append(header, frame_header_size);
+            }
+
+            inline void append_uint32(std::string &out, std::uint32_t value) {
+                char bytes[4];
+                write_uint32(bytes, value);
+                out.append(bytes, 4);
+            }
+
+            /* error codes of RST_STREAM and GOAWAY (section 7) */
+            enum class error_code : std::uint32_t {
+                no_error = 0x0,
+                protocol_error = 0x1,
+                internal_error = 0x2,
+                flow_control_error = 0x3,
+                settings_timeout = 0x4,
+                stream_closed = 0x5,
+                frame_size_error = 0x6,
+                refused_stream = 0x7,
+                cancel = 0x8,
+                compression_error = 0x9,
+                connect_error = 0xa,
+                enhance_your_calm = 0xb,
+                inadequate_security = 0xc,
+                http_1_1_required = 0xd,
+            };
+
+            class http2_category_impl : public boost::system::error_category {
+            public:
+                virtual const char *name() const noexcept {
+                    return "http2";
+                }
+
+                virtual std::string message(int ev) const {
+                    switch (error_code(ev)) {
+                    case error_code::no_error:
+                        return "No error.";
+                    case error_code::protocol_error:
+                        return "HTTP/2 protocol error.";
+                    case error_code::internal_error:
+                        return "HTTP/2 internal error.";
+                    case error_code::flow_control_error:
+                        return "HTTP/2 flow control error.";
+                    case error_code::settings_timeout:
+                        return "HTTP/2 settings timeout.";
+                    case error_code::stream_closed:
+                        return "HTTP/2 stream closed.";
+                    case error_code::frame_size_error:
+                        return "HTTP/2 frame size error.";
+                    case error_code::refused_stream:
+                        return "HTTP/2 stream refused.";
+                    case error_code::cancel:
+                        return "HTTP/2 stream cancelled.";
+                    case error_code::compression_error:
+                        return "HTTP/2 compression error.";
+                    case error_code::connect_error:
+                        return "HTTP/2 connect error.";
+                    case error_code::enhance_your_calm:
+                        return "HTTP/2 enhance your calm.";
+                    case error_code::inadequate_security:
+                        return "HTTP/2 inadequate security.";
+                    case error_code::http_1_1_required:
+                        return "HTTP/1.1 required.";
+                    default:
+                        break;
+                    }
+                    return "Unknown HTTP/2 error.";
+                }
+            };
+
+            inline const boost::system::error_category &http2_category() {
+                static http2_category_impl category;
+                return category;
+            }
+
+            inline boost::system::error_code make_error_code(error_code e) {
+                return boost::system::error_code(static_cast<int>(e), http2_category());
+            }
+        } // namespace http2
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_HTTP2_FRAME_INC
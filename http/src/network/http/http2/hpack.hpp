@@ -0,0 +1,590 @@
+#ifndef NETWORK_HTTP_HTTP2_HPACK_INC
+#define NETWORK_HTTP_HTTP2_HPACK_INC
+
+#include <string>
+#include <deque>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <boost/utility/string_ref.hpp>
+#include <network/config.hpp>
+
+namespace network {
+    namespace http {
+        namespace http2 {
+            /*
+             * HPACK header compression (RFC 7541).
+             */
+            namespace hpack {
+                struct static_entry {
+                    const char *name;
+                    const char *value;
+                };
+
+                /* the static table, index 1 is element 0 */
+                inline const static_entry *static_table() {
+                    static const static_entry table[] = {
+                    { ":authority", "" },
+                    { ":method", "GET" },
+                    { ":method", "POST" },
+                    { ":path", "/" },
+                    { ":path", "/index.html" },
+                    { ":scheme", "http" },
+                    { ":scheme", "https" },
+                    { ":status", "200" },
+                    { ":status", "204" },
+                    { ":status", "206" },
+                    { ":status", "304" },
+                    { ":status", "400" },
+                    { ":status", "404" },
+                    { ":status", "500" },
+                    { "accept-charset", "" },
+                    { "accept-encoding", "gzip, deflate" },
+                    { "accept-language", "" },
+                    { "accept-ranges", "" },
+                    { "accept", "" },
+                    { "access-control-allow-origin", "" },
+                    { "age", "" },
+                    { "allow", "" },
+                    { "authorization", "" },
+                    { "cache-control", "" },
+                    { "content-disposition", "" },
+                    { "content-encoding", "" },
+                    { "content-language", "" },
+                    { "content-length", "" },
+                    { "content-location", "" },
+                    { "content-range", "" },
+                    { "content-type", "" },
+                    { "cookie", "" },
+                    { "date", "" },
+                    { "etag", "" },
+                    { "expect", "" },
+                    { "expires", "" },
+                    { "from", "" },
+                    { "host", "" },
+                    { "if-match", "" },
+                    { "if-modified-since", "" },
+                    { "if-none-match", "" },
+                    { "if-range", "" },
+                    { "if-unmodified-since", "" },
+                    { "last-modified", "" },
+                    { "link", "" },
+                    { "location", "" },
+                    { "max-forwards", "" },
+                    { "proxy-authenticate", "" },
+                    { "proxy-authorization", "" },
+                    { "range", "" },
+                    { "referer", "" },
+                    { "refresh", "" },
+                    { "retry-after", "" },
+                    { "server", "" },
+                    { "set-cookie", "" },
+                    { "strict-transport-security", "" },
+                    { "transfer-encoding", "" },
+                    { "user-agent", "" },
+                    { "vary", "" },
+                    { "via", "" },
+                    { "www-authenticate", "" }
+                    };
+                    return table;
+                }
+
+                enum : std::size_t { static_table_size = 61 };
+
+                /* Huffman code of each octet, and of EOS as symbol 256 (Appendix B) */
+                inline const std::uint32_t *huffman_codes() {
+                    static const std::uint32_t codes[257] = {
+                    0x00001ff8, 0x007fffd8, 0x0fffffe2, 0x0fffffe3, 0x0fffffe4, 0x0fffffe5,
+                    0x0fffffe6, 0x0fffffe7, 0x0fffffe8, 0x00ffffea, 0x3ffffffc, 0x0fffffe9,
+                    0x0fffffea, 0x3ffffffd, 0x0fffffeb, 0x0fffffec, 0x0fffffed, 0x0fffffee,
+                    0x0fffffef, 0x0ffffff0, 0x0ffffff1, 0x0ffffff2, 0x3ffffffe, 0x0ffffff3,
+                    0x0ffffff4, 0x0ffffff5, 0x0ffffff6, 0x0ffffff7, 0x0ffffff8, 0x0ffffff9,
+                    0x0ffffffa, 0x0ffffffb, 0x00000014, 0x000003f8, 0x000003f9, 0x00000ffa,
+                    0x00001ff9, 0x00000015, 0x000000f8, 0x000007fa, 0x000003fa, 0x000003fb,
+                    0x000000f9, 0x000007fb, 0x000000fa, 0x00000016, 0x00000017, 0x00000018,
+                    0x00000000, 0x00000001, 0x00000002, 0x00000019, 0x0000001a, 0x0000001b,
+                    0x0000001c, 0x0000001d, 0x0000001e, 0x0000001f, 0x0000005c, 0x000000fb,
+                    0x00007ffc, 0x00000020, 0x00000ffb, 0x000003fc, 0x00001ffa, 0x00000021,
+                    0x0000005d, 0x0000005e, 0x0000005f, 0x00000060, 0x00000061, 0x00000062,
+                    0x00000063, 0x00000064, 0x00000065, 0x00000066, 0x00000067, 0x00000068,
+                    0x00000069, 0x0000006a, 0x0000006b, 0x0000006c, 0x0000006d, 0x0000006e,
+                    0x0000006f, 0x00000070, 0x00000071, 0x00000072, 0x000000fc, 0x00000073,
+                    0x000000fd, 0x00001ffb, 0x0007fff0, 0x00001ffc, 0x00003ffc, 0x00000022,
+                    0x00007ffd, 0x00000003, 0x00000023, 0x00000004, 0x00000024, 0x00000005,
+                    0x00000025, 0x00000026, 0x00000027, 0x00000006, 0x00000074, 0x00000075,
+                    0x00000028, 0x00000029, 0x0000002a, 0x00000007, 0x0000002b, 0x00000076,
+                    0x0000002c, 0x00000008, 0x00000009, 0x0000002d, 0x00000077, 0x00000078,
+                    0x00000079, 0x0000007a, 0x0000007b, 0x00007ffe, 0x000007fc, 0x00003ffd,
+                    0x00001ffd, 0x0ffffffc, 0x000fffe6, 0x003fffd2, 0x000fffe7, 0x000fffe8,
+                    0x003fffd3, 0x003fffd4, 0x003fffd5, 0x007fffd9, 0x003fffd6, 0x007fffda,
+                    0x007fffdb, 0x007fffdc, 0x007fffdd, 0x007fffde, 0x00ffffeb, 0x007fffdf,
+                    0x00ffffec, 0x00ffffed, 0x003fffd7, 0x007fffe0, 0x00ffffee, 0x007fffe1,
+                    0x007fffe2, 0x007fffe3, 0x007fffe4, 0x001fffdc, 0x003fffd8, 0x007fffe5,
+                    0x003fffd9, 0x007fffe6, 0x007fffe7, 0x00ffffef, 0x003fffda, 0x001fffdd,
+                    0x000fffe9, 0x003fffdb, 0x003fffdc, 0x007fffe8, 0x007fffe9, 0x001fffde,
+                    0x007fffea, 0x003fffdd, 0x003fffde, 0x00fffff0, 0x001fffdf, 0x003fffdf,
+                    0x007fffeb, 0x007fffec, 0x001fffe0, 0x001fffe1, 0x003fffe0, 0x001fffe2,
+                    0x007fffed, 0x003fffe1, 0x007fffee, 0x007fffef, 0x000fffea, 0x003fffe2,
+                    0x003fffe3, 0x003fffe4, 0x007ffff0, 0x003fffe5, 0x003fffe6, 0x007ffff1,
+                    0x03ffffe0, 0x03ffffe1, 0x000fffeb, 0x0007fff1, 0x003fffe7, 0x007ffff2,
+                    0x003fffe8, 0x01ffffec, 0x03ffffe2, 0x03ffffe3, 0x03ffffe4, 0x07ffffde,
+                    0x07ffffdf, 0x03ffffe5, 0x00fffff1, 0x01ffffed, 0x0007fff2, 0x001fffe3,
+                    0x03ffffe6, 0x07ffffe0, 0x07ffffe1, 0x03ffffe7, 0x07ffffe2, 0x00fffff2,
+                    0x001fffe4, 0x001fffe5, 0x03ffffe8, 0x03ffffe9, 0x0ffffffd, 0x07ffffe3,
+                    0x07ffffe4, 0x07ffffe5, 0x000fffec, 0x00fffff3, 0x000fffed, 0x001fffe6,
+                    0x003fffe9, 0x001fffe7, 0x001fffe8, 0x007ffff3, 0x003fffea, 0x003fffeb,
+                    0x01ffffee, 0x01ffffef, 0x00fffff4, 0x00fffff5, 0x03ffffea, 0x007ffff4,
+                    0x03ffffeb, 0x07ffffe6, 0x03ffffec, 0x03ffffed, 0x07ffffe7, 0x07ffffe8,
+                    0x07ffffe9, 0x07ffffea, 0x07ffffeb, 0x0ffffffe, 0x07ffffec, 0x07ffffed,
+                    0x07ffffee, 0x07ffffef, 0x07fffff0, 0x03ffffee, 0x3fffffff
+                    };
+                    return codes;
+                }
+
+                inline const std::uint8_t *huffman_lengths() {
+                    static const std::uint8_t lengths[257] = {
+                    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+                    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+                    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+                    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+                    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+                    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+                    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+                    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+                    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+                    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+                    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+                    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+                    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+                    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+                    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+                    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+                    30
+                    };
+                    return lengths;
+                }
+
+                /*
+                 * The code is canonical: codes of one length are consecutive
+                 * and ordered by symbol, so a code is decoded by comparing it
+                 * with the first code of its length.
+                 */
+                struct huffman_decode_table {
+                    huffman_decode_table() {
+                        const std::uint8_t *lengths = huffman_lengths();
+                        std::uint32_t count[31] = { 0 };
+                        for (std::size_t s = 0; s < 257; ++s) {
+                            ++count[lengths[s]];
+                        }
+
+                        std::uint32_t code = 0, offset = 0;
+                        for (std::size_t len = 1; len <= 30; ++len) {
+                            first_code[len] = code;
+                            codes_of_length[len] = count[len];
+                            first_symbol[len] = offset;
+                            code = (code + count[len]) << 1;
+                            offset += count[len];
+                        }
+
+                        std::uint32_t next[31];
+                        std::memcpy(next, first_symbol, sizeof(next));
+                        for (std::uint16_t s = 0; s < 257; ++s) {
+                            symbols[next[lengths[s]]++] = s;
+                        }
+                    }
+
+                    std::uint32_t first_code[31];
+                    std::uint32_t codes_of_length[31];
+                    std::uint32_t first_symbol[31];
+                    std::uint16_t symbols[257];
+                };
+
+                inline std::size_t huffman_encoded_size(boost::string_ref s) {
+                    const std::uint8_t *lengths = huffman_lengths();
+                    std::size_t bits = 0;
+                    for (char c : s) {
+                        bits += lengths[static_cast<std::uint8_t>(c)];
+                    }
+                    return (bits + 7) / 8;
+                }
+
+                inline void huffman_encode(std::string &out, boost::string_ref s) {
+                    const std::uint32_t *codes = huffman_codes();
+                    const std::uint8_t *lengths = huffman_lengths();
+                    std::uint64_t bits = 0;
+                    std::size_t count = 0;
+                    for (char c : s) {
+                        auto symbol = static_cast<std::uint8_t>(c);
+                        bits = (bits << lengths[symbol]) | codes[symbol];
+                        count += lengths[symbol];
+                        while (count >= 8) {
+                            count -= 8;
+                            out.push_back(static_cast<char>(bits >> count));
+                        }
+                        bits &= (std::uint64_t(1) << count) - 1;
+                    }
+                    if (count > 0) {
+                        /* padded with the most significant bits of EOS */
+                        out.push_back(static_cast<char>((bits << (8 - count)) | (0xff >> count)));
+                    }
+                }
+
+                /* false on EOS, a code longer than 30 bits or padding that is not a prefix of EOS */
+                inline bool huffman_decode(std::string &out, const char *data, std::size_t size) {
+                    static const huffman_decode_table table;
+                    std::uint32_t code = 0;
+                    std::size_t length = 0;
+                    for (std::size_t i = 0; i < size; ++i) {
+                        auto octet = static_cast<std::uint8_t>(data[i]);
+                        for (int bit = 7; bit >= 0; --bit) {
+                            code = (code << 1) | ((octet >> bit) & 1);
+                            if (++length > 30) {
+                                return false;
+                            }
+                            if (code - table.first_code[length] < table.codes_of_length[length]) {
+                                std::uint16_t symbol = table.symbols[
+                                    table.first_symbol[length] + code - table.first_code[length]];
+                                if (symbol == 256) {
+                                    return false;
+                                }
+                                out.push_back(static_cast<char>(symbol));
+                                code = 0;
+                                length = 0;
+                            }
+                        }
+                    }
+                    return length < 8 && code == (std::uint32_t(1) << length) - 1;
+                }
+
+                /* integer with an n-bit prefix, the other bits of the first octet are `flags` */
+                inline void encode_integer(std::string &out, std::uint8_t flags, int n, std::uint64_t value) {
+                    std::uint64_t limit = (std::uint64_t(1) << n) - 1;
+                    if (value < limit) {
+                        out.push_back(static_cast<char>(flags | value));
+                        return;
+                    }
+                    out.push_back(static_cast<char>(flags | limit));
+                    value -= limit;
+                    while (value >= 128) {
+                        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+                        value >>= 7;
+                    }
+                    out.push_back(static_cast<char>(value));
+                }
+
+                inline bool decode_integer(const char *&p, const char *end, int n, std::uint64_t &value) {
+                    if (p == end) {
+                        return false;
+                    }
+                    std::uint64_t limit = (std::uint64_t(1) << n) - 1;
+                    value = static_cast<std::uint8_t>(*p++) & limit;
+                    if (value < limit) {
+                        return true;
+                    }
+                    for (int shift = 0; shift < 32; shift += 7) {
+                        if (p == end) {
+                            return false;
+                        }
+                        auto octet = static_cast<std::uint8_t>(*p++);
+                        value += std::uint64_t(octet & 0x7f) << shift;
+                        if (!(octet & 0x80)) {
+                            return true;
+                        }
+                    }
+                    return false;
+                }
+
+                inline void encode_string(std::string &out, boost::string_ref s) {
+                    std::size_t huffman_size = huffman_encoded_size(s);
+                    if (huffman_size < s.size()) {
+                        encode_integer(out, 0x80, 7, huffman_size);
+                        huffman_encode(out, s);
+                    } else {
+                        encode_integer(out, 0, 7, s.size());
+                        out.append(s.data(), s.size());
+                    }
+                }
+
+                inline bool decode_string(const char *&p, const char *end, std::string &out) {
+                    if (p == end) {
+                        return false;
+                    }
+                    bool huffman = (static_cast<std::uint8_t>(*p) & 0x80) != 0;
+                    std::uint64_t length;
+                    if (!decode_integer(p, end, 7, length) || length > static_cast<std::uint64_t>(end - p)) {
+                        return false;
+                    }
+
+                    out.clear();
+                    const char *s = p;
+                    p += length;
+                    if (huffman) {
+                        return huffman_decode(out, s, static_cast<std::size_t>(length));
+                    }
+                    out.assign(s, static_cast<std::size_t>(length));
+                    return true;
+                }
+
+                /*
+                 * class header_table
+                 *
+                 * The dynamic table: newest entry first, entries are evicted
+                 * from the end once their size (RFC 7541, 4.1) exceeds the
+                 * maximum.
+                 */
+                class header_table {
+                public:
+                    struct entry {
+                        std::string name;
+                        std::string value;
+                    };
+
+                    explicit header_table(std::size_t max_size = 4096) :
+                        _size(0), _max_size(max_size) { }
+
+                    static std::size_t entry_size(boost::string_ref name, boost::string_ref value) {
+                        return 32 + name.size() + value.size();
+                    }
+
+                    void insert(boost::string_ref name, boost::string_ref value) {
+                        std::size_t size = entry_size(name, value);
+                        evict(size > _max_size ? _max_size : _max_size - size);
+                        if (size <= _max_size) {
+                            _entries.push_front(entry{ std::string(name.data(), name.size()),
+                                    std::string(value.data(), value.size()) });
+                            _size += size;
+                        }
+                    }
+
+                    void max_size(std::size_t size) {
+                        _max_size = size;
+                        evict(size);
+                    }
+
+                    std::size_t max_size() const {
+                        return _max_size;
+                    }
+
+                    std::size_t size() const {
+                        return _size;
+                    }
+
+                    std::size_t count() const {
+                        return _entries.size();
+                    }
+
+                    /* 0 is the newest entry */
+                    const entry &operator [] (std::size_t i) const {
+                        return _entries[i];
+                    }
+
+                private:
+                    void evict(std::size_t limit) {
+                        while (_size > limit) {
+                            _size -= entry_size(_entries.back().name, _entries.back().value);
+                            _entries.pop_back();
+                        }
+                    }
+
+                    std::deque<entry> _entries;
+                    std::size_t _size;
+                    std::size_t _max_size;
+                };
+
+                /*
+                 * class encoder
+                 *
+                 * Fields found in the tables are sent as an index, others are
+                 * added to the dynamic table, except values that change with
+                 * every request and credentials, which are never indexed.
+                 */
+                class encoder {
+                public:
+                    explicit encoder(std::size_t max_table_size = 4096) :
+                        _table(max_table_size),
+                        _pending_size_update(false),
+                        _smallest_size(max_table_size) { }
+
+                    /* the peer's SETTINGS_HEADER_TABLE_SIZE, announced in the next header block */
+                    void max_table_size(std::size_t size) {
+                        _smallest_size = std::min(_smallest_size, size);
+                        _table.max_size(size);
+                        _pending_size_update = true;
+                    }
+
+                    /* starts a header block */
+                    void begin(std::string &out) {
+                        if (_pending_size_update) {
+                            if (_smallest_size < _table.max_size()) {
+                                encode_integer(out, 0x20, 5, _smallest_size);
+                            }
+                            encode_integer(out, 0x20, 5, _table.max_size());
+                            _pending_size_update = false;
+                            _smallest_size = _table.max_size();
+                        }
+                    }
+
+                    void encode(std::string &out, boost::string_ref name, boost::string_ref value) {
+                        std::size_t name_index = 0;
+                        std::size_t index = find(name, value, name_index);
+                        if (index != 0) {
+                            encode_integer(out, 0x80, 7, index);
+                            return;
+                        }
+
+                        if (never_indexed(name, value)) {
+                            encode_integer(out, 0x10, 4, name_index);
+                        } else if (not_indexed(name)) {
+                            encode_integer(out, 0x00, 4, name_index);
+                        } else {
+                            encode_integer(out, 0x40, 6, name_index);
+                            _table.insert(name, value);
+                        }
+                        if (name_index == 0) {
+                            encode_string(out, name);
+                        }
+                        encode_string(out, value);
+                    }
+
+                    const header_table &table() const {
+                        return _table;
+                    }
+
+                private:
+                    static bool never_indexed(boost::string_ref name, boost::string_ref value) {
+                        return name == "authorization" || name == "proxy-authorization" ||
+                            (name == "cookie" && value.size() < 20);
+                    }
+
+                    static bool not_indexed(boost::string_ref name) {
+                        return name == ":path" || name == "content-length";
+                    }
+
+                    /* index of the field, or 0; name_index is set to an entry with the same name */
+                    std::size_t find(boost::string_ref name, boost::string_ref value, std::size_t &name_index) const {
+                        static const std::unordered_map<std::string, std::size_t> static_names = [] () {
+                            std::unordered_map<std::string, std::size_t> names;
+                            for (std::size_t i = static_table_size; i > 0; --i) {
+                                names[static_table()[i - 1].name] = i;
+                            }
+                            return names;
+                        }();
+
+                        auto it = static_names.find(std::string(name.data(), name.size()));
+                        if (it != static_names.end()) {
+                            name_index = it->second;
+                            for (std::size_t i = it->second; i <= static_table_size &&
+                                     name == static_table()[i - 1].name; ++i) {
+                                if (value == static_table()[i - 1].value) {
+                                    return i;
+                                }
+                            }
+                        }
+
+                        for (std::size_t i = 0; i < _table.count(); ++i) {
+                            if (_table[i].name == name) {
+                                if (_table[i].value == value) {
+                                    return static_table_size + 1 + i;
+                                }
+                                if (name_index == 0) {
+                                    name_index = static_table_size + 1 + i;
+                                }
+                            }
+                        }
+                        return 0;
+                    }
+
+                    header_table _table;
+                    bool _pending_size_update;
+                    std::size_t _smallest_size;
+                };
+
+                /*
+                 * class decoder
+                 *
+                 * Decodes header blocks, which must be fed in the order they
+                 * were received. max_table_size is the limit announced in
+                 * our SETTINGS_HEADER_TABLE_SIZE.
+                 */
+                class decoder {
+                public:
+                    explicit decoder(std::size_t max_table_size = 4096) :
+                        _table(max_table_size),
+                        _max_table_size(max_table_size) { }
+
+                    /* calls handler(name, value) for each field; false if the block is malformed */
+                    template <class Handler>
+                        bool decode(const char *data, std::size_t size, Handler &&handler) {
+                            const char *p = data, *end = data + size;
+                            bool first = true;
+                            while (p != end) {
+                                auto octet = static_cast<std::uint8_t>(*p);
+                                std::uint64_t index;
+
+                                if (octet & 0x80) {
+                                    if (!decode_integer(p, end, 7, index) || index == 0) {
+                                        return false;
+                                    }
+                                    if (index <= static_table_size) {
+                                        const static_entry &e = static_table()[index - 1];
+                                        handler(boost::string_ref(e.name), boost::string_ref(e.value));
+                                    } else if (index - static_table_size - 1 < _table.count()) {
+                                        const header_table::entry &e = _table[index - static_table_size - 1];
+                                        handler(boost::string_ref(e.name), boost::string_ref(e.value));
+                                    } else {
+                                        return false;
+                                    }
+                                } else if ((octet & 0xe0) == 0x20) {
+                                    /* size updates only come first */
+                                    if (!first || !decode_integer(p, end, 5, index) || index > _max_table_size) {
+                                        return false;
+                                    }
+                                    _table.max_size(static_cast<std::size_t>(index));
+                                    continue;
+                                } else {
+                                    bool indexing = (octet & 0xc0) == 0x40;
+                                    if (!decode_integer(p, end, indexing ? 6 : 4, index)) {
+                                        return false;
+                                    }
+                                    if (index == 0) {
+                                        if (!decode_string(p, end, _name)) {
+                                            return false;
+                                        }
+                                    } else if (index <= static_table_size) {
+                                        _name = static_table()[index - 1].name;
+                                    } else if (index - static_table_size - 1 < _table.count()) {
+                                        _name = _table[index - static_table_size - 1].name;
+                                    } else {
+                                        return false;
+                                    }
+                                    if (!decode_string(p, end, _value)) {
+                                        return false;
+                                    }
+
+                                    handler(boost::string_ref(_name), boost::string_ref(_value));
+                                    if (indexing) {
+                                        _table.insert(_name, _value);
+                                    }
+                                }
+                                first = false;
+                            }
+                            return true;
+                        }
+
+                    const header_table &table() const {
+                        return _table;
+                    }
+
+                private:
+                    header_table _table;
+                    std::size_t _max_table_size;
+                    std::string _name;
+                    std::string _value;
+                };
+            } // namespace hpack
+        } // namespace http2
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_HTTP2_HPACK_INC
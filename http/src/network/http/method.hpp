@@ -23,32 +23,39 @@ namespace network {
 
         typedef enum method method;
 
-        inline std::ostream &operator << (std::ostream *os, method m) {
+        /*
+         * Returns the request-line token for a method. The string is static,
+         * so it can be handed to a gather write without copying.
+         */
+        inline const char *method_name(method m) {
             switch (m) {
             case method::get:
-                return os << "GET";
+                return "GET";
             case method::post:
-                return os << "POST";
+                return "POST";
             case method::put:
-                return os << "PUT";
+                return "PUT";
             case method::delete_:
-                return os << "DELETE";
+                return "DELETE";
             case method::head:
-                return os << "HEAD";
+                return "HEAD";
             case method::options:
-                return os << "OPTIONS";
+                return "OPTIONS";
             case method::trace:
-                return os << "TRACE";
+                return "TRACE";
             case method::connect:
-                return os << "CONNECT";
+                return "CONNECT";
             case method::merge:
-                return os << "MERGE";
+                return "MERGE";
             case method::patch:
-                return os << "PATCH";
+                return "PATCH";
             default:
-                return os << "NOT_EXIST";
+                return "NOT_EXIST";
             }
-            return os;
+        }
+
+        inline std::ostream &operator << (std::ostream &os, method m) {
+            return os << method_name(m);
         }
     } // namespace http
 }// namespace network
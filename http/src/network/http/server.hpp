@@ -0,0 +1,10 @@
+#ifndef NETWORK_HTTP_SERVER_INC
+#define NETWORK_HTTP_SERVER_INC
+
+/*
+ * include the server.hpp file in server directory
+ */
+#include <network/http/server/server.hpp>
+
+
+#endif // NETWORK_HTTP_SERVER_INC
@@ -0,0 +1,110 @@
+#ifndef NETWORK_HTTP_SERVER_REQUEST_INC
+#define NETWORK_HTTP_SERVER_REQUEST_INC
+
+#include <string>
+#include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <network/config.hpp>
+#include <network/http/method.hpp>
+#include <network/http/header_map.hpp>
+
+namespace network {
+    namespace http {
+        namespace server_connection {
+            class connection;
+        } // namespace server_connection
+
+        namespace server_message {
+            /*
+             * class request
+             *
+             * A request as read by the server, handed to its handler. A
+             * connection keeps one per request it reads ahead and fills it
+             * again for later requests, so its storage is reused: it is
+             * only valid during the call to the handler.
+             */
+            class request {
+                request(const request &) = delete;
+                request &operator = (const request &) = delete;
+
+            public:
+                typedef boost::string_ref string_ref;
+
+                request() :
+                    _method(method::none),
+                    _keep_alive(true) { }
+
+                /* method::none for a method http::method does not name, see method_name() */
+                http::method method() const {
+                    return _method;
+                }
+
+                const std::string &method_name() const {
+                    return _method_name;
+                }
+
+                /* the request target as sent, e.g. "/search?q=1" */
+                const std::string &target() const {
+                    return _target;
+                }
+
+                string_ref path() const {
+                    string_ref target(_target);
+                    return target.substr(0, target.find('?'));
+                }
+
+                /* what follows the '?', empty if there is none */
+                string_ref query() const {
+                    auto mark = _target.find('?');
+                    return mark == std::string::npos ? string_ref() : string_ref(_target).substr(mark + 1);
+                }
+
+                /* e.g. "1.1" */
+                const std::string &version() const {
+                    return _version;
+                }
+
+                /* the first value of the header */
+                boost::optional<string_ref> header(string_ref name) const {
+                    return _headers.find(name);
+                }
+
+                const header_map &headers() const {
+                    return _headers;
+                }
+
+                const std::string &body() const {
+                    return _body;
+                }
+
+                /* whether the connection stays open after the response */
+                bool keep_alive() const {
+                    return _keep_alive;
+                }
+
+            private:
+                friend class server_connection::connection;
+
+                void clear() {
+                    _method = method::none;
+                    _method_name.clear();
+                    _target.clear();
+                    _version.clear();
+                    _headers.clear();
+                    _body.clear();
+                    _keep_alive = true;
+                }
+
+                http::method _method;
+                std::string _method_name;
+                std::string _target;
+                std::string _version;
+                header_map _headers;
+                std::string _body;
+                bool _keep_alive;
+            };
+        } // namespace server_message
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_SERVER_REQUEST_INC
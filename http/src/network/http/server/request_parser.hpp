@@ -0,0 +1,383 @@
+#ifndef NETWORK_HTTP_SERVER_REQUEST_PARSER_INC
+#define NETWORK_HTTP_SERVER_REQUEST_PARSER_INC
+
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <network/config.hpp>
+#include <network/constants.hpp>
+#include <network/http/method.hpp>
+#include <network/http/header_scanner.hpp>
+
+namespace network {
+    namespace http {
+        namespace server_message {
+            /*
+             * class request_parser
+             *
+             * Resumable HTTP/1.1 request parser, the counterpart of
+             * client_message::response_parser: parse() is fed the bytes
+             * received and not consumed yet, reports the parts of the
+             * request to a handler as views into them, and never copies or
+             * allocates. The handler must provide:
+             *
+             *   void on_request_line(http::method m, string_ref method, string_ref target, string_ref version);
+             *   void on_header(string_ref name, string_ref value);
+             *   void on_headers_complete();
+             *   void on_body(string_ref data);
+             *
+             * m is method::none for a method http::method does not name.
+             * Trailers of chunked bodies are skipped. A request without
+             * Content-Length or Transfer-Encoding has no body; one whose
+             * final transfer coding is not chunked, or that has both, is an
+             * error, as either could be read differently by a proxy in
+             * front (RFC 9112, 6.1 and 6.3).
+             */
+            class request_parser {
+            public:
+                typedef boost::string_ref string_ref;
+
+                enum state {
+                    request_line,
+                    header_line,
+                    body_fixed,
+                    chunk_size,
+                    chunk_data,
+                    chunk_data_end,
+                    trailer_line,
+                    complete,
+                    error,
+                };
+
+                explicit request_parser(std::size_t max_line = 8 * 1024,
+                    const header_scanner &scanner = active_header_scanner()) :
+                    _scanner(&scanner),
+                    _max_line(max_line) {
+                    reset();
+                }
+
+                /* prepares for the next request */
+                void reset() {
+                    _state = request_line;
+                    _scanned = 0;
+                    _http_1_0 = false;
+                    _chunked = false;
+                    _close = false;
+                    _keep_alive = false;
+                    _expect_continue = false;
+                    _content_length = boost::none;
+                    _remaining = 0;
+                }
+
+                /* returns the number of bytes consumed from data */
+                template <class Handler>
+                    std::size_t parse(const char *data, std::size_t len, Handler &handler) {
+                        std::size_t consumed = 0;
+                        while (consumed < len && _state != complete && _state != error) {
+                            const char *begin = data + consumed;
+                            std::size_t available = len - consumed;
+
+                            if (_state == body_fixed || _state == chunk_data) {
+                                auto n = static_cast<std::size_t>(std::min<std::uint64_t>(available, _remaining));
+                                handler.on_body(string_ref(begin, n));
+                                consumed += n;
+                                _remaining -= n;
+                                if (_remaining == 0) {
+                                    _state = _state == body_fixed ? complete : chunk_data_end;
+                                }
+                                continue;
+                            }
+
+                            /* as in response_parser, the first control character ends the line */
+                            const char *end = begin + available;
+                            const char *hit = _scanner->find_ctl(begin + _scanned, end);
+                            std::size_t line_len = hit - begin;
+                            if (hit == end || (*hit == '\r' && hit + 1 == end)) {
+                                _scanned = line_len;
+                                if (_scanned > _max_line) {
+                                    _state = error;
+                                }
+                                return consumed;
+                            }
+
+                            std::size_t terminator = *hit == '\r' ? 2 : 1;
+                            if (hit[terminator - 1] != '\n') {
+                                _state = error;
+                                break;
+                            }
+
+                            consumed += line_len + terminator;
+                            _scanned = 0;
+                            if (line_len > _max_line || !parse_line(string_ref(begin, line_len), handler)) {
+                                _state = error;
+                            }
+                        }
+                        return consumed;
+                    }
+
+                state current() const {
+                    return _state;
+                }
+
+                bool is_complete() const {
+                    return _state == complete;
+                }
+
+                bool has_error() const {
+                    return _state == error;
+                }
+
+                /* true until the first byte of the request line is consumed */
+                bool is_idle() const {
+                    return _state == request_line && _scanned == 0;
+                }
+
+                /* whether the connection may carry another request after this one */
+                bool keep_alive() const {
+                    return !_close && (!_http_1_0 || _keep_alive);
+                }
+
+                /* the request asked for 100 Continue before sending its body */
+                bool expect_continue() const {
+                    return _expect_continue;
+                }
+
+                boost::optional<std::uint64_t> content_length() const {
+                    return _content_length;
+                }
+
+                bool chunked() const {
+                    return _chunked;
+                }
+
+            private:
+                template <class Handler>
+                    bool parse_line(string_ref line, Handler &handler) {
+                        switch (_state) {
+                        case request_line:
+                            /* robustness: empty lines before a request are ignored (RFC 7230, 3.5) */
+                            return line.empty() || parse_request_line(line, handler);
+                        case header_line:
+                            if (line.empty()) {
+                                return headers_complete(handler);
+                            }
+                            return parse_header(line, handler);
+                        case chunk_size:
+                            return parse_chunk_size(line);
+                        case chunk_data_end:
+                            _state = chunk_size;
+                            return line.empty();
+                        case trailer_line:
+                            if (line.empty()) {
+                                _state = complete;
+                            }
+                            return true;
+                        default:
+                            return false;
+                        }
+                    }
+
+                /* GET /index.html HTTP/1.1 */
+                template <class Handler>
+                    bool parse_request_line(string_ref line, Handler &handler) {
+                        const char *method_end = _scanner->find_non_token(line.begin(), line.end());
+                        if (method_end == line.begin() || method_end == line.end() || *method_end != ' ') {
+                            return false;
+                        }
+                        string_ref name(line.begin(), method_end - line.begin());
+
+                        string_ref rest = line.substr(name.size() + 1);
+                        auto space = rest.rfind(' ');
+                        if (space == string_ref::npos || space == 0) {
+                            return false;
+                        }
+                        string_ref target = rest.substr(0, space);
+                        string_ref version = rest.substr(space + 1);
+                        if (version.size() != 8 || !version.starts_with(constants::http_slash()) ||
+                            !is_digit(version[5]) || version[6] != '.' || !is_digit(version[7]) ||
+                            target.find(' ') != string_ref::npos) {
+                            return false;
+                        }
+
+                        _http_1_0 = version[5] == '1' && version[7] == '0';
+                        handler.on_request_line(method_of(name), name, target, version.substr(5));
+                        _state = header_line;
+                        return true;
+                    }
+
+                template <class Handler>
+                    bool parse_header(string_ref line, Handler &handler) {
+                        const char *colon = _scanner->find_non_token(line.begin(), line.end());
+                        if (colon == line.begin() || colon == line.end() || *colon != ':') {
+                            return false;
+                        }
+
+                        string_ref name(line.begin(), colon - line.begin());
+                        string_ref value = trim(line.substr(name.size() + 1));
+
+                        if (equals_ignore_case(name, constants::content_length())) {
+                            std::uint64_t length = 0;
+                            if (!parse_decimal(value, length) ||
+                                (_content_length && *_content_length != length)) {
+                                return false;
+                            }
+                            _content_length = length;
+                        } else if (equals_ignore_case(name, constants::transfer_encoding())) {
+                            _chunked = equals_ignore_case(last_token(value), constants::chunked());
+                            if (!_chunked) {
+                                /* a body whose end cannot be told (RFC 7230, 3.3.3) */
+                                return false;
+                            }
+                        } else if (equals_ignore_case(name, constants::connection())) {
+                            _close = _close || contains_ignore_case(value, constants::close());
+                            _keep_alive = _keep_alive || contains_ignore_case(value, constants::keep_alive());
+                        } else if (equals_ignore_case(name, "Expect")) {
+                            _expect_continue = equals_ignore_case(value, "100-continue");
+                        }
+
+                        handler.on_header(name, value);
+                        return true;
+                    }
+
+                template <class Handler>
+                    bool headers_complete(Handler &handler) {
+                        if (_chunked && _content_length) {
+                            /* request smuggling */
+                            return false;
+                        }
+                        handler.on_headers_complete();
+
+                        if (_chunked) {
+                            _state = chunk_size;
+                        } else if (_content_length && *_content_length != 0) {
+                            _remaining = *_content_length;
+                            _state = body_fixed;
+                        } else {
+                            _state = complete;
+                        }
+                        return true;
+                    }
+
+                bool parse_chunk_size(string_ref line) {
+                    std::uint64_t size = 0;
+                    std::size_t digits = 0;
+                    for (; digits < line.size(); ++digits) {
+                        int value = hex_value(line[digits]);
+                        if (value < 0) {
+                            break;
+                        }
+                        if (size > (std::numeric_limits<std::uint64_t>::max() >> 4)) {
+                            return false;
+                        }
+                        size = (size << 4) | static_cast<std::uint64_t>(value);
+                    }
+                    if (digits == 0) {
+                        return false;
+                    }
+
+                    string_ref rest = trim(line.substr(digits));
+                    if (!rest.empty() && rest[0] != ';') {
+                        return false;
+                    }
+
+                    _remaining = size;
+                    _state = size == 0 ? trailer_line : chunk_data;
+                    return true;
+                }
+
+                static http::method method_of(string_ref name) {
+                    for (int m = method::get; m < method::num; ++m) {
+                        if (name == method_name(static_cast<http::method>(m))) {
+                            return static_cast<http::method>(m);
+                        }
+                    }
+                    return method::none;
+                }
+
+                static bool parse_decimal(string_ref value, std::uint64_t &result) {
+                    if (value.empty()) {
+                        return false;
+                    }
+                    result = 0;
+                    for (char c : value) {
+                        if (!is_digit(c) || result > (std::numeric_limits<std::uint64_t>::max() - 9) / 10) {
+                            return false;
+                        }
+                        result = result * 10 + static_cast<std::uint64_t>(c - '0');
+                    }
+                    return true;
+                }
+
+                static bool equals_ignore_case(string_ref lhs, string_ref rhs) {
+                    if (lhs.size() != rhs.size()) {
+                        return false;
+                    }
+                    for (std::size_t i = 0; i < lhs.size(); ++i) {
+                        if ((lhs[i] | 0x20) != (rhs[i] | 0x20)) {
+                            return false;
+                        }
+                    }
+                    return true;
+                }
+
+                static bool contains_ignore_case(string_ref value, string_ref token) {
+                    for (std::size_t i = 0; i + token.size() <= value.size(); ++i) {
+                        if (equals_ignore_case(value.substr(i, token.size()), token)) {
+                            return true;
+                        }
+                    }
+                    return false;
+                }
+
+                /* the last element of a comma-separated list */
+                static string_ref last_token(string_ref value) {
+                    auto comma = value.rfind(',');
+                    return trim(comma == string_ref::npos ? value : value.substr(comma + 1));
+                }
+
+                static string_ref trim(string_ref value) {
+                    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+                        value.remove_prefix(1);
+                    }
+                    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+                        value.remove_suffix(1);
+                    }
+                    return value;
+                }
+
+                static bool is_digit(char c) {
+                    return c >= '0' && c <= '9';
+                }
+
+                static int hex_value(char c) {
+                    if (c >= '0' && c <= '9') {
+                        return c - '0';
+                    }
+                    if (c >= 'a' && c <= 'f') {
+                        return c - 'a' + 10;
+                    }
+                    if (c >= 'A' && c <= 'F') {
+                        return c - 'A' + 10;
+                    }
+                    return -1;
+                }
+
+                state _state;
+                const header_scanner *_scanner;
+                std::size_t _max_line;
+                std::size_t _scanned;
+                bool _http_1_0;
+                bool _chunked;
+                bool _close;
+                bool _keep_alive;
+                bool _expect_continue;
+                boost::optional<std::uint64_t> _content_length;
+                std::uint64_t _remaining;
+            };
+        } // namespace server_message
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_SERVER_REQUEST_PARSER_INC
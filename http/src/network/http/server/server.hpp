@@ -0,0 +1,1341 @@
+#ifndef NETWORK_HTTP_SERVER_SERVER_INC
+#define NETWORK_HTTP_SERVER_SERVER_INC
+
+#include <ctime>
+#include <cerrno>
+#include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <type_traits>
+#include <unordered_set>
+#if defined(__linux__)
+#include <sched.h>
+#include <pthread.h>
+#endif // defined(__linux__)
+#include <sys/socket.h>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/container/small_vector.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/find.hpp>
+#include <boost/system/system_error.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <network/config.hpp>
+#include <network/version.hpp>
+#include <network/http/status.hpp>
+#include <network/http/server/request.hpp>
+#include <network/http/server/request_parser.hpp>
+#include <network/http/client/connection/receive_buffer.hpp>
+
+namespace network {
+    namespace http {
+        class server_options {
+        public:
+            server_options() :
+                _threads(1),
+                _reuse_port(true),
+                _backlog(boost::asio::socket_base::max_listen_connections),
+                _max_pipeline(16),
+                _max_line(8 * 1024),
+                _max_head(64 * 1024),
+                _max_body(8 * 1024 * 1024),
+                _idle_timeout(30000),
+                _server_name(std::string("cpp-netlibx/") + NETLIBX_VERSION) { }
+
+            server_options(const server_options &other) :
+                _threads(other._threads),
+                _reuse_port(other._reuse_port),
+                _backlog(other._backlog),
+                _max_pipeline(other._max_pipeline),
+                _max_line(other._max_line),
+                _max_head(other._max_head),
+                _max_body(other._max_body),
+                _idle_timeout(other._idle_timeout),
+                _server_name(other._server_name) { }
+
+            server_options(server_options &&other) :
+                _threads(std::move(other._threads)),
+                _reuse_port(std::move(other._reuse_port)),
+                _backlog(std::move(other._backlog)),
+                _max_pipeline(std::move(other._max_pipeline)),
+                _max_line(std::move(other._max_line)),
+                _max_head(std::move(other._max_head)),
+                _max_body(std::move(other._max_body)),
+                _idle_timeout(std::move(other._idle_timeout)),
+                _server_name(std::move(other._server_name)) { }
+
+            server_options &operator = (server_options sopts) {
+                sopts.swap(*this);
+                return (*this);
+            }
+
+            void swap(server_options &other) noexcept {
+                using std::swap;
+
+                swap(_threads, other._threads);
+                swap(_reuse_port, other._reuse_port);
+                swap(_backlog, other._backlog);
+                swap(_max_pipeline, other._max_pipeline);
+                swap(_max_line, other._max_line);
+                swap(_max_head, other._max_head);
+                swap(_max_body, other._max_body);
+                swap(_idle_timeout, other._idle_timeout);
+                swap(_server_name, other._server_name);
+            }
+
+            /*
+             * threads: the number of reactors, each an io_service run by
+             * its own thread, pinned to a CPU, serving the connections it
+             * accepted; 0 for one per hardware thread.
+             */
+            server_options &threads(std::size_t count) {
+                _threads = count;
+                return *this;
+            }
+
+            std::size_t threads() const {
+                return _threads;
+            }
+
+            /*
+             * reuse_port: every reactor listens on the port with a socket
+             * of its own, SO_REUSEPORT letting the kernel spread new
+             * connections over them. Without it, or where SO_REUSEPORT is
+             * missing, the first reactor accepts for all of them in turn.
+             */
+            server_options &reuse_port(bool reuse) {
+                _reuse_port = reuse;
+                return *this;
+            }
+
+            bool reuse_port() const {
+                return _reuse_port;
+            }
+
+            server_options &backlog(int backlog) {
+                _backlog = backlog;
+                return *this;
+            }
+
+            int backlog() const {
+                return _backlog;
+            }
+
+            /*
+             * max_pipeline: how many requests of a connection are read
+             * ahead of their responses; reading stops until the oldest
+             * response is written.
+             */
+            server_options &max_pipeline(std::size_t depth) {
+                _max_pipeline = std::max<std::size_t>(depth, 1);
+                return *this;
+            }
+
+            std::size_t max_pipeline() const {
+                return _max_pipeline;
+            }
+
+            /* max_line: longer request or header lines are answered 400 */
+            server_options &max_line(std::size_t size) {
+                _max_line = size;
+                return *this;
+            }
+
+            std::size_t max_line() const {
+                return _max_line;
+            }
+
+            /* max_head: larger heads are answered 431 */
+            server_options &max_head(std::size_t size) {
+                _max_head = size;
+                return *this;
+            }
+
+            std::size_t max_head() const {
+                return _max_head;
+            }
+
+            /* max_body: larger request bodies are answered 413 */
+            server_options &max_body(std::uint64_t size) {
+                _max_body = size;
+                return *this;
+            }
+
+            std::uint64_t max_body() const {
+                return _max_body;
+            }
+
+            /* idle_timeout: connections without a request in progress for longer are closed */
+            server_options &idle_timeout(std::chrono::milliseconds ms) {
+                _idle_timeout = ms;
+                return *this;
+            }
+
+            std::chrono::milliseconds idle_timeout() const {
+                return _idle_timeout;
+            }
+
+            /* server_name: the Server header of responses, none if empty */
+            server_options &server_name(std::string name) {
+                _server_name = std::move(name);
+                return *this;
+            }
+
+            const std::string &server_name() const {
+                return _server_name;
+            }
+
+        private:
+            std::size_t _threads;
+            bool _reuse_port;
+            int _backlog;
+            std::size_t _max_pipeline;
+            std::size_t _max_line;
+            std::size_t _max_head;
+            std::uint64_t _max_body;
+            std::chrono::milliseconds _idle_timeout;
+            std::string _server_name;
+        };
+
+        inline void swap(server_options &lhs, server_options &rhs) noexcept {
+            lhs.swap(rhs);
+        }
+
+        namespace server_message {
+            class response;
+        } // namespace server_message
+
+        typedef std::function<void (const server_message::request &, server_message::response)> server_handler;
+
+        namespace server_connection {
+            class reactor;
+            class connection;
+
+            /*
+             * struct exchange
+             *
+             * A request of a connection and its response, one of the ring
+             * of max_pipeline a connection reads ahead into. The storage
+             * of the strings is kept from one request to the next.
+             */
+            struct exchange {
+                exchange() :
+                    code(status::ok),
+                    sequence(~std::uint64_t(0)),
+                    handles(0),
+                    sent(false),
+                    ready(false),
+                    close(false),
+                    keep_alive(true) { }
+
+                server_message::request request;
+                status::code code;
+                /* the header lines given by the handler */
+                std::string fields;
+                /* the status line, fields and the headers added by the server, as written */
+                std::string head;
+                /* the body, when moved in */
+                std::string owned;
+                /* keeps the body alive, when not owned */
+                std::shared_ptr<const void> keeper;
+                boost::asio::const_buffer body;
+                /* of the request the exchange holds; handles to an earlier one are stale */
+                std::atomic<std::uint64_t> sequence;
+                /* copies of the response handle alive */
+                std::atomic<int> handles;
+                bool sent;
+                bool ready;
+                /* the handler asked for the connection to be closed */
+                bool close;
+                bool keep_alive;
+            };
+        } // namespace server_connection
+
+        namespace server_message {
+            /*
+             * class response
+             *
+             * The handle a handler answers its request with, on its thread
+             * or any other, now or later: set the status and headers, then
+             * send() once. Bodies are not copied: a string is moved in, a
+             * shared string or a buffer, with whatever keeps it alive, is
+             * written from where it is. Content-Length, Date and Server are
+             * added by the server; a Content-Length given is ignored, a
+             * header name that is not a token or a value with CR, LF or NUL
+             * throws boost::system::system_error. The handle can be copied;
+             * when the last copy goes without a response sent, 500 is.
+             * Responses are written in the order of their requests, and
+             * must be sent before the server is destroyed. A handle kept
+             * past its response does nothing.
+             */
+            class response {
+            public:
+                typedef boost::string_ref string_ref;
+
+                response(const response &other) :
+                    _connection(other._connection),
+                    _exchange(other.current()),
+                    _sequence(other._sequence) {
+                    if (_exchange) {
+                        ++_exchange->handles;
+                    }
+                }
+
+                response(response &&other) noexcept :
+                    _connection(std::move(other._connection)),
+                    _exchange(other._exchange),
+                    _sequence(other._sequence) {
+                    other._exchange = nullptr;
+                }
+
+                response &operator = (response other) {
+                    std::swap(_connection, other._connection);
+                    std::swap(_exchange, other._exchange);
+                    std::swap(_sequence, other._sequence);
+                    return *this;
+                }
+
+                ~response() {
+                    release();
+                }
+
+                response &status(status::code code);
+
+                response &header(string_ref name, string_ref value);
+
+                void send();
+
+                void send(std::string body);
+
+                void send(std::shared_ptr<const std::string> body);
+
+                /* body is written from where it is, owner keeps it alive until then */
+                void send(boost::asio::const_buffer body, std::shared_ptr<const void> owner = nullptr);
+
+                bool sent() const {
+                    server_connection::exchange *e = current();
+                    return !e || e->sent;
+                }
+
+            private:
+                friend class server_connection::connection;
+
+                response(std::shared_ptr<server_connection::connection> connection,
+                    server_connection::exchange &e) :
+                    _connection(std::move(connection)),
+                    _exchange(&e),
+                    _sequence(e.sequence) {
+                    ++_exchange->handles;
+                }
+
+                /* the exchange, unless its ring slot has moved on to a later request */
+                server_connection::exchange *current() const {
+                    return _exchange && _exchange->sequence == _sequence ? _exchange : nullptr;
+                }
+
+                void finish();
+
+                void release();
+
+                std::shared_ptr<server_connection::connection> _connection;
+                server_connection::exchange *_exchange;
+                std::uint64_t _sequence;
+            };
+        } // namespace server_message
+
+        namespace server_connection {
+            typedef std::chrono::steady_clock clock;
+
+            /*
+             * class handler_memory
+             *
+             * Room for the one operation of a kind a connection has in
+             * flight, reads or writes, handed to asio through the
+             * allocator of their handler, so that they are not allocated
+             * every time. Larger ones, or a second one, are allocated.
+             */
+            template <std::size_t Size>
+                class handler_memory {
+                    handler_memory(const handler_memory &) = delete;
+                    handler_memory &operator = (const handler_memory &) = delete;
+
+                public:
+                    handler_memory() :
+                        _used(false) { }
+
+                    void *allocate(std::size_t size) {
+                        if (!_used && size <= Size) {
+                            _used = true;
+                            return &_storage;
+                        }
+                        return ::operator new(size);
+                    }
+
+                    void deallocate(void *p) {
+                        if (p == &_storage) {
+                            _used = false;
+                        } else {
+                            ::operator delete(p);
+                        }
+                    }
+
+                private:
+                    typename std::aligned_storage<Size>::type _storage;
+                    bool _used;
+                };
+
+            template <class T, std::size_t Size>
+                class handler_allocator {
+                public:
+                    typedef T value_type;
+
+                    template <class U>
+                        struct rebind {
+                            typedef handler_allocator<U, Size> other;
+                        };
+
+                    explicit handler_allocator(handler_memory<Size> &memory) :
+                        _memory(&memory) { }
+
+                    template <class U>
+                        handler_allocator(const handler_allocator<U, Size> &other) :
+                            _memory(other._memory) { }
+
+                    T *allocate(std::size_t n) const {
+                        return static_cast<T *>(_memory->allocate(sizeof(T) * n));
+                    }
+
+                    void deallocate(T *p, std::size_t) const {
+                        _memory->deallocate(p);
+                    }
+
+                    template <class U>
+                        bool operator == (const handler_allocator<U, Size> &other) const {
+                            return _memory == other._memory;
+                        }
+
+                    template <class U>
+                        bool operator != (const handler_allocator<U, Size> &other) const {
+                            return _memory != other._memory;
+                        }
+
+                private:
+                    template <class U, std::size_t> friend class handler_allocator;
+
+                    handler_memory<Size> *_memory;
+                };
+
+            template <class Handler, std::size_t Size>
+                class allocating_handler {
+                public:
+                    typedef handler_allocator<Handler, Size> allocator_type;
+
+                    allocating_handler(handler_memory<Size> &memory, Handler handler) :
+                        _memory(memory),
+                        _handler(std::move(handler)) { }
+
+                    allocator_type get_allocator() const noexcept {
+                        return allocator_type(_memory);
+                    }
+
+                    template <class... Args>
+                        void operator () (Args &&... args) {
+                            _handler(std::forward<Args>(args)...);
+                        }
+
+                private:
+                    handler_memory<Size> &_memory;
+                    Handler _handler;
+                };
+
+            template <class Handler, std::size_t Size>
+                allocating_handler<typename std::decay<Handler>::type, Size>
+                make_allocating_handler(handler_memory<Size> &memory, Handler &&handler) {
+                    return allocating_handler<typename std::decay<Handler>::type, Size>(
+                        memory, std::forward<Handler>(handler));
+                }
+
+            /*
+             * class connection
+             *
+             * A connection accepted by a reactor, and only used on its
+             * thread but for response::send(). Requests are parsed as they
+             * come, pipelined ones included, into the exchange ring, and
+             * passed to the handler; the responses ready at the front of
+             * the ring are written together by one gather write.
+             */
+            class connection : public std::enable_shared_from_this<connection> {
+                connection(const connection &) = delete;
+                connection &operator = (const connection &) = delete;
+
+            public:
+                connection(reactor &r, boost::asio::ip::tcp::socket socket);
+
+                void start();
+
+                void close();
+
+                /* nothing in progress since limit */
+                bool idle_since(clock::time_point limit) const {
+                    return _first == _next && !_writing && _last_active < limit;
+                }
+
+            private:
+                friend class server_message::request_parser;
+                friend class server_message::response;
+
+                typedef boost::string_ref string_ref;
+                typedef boost::container::small_vector<boost::asio::const_buffer, 64> const_buffers;
+
+                /* responses gathered into one write, at two buffers each */
+                enum { max_gathered = 32 };
+
+                exchange &at(std::uint64_t sequence) {
+                    return _exchanges[sequence % _depth];
+                }
+
+                void read();
+                void on_read(const boost::system::error_code &ec, std::size_t bytes);
+                void process();
+                void dispatch(exchange &e);
+                void reject(exchange &e, status::code code);
+                void finish(exchange &e);
+                void complete(exchange &e);
+                void write();
+                void on_write(const boost::system::error_code &ec);
+
+                /* request_parser handler */
+                void on_request_line(http::method m, string_ref method, string_ref target, string_ref version);
+                void on_header(string_ref name, string_ref value);
+                void on_headers_complete();
+                void on_body(string_ref data);
+
+                reactor &_reactor;
+                boost::asio::ip::tcp::socket _socket;
+                client_connection::receive_buffer _in;
+                server_message::request_parser _parser;
+                std::size_t _depth;
+                std::unique_ptr<exchange[]> _exchanges;
+                /* the oldest exchange not written, the one being read */
+                std::uint64_t _first;
+                std::uint64_t _next;
+                std::size_t _head_size;
+                /* why the request being read is refused, ok if it is not */
+                status::code _refusal;
+                const_buffers _gather;
+                std::size_t _gathered;
+                handler_memory<256> _read_memory;
+                /* the gather write copies its buffers */
+                handler_memory<4096> _write_memory;
+                bool _reading;
+                bool _writing;
+                bool _closing;
+                bool _done_reading;
+                bool _continue;
+                bool _closed;
+                clock::time_point _last_active;
+            };
+
+            /*
+             * class reactor
+             *
+             * An io_service and the thread running it, with the connections
+             * it serves and, unless another reactor accepts for it, its
+             * listening socket. Once a second, it refreshes the Date header
+             * and closes the connections idle for too long.
+             */
+            class reactor {
+                reactor(const reactor &) = delete;
+                reactor &operator = (const reactor &) = delete;
+
+            public:
+                reactor(const server_options &options, const server_handler &handler);
+
+                ~reactor();
+
+                boost::asio::io_service &io_service() {
+                    return _io_service;
+                }
+
+                const server_options &options() const {
+                    return _options;
+                }
+
+                const server_handler &handler() const {
+                    return _handler;
+                }
+
+                /* binds to endpoint, whose port is set to the one bound if 0 */
+                void listen(boost::asio::ip::tcp::endpoint &endpoint, bool reuse_port);
+
+                /* accepts connections for targets, in turn */
+                void accept_for(std::vector<reactor *> targets);
+
+                void start(int cpu);
+
+                /* closes the listening socket and every connection, then lets the thread end */
+                void stop();
+
+                void join();
+
+                bool running_in_this_thread() const {
+                    return std::this_thread::get_id() == _thread_id.load(std::memory_order_relaxed);
+                }
+
+                bool stopping() const {
+                    return _stopping;
+                }
+
+                /* "Date: ...\r\n", updated every second */
+                const std::string &date() const {
+                    return _date;
+                }
+
+                /* "Server: ...\r\n", or empty */
+                const std::string &server_header() const {
+                    return _server_header;
+                }
+
+                static std::vector<int> usable_cpus();
+
+                static void pin_thread(int cpu);
+
+                void add(const std::shared_ptr<connection> &c) {
+                    _connections.insert(c);
+                }
+
+                void remove(const std::shared_ptr<connection> &c) {
+                    _connections.erase(c);
+                }
+
+            private:
+                void accept();
+                void on_accept(const boost::system::error_code &ec);
+                void sweep();
+                void update_date();
+                void shutdown();
+
+                const server_options &_options;
+                const server_handler &_handler;
+                boost::asio::io_service _io_service;
+                std::unique_ptr<boost::asio::io_service::work> _work;
+                std::unique_ptr<boost::asio::ip::tcp::acceptor> _acceptor;
+                std::vector<reactor *> _targets;
+                std::size_t _turn;
+                std::unique_ptr<boost::asio::ip::tcp::socket> _accepted;
+                reactor *_accepted_for;
+                bool _accept_paused;
+                boost::asio::steady_timer _timer;
+                std::unordered_set<std::shared_ptr<connection> > _connections;
+                std::string _date;
+                std::string _server_header;
+                std::thread _thread;
+                std::atomic<std::thread::id> _thread_id;
+                bool _stopping;
+            };
+
+            /* "HTTP/1.1 200 OK\r\n", built once for every code */
+            inline const std::string &status_line(status::code code) {
+                static const std::vector<std::string> lines = [] () {
+                    std::vector<std::string> lines(600);
+                    for (int c = 100; c < 600; ++c) {
+                        /* past network_authentication_required, a value status::code cannot hold */
+                        std::string message = c <= status::network_authentication_required ?
+                            status::message(static_cast<status::code>(c)) : std::string();
+                        if (message.empty() || message == "Invalid Status Code") {
+                            message = "Unknown";
+                        }
+                        lines[c] = "HTTP/1.1 " + std::to_string(c) + " " + message + "\r\n";
+                    }
+                    return lines;
+                }();
+                int c = static_cast<int>(code);
+                return lines[c >= 100 && c < 600 ? c : 500];
+            }
+        } // namespace server_connection
+
+        /*
+         * class server
+         *
+         * Asynchronous HTTP/1.1 server: requests, keep-alive and pipelined
+         * ones included, are passed to the handler on the thread of the
+         * reactor that accepted their connection, which answers them
+         * through the response, there or on another thread. Listening
+         * starts in the constructor, which throws
+         * boost::system::system_error when it fails, and ends with stop()
+         * or the destructor, which close every connection.
+         */
+        class server {
+            server(const server &) = delete;
+            server &operator = (const server &) = delete;
+
+        public:
+            typedef server_handler handler_type;
+
+            server(const std::string &address, std::uint16_t port, handler_type handler,
+                server_options options = server_options());
+
+            ~server();
+
+            /* the port listened on, e.g. when 0 was asked for */
+            std::uint16_t port() const {
+                return _port;
+            }
+
+            void stop();
+
+        private:
+            static bool can_reuse_port();
+
+            server_options _options;
+            handler_type _handler;
+            std::vector<std::unique_ptr<server_connection::reactor> > _reactors;
+            std::uint16_t _port;
+            bool _stopped;
+        };
+
+        namespace server_message {
+            inline response &response::status(status::code code) {
+                if (!sent()) {
+                    _exchange->code = code;
+                }
+                return *this;
+            }
+
+            inline response &response::header(string_ref name, string_ref value) {
+                /* anything else would let a value add headers of its own, or a body */
+                if (name.empty() || active_header_scanner().find_non_token(name.begin(), name.end()) != name.end() ||
+                    value.find_first_of(string_ref("\r\n\0", 3)) != string_ref::npos) {
+                    throw boost::system::system_error(
+                        boost::system::errc::make_error_code(boost::system::errc::invalid_argument),
+                        "invalid response header");
+                }
+                if (sent() || boost::algorithm::iequals(name, constants::content_length())) {
+                    return *this;
+                }
+                if (boost::algorithm::iequals(name, constants::connection()) &&
+                    !boost::algorithm::ifind_first(value, constants::close()).empty()) {
+                    _exchange->close = true;
+                }
+                std::string &fields = _exchange->fields;
+                fields.append(name.data(), name.size());
+                fields.append(": ", 2);
+                fields.append(value.data(), value.size());
+                fields.append("\r\n", 2);
+                return *this;
+            }
+
+            inline void response::send() {
+                send(boost::asio::const_buffer());
+            }
+
+            inline void response::send(std::string body) {
+                if (sent()) {
+                    return;
+                }
+                _exchange->owned = std::move(body);
+                _exchange->body = boost::asio::buffer(_exchange->owned);
+                finish();
+            }
+
+            inline void response::send(std::shared_ptr<const std::string> body) {
+                if (sent()) {
+                    return;
+                }
+                _exchange->body = body ? boost::asio::buffer(*body) : boost::asio::const_buffer();
+                _exchange->keeper = std::move(body);
+                finish();
+            }
+
+            inline void response::send(boost::asio::const_buffer body, std::shared_ptr<const void> owner) {
+                if (sent()) {
+                    return;
+                }
+                _exchange->body = body;
+                _exchange->keeper = std::move(owner);
+                finish();
+            }
+
+            inline void response::finish() {
+                _exchange->sent = true;
+                _connection->finish(*_exchange);
+            }
+
+            /* the last copy answers 500 for a handler that did not */
+            inline void response::release() {
+                if (current() && --_exchange->handles == 0 && !_exchange->sent) {
+                    _exchange->code = status::internal_error;
+                    _exchange->fields.clear();
+                    _exchange->owned.clear();
+                    _exchange->body = boost::asio::const_buffer();
+                    finish();
+                }
+                _exchange = nullptr;
+                _connection.reset();
+            }
+        } // namespace server_message
+
+        namespace server_connection {
+            inline connection::connection(reactor &r, boost::asio::ip::tcp::socket socket) :
+                _reactor(r),
+                _socket(std::move(socket)),
+                _parser(r.options().max_line()),
+                _depth(r.options().max_pipeline()),
+                _exchanges(new exchange[_depth]),
+                _first(0),
+                _next(0),
+                _head_size(0),
+                _refusal(status::ok),
+                _gathered(0),
+                _reading(false),
+                _writing(false),
+                _closing(false),
+                _done_reading(false),
+                _continue(false),
+                _closed(false),
+                _last_active(clock::now()) { }
+
+            inline void connection::start() {
+                if (_reactor.stopping()) {
+                    boost::system::error_code ignored;
+                    _socket.close(ignored);
+                    return;
+                }
+                _reactor.add(shared_from_this());
+                read();
+            }
+
+            inline void connection::close() {
+                if (_closed) {
+                    return;
+                }
+                _closed = true;
+                boost::system::error_code ignored;
+                _socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+                _socket.close(ignored);
+                _reactor.remove(shared_from_this());
+            }
+
+            /* one exchange free at least, or nothing would be read into it */
+            inline void connection::read() {
+                if (_reading || _closed || _done_reading || _next - _first >= _depth) {
+                    return;
+                }
+                _reading = true;
+                auto self = shared_from_this();
+                _socket.async_read_some(_in.prepare(), make_allocating_handler(_read_memory,
+                        [self] (const boost::system::error_code &ec, std::size_t bytes) {
+                            self->on_read(ec, bytes);
+                        }));
+            }
+
+            inline void connection::on_read(const boost::system::error_code &ec, std::size_t bytes) {
+                _reading = false;
+                if (_closed) {
+                    return;
+                }
+                if (ec) {
+                    /* the responses owed are still written, unless the connection is gone */
+                    _done_reading = true;
+                    if (ec != boost::asio::error::eof || (_first == _next && !_writing)) {
+                        close();
+                    }
+                    return;
+                }
+                _in.commit(bytes);
+                _last_active = clock::now();
+                process();
+            }
+
+            inline void connection::process() {
+                while (!_closed && !_done_reading && !_in.empty() && _next - _first < _depth) {
+                    exchange &e = at(_next);
+                    if (_parser.is_idle()) {
+                        e.request.clear();
+                        _head_size = 0;
+                        _refusal = status::ok;
+                    }
+
+                    std::size_t consumed = _parser.parse(_in.data(), _in.size(), *this);
+                    _in.consume(consumed);
+                    if (_parser.has_error()) {
+                        reject(e, status::bad_request);
+                    } else if (_refusal != status::ok) {
+                        reject(e, _refusal);
+                    } else if (_parser.is_complete()) {
+                        dispatch(e);
+                    } else {
+                        break;
+                    }
+                }
+                if (_continue) {
+                    write();
+                }
+                read();
+            }
+
+            inline void connection::dispatch(exchange &e) {
+                e.request._keep_alive = _parser.keep_alive() && !_reactor.stopping();
+                e.code = status::ok;
+                e.fields.clear();
+                e.sent = e.ready = e.close = false;
+                e.keep_alive = e.request._keep_alive;
+                /* handles to the request the slot held before are stale from here on */
+                e.sequence = _next;
+                e.handles = 0;
+                _parser.reset();
+                ++_next;
+                if (!e.keep_alive) {
+                    _done_reading = true;
+                }
+
+                server_message::response r(shared_from_this(), e);
+                try {
+                    _reactor.handler()(e.request, r);
+                } catch (...) {
+                    if (!r.sent()) {
+                        e.fields.clear();
+                        r.status(status::internal_error).send();
+                    }
+                }
+            }
+
+            /* answers code and closes the connection, the request is not passed on */
+            inline void connection::reject(exchange &e, status::code code) {
+                e.code = code;
+                e.fields.clear();
+                e.owned.clear();
+                e.body = boost::asio::const_buffer();
+                e.request._method = method::none;
+                e.sent = true;
+                e.ready = e.close = false;
+                e.keep_alive = false;
+                e.sequence = _next;
+                _parser.reset();
+                _continue = false;
+                ++_next;
+                _done_reading = true;
+                complete(e);
+            }
+
+            inline void connection::finish(exchange &e) {
+                if (_reactor.running_in_this_thread()) {
+                    complete(e);
+                    return;
+                }
+                auto self = shared_from_this();
+                _reactor.io_service().post([self, &e] () { self->complete(e); });
+            }
+
+            inline void connection::complete(exchange &e) {
+                if (_closed) {
+                    return;
+                }
+
+                e.keep_alive = e.keep_alive && !e.close && !_reactor.stopping();
+                if (!e.keep_alive) {
+                    _done_reading = true;
+                }
+
+                int code = static_cast<int>(e.code);
+                bool bodiless = code < 200 || code == status::no_content || code == status::not_modified;
+                if (bodiless || e.request.method() == method::head) {
+                    /* HEAD keeps the Content-Length of the body it does not get */
+                    e.owned.clear();
+                    e.keeper.reset();
+                }
+
+                std::string &head = e.head;
+                head.assign(status_line(e.code));
+                head += e.fields;
+                if (!bodiless) {
+                    char length[32];
+                    int n = std::snprintf(length, sizeof(length), "Content-Length: %zu\r\n",
+                        boost::asio::buffer_size(e.body));
+                    head.append(length, static_cast<std::size_t>(n));
+                }
+                if (bodiless || e.request.method() == method::head) {
+                    e.body = boost::asio::const_buffer();
+                }
+                head += _reactor.date();
+                head += _reactor.server_header();
+                if (!e.keep_alive && !e.close) {
+                    head += "Connection: close\r\n";
+                } else if (e.keep_alive && e.request.version() == "1.0") {
+                    head += "Connection: keep-alive\r\n";
+                }
+                head += "\r\n";
+
+                e.ready = true;
+                write();
+            }
+
+            inline void connection::write() {
+                if (_writing || _closed) {
+                    return;
+                }
+
+                static const char interim[] = "HTTP/1.1 100 Continue\r\n\r\n";
+                _gather.clear();
+                _gathered = 0;
+                _closing = false;
+                if (_continue && _first == _next) {
+                    _gather.push_back(boost::asio::buffer(interim, sizeof(interim) - 1));
+                }
+                _continue = false;
+
+                for (std::uint64_t s = _first; s < _next && _gathered < max_gathered; ++s) {
+                    exchange &e = at(s);
+                    if (!e.ready) {
+                        break;
+                    }
+                    _gather.push_back(boost::asio::buffer(e.head));
+                    if (boost::asio::buffer_size(e.body) != 0) {
+                        _gather.push_back(e.body);
+                    }
+                    ++_gathered;
+                    if (!e.keep_alive) {
+                        /* nothing is written after it */
+                        _closing = true;
+                        break;
+                    }
+                }
+                if (_gather.empty()) {
+                    return;
+                }
+
+                _writing = true;
+                auto self = shared_from_this();
+                boost::asio::async_write(_socket, _gather, make_allocating_handler(_write_memory,
+                        [self] (const boost::system::error_code &ec, std::size_t) {
+                            self->on_write(ec);
+                        }));
+            }
+
+            inline void connection::on_write(const boost::system::error_code &ec) {
+                _writing = false;
+                if (_closed) {
+                    return;
+                }
+                if (ec) {
+                    close();
+                    return;
+                }
+
+                for (std::size_t i = 0; i < _gathered; ++i) {
+                    exchange &e = at(_first);
+                    e.keeper.reset();
+                    e.body = boost::asio::const_buffer();
+                    e.ready = false;
+                    ++_first;
+                }
+                _gathered = 0;
+                _last_active = clock::now();
+
+                if (_closing || (_done_reading && _first == _next)) {
+                    close();
+                    return;
+                }
+                write();
+                process();
+            }
+
+            inline void connection::on_request_line(http::method m, string_ref method,
+                string_ref target, string_ref version) {
+                server_message::request &r = at(_next).request;
+                r._method = m;
+                r._method_name.assign(method.data(), method.size());
+                r._target.assign(target.data(), target.size());
+                r._version.assign(version.data(), version.size());
+                _head_size += method.size() + target.size() + version.size();
+                if (_head_size > _reactor.options().max_head()) {
+                    _refusal = status::request_header_fields_too_large;
+                }
+            }
+
+            inline void connection::on_header(string_ref name, string_ref value) {
+                _head_size += name.size() + value.size() + 4;
+                if (_head_size > _reactor.options().max_head()) {
+                    _refusal = status::request_header_fields_too_large;
+                    return;
+                }
+                at(_next).request._headers.append(name, value);
+            }
+
+            inline void connection::on_headers_complete() {
+                auto length = _parser.content_length();
+                if (!_parser.chunked() && length && *length > _reactor.options().max_body()) {
+                    _refusal = status::request_entity_too_large;
+                }
+                /* only when it is next to be answered, as the interim response goes first */
+                _continue = _refusal == status::ok && _parser.expect_continue() && _first == _next &&
+                    (_parser.chunked() || (length && *length != 0));
+            }
+
+            inline void connection::on_body(string_ref data) {
+                std::string &body = at(_next).request._body;
+                if (_refusal != status::ok || body.size() + data.size() > _reactor.options().max_body()) {
+                    _refusal = status::request_entity_too_large;
+                    return;
+                }
+                body.append(data.data(), data.size());
+            }
+
+            inline reactor::reactor(const server_options &options, const server_handler &handler) :
+                _options(options),
+                _handler(handler),
+                _work(new boost::asio::io_service::work(_io_service)),
+                _turn(0),
+                _accepted_for(nullptr),
+                _accept_paused(false),
+                _timer(_io_service),
+                _stopping(false) {
+                if (!_options.server_name().empty()) {
+                    _server_header = "Server: " + _options.server_name() + "\r\n";
+                }
+                update_date();
+            }
+
+            inline reactor::~reactor() {
+                stop();
+                join();
+            }
+
+            inline void reactor::listen(boost::asio::ip::tcp::endpoint &endpoint, bool reuse_port) {
+                _acceptor.reset(new boost::asio::ip::tcp::acceptor(_io_service));
+                _acceptor->open(endpoint.protocol());
+                _acceptor->set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+#if defined(SO_REUSEPORT)
+                if (reuse_port) {
+                    int on = 1;
+                    if (::setsockopt(_acceptor->native_handle(), SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0) {
+                        throw boost::system::system_error(errno, boost::system::system_category(), "SO_REUSEPORT");
+                    }
+                }
+#else
+                (void)reuse_port;
+#endif // defined(SO_REUSEPORT)
+                _acceptor->bind(endpoint);
+                _acceptor->listen(_options.backlog());
+                endpoint.port(_acceptor->local_endpoint().port());
+            }
+
+            inline void reactor::accept_for(std::vector<reactor *> targets) {
+                _targets = std::move(targets);
+                _io_service.post([this] () { accept(); });
+            }
+
+            inline void reactor::start(int cpu) {
+                _thread = std::thread([this, cpu] () {
+                        _thread_id = std::this_thread::get_id();
+                        if (cpu >= 0) {
+                            pin_thread(cpu);
+                        }
+                        sweep();
+                        _io_service.run();
+                    });
+            }
+
+            inline void reactor::stop() {
+                if (_work) {
+                    _io_service.post([this] () { shutdown(); });
+                    _work.reset();
+                }
+            }
+
+            inline void reactor::join() {
+                if (_thread.joinable()) {
+                    _thread.join();
+                }
+            }
+
+            inline void reactor::accept() {
+                if (_stopping || !_acceptor) {
+                    return;
+                }
+                _accepted_for = _targets[_turn++ % _targets.size()];
+                _accepted.reset(new boost::asio::ip::tcp::socket(_accepted_for->io_service()));
+                _acceptor->async_accept(*_accepted, [this] (const boost::system::error_code &ec) {
+                        on_accept(ec);
+                    });
+            }
+
+            inline void reactor::on_accept(const boost::system::error_code &ec) {
+                if (ec == boost::asio::error::operation_aborted || _stopping) {
+                    return;
+                }
+                if (ec) {
+                    /* e.g. out of descriptors: tried again on the next sweep */
+                    _accept_paused = true;
+                    return;
+                }
+
+                boost::system::error_code ignored;
+                _accepted->set_option(boost::asio::ip::tcp::no_delay(true), ignored);
+                reactor &target = *_accepted_for;
+                auto c = std::make_shared<connection>(target, std::move(*_accepted));
+                if (&target == this) {
+                    c->start();
+                } else {
+                    target.io_service().post([c] () { c->start(); });
+                }
+                accept();
+            }
+
+            inline void reactor::sweep() {
+                if (_stopping) {
+                    return;
+                }
+                update_date();
+
+                auto limit = clock::now() - _options.idle_timeout();
+                std::vector<std::shared_ptr<connection> > idle;
+                for (const auto &c : _connections) {
+                    if (c->idle_since(limit)) {
+                        idle.push_back(c);
+                    }
+                }
+                for (const auto &c : idle) {
+                    c->close();
+                }
+
+                if (_accept_paused) {
+                    _accept_paused = false;
+                    accept();
+                }
+
+                _timer.expires_from_now(std::chrono::seconds(1));
+                _timer.async_wait([this] (const boost::system::error_code &ec) {
+                        if (!ec) {
+                            sweep();
+                        }
+                    });
+            }
+
+            inline void reactor::update_date() {
+                char date[64];
+                std::time_t now = std::time(nullptr);
+                std::tm tm;
+                gmtime_r(&now, &tm);
+                std::size_t n = std::strftime(date, sizeof(date), "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm);
+                _date.assign(date, n);
+            }
+
+            inline void reactor::shutdown() {
+                _stopping = true;
+                boost::system::error_code ignored;
+                if (_acceptor) {
+                    _acceptor->close(ignored);
+                }
+                _timer.cancel(ignored);
+                std::vector<std::shared_ptr<connection> > open(_connections.begin(), _connections.end());
+                for (const auto &c : open) {
+                    c->close();
+                }
+            }
+        } // namespace server_connection
+
+        inline server::server(const std::string &address, std::uint16_t port, handler_type handler,
+            server_options options) :
+            _options(std::move(options)),
+            _handler(std::move(handler)),
+            _port(0),
+            _stopped(false) {
+            std::size_t threads = _options.threads();
+            if (threads == 0) {
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+            for (std::size_t i = 0; i < threads; ++i) {
+                _reactors.emplace_back(new server_connection::reactor(_options, _handler));
+            }
+
+            boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address::from_string(address), port);
+            if (threads > 1 && _options.reuse_port() && can_reuse_port()) {
+                /* the first binds the port asked for, or picks one the others then bind */
+                for (auto &r : _reactors) {
+                    r->listen(endpoint, true);
+                    r->accept_for({ r.get() });
+                }
+            } else {
+                std::vector<server_connection::reactor *> targets;
+                for (auto &r : _reactors) {
+                    targets.push_back(r.get());
+                }
+                _reactors.front()->listen(endpoint, false);
+                _reactors.front()->accept_for(std::move(targets));
+            }
+            _port = endpoint.port();
+
+            std::vector<int> cpus = threads > 1 ? server_connection::reactor::usable_cpus() : std::vector<int>();
+            for (std::size_t i = 0; i < threads; ++i) {
+                _reactors[i]->start(cpus.empty() ? -1 : cpus[i % cpus.size()]);
+            }
+        }
+
+        inline server::~server() {
+            stop();
+        }
+
+        inline void server::stop() {
+            if (_stopped) {
+                return;
+            }
+            _stopped = true;
+            for (auto &r : _reactors) {
+                r->stop();
+            }
+            for (auto &r : _reactors) {
+                r->join();
+            }
+        }
+
+        inline bool server::can_reuse_port() {
+#if defined(SO_REUSEPORT)
+            return true;
+#else
+            return false;
+#endif // defined(SO_REUSEPORT)
+        }
+
+        inline std::vector<int> server_connection::reactor::usable_cpus() {
+            std::vector<int> cpus;
+#if defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+                for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                    if (CPU_ISSET(cpu, &set)) {
+                        cpus.push_back(cpu);
+                    }
+                }
+            }
+#endif // defined(__linux__)
+            return cpus;
+        }
+
+        /* best effort, the thread runs anywhere if this fails */
+        inline void server_connection::reactor::pin_thread(int cpu) {
+#if defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+            (void)cpu;
+#endif // defined(__linux__)
+        }
+    } // namespace http
+} // namespace network
+
+#endif // NETWORK_HTTP_SERVER_SERVER_INC
@@ -4,10 +4,11 @@
 #include <string>
 #include <unordered_map>
 #include <functional>
+#include <cstdint>
 
 namespace network{
     namespace http {
-        namspace status {
+        namespace status {
             enum code {
                 // informational
                 continue_           = 100,
@@ -20,7 +21,7 @@ namespace network{
                 non_auth_info       = 203,
                 no_content          = 204,
                 reset_content       = 205,
-                partial_conten      = 206,
+                partial_content     = 206,
 
                 // redirection
                 multiple_choices    = 300,
@@ -30,6 +31,7 @@ namespace network{
                 not_modified        = 304,
                 use_proxy           = 305,
                 temporary_redirect  = 307,
+                permanent_redirect  = 308,
 
                 // client error
                 bad_request         = 400,
@@ -67,13 +69,11 @@ namespace network{
     } // end http
 } // end network
 
-typedef enum code code;
-
 #if !defined(DOXYGEN_SHOULD_SKIP_THIS)
 namespace std {
     template <>
-        struct hash<network::http::v2::status::code> {
-            std::size_t operator()(network::http::v2::status::code status_code) const {
+        struct hash<network::http::status::code> {
+            std::size_t operator()(network::http::status::code status_code) const {
                 hash<std::uint16_t> hasher;
                 return hasher(static_cast<std::uint16_t>(status_code));
             }
@@ -114,6 +114,7 @@ namespace network {
                             {code::not_modified, "Not Modified"},
                             {code::use_proxy, "Use Proxy"},
                             {code::temporary_redirect, "Temporary Redirect"},
+                            {code::permanent_redirect, "Permanent Redirect"},
                             {code::bad_request, "Bad Request"},
                             {code::unauthorized, "Unauthorized"},
                             {code::payment_required, "Payment Required"},
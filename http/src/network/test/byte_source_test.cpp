@@ -0,0 +1,95 @@
+/*
+ * Request bodies from byte sources: a sized source that ends before its
+ * size, or runs past it, fails the request instead of leaving the server
+ * waiting for the rest, and its connection is not reused.
+ */
+#include <string>
+#include <chrono>
+#include <future>
+#include <algorithm>
+#include <network/http/client.hpp>
+#include "../bench/loopback_server.hpp"
+#include "check.hpp"
+
+namespace {
+    using namespace network::http;
+
+    /* announces `announced` bytes, holds `actual` */
+    class sized_source : public client_message::byte_source {
+    public:
+        sized_source(std::uint64_t announced, std::size_t actual) :
+            _announced(announced),
+            _data(actual, 'b'),
+            _offset(0) { }
+
+        virtual boost::optional<std::uint64_t> size() const {
+            return _announced;
+        }
+
+        virtual const_buffer next(std::size_t max_len) {
+            std::size_t len = std::min(max_len, _data.size() - _offset);
+            const_buffer piece(_data.data() + _offset, len);
+            _offset += len;
+            return piece;
+        }
+
+    private:
+        std::uint64_t _announced;
+        std::string _data;
+        std::size_t _offset;
+    };
+
+    request body_request(const network::bench::loopback_server &server, std::uint64_t announced, std::size_t actual) {
+        request req(network::uri(server.url("/upload")));
+        req.body(std::make_shared<sized_source>(announced, actual));
+        return req;
+    }
+
+    /* the error the request failed with, invalid_response if it did not */
+    std::error_code failure(std::future<response> &future) {
+        if (future.wait_for(std::chrono::seconds(5)) != std::future_status::ready) {
+            return make_error_code(client_error::invalid_response);
+        }
+        try {
+            future.get();
+        } catch (const client_exception &e) {
+            return e.code();
+        } catch (...) {
+        }
+        return make_error_code(client_error::invalid_response);
+    }
+
+    void ends_early() {
+        network::bench::loopback_server server;
+        client c;
+
+        /* several pieces are sent before the source runs dry */
+        auto future = c.post(body_request(server, 1024 * 1024, 200 * 1024));
+        NETWORK_CHECK(failure(future) == make_error_code(client_error::invalid_request));
+        NETWORK_CHECK(server.requests() == 0);
+
+        auto empty = c.post(body_request(server, 10, 0));
+        NETWORK_CHECK(failure(empty) == make_error_code(client_error::invalid_request));
+
+        /* the half-sent connections were dropped, a good body gets a new one */
+        auto response = c.post(body_request(server, 300 * 1024, 300 * 1024)).get();
+        NETWORK_CHECK(response.status() == status::code::ok);
+        NETWORK_CHECK(server.requests() == 1);
+        NETWORK_CHECK(server.accepted() == 3);
+    }
+
+    void runs_long() {
+        network::bench::loopback_server server;
+        client c;
+
+        auto future = c.post(body_request(server, 1000, 5000));
+        NETWORK_CHECK(failure(future) == make_error_code(client_error::invalid_request));
+        NETWORK_CHECK(server.requests() == 0);
+    }
+} // namespace
+
+int main() {
+    ends_early();
+    runs_long();
+    return network::test::report("byte_source_test");
+}
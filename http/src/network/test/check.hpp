@@ -0,0 +1,64 @@
+#ifndef NETWORK_TEST_CHECK_HPP
+#define NETWORK_TEST_CHECK_HPP
+
+/*
+ * The few helpers the tests share. Each test is a program of its own that
+ * runs every case, reports the failed checks on stderr and exits with 1 if
+ * there were any.
+ */
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <boost/asio/io_service.hpp>
+
+namespace network {
+    namespace test {
+        inline std::atomic<int> &failures() {
+            static std::atomic<int> count(0);
+            return count;
+        }
+
+        inline void check(bool ok, const char *what, const char *file, int line) {
+            if (!ok) {
+                ++failures();
+                std::cerr << file << ":" << line << ": check failed: " << what << std::endl;
+            }
+        }
+
+        /* what main returns */
+        inline int report(const char *name) {
+            int failed = failures();
+            std::cout << name << ": " << (failed ? "FAILED" : "passed");
+            if (failed) {
+                std::cout << " (" << failed << " checks)";
+            }
+            std::cout << std::endl;
+            return failed ? 1 : 0;
+        }
+
+        /* runs io_service until it is out of work, ready to be run again */
+        inline void drain(boost::asio::io_service &io_service) {
+            io_service.run();
+            io_service.restart();
+        }
+
+        /* polls io_service until done() or the timeout, returns done() */
+        template <class Predicate>
+        bool run_until(boost::asio::io_service &io_service, Predicate done,
+            std::chrono::milliseconds timeout = std::chrono::seconds(5)) {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            while (!done() && std::chrono::steady_clock::now() < deadline) {
+                if (io_service.poll() == 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                io_service.restart();
+            }
+            return done();
+        }
+    } // namespace test
+} // namespace network
+
+#define NETWORK_CHECK(expr) ::network::test::check((expr), #expr, __FILE__, __LINE__)
+
+#endif // NETWORK_TEST_CHECK_HPP
@@ -0,0 +1,236 @@
+/*
+ * happy_eyeballs against loopback listeners: endpoints that never answer
+ * are listeners whose accept queue is full, so their SYNs are dropped.
+ * Checks the order of the attempts, the stagger between them, the winner,
+ * that the losers are cancelled and what connect_observer reports.
+ */
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <boost/asio.hpp>
+#include <network/http/client.hpp>
+#include <network/http/client/connection/happy_eyeballs.hpp>
+#include <network/http/client/connection/normal_connection.hpp>
+#include "../bench/loopback_server.hpp"
+#include "check.hpp"
+
+namespace {
+    using namespace network::http::client_connection;
+    typedef boost::asio::ip::tcp::endpoint endpoint;
+    typedef boost::asio::ip::address address;
+    typedef std::chrono::steady_clock clock;
+
+    const std::chrono::milliseconds delay(100);
+
+    /* a listener on address:port that never completes another connection */
+    class blackhole {
+    public:
+        blackhole(boost::asio::io_service &io_service, const address &a, std::uint16_t port = 0) :
+            _acceptor(io_service),
+            _filler(io_service) {
+            _acceptor.open(a.is_v6() ? boost::asio::ip::tcp::v6() : boost::asio::ip::tcp::v4());
+            _acceptor.bind(endpoint(a, port));
+            _acceptor.listen(0);
+            /* a backlog of 0 still queues one connection, fill it */
+            _filler.connect(_acceptor.local_endpoint());
+        }
+
+        endpoint local_endpoint() const {
+            return _acceptor.local_endpoint();
+        }
+
+    private:
+        boost::asio::ip::tcp::acceptor _acceptor;
+        boost::asio::ip::tcp::socket _filler;
+    };
+
+    std::chrono::milliseconds ms(clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(d);
+    }
+
+    struct race_result {
+        race_result() : calls(0) { }
+
+        int calls;
+        boost::system::error_code ec;
+        happy_eyeballs::connection_ptr winner;
+        std::vector<connect_attempt> attempts;
+        clock::duration took;
+    };
+
+    race_result race(const happy_eyeballs::endpoints &candidates, std::chrono::milliseconds attempt_delay) {
+        boost::asio::io_service io_service;
+        race_result result;
+        auto race = std::make_shared<happy_eyeballs>(io_service, candidates, "localhost",
+            [&io_service] () { return std::make_shared<normal_connection>(io_service); },
+            attempt_delay);
+        auto start = clock::now();
+        race->async_connect([&] (const boost::system::error_code &ec, happy_eyeballs::connection_ptr winner,
+                const std::vector<connect_attempt> &attempts) {
+                ++result.calls;
+                result.ec = ec;
+                result.winner = winner;
+                result.attempts = attempts;
+                result.took = clock::now() - start;
+            });
+        network::test::run_until(io_service, [&result] () { return result.calls > 0; });
+        if (result.winner) {
+            result.winner->disconnect();
+        }
+        return result;
+    }
+
+    void interleave() {
+        endpoint v6a(address::from_string("2001:db8::1"), 80), v6b(address::from_string("2001:db8::2"), 80),
+            v6c(address::from_string("2001:db8::3"), 80);
+        endpoint v4a(address::from_string("192.0.2.1"), 80), v4b(address::from_string("192.0.2.2"), 80);
+
+        happy_eyeballs::endpoints ordered = happy_eyeballs::interleave({ v6a, v6b, v6c, v4a, v4b });
+        NETWORK_CHECK((ordered == happy_eyeballs::endpoints{ v6a, v4a, v6b, v4b, v6c }));
+
+        /* the family of the first endpoint goes first */
+        ordered = happy_eyeballs::interleave({ v4a, v6a, v6b, v4b });
+        NETWORK_CHECK((ordered == happy_eyeballs::endpoints{ v4a, v6a, v4b, v6b }));
+        NETWORK_CHECK(happy_eyeballs::interleave({}).empty());
+    }
+
+    void stagger() {
+        network::bench::loopback_server server;
+        boost::asio::io_service io_service;
+        blackhole silent(io_service, address::from_string("127.0.0.1"));
+        endpoint live(address::from_string("127.0.0.1"), server.port());
+
+        race_result result = race({ silent.local_endpoint(), live }, delay);
+        NETWORK_CHECK(result.calls == 1 && !result.ec && result.winner);
+        NETWORK_CHECK(result.attempts.size() == 2);
+        if (result.attempts.size() == 2) {
+            const connect_attempt &loser = result.attempts[0], &winner = result.attempts[1];
+            NETWORK_CHECK(loser.endpoint == silent.local_endpoint() && !loser.won);
+            NETWORK_CHECK(loser.error == boost::asio::error::operation_aborted);
+            NETWORK_CHECK(winner.endpoint == live && winner.won && !winner.error);
+            /* the second attempt waits for the delay, not for the first one to time out */
+            NETWORK_CHECK(ms(winner.started) >= delay);
+            NETWORK_CHECK(ms(winner.started) < delay * 5);
+            NETWORK_CHECK(loser.finished >= winner.finished);
+        }
+        NETWORK_CHECK(ms(result.took) < delay * 5);
+    }
+
+    void failure_skips_delay() {
+        network::bench::loopback_server server;
+        endpoint live(address::from_string("127.0.0.1"), server.port());
+
+        /* nothing listens on a port just released */
+        endpoint refused;
+        {
+            boost::asio::io_service io_service;
+            boost::asio::ip::tcp::acceptor closed(io_service, endpoint(address::from_string("127.0.0.1"), 0));
+            refused = closed.local_endpoint();
+        }
+
+        race_result result = race({ refused, live }, std::chrono::seconds(10));
+        NETWORK_CHECK(result.calls == 1 && !result.ec && result.winner);
+        NETWORK_CHECK(result.attempts.size() == 2);
+        if (result.attempts.size() == 2) {
+            NETWORK_CHECK(result.attempts[0].error == boost::asio::error::connection_refused);
+            NETWORK_CHECK(result.attempts[1].won);
+            NETWORK_CHECK(ms(result.attempts[1].started) < std::chrono::seconds(1));
+        }
+
+        /* every attempt failing reports the last error */
+        result = race({ refused, refused }, delay);
+        NETWORK_CHECK(result.calls == 1 && result.ec == boost::asio::error::connection_refused && !result.winner);
+        NETWORK_CHECK(result.attempts.size() == 2);
+    }
+
+    void cancel() {
+        boost::asio::io_service io_service;
+        blackhole first(io_service, address::from_string("127.0.0.1")), second(io_service, address::from_string("::1"));
+        int calls = 0;
+        boost::system::error_code error;
+        std::vector<connect_attempt> reported;
+        auto race = std::make_shared<happy_eyeballs>(io_service,
+            happy_eyeballs::endpoints{ first.local_endpoint(), second.local_endpoint() }, "localhost",
+            [&io_service] () { return std::make_shared<normal_connection>(io_service); },
+            std::chrono::milliseconds(10));
+        race->async_connect([&] (const boost::system::error_code &ec, happy_eyeballs::connection_ptr,
+                const std::vector<connect_attempt> &attempts) {
+                ++calls;
+                error = ec;
+                reported = attempts;
+            });
+
+        boost::asio::steady_timer timer(io_service);
+        timer.expires_from_now(std::chrono::milliseconds(50));
+        timer.async_wait([race] (const boost::system::error_code &) { race->cancel(); });
+        network::test::run_until(io_service, [&calls] () { return calls > 0; });
+        network::test::drain(io_service);
+
+        NETWORK_CHECK(calls == 1 && error == boost::asio::error::operation_aborted);
+        NETWORK_CHECK(reported.size() == 2);
+        for (const auto &attempt : reported) {
+            NETWORK_CHECK(attempt.error == boost::asio::error::operation_aborted && !attempt.won);
+        }
+    }
+
+    /* the same race through the client, as connect_observer sees it */
+    void observer() {
+        using namespace network::http;
+
+        network::bench::loopback_server server;
+        boost::asio::io_service io_service;
+        /* same port as the live server, on addresses that do not answer */
+        blackhole silent_v4(io_service, address::from_string("127.0.0.2"), server.port());
+        blackhole silent_v6(io_service, address::from_string("::1"), server.port());
+
+        auto cache = std::make_shared<resolver_cache>();
+        cache->add_host("race.test", {
+                address::from_string("127.0.0.2"),
+                address::from_string("127.0.0.1"),
+                address::from_string("::1") });
+
+        std::vector<std::vector<connect_attempt> > observed;
+        client c(client_options()
+            .cache_resolved(true)
+            .resolver_cache(cache)
+            .connection_attempt_delay(delay)
+            .connect_observer([&observed] (const std::vector<connect_attempt> &attempts) {
+                    observed.push_back(attempts);
+                }));
+
+        auto response = c.get(request(network::uri("http://race.test:" + std::to_string(server.port()) + "/"))).get();
+        NETWORK_CHECK(response.status() == status::code::ok);
+        NETWORK_CHECK(observed.size() == 1);
+        if (observed.size() != 1 || observed[0].size() != 3) {
+            NETWORK_CHECK(!"three attempts reported");
+            return;
+        }
+
+        /* IPv4, then IPv6, then IPv4 again, each one delay after the last */
+        const std::vector<connect_attempt> &attempts = observed[0];
+        NETWORK_CHECK(attempts[0].endpoint == silent_v4.local_endpoint());
+        NETWORK_CHECK(attempts[1].endpoint == silent_v6.local_endpoint());
+        NETWORK_CHECK(attempts[2].endpoint == endpoint(address::from_string("127.0.0.1"), server.port()));
+        NETWORK_CHECK(ms(attempts[1].started - attempts[0].started) >= delay);
+        NETWORK_CHECK(ms(attempts[2].started - attempts[1].started) >= delay);
+        NETWORK_CHECK(ms(attempts[2].started) < delay * 6);
+        NETWORK_CHECK(attempts[2].won && !attempts[2].error);
+        NETWORK_CHECK(!attempts[0].won && attempts[0].error == boost::asio::error::operation_aborted);
+        NETWORK_CHECK(!attempts[1].won && attempts[1].error == boost::asio::error::operation_aborted);
+
+        /* the winner went back to the pool, the next request races nothing */
+        c.get(request(network::uri("http://race.test:" + std::to_string(server.port()) + "/"))).get();
+        NETWORK_CHECK(observed.size() == 1);
+        NETWORK_CHECK(server.accepted() == 1);
+    }
+} // namespace
+
+int main() {
+    interleave();
+    stagger();
+    failure_skips_delay();
+    cancel();
+    observer();
+    return network::test::report("happy_eyeballs_test");
+}
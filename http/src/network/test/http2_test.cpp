@@ -0,0 +1,522 @@
+/*
+ * HTTP/2 against loopback_h2_server: h2c with prior knowledge and h2
+ * chosen with ALPN, requests multiplexed on one session, flow control
+ * while a sink holds a stream back, GOAWAY and REFUSED_STREAM retries,
+ * CONTINUATION floods, trailers, SETTINGS changes on open streams and
+ * malformed :status values; and HPACK against RFC 7541 Appendix C.
+ */
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <future>
+#include <algorithm>
+#include <condition_variable>
+#include <network/http/client.hpp>
+#include "../bench/loopback_h2_server.hpp"
+#include "../bench/loopback_server.hpp"
+#include "check.hpp"
+
+namespace {
+    using namespace network::http;
+    namespace h2 = network::http::http2;
+    typedef network::bench::loopback_h2_server h2_server;
+    typedef std::vector<std::pair<std::string, std::string> > fields;
+
+    std::string unhex(const std::string &hex) {
+        std::string bytes;
+        for (std::size_t i = 0; i + 1 < hex.size(); i += 2) {
+            bytes.push_back(static_cast<char>(std::stoi(hex.substr(i, 2), nullptr, 16)));
+        }
+        return bytes;
+    }
+
+    std::string pattern(std::size_t size) {
+        std::string body(size, '\0');
+        for (std::size_t i = 0; i < size; ++i) {
+            body[i] = static_cast<char>('a' + (i * 7 + i / 4096) % 26);
+        }
+        return body;
+    }
+
+    /* polls until pred holds, false after five seconds */
+    template <class Predicate>
+        bool eventually(Predicate pred) {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (!pred()) {
+                if (std::chrono::steady_clock::now() > deadline) {
+                    return false;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            return true;
+        }
+
+    /* true if the request failed within five seconds */
+    bool failed(std::future<response> &future) {
+        if (future.wait_for(std::chrono::seconds(5)) != std::future_status::ready) {
+            return false;
+        }
+        try {
+            future.get();
+        } catch (...) {
+            return true;
+        }
+        return false;
+    }
+
+    std::string body_of(const response &r) {
+        return std::string(r.body().data(), r.body().size());
+    }
+
+    client_options h2_options() {
+        return client_options().http2(true);
+    }
+
+    request get(const h2_server &server, const std::string &path) {
+        return request(network::uri(server.url(path)));
+    }
+
+    /* decodes each block in turn with one decoder, as blocks of one connection */
+    void check_decoding(std::size_t table_size, const std::vector<std::string> &blocks,
+        const std::vector<fields> &expected, const std::vector<std::size_t> &sizes) {
+        h2::hpack::decoder decoder(table_size);
+        for (std::size_t i = 0; i < blocks.size(); ++i) {
+            fields decoded;
+            std::string block = unhex(blocks[i]);
+            bool valid = decoder.decode(block.data(), block.size(), [&decoded] (boost::string_ref name, boost::string_ref value) {
+                    decoded.emplace_back(std::string(name.data(), name.size()), std::string(value.data(), value.size()));
+                });
+            NETWORK_CHECK(valid);
+            NETWORK_CHECK(decoded == expected[i]);
+            NETWORK_CHECK(decoder.table().size() == sizes[i]);
+        }
+    }
+
+    /* encodes each list in turn with one encoder and compares the bytes */
+    void check_encoding(std::size_t table_size, const std::vector<std::string> &blocks,
+        const std::vector<fields> &headers) {
+        h2::hpack::encoder encoder(table_size);
+        for (std::size_t i = 0; i < blocks.size(); ++i) {
+            std::string block;
+            encoder.begin(block);
+            for (const auto &f : headers[i]) {
+                encoder.encode(block, f.first, f.second);
+            }
+            NETWORK_CHECK(block == unhex(blocks[i]));
+        }
+    }
+
+    void hpack_vectors() {
+        /* C.2: one field each, from an empty table */
+        check_decoding(4096, { "400a637573746f6d2d6b65790d637573746f6d2d686561646572" },
+            { { { "custom-key", "custom-header" } } }, { 55 });
+        check_decoding(4096, { "040c2f73616d706c652f70617468" }, { { { ":path", "/sample/path" } } }, { 0 });
+        check_decoding(4096, { "100870617373776f726406736563726574" }, { { { "password", "secret" } } }, { 0 });
+        check_decoding(4096, { "82" }, { { { ":method", "GET" } } }, { 0 });
+
+        std::vector<fields> requests = {
+            { { ":method", "GET" }, { ":scheme", "http" }, { ":path", "/" }, { ":authority", "www.example.com" } },
+            { { ":method", "GET" }, { ":scheme", "http" }, { ":path", "/" }, { ":authority", "www.example.com" },
+                { "cache-control", "no-cache" } },
+            { { ":method", "GET" }, { ":scheme", "https" }, { ":path", "/index.html" },
+                { ":authority", "www.example.com" }, { "custom-key", "custom-value" } },
+        };
+        std::vector<std::size_t> request_sizes = { 57, 110, 164 };
+
+        /* C.3: requests without Huffman coding */
+        check_decoding(4096, {
+                "828684410f7777772e6578616d706c652e636f6d",
+                "828684be58086e6f2d6361636865",
+                "828785bf400a637573746f6d2d6b65790c637573746f6d2d76616c7565" },
+            requests, request_sizes);
+
+        /* C.4: the same with Huffman coding, which is what the encoder writes */
+        std::vector<std::string> c4 = {
+            "828684418cf1e3c2e5f23a6ba0ab90f4ff",
+            "828684be5886a8eb10649cbf",
+            "828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf" };
+        check_decoding(4096, c4, requests, request_sizes);
+        check_encoding(4096, c4, requests);
+
+        std::vector<fields> responses = {
+            { { ":status", "302" }, { "cache-control", "private" }, { "date", "Mon, 21 Oct 2013 20:13:21 GMT" },
+                { "location", "https://www.example.com" } },
+            { { ":status", "307" }, { "cache-control", "private" }, { "date", "Mon, 21 Oct 2013 20:13:21 GMT" },
+                { "location", "https://www.example.com" } },
+            { { ":status", "200" }, { "cache-control", "private" }, { "date", "Mon, 21 Oct 2013 20:13:22 GMT" },
+                { "location", "https://www.example.com" }, { "content-encoding", "gzip" },
+                { "set-cookie", "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1" } },
+        };
+        std::vector<std::size_t> response_sizes = { 222, 222, 215 };
+
+        /* C.5: responses in a 256 byte table, which evicts */
+        check_decoding(256, {
+                "4803333032580770726976617465611d4d6f6e2c203231204f637420323031332032303a31333a323120474d54"
+                "6e1768747470733a2f2f7777772e6578616d706c652e636f6d",
+                "4803333037c1c0bf",
+                "88c1611d4d6f6e2c203231204f637420323031332032303a31333a323220474d54c05a04677a69707738666f6f3d"
+                "4153444a4b48514b425a584f5157454f50495541585157454f49553b206d61782d6167653d333630303b207665"
+                "7273696f6e3d31" },
+            responses, response_sizes);
+
+        /* C.6: the same with Huffman coding */
+        std::vector<std::string> c6 = {
+            "488264025885aec3771a4b6196d07abe941054d444a8200595040b8166e082a62d1bff6e919d29ad171863c78f0b97"
+            "c8e9ae82ae43d3",
+            "4883640effc1c0bf",
+            "88c16196d07abe941054d444a8200595040b8166e084a62d1bffc05a839bd9ab77ad94e7821dd7f2e6c7b335dfdfcd"
+            "5b3960d5af27087f3672c1ab270fb5291f9587316065c003ed4ee5b1063d5007" };
+        check_decoding(256, c6, responses, response_sizes);
+        /* Huffman coding leaves "307" at three bytes, so the encoder keeps it literal */
+        c6[1] = "4803333037c1c0bf";
+        check_encoding(256, c6, responses);
+
+        /* an index past the dynamic table is malformed */
+        h2::hpack::decoder decoder;
+        std::string block = unhex("be");
+        NETWORK_CHECK(!decoder.decode(block.data(), block.size(), [] (boost::string_ref, boost::string_ref) { }));
+    }
+
+    /* http:// with http2 talks HTTP/2 straight away, and keeps the session */
+    void prior_knowledge() {
+        h2_server server;
+        client c(h2_options());
+        for (int i = 0; i < 2; ++i) {
+            auto response = c.get(get(server, "/")).get();
+            NETWORK_CHECK(response.status() == status::code::ok);
+            NETWORK_CHECK(response.version() == "2");
+            NETWORK_CHECK(body_of(response) == std::string(64, 'x'));
+        }
+        auto stats = server.statistics();
+        NETWORK_CHECK(stats.connections == 1);
+        NETWORK_CHECK(stats.requests == 2);
+        NETWORK_CHECK(stats.client_initial_window == 1024 * 1024);
+    }
+
+#if defined(NETLIBX_ENABLE_HTTPS)
+    /* https:// asks for h2 with ALPN, and talks HTTP/1.1 to servers that do not choose it */
+    void alpn() {
+        auto tls = std::make_shared<client_connection::tls_context>(
+            std::vector<std::string>(), std::vector<std::string>(), false);
+
+        h2_server server(network::bench::self_signed_context());
+        client c(h2_options().tls_context(tls));
+        auto response = c.get(get(server, "/")).get();
+        NETWORK_CHECK(response.status() == status::code::ok);
+        NETWORK_CHECK(response.version() == "2");
+        NETWORK_CHECK(server.statistics().requests == 1);
+
+        network::bench::loopback_server http1(network::bench::self_signed_context());
+        response = c.get(request(network::uri(http1.url()))).get();
+        NETWORK_CHECK(response.status() == status::code::ok);
+        NETWORK_CHECK(response.version() == "1.1");
+        response = c.get(request(network::uri(http1.url()))).get();
+        NETWORK_CHECK(http1.requests() == 2);
+        NETWORK_CHECK(http1.accepted() == 1);
+    }
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+
+    /* concurrent requests share one connection; answers in reverse order reach the right callers */
+    void multiplexing() {
+        const std::size_t count = 8;
+        h2_server server;
+        std::vector<h2_server::stream_request> held;
+        server.handler([&held, count] (h2_server::connection &connection, const h2_server::stream_request &req) {
+                held.push_back(req);
+                if (held.size() == count) {
+                    for (auto it = held.rbegin(); it != held.rend(); ++it) {
+                        connection.respond(it->id, 200, it->header(":path"));
+                    }
+                }
+            });
+
+        client c(h2_options());
+        std::vector<std::future<response> > futures;
+        for (std::size_t i = 0; i < count; ++i) {
+            futures.push_back(c.get(get(server, "/" + std::to_string(i))));
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            auto response = futures[i].get();
+            NETWORK_CHECK(response.status() == status::code::ok);
+            NETWORK_CHECK(body_of(response) == "/" + std::to_string(i));
+        }
+        auto stats = server.statistics();
+        NETWORK_CHECK(stats.connections == 1);
+        NETWORK_CHECK(stats.max_open_streams == count);
+    }
+
+    /* refuses its first piece and is resumed from the test thread */
+    struct paused_sink {
+        paused_sink() : calls(0), paused(false) { }
+
+        client_message::body_sink sink() {
+            return [this] (boost::string_ref data, const client_message::resume_function &resume) {
+                std::lock_guard<std::mutex> lock(mutex);
+                received.append(data.data(), data.size());
+                if (++calls > 1) {
+                    return true;
+                }
+                paused = true;
+                pending = resume;
+                wake.notify_all();
+                return false;
+            };
+        }
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::string received;
+        std::size_t calls;
+        bool paused;
+        client_message::resume_function pending;
+    };
+
+    /*
+     * A paused stream gets no WINDOW_UPDATE and stops at its window, while
+     * another stream of the connection goes on past the connection's
+     * initial window; resuming lets the first one finish.
+     */
+    void flow_control() {
+        const std::string held_body = pattern(4 * 1024 * 1024), free_body = pattern(9 * 1024 * 1024);
+        h2_server server;
+        server.handler([&] (h2_server::connection &connection, const h2_server::stream_request &req) {
+                connection.respond(req.id, 200, req.header(":path") == "/held" ? held_body : free_body);
+            });
+
+        client c(h2_options());
+        paused_sink sink;
+        auto held = c.get(get(server, "/held"), request_options().sink(sink.sink()));
+        {
+            std::unique_lock<std::mutex> lock(sink.mutex);
+            NETWORK_CHECK(sink.wake.wait_for(lock, std::chrono::seconds(5), [&sink] () { return sink.paused; }));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        auto stats = server.statistics();
+        NETWORK_CHECK(stats.data_sent <= 1024 * 1024);
+        NETWORK_CHECK(stats.stream_window_updates == 0);
+
+        /* past half the connection window the client gives it back, with the held stream still short */
+        auto response = c.get(get(server, "/free")).get();
+        NETWORK_CHECK(body_of(response) == free_body);
+        NETWORK_CHECK(held.wait_for(std::chrono::seconds(0)) != std::future_status::ready);
+        auto after = server.statistics();
+        NETWORK_CHECK(after.stream_window_updates > 0);
+        NETWORK_CHECK(after.connection_window_updates > stats.connection_window_updates);
+        NETWORK_CHECK(after.data_sent <= 1024 * 1024 + free_body.size());
+
+        client_message::resume_function resume;
+        {
+            std::lock_guard<std::mutex> lock(sink.mutex);
+            NETWORK_CHECK(sink.calls == 1);
+            resume.swap(sink.pending);
+        }
+        resume();
+        NETWORK_CHECK(held.get().status() == status::code::ok);
+        std::lock_guard<std::mutex> lock(sink.mutex);
+        NETWORK_CHECK(sink.received == held_body);
+        NETWORK_CHECK(server.statistics().connections == 1);
+    }
+
+    /* streams past GOAWAY's last stream were not processed and go to a new connection */
+    void goaway() {
+        h2_server server;
+        std::vector<std::uint32_t> first;
+        server.handler([&first] (h2_server::connection &connection, const h2_server::stream_request &req) {
+                if (connection.index() > 1) {
+                    connection.respond(req.id, 200, "second");
+                    return;
+                }
+                first.push_back(req.id);
+                if (first.size() == 3) {
+                    connection.respond(first[0], 200, "first");
+                    connection.goaway(first[0], h2::error_code::no_error);
+                }
+            });
+
+        client c(h2_options());
+        std::vector<std::future<response> > futures;
+        for (int i = 0; i < 3; ++i) {
+            futures.push_back(c.get(get(server, "/")));
+        }
+        std::vector<std::string> bodies;
+        for (auto &f : futures) {
+            bodies.push_back(body_of(f.get()));
+        }
+        std::sort(bodies.begin(), bodies.end());
+        NETWORK_CHECK((bodies == std::vector<std::string>{ "first", "second", "second" }));
+        auto stats = server.statistics();
+        NETWORK_CHECK(stats.connections == 2);
+        NETWORK_CHECK(stats.requests == 5);
+    }
+
+    /* REFUSED_STREAM is sent again on a new connection, up to max_refusals times */
+    void refused_stream() {
+        h2_server server;
+        std::map<std::string, int> seen;
+        server.handler([&seen] (h2_server::connection &connection, const h2_server::stream_request &req) {
+                std::string path = req.header(":path");
+                if (path == "/always" || seen[path]++ == 0) {
+                    connection.reset(req.id, h2::error_code::refused_stream);
+                    return;
+                }
+                connection.respond(req.id, 200, "accepted");
+            });
+
+        client c(h2_options());
+        auto response = c.get(get(server, "/once")).get();
+        NETWORK_CHECK(body_of(response) == "accepted");
+        auto stats = server.statistics();
+        NETWORK_CHECK(stats.requests == 2);
+        NETWORK_CHECK(stats.connections == 2);
+
+        /* the first try and four more, each refusal closing its connection */
+        auto future = c.get(get(server, "/always"));
+        NETWORK_CHECK(failed(future));
+        stats = server.statistics();
+        NETWORK_CHECK(stats.requests == 2 + 5);
+        NETWORK_CHECK(stats.connections == 2 + 4);
+
+        /* a body is sent again too */
+        request upload = get(server, "/upload");
+        upload.body(std::make_shared<client_message::string_byte_source>(pattern(100 * 1024)));
+        response = c.post(upload).get();
+        NETWORK_CHECK(body_of(response) == "accepted");
+        stats = server.statistics();
+        NETWORK_CHECK(stats.data_received == 2 * 100 * 1024);
+        NETWORK_CHECK(stats.connections == 2 + 4 + 2);
+    }
+
+    /* a header block larger than the client takes ends the connection with ENHANCE_YOUR_CALM */
+    void continuation_flood() {
+        h2_server server;
+        server.handler([] (h2_server::connection &connection, const h2_server::stream_request &req) {
+                if (connection.index() > 1) {
+                    connection.respond(req.id, 200, "calm");
+                    return;
+                }
+                std::string frames;
+                h2::append_frame_header(frames, 1, h2::frame_type::headers, 0, req.id);
+                frames.push_back('\x88');
+                for (int i = 0; i < 5; ++i) {
+                    h2::append_frame_header(frames, h2::default_max_frame_size, h2::frame_type::continuation,
+                        0, req.id);
+                    frames.append(h2::default_max_frame_size, 'a');
+                }
+                connection.raw(frames);
+            });
+
+        client c(h2_options());
+        auto future = c.get(get(server, "/"));
+        NETWORK_CHECK(failed(future));
+        NETWORK_CHECK(eventually([&server] () { return !server.statistics().goaways.empty(); }));
+        NETWORK_CHECK(server.statistics().goaways ==
+            std::vector<std::uint32_t>{ static_cast<std::uint32_t>(h2::error_code::enhance_your_calm) });
+
+        auto response = c.get(get(server, "/")).get();
+        NETWORK_CHECK(body_of(response) == "calm");
+        NETWORK_CHECK(server.statistics().connections == 2);
+    }
+
+    /* trailers after the body are added to the response's headers */
+    void trailers() {
+        h2_server server;
+        server.handler([] (h2_server::connection &connection, const h2_server::stream_request &req) {
+                connection.respond(req.id, 200, "with trailers", { { "x-before", "1" } },
+                    { { "x-checksum", "5d41402a" } });
+            });
+
+        client c(h2_options());
+        auto response = c.get(get(server, "/")).get();
+        NETWORK_CHECK(body_of(response) == "with trailers");
+        NETWORK_CHECK(response.header("x-before") == boost::string_ref("1"));
+        NETWORK_CHECK(response.header("x-checksum") == boost::string_ref("5d41402a"));
+    }
+
+    /*
+     * A server window of 0 holds an upload back until SETTINGS raises it;
+     * the change applies to the stream already open.
+     */
+    void initial_window_size() {
+        h2_server server;
+        server.settings({ { h2::setting::initial_window_size, 0 } });
+        std::shared_ptr<h2_server::connection> opened;
+        std::mutex mutex;
+        server.handler([&] (h2_server::connection &connection, const h2_server::stream_request &req) {
+                if (req.header(":method") == "GET") {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    opened = connection.shared_from_this();
+                }
+                connection.respond(req.id, 200, std::to_string(req.body.size()));
+            });
+
+        client c(h2_options());
+        NETWORK_CHECK(body_of(c.get(get(server, "/")).get()) == "0");
+
+        const std::size_t size = 300 * 1024;
+        request upload = get(server, "/upload");
+        upload.body(std::make_shared<client_message::string_byte_source>(pattern(size)));
+        auto future = c.post(upload);
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        NETWORK_CHECK(server.statistics().data_received == 0);
+        NETWORK_CHECK(future.wait_for(std::chrono::seconds(0)) != std::future_status::ready);
+
+        std::shared_ptr<h2_server::connection> connection;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            connection = opened;
+        }
+        server.post([connection] () {
+                connection->settings({ { h2::setting::initial_window_size, 64 * 1024 } });
+            });
+        auto response = future.get();
+        NETWORK_CHECK(body_of(response) == std::to_string(size));
+        NETWORK_CHECK(server.statistics().data_received == size);
+        NETWORK_CHECK(server.statistics().connections == 1);
+    }
+
+    /* :status must be three digits from 100 to 599, and not 101; anything else resets the stream */
+    void bad_status() {
+        h2_server server;
+        server.handler([] (h2_server::connection &connection, const h2_server::stream_request &req) {
+                std::string path = req.header(":path");
+                connection.send_headers(req.id, { { ":status", path.substr(1) } }, false);
+                connection.send_data(req.id, "body", true);
+            });
+
+        client c(h2_options());
+        const std::vector<std::string> bad = { "2000", "20", "abc", "2x0", "099", "600", "101", "" };
+        for (const auto &status : bad) {
+            auto future = c.get(get(server, "/" + status));
+            NETWORK_CHECK(failed(future));
+        }
+        NETWORK_CHECK(eventually([&server, &bad] () { return server.statistics().resets.size() == bad.size(); }));
+        for (const auto &reset : server.statistics().resets) {
+            NETWORK_CHECK(reset.second == static_cast<std::uint32_t>(h2::error_code::protocol_error));
+        }
+
+        auto response = c.get(get(server, "/200")).get();
+        NETWORK_CHECK(response.status() == status::code::ok);
+        NETWORK_CHECK(body_of(response) == "body");
+        NETWORK_CHECK(server.statistics().connections == 1);
+    }
+} // namespace
+
+int main() {
+    hpack_vectors();
+    prior_knowledge();
+#if defined(NETLIBX_ENABLE_HTTPS)
+    alpn();
+#endif // defined(NETLIBX_ENABLE_HTTPS)
+    multiplexing();
+    flow_control();
+    goaway();
+    refused_stream();
+    continuation_flood();
+    trailers();
+    initial_window_size();
+    bad_status();
+    return network::test::report("http2_test");
+}
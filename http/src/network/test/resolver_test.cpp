@@ -0,0 +1,270 @@
+/*
+ * resolver_cache and async_resolver: the hosts table, positive and negative
+ * TTLs, coalesced lookups, max_entries eviction and queries aborted by the
+ * resolver that started them. Queries never reach the system resolver,
+ * they are answered from a table or held back by the test.
+ */
+#include <map>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/error.hpp>
+#include <network/http/client/connection/async_resolver.hpp>
+#include "check.hpp"
+
+namespace {
+    using namespace network::http::client_connection;
+    using network::test::drain;
+    typedef boost::asio::ip::address address;
+
+    /* answers queries from a table, or holds them until answer() when told to */
+    class table_resolver : public async_resolver {
+    public:
+        table_resolver(boost::asio::io_service &io_service, std::shared_ptr<resolver_cache> cache) :
+            async_resolver(io_service, std::move(cache)),
+            queries(0),
+            hold(false) { }
+
+        void answer(const std::string &host) {
+            auto it = held.find(host);
+            if (it == held.end()) {
+                return;
+            }
+            std::vector<resolve_callback> callbacks = std::move(it->second.second);
+            std::uint16_t port = it->second.first;
+            held.erase(it);
+            for (auto &callback : callbacks) {
+                reply(host, port, callback);
+            }
+        }
+
+        std::map<std::string, address> table;
+        int queries;
+        bool hold;
+
+    protected:
+        void async_query(const std::string &host, std::uint16_t port, resolve_callback callback) override {
+            ++queries;
+            if (hold) {
+                held[host].first = port;
+                held[host].second.push_back(std::move(callback));
+                return;
+            }
+            reply(host, port, callback);
+        }
+
+    private:
+        void reply(const std::string &host, std::uint16_t port, const resolve_callback &callback) {
+            auto it = table.find(host);
+            endpoints resolved;
+            boost::system::error_code ec = boost::asio::error::host_not_found;
+            if (it != table.end()) {
+                resolved.push_back(endpoint(it->second, port));
+                ec = boost::system::error_code();
+            }
+            _io_service.post([callback, ec, resolved] () { callback(ec, resolved); });
+        }
+
+        std::map<std::string, std::pair<std::uint16_t, std::vector<resolve_callback> > > held;
+    };
+
+    struct outcome {
+        outcome() : calls(0) { }
+
+        async_resolver::resolve_callback callback() {
+            return [this] (const boost::system::error_code &e, const async_resolver::endpoints &r) {
+                ++calls;
+                ec = e;
+                resolved = r;
+            };
+        }
+
+        int calls;
+        boost::system::error_code ec;
+        async_resolver::endpoints resolved;
+    };
+
+    const address one = address::from_string("192.0.2.1");
+    const address two = address::from_string("192.0.2.2");
+
+    void hosts_table() {
+        boost::asio::io_service io_service;
+        auto cache = std::make_shared<resolver_cache>();
+        table_resolver resolver(io_service, cache);
+        cache->add_host("Pinned.Example", { one, two });
+
+        outcome pinned;
+        resolver.async_resolve("pinned.example", 8080, pinned.callback());
+        drain(io_service);
+        NETWORK_CHECK(pinned.calls == 1 && !pinned.ec);
+        NETWORK_CHECK(pinned.resolved.size() == 2 && pinned.resolved[0] == async_resolver::endpoint(one, 8080));
+        NETWORK_CHECK(resolver.queries == 0);
+        NETWORK_CHECK(cache->size() == 0);
+
+        cache->remove_host("pinned.example");
+        outcome queried;
+        resolver.async_resolve("pinned.example", 8080, queried.callback());
+        drain(io_service);
+        NETWORK_CHECK(resolver.queries == 1);
+        NETWORK_CHECK(queried.ec == boost::asio::error::host_not_found);
+    }
+
+    void positive_ttl() {
+        boost::asio::io_service io_service;
+        auto cache = std::make_shared<resolver_cache>(16, std::chrono::milliseconds(100), std::chrono::milliseconds(100));
+        table_resolver resolver(io_service, cache);
+        resolver.table["a.example"] = one;
+
+        outcome first, second, expired;
+        resolver.async_resolve("a.example", 80, first.callback());
+        drain(io_service);
+        resolver.async_resolve("a.example", 443, second.callback());
+        drain(io_service);
+        NETWORK_CHECK(resolver.queries == 1);
+        NETWORK_CHECK(!second.ec && second.resolved.size() == 1 && second.resolved[0] == async_resolver::endpoint(one, 443));
+        NETWORK_CHECK(cache->statistics().hits == 1);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        resolver.async_resolve("a.example", 80, expired.callback());
+        drain(io_service);
+        NETWORK_CHECK(resolver.queries == 2);
+        NETWORK_CHECK(expired.calls == 1 && !expired.ec);
+    }
+
+    void negative_ttl() {
+        boost::asio::io_service io_service;
+        auto cache = std::make_shared<resolver_cache>(16, std::chrono::seconds(60), std::chrono::milliseconds(100));
+        table_resolver resolver(io_service, cache);
+
+        outcome first, second, expired;
+        resolver.async_resolve("missing.example", 80, first.callback());
+        drain(io_service);
+        resolver.async_resolve("missing.example", 80, second.callback());
+        drain(io_service);
+        NETWORK_CHECK(first.ec == boost::asio::error::host_not_found);
+        NETWORK_CHECK(second.ec == boost::asio::error::host_not_found && second.resolved.empty());
+        NETWORK_CHECK(resolver.queries == 1);
+        NETWORK_CHECK(cache->statistics().negative_hits == 1);
+
+        /* the name shows up once the negative entry is gone */
+        resolver.table["missing.example"] = two;
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        resolver.async_resolve("missing.example", 80, expired.callback());
+        drain(io_service);
+        NETWORK_CHECK(resolver.queries == 2);
+        NETWORK_CHECK(!expired.ec && expired.resolved.size() == 1);
+    }
+
+    void coalescing() {
+        boost::asio::io_service io_service;
+        auto cache = std::make_shared<resolver_cache>();
+        table_resolver first(io_service, cache), second(io_service, cache);
+        first.table["c.example"] = one;
+        first.hold = true;
+        second.hold = true;
+
+        const int lookups = 8;
+        std::vector<outcome> outcomes(lookups);
+        for (int i = 0; i < lookups; ++i) {
+            table_resolver &resolver = (i % 2) ? second : first;
+            resolver.async_resolve("c.example", static_cast<std::uint16_t>(1000 + i), outcomes[i].callback());
+        }
+        drain(io_service);
+        NETWORK_CHECK(first.queries == 1 && second.queries == 0);
+        NETWORK_CHECK(cache->statistics().misses == 1);
+        NETWORK_CHECK(cache->statistics().coalesced == lookups - 1);
+        NETWORK_CHECK(outcomes[0].calls == 0);
+
+        first.answer("c.example");
+        drain(io_service);
+        for (int i = 0; i < lookups; ++i) {
+            NETWORK_CHECK(outcomes[i].calls == 1 && !outcomes[i].ec);
+            NETWORK_CHECK(outcomes[i].resolved.size() == 1 &&
+                outcomes[i].resolved[0] == async_resolver::endpoint(one, static_cast<std::uint16_t>(1000 + i)));
+        }
+    }
+
+    void eviction() {
+        boost::asio::io_service io_service;
+        auto cache = std::make_shared<resolver_cache>(2);
+        table_resolver resolver(io_service, cache);
+        resolver.table["a.example"] = one;
+        resolver.table["b.example"] = one;
+        resolver.table["c.example"] = two;
+
+        outcome ignored;
+        for (const char *host : { "a.example", "b.example", "c.example" }) {
+            resolver.async_resolve(host, 80, ignored.callback());
+            drain(io_service);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        NETWORK_CHECK(cache->size() == 2);
+        NETWORK_CHECK(cache->statistics().evicted == 1);
+
+        /* the entry closest to expiry, the oldest, went first */
+        resolver.async_resolve("c.example", 80, ignored.callback());
+        resolver.async_resolve("b.example", 80, ignored.callback());
+        drain(io_service);
+        NETWORK_CHECK(resolver.queries == 3);
+        resolver.async_resolve("a.example", 80, ignored.callback());
+        drain(io_service);
+        NETWORK_CHECK(resolver.queries == 4);
+        NETWORK_CHECK(cache->size() == 2);
+    }
+
+    void abort_on_destroy() {
+        boost::asio::io_service starter_service, waiter_service;
+        auto cache = std::make_shared<resolver_cache>();
+        std::unique_ptr<table_resolver> starter(new table_resolver(starter_service, cache));
+        table_resolver waiter(waiter_service, cache);
+        starter->hold = true;
+        waiter.table["d.example"] = one;
+
+        outcome started, waiting;
+        starter->async_resolve("d.example", 80, started.callback());
+        waiter.async_resolve("d.example", 80, waiting.callback());
+        NETWORK_CHECK(starter->queries == 1 && waiter.queries == 0);
+
+        /* the query dies with its resolver, the other one is told instead of left waiting */
+        starter.reset();
+        drain(waiter_service);
+        drain(starter_service);
+        NETWORK_CHECK(waiting.calls == 1 && waiting.ec == boost::asio::error::operation_aborted);
+        NETWORK_CHECK(started.calls == 0);
+        NETWORK_CHECK(cache->size() == 0);
+
+        /* an aborted query is not cached, the next lookup asks again */
+        outcome again;
+        waiter.async_resolve("d.example", 80, again.callback());
+        drain(waiter_service);
+        NETWORK_CHECK(waiter.queries == 1);
+        NETWORK_CHECK(again.calls == 1 && !again.ec);
+
+        /* cancel() does the same for a resolver that stays */
+        cache->clear();
+        waiter.hold = true;
+        outcome cancelled;
+        waiter.async_resolve("d.example", 80, cancelled.callback());
+        waiter.cancel();
+        drain(waiter_service);
+        NETWORK_CHECK(cancelled.calls == 1 && cancelled.ec == boost::asio::error::operation_aborted);
+
+        /* a late answer for the cancelled query is dropped */
+        waiter.answer("d.example");
+        drain(waiter_service);
+        NETWORK_CHECK(cancelled.calls == 1);
+        NETWORK_CHECK(cache->size() == 0);
+    }
+} // namespace
+
+int main() {
+    hosts_table();
+    positive_ttl();
+    negative_ttl();
+    coalescing();
+    eviction();
+    abort_on_destroy();
+    return network::test::report("resolver_test");
+}
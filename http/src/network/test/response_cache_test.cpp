@@ -0,0 +1,281 @@
+/*
+ * response_cache: when a stored response is fresh and when it has to be
+ * revalidated (max-age, Age, Expires, the Last-Modified heuristic and
+ * the Cache-Control of both sides), and how a 304 Not Modified is merged
+ * into the stored response. Responses are stored as if they had arrived
+ * some time ago, the cache reads the clock itself.
+ */
+#include <ctime>
+#include <string>
+#include <chrono>
+#include <network/http/client.hpp>
+#include "../bench/loopback_server.hpp"
+#include "check.hpp"
+
+namespace {
+    using namespace network::http;
+    typedef client_message::response_cache cache_type;
+    typedef cache_type::clock clock;
+
+    const std::string url = "http://cache.test/resource";
+
+    std::string http_date(clock::time_point t) {
+        std::time_t seconds = clock::to_time_t(t);
+        std::tm tm;
+        gmtime_r(&seconds, &tm);
+        char buffer[64];
+        std::strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        return buffer;
+    }
+
+    request get() {
+        return request(network::uri(url));
+    }
+
+    /* a 200 with body "hello" that was sent `ago` before now, with a Date to match */
+    response ok(std::chrono::seconds ago = std::chrono::seconds(0)) {
+        response r;
+        r.status(status::code::ok);
+        r.add_header("Date", http_date(clock::now() - ago));
+        r.add_header("Content-Length", "5");
+        r.append_body("hello");
+        return r;
+    }
+
+    /* stores r as received `ago` before now */
+    void store(cache_type &cache, const response &r, std::chrono::seconds ago = std::chrono::seconds(0),
+        const request &req = get()) {
+        auto then = clock::now() - ago;
+        cache.store(req, r, then, then);
+    }
+
+    cache_type::lookup_result lookup(cache_type &cache, const request &req = get()) {
+        cache_type::entry_ptr found;
+        return cache.lookup(req, found);
+    }
+
+    void max_age() {
+        cache_type cache;
+        response r = ok();
+        r.add_header("Cache-Control", "max-age=60");
+        store(cache, r);
+        NETWORK_CHECK(lookup(cache) == cache_type::fresh);
+
+        /* fresh when it arrived two minutes ago, not any more */
+        cache.clear();
+        response old = ok(std::chrono::seconds(120));
+        old.add_header("Cache-Control", "max-age=60");
+        store(cache, old, std::chrono::seconds(120));
+        NETWORK_CHECK(lookup(cache) == cache_type::stale);
+
+        /* the Age the response came with counts: stale on arrival, kept only with a validator */
+        cache.clear();
+        response aged = ok();
+        aged.add_header("Cache-Control", "max-age=60");
+        aged.add_header("Age", "100");
+        store(cache, aged);
+        NETWORK_CHECK(cache.size() == 0);
+        NETWORK_CHECK(lookup(cache) == cache_type::miss);
+        aged.add_header("ETag", "\"v1\"");
+        store(cache, aged);
+        NETWORK_CHECK(lookup(cache) == cache_type::stale);
+
+        /* so does a Date older than its arrival */
+        cache.clear();
+        response late = ok(std::chrono::seconds(100));
+        late.add_header("Cache-Control", "max-age=60");
+        late.add_header("Last-Modified", http_date(clock::now() - std::chrono::hours(1)));
+        store(cache, late);
+        NETWORK_CHECK(lookup(cache) == cache_type::stale);
+
+        auto stats = cache.statistics();
+        NETWORK_CHECK(stats.hits == 1 && stats.revalidations == 3 && stats.misses == 1);
+    }
+
+    void expires() {
+        cache_type cache;
+        response r = ok();
+        r.add_header("Expires", http_date(clock::now() + std::chrono::hours(1)));
+        store(cache, r);
+        NETWORK_CHECK(lookup(cache) == cache_type::fresh);
+
+        /* max-age wins over Expires */
+        cache.clear();
+        response both = ok();
+        both.add_header("Cache-Control", "max-age=0");
+        both.add_header("Expires", http_date(clock::now() + std::chrono::hours(1)));
+        both.add_header("ETag", "\"v1\"");
+        store(cache, both);
+        NETWORK_CHECK(lookup(cache) == cache_type::stale);
+
+        /* an Expires that is no date is in the past */
+        cache.clear();
+        response invalid = ok();
+        invalid.add_header("Expires", "0");
+        store(cache, invalid);
+        NETWORK_CHECK(cache.size() == 0);
+    }
+
+    /* without explicit freshness: a tenth of the time since Last-Modified, at most a day */
+    void heuristic() {
+        cache_type cache;
+        response r = ok();
+        r.add_header("Last-Modified", http_date(clock::now() - std::chrono::hours(100)));
+        store(cache, r);
+        NETWORK_CHECK(lookup(cache) == cache_type::fresh);
+
+        /* ten hours old: its lifetime was a tenth of 100 hours */
+        cache.clear();
+        response old = ok(std::chrono::hours(11));
+        old.add_header("Last-Modified", http_date(clock::now() - std::chrono::hours(111)));
+        store(cache, old, std::chrono::hours(11));
+        NETWORK_CHECK(lookup(cache) == cache_type::stale);
+
+        /* capped at a day */
+        cache.clear();
+        response capped = ok(std::chrono::hours(25));
+        capped.add_header("Last-Modified", http_date(clock::now() - std::chrono::hours(25 + 24 * 30)));
+        store(cache, capped, std::chrono::hours(25));
+        NETWORK_CHECK(lookup(cache) == cache_type::stale);
+
+        /* only for status codes cacheable by default */
+        cache.clear();
+        response found = ok();
+        found.status(status::code::found);
+        found.add_header("Last-Modified", http_date(clock::now() - std::chrono::hours(100)));
+        store(cache, found);
+        NETWORK_CHECK(cache.size() == 0);
+
+        /* neither lifetime nor validators */
+        store(cache, ok());
+        NETWORK_CHECK(cache.size() == 0);
+    }
+
+    void cache_control() {
+        cache_type cache;
+        response r = ok();
+        r.add_header("Cache-Control", "max-age=60");
+        r.add_header("ETag", "\"v1\"");
+        store(cache, r);
+
+        request no_cache = get();
+        no_cache.append_header("Cache-Control", "no-cache");
+        NETWORK_CHECK(lookup(cache, no_cache) == cache_type::stale);
+        request max_age_0 = get();
+        max_age_0.append_header("Cache-Control", "max-age=0");
+        NETWORK_CHECK(lookup(cache, max_age_0) == cache_type::stale);
+        NETWORK_CHECK(lookup(cache) == cache_type::fresh);
+
+        /* no-cache in the response: always revalidated */
+        cache.clear();
+        response revalidate = ok();
+        revalidate.add_header("Cache-Control", "no-cache, max-age=60");
+        revalidate.add_header("ETag", "\"v1\"");
+        store(cache, revalidate);
+        NETWORK_CHECK(lookup(cache) == cache_type::stale);
+
+        cache.clear();
+        response no_store = ok();
+        no_store.add_header("Cache-Control", "max-age=60, no-store");
+        store(cache, no_store);
+        NETWORK_CHECK(cache.size() == 0);
+        request req_no_store = get();
+        req_no_store.append_header("Cache-Control", "no-store");
+        store(cache, r, std::chrono::seconds(0), req_no_store);
+        NETWORK_CHECK(cache.size() == 0);
+    }
+
+    /* a 304 updates the stored headers, keeps the body and what describes it, and restarts the age */
+    void revalidation() {
+        cache_type cache;
+        response stale = ok(std::chrono::seconds(120));
+        stale.add_header("Cache-Control", "max-age=60");
+        stale.add_header("ETag", "\"v1\"");
+        stale.add_header("X-Kept", "old");
+        stale.add_header("X-Replaced", "old");
+        store(cache, stale, std::chrono::seconds(120));
+
+        request req = get();
+        cache_type::entry_ptr found;
+        NETWORK_CHECK(cache.lookup(req, found) == cache_type::stale);
+        NETWORK_CHECK(cache_type::add_validators(req, *found));
+        NETWORK_CHECK(req.header("If-None-Match") == boost::string_ref("\"v1\""));
+
+        response not_modified;
+        not_modified.status(status::code::not_modified);
+        not_modified.add_header("Date", http_date(clock::now()));
+        not_modified.add_header("Cache-Control", "max-age=600");
+        not_modified.add_header("ETag", "\"v1\"");
+        not_modified.add_header("X-Replaced", "new");
+        not_modified.add_header("X-Added", "new");
+        /* describe the 304 itself, not the stored body */
+        not_modified.add_header("Content-Length", "0");
+        not_modified.add_header("Content-Encoding", "gzip");
+
+        auto now = clock::now();
+        response merged = cache.revalidated(found, req, not_modified, now, now);
+        NETWORK_CHECK(merged.status() == status::code::ok);
+        NETWORK_CHECK(std::string(merged.body().data(), merged.body().size()) == "hello");
+        NETWORK_CHECK(merged.header("Content-Length") == boost::string_ref("5"));
+        NETWORK_CHECK(!merged.header("Content-Encoding"));
+        NETWORK_CHECK(merged.header("Cache-Control") == boost::string_ref("max-age=600"));
+        NETWORK_CHECK(merged.header("X-Kept") == boost::string_ref("old"));
+        NETWORK_CHECK(merged.header("X-Replaced") == boost::string_ref("new"));
+        NETWORK_CHECK(merged.header("X-Added") == boost::string_ref("new"));
+        NETWORK_CHECK(merged.header("Age") == boost::string_ref("0"));
+        std::size_t replaced = 0;
+        for (auto field : merged.headers()) {
+            replaced += field.first == "X-Replaced" || field.first == "Cache-Control";
+        }
+        NETWORK_CHECK(replaced == 2);
+
+        /* the entry itself was refreshed */
+        NETWORK_CHECK(lookup(cache) == cache_type::fresh);
+        NETWORK_CHECK(cache.size() == 1);
+        NETWORK_CHECK(cache.statistics().revalidated == 1);
+
+        /* a 304 that forbids storing drops the entry, the merged response is still served */
+        NETWORK_CHECK(cache.lookup(req, found) == cache_type::fresh);
+        response no_store;
+        no_store.status(status::code::not_modified);
+        no_store.add_header("Cache-Control", "no-store");
+        merged = cache.revalidated(found, req, no_store, now, now);
+        NETWORK_CHECK(std::string(merged.body().data(), merged.body().size()) == "hello");
+        NETWORK_CHECK(cache.size() == 0);
+    }
+
+    /* the same through the client: the second request asks with the ETag and gets the stored body */
+    void client_revalidation() {
+        network::bench::loopback_server server;
+        server.cache_control("max-age=0");
+        auto cache = std::make_shared<cache_type>();
+        client c(client_options().response_cache(cache));
+
+        auto first = c.get(request(network::uri(server.url()))).get();
+        auto second = c.get(request(network::uri(server.url()))).get();
+        NETWORK_CHECK(second.status() == status::code::ok);
+        NETWORK_CHECK(std::string(second.body().data(), second.body().size()) ==
+            std::string(first.body().data(), first.body().size()));
+        NETWORK_CHECK(second.header("ETag") == first.header("ETag"));
+        NETWORK_CHECK(server.requests() == 2);
+        auto stats = cache->statistics();
+        NETWORK_CHECK(stats.revalidations == 1 && stats.revalidated == 1);
+
+        /* validators of the caller's own get the 304 as is */
+        request conditional(network::uri(server.url()));
+        conditional.append_header("If-None-Match", std::string(*first.header("ETag")));
+        auto third = c.get(conditional).get();
+        NETWORK_CHECK(third.status() == status::code::not_modified);
+        NETWORK_CHECK(third.body().empty());
+    }
+} // namespace
+
+int main() {
+    max_age();
+    expires();
+    heuristic();
+    cache_control();
+    revalidation();
+    client_revalidation();
+    return network::test::report("response_cache_test");
+}
@@ -0,0 +1,246 @@
+/*
+ * The HTTP/1.1 server over a raw socket: pipelined requests answered out
+ * of order are written in order, a response handle kept past its request
+ * does nothing, a request with both Content-Length and chunked is
+ * refused with 400, and Expect: 100-continue gets its interim response
+ * only when the body is wanted. A short idle timeout ends a connection
+ * the test would otherwise wait on for ever.
+ */
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <boost/asio.hpp>
+#include <network/http/server.hpp>
+#include "check.hpp"
+
+namespace {
+    using namespace network::http;
+    using boost::asio::ip::tcp;
+
+    server_options options() {
+        return server_options().threads(1).max_body(1000).idle_timeout(std::chrono::seconds(2));
+    }
+
+    tcp::endpoint endpoint(const server &s) {
+        return tcp::endpoint(boost::asio::ip::address_v4::loopback(), s.port());
+    }
+
+    /* everything the server sends until it closes the connection */
+    std::string read_all(tcp::socket &socket) {
+        std::string in;
+        char buffer[4096];
+        boost::system::error_code ec;
+        for (;;) {
+            std::size_t n = socket.read_some(boost::asio::buffer(buffer), ec);
+            if (ec) {
+                return in;
+            }
+            in.append(buffer, n);
+        }
+    }
+
+    std::string exchange(const server &s, const std::string &out) {
+        boost::asio::io_service io_service;
+        tcp::socket socket(io_service);
+        socket.connect(endpoint(s));
+        boost::asio::write(socket, boost::asio::buffer(out));
+        return read_all(socket);
+    }
+
+    int count(const std::string &s, const std::string &what) {
+        int n = 0;
+        for (auto i = s.find(what); i != std::string::npos; i = s.find(what, i + 1)) {
+            ++n;
+        }
+        return n;
+    }
+
+    /* answers later than the requests after them, from other threads */
+    void pipelined_order() {
+        std::mutex mutex;
+        std::vector<std::thread> answers;
+        server s("127.0.0.1", 0, [&] (const server_message::request &r, server_message::response response) {
+                std::string path = r.path().to_string();
+                if (path.compare(0, 5, "/slow") != 0) {
+                    response.send(path.substr(1));
+                    return;
+                }
+                int delay = std::stoi(path.substr(5));
+                std::lock_guard<std::mutex> lock(mutex);
+                answers.emplace_back([response, delay, path] () mutable {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+                        response.send(path.substr(1));
+                    });
+            }, options().max_pipeline(2));
+
+        std::string out = exchange(s,
+            "GET /slow100 HTTP/1.1\r\nHost: x\r\n\r\n"
+            "GET /a HTTP/1.1\r\nHost: x\r\n\r\n"
+            "GET /slow50 HTTP/1.1\r\nHost: x\r\n\r\n"
+            "GET /b HTTP/1.1\r\nHost: x\r\n\r\n"
+            "GET /slow10 HTTP/1.1\r\nHost: x\r\n\r\n"
+            "GET /c HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n");
+        NETWORK_CHECK(count(out, "HTTP/1.1 200 OK") == 6);
+        std::vector<std::string> order = { "slow100", "a", "slow50", "b", "slow10", "c" };
+        std::size_t at = 0;
+        for (const auto &body : order) {
+            std::size_t found = out.find("\r\n\r\n" + body, at);
+            NETWORK_CHECK(found != std::string::npos);
+            at = found == std::string::npos ? at : found + 1;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto &t : answers) {
+            t.join();
+        }
+    }
+
+    /* a copy of a sent response stays with its request, not the one that reuses its slot */
+    void stale_handle() {
+        std::mutex mutex;
+        std::unique_ptr<server_message::response> kept, pending;
+        server s("127.0.0.1", 0, [&] (const server_message::request &r, server_message::response response) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (r.path() == "/first") {
+                    kept.reset(new server_message::response(response));
+                    response.send(std::string("one"));
+                } else {
+                    pending.reset(new server_message::response(response));
+                }
+            }, options().max_pipeline(1));
+
+        boost::asio::io_service io_service;
+        tcp::socket socket(io_service);
+        socket.connect(endpoint(s));
+        boost::asio::write(socket, boost::asio::buffer(std::string(
+                    "GET /first HTTP/1.1\r\nHost: x\r\n\r\n"
+                    "GET /second HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n")));
+
+        /* the second request is in the only slot once its handler has run */
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        for (;;) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (pending || std::chrono::steady_clock::now() > deadline) {
+                    break;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+
+        std::unique_ptr<server_message::response> first, second;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            first = std::move(kept);
+            second = std::move(pending);
+        }
+        NETWORK_CHECK(first && second);
+        if (!first || !second) {
+            return;
+        }
+        NETWORK_CHECK(first->sent());
+        NETWORK_CHECK(!second->sent());
+        first->status(status::bad_request).header("X-Stale", "1");
+        first->send(std::string("stale"));
+        NETWORK_CHECK(!second->sent());
+        second->send(std::string("two"));
+        NETWORK_CHECK(second->sent());
+        first.reset();
+        second.reset();
+
+        std::string out = read_all(socket);
+        NETWORK_CHECK(count(out, "HTTP/1.1 200 OK") == 2);
+        NETWORK_CHECK(out.find("one") != std::string::npos && out.find("one") < out.find("two"));
+        NETWORK_CHECK(out.find("stale") == std::string::npos);
+        NETWORK_CHECK(out.find("X-Stale") == std::string::npos);
+        NETWORK_CHECK(out.find("400") == std::string::npos);
+    }
+
+    /* both framings at once could be read two ways, the request is refused and the connection closed */
+    void content_length_and_chunked() {
+        std::atomic<int> handled(0);
+        server s("127.0.0.1", 0, [&handled] (const server_message::request &r, server_message::response response) {
+                ++handled;
+                response.send(r.body());
+            }, options());
+
+        std::string out = exchange(s,
+            "POST /echo HTTP/1.1\r\nHost: x\r\nContent-Length: 5\r\nTransfer-Encoding: chunked\r\n\r\n"
+            "5\r\nhello\r\n0\r\n\r\n"
+            "GET /after HTTP/1.1\r\nHost: x\r\n\r\n");
+        NETWORK_CHECK(out.compare(0, 24, "HTTP/1.1 400 Bad Request") == 0);
+        NETWORK_CHECK(count(out, "HTTP/1.1 ") == 1);
+        NETWORK_CHECK(out.find("Connection: close") != std::string::npos);
+        NETWORK_CHECK(handled == 0);
+
+        /* the same after a good request on the connection: that one is answered first */
+        out = exchange(s,
+            "POST /echo HTTP/1.1\r\nHost: x\r\nContent-Length: 2\r\n\r\nok"
+            "POST /echo HTTP/1.1\r\nHost: x\r\nTransfer-Encoding: chunked\r\nContent-Length: 5\r\n\r\n"
+            "5\r\nhello\r\n0\r\n\r\n");
+        NETWORK_CHECK(out.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+        NETWORK_CHECK(out.find("\r\n\r\nok") < out.find("HTTP/1.1 400 Bad Request"));
+        NETWORK_CHECK(out.find("hello") == std::string::npos);
+        NETWORK_CHECK(handled == 1);
+    }
+
+    void expect_continue() {
+        server s("127.0.0.1", 0, [] (const server_message::request &r, server_message::response response) {
+                response.send("got " + r.body());
+            }, options());
+
+        boost::asio::io_service io_service;
+        char buffer[512];
+        {
+            /* the interim response comes before the body is sent */
+            tcp::socket socket(io_service);
+            socket.connect(endpoint(s));
+            boost::asio::write(socket, boost::asio::buffer(std::string(
+                        "POST /echo HTTP/1.1\r\nHost: x\r\nExpect: 100-continue\r\nContent-Length: 2\r\n\r\n")));
+            std::size_t n = socket.read_some(boost::asio::buffer(buffer));
+            NETWORK_CHECK(std::string(buffer, n) == "HTTP/1.1 100 Continue\r\n\r\n");
+            boost::asio::write(socket, boost::asio::buffer(std::string("hi")));
+            n = socket.read_some(boost::asio::buffer(buffer));
+            std::string response(buffer, n);
+            NETWORK_CHECK(response.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+            NETWORK_CHECK(response.find("\r\n\r\ngot hi") != std::string::npos);
+        }
+
+        /* a body too large is refused without asking for it */
+        std::string out = exchange(s,
+            "POST /echo HTTP/1.1\r\nHost: x\r\nExpect: 100-continue\r\nContent-Length: 5000\r\n\r\n");
+        NETWORK_CHECK(out.find("100 Continue") == std::string::npos);
+        NETWORK_CHECK(out.compare(0, 12, "HTTP/1.1 413") == 0);
+
+        /* nothing to continue with */
+        out = exchange(s,
+            "POST /echo HTTP/1.1\r\nHost: x\r\nExpect: 100-continue\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        NETWORK_CHECK(out.find("100 Continue") == std::string::npos);
+        NETWORK_CHECK(out.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+
+        /*
+         * A client that sends the body without waiting: the server skips
+         * the interim response when the body is read with the head, and
+         * may only send it before the final one otherwise.
+         */
+        out = exchange(s,
+            "POST /echo HTTP/1.1\r\nHost: x\r\nExpect: 100-continue\r\nContent-Length: 2\r\n\r\nhi"
+            "GET /echo HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n");
+        NETWORK_CHECK(count(out, "HTTP/1.1 200 OK") == 2);
+        NETWORK_CHECK(count(out, "100 Continue") == 0 ||
+            (count(out, "100 Continue") == 1 && out.compare(0, 25, "HTTP/1.1 100 Continue\r\n\r\n") == 0));
+        NETWORK_CHECK(out.find("got hi") < out.find("Connection: close"));
+    }
+} // namespace
+
+int main() {
+    pipelined_order();
+    stale_handle();
+    content_length_and_chunked();
+    expect_continue();
+    return network::test::report("server_test");
+}
@@ -0,0 +1,147 @@
+/*
+ * Response bodies streamed to a sink: a sink that returns false stops the
+ * reads until it calls resume, from another thread here, and then gets
+ * the held-back data in order without anything lost or repeated.
+ */
+#include <mutex>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <condition_variable>
+#include <network/http/client.hpp>
+#include "../bench/loopback_server.hpp"
+#include "check.hpp"
+
+namespace {
+    using namespace network::http;
+
+    /* more than the socket buffers of both ends hold, so the server has to wait */
+    const std::size_t body_size = 16 * 1024 * 1024;
+
+    std::string pattern(std::size_t size) {
+        std::string body(size, '\0');
+        for (std::size_t i = 0; i < size; ++i) {
+            body[i] = static_cast<char>('a' + (i * 7 + i / 4096) % 26);
+        }
+        return body;
+    }
+
+    /* refuses every `every`th piece, the test thread resumes it */
+    struct paused_sink {
+        explicit paused_sink(std::size_t every) :
+            every(every), calls(0), calls_while_paused(0), pauses(0), paused(false) { }
+
+        client_message::body_sink sink() {
+            return [this] (boost::string_ref data, const client_message::resume_function &resume) {
+                std::lock_guard<std::mutex> lock(mutex);
+                received.append(data.data(), data.size());
+                ++calls;
+                if (paused) {
+                    ++calls_while_paused;
+                }
+                if ((calls - 1) % every != 0) {
+                    return true;
+                }
+                ++pauses;
+                paused = true;
+                pending = resume;
+                wake.notify_all();
+                return false;
+            };
+        }
+
+        /* the resume function of the next pause, empty after the timeout */
+        client_message::resume_function wait_for_pause(std::chrono::milliseconds timeout) {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait_for(lock, timeout, [this] () { return paused; });
+            client_message::resume_function resume;
+            if (paused) {
+                resume.swap(pending);
+                paused = false;
+            }
+            return resume;
+        }
+
+        std::size_t every;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::string received;
+        std::size_t calls;
+        std::size_t calls_while_paused;
+        std::size_t pauses;
+        bool paused;
+        client_message::resume_function pending;
+    };
+
+    void pause_and_resume() {
+        network::bench::loopback_server server;
+        const std::string body = pattern(body_size);
+        server.body(body);
+
+        client c;
+        paused_sink sink(64);
+        auto future = c.get(request(network::uri(server.url())), request_options().sink(sink.sink()));
+
+        /* the first piece pauses the exchange: nothing more arrives and the server stalls */
+        client_message::resume_function resume = sink.wait_for_pause(std::chrono::seconds(5));
+        NETWORK_CHECK(static_cast<bool>(resume));
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        std::size_t held_at;
+        {
+            std::lock_guard<std::mutex> lock(sink.mutex);
+            NETWORK_CHECK(sink.calls == 1);
+            held_at = sink.received.size();
+        }
+        NETWORK_CHECK(future.wait_for(std::chrono::seconds(0)) != std::future_status::ready);
+        NETWORK_CHECK(server.bytes_sent() < body_size);
+
+        /* each resume comes from this thread, not the client's */
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+        while (resume) {
+            resume();
+            resume = nullptr;
+            while (!resume && future.wait_for(std::chrono::seconds(0)) != std::future_status::ready &&
+                std::chrono::steady_clock::now() < deadline) {
+                resume = sink.wait_for_pause(std::chrono::milliseconds(10));
+            }
+        }
+
+        auto response = future.get();
+        NETWORK_CHECK(response.status() == status::code::ok);
+        NETWORK_CHECK(response.body().empty());
+
+        std::lock_guard<std::mutex> lock(sink.mutex);
+        NETWORK_CHECK(sink.received.size() > held_at);
+        NETWORK_CHECK(sink.received.size() == body.size());
+        NETWORK_CHECK(sink.received == body);
+        NETWORK_CHECK(sink.pauses > 2);
+        NETWORK_CHECK(sink.calls_while_paused == 0);
+    }
+
+    /* the same body without pauses, and the next request reuses the connection */
+    void no_pause() {
+        network::bench::loopback_server server;
+        const std::string body = pattern(256 * 1024);
+        server.body(body);
+
+        client c;
+        std::string received;
+        auto sink = [&received] (boost::string_ref data, const client_message::resume_function &) {
+            received.append(data.data(), data.size());
+            return true;
+        };
+        for (int i = 0; i < 2; ++i) {
+            received.clear();
+            auto response = c.get(request(network::uri(server.url())), request_options().sink(sink)).get();
+            NETWORK_CHECK(response.status() == status::code::ok);
+            NETWORK_CHECK(received == body);
+        }
+        NETWORK_CHECK(server.accepted() == 1);
+    }
+} // namespace
+
+int main() {
+    pause_and_resume();
+    no_pause();
+    return network::test::report("sink_test");
+}